@@ -62,6 +62,9 @@ namespace HIP {
     // Resources
     //#**********************************************************************
 
+    QString getResolvedFileName (const QString& name);
+    QByteArray getResourceKey (const QString& name);
+
     template<class T>
     T loadResource (const QString& name)
     {
@@ -73,6 +76,9 @@ namespace HIP {
 
     template<>
     QImage loadResource (const QString& name);
+
+    template<>
+    QByteArray loadResource (const QString& name);
   }
 }
 
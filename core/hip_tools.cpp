@@ -8,7 +8,10 @@
 #include "core/HIPException.h"
 
 #include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QFile>
+#include <QFileInfo>
 #include <QImage>
 #include <QTextStream>
 #include <QDebug>
@@ -17,41 +20,64 @@ namespace HIP {
   namespace Tools {
 
     //#************************************************************************
-    // Local functions
+    // CLASS HIP::Tools
     //#************************************************************************
 
-    namespace {
-
-      /*
-       * Return file name resolved to access either an resource file or some file
-       * from the local file system
-       */
-      QString getResolvedFileName (const QString& name)
-      {
-        QString resolved = name.trimmed ();
-        if (!resolved.startsWith (':'))
-          {
-            resolved = QCoreApplication::applicationDirPath () + "/" + name.trimmed ();
+    /*! Convert QQmlError to string */
+    QString toString (const QQmlError& error)
+    {
+      return error.toString ();
+    }
 
-            // XXX
-            resolved.replace (QString ("hippopunktur-build-debug/debug"), QString ("hippopunktur"));
-            resolved.replace (QString ("hippopunktur-build-release/release"), QString ("hippopunktur"));
-          }
+    /*!
+     * Return file name resolved to access either an resource file or some file
+     * from the local file system
+     *
+     * Relative paths are resolved against the application directory, absolute
+     * paths are used as they are.
+     */
+    QString getResolvedFileName (const QString& name)
+    {
+      QString resolved = name.trimmed ();
+      if (!resolved.startsWith (':') && QFileInfo (resolved).isRelative ())
+        {
+          resolved = QCoreApplication::applicationDirPath () + "/" + name.trimmed ();
 
-        return resolved;
-      }
+          // XXX
+          resolved.replace (QString ("hippopunktur-build-debug/debug"), QString ("hippopunktur"));
+          resolved.replace (QString ("hippopunktur-build-release/release"), QString ("hippopunktur"));
+        }
 
+      return resolved;
     }
 
+    /*!
+     * Compute key identifying the current state of a resource file
+     *
+     * The key is built from the resolved path, the file size and the modification
+     * time. Resource files do not have a reliable modification time, so their content
+     * is hashed instead. Used to check if cache files derived from a resource are
+     * still up to date.
+     */
+    QByteArray getResourceKey (const QString& name)
+    {
+      QString resolved = getResolvedFileName (name);
+      QFileInfo info (resolved);
 
-    //#************************************************************************
-    // CLASS HIP::Tools
-    //#************************************************************************
+      QCryptographicHash hash (QCryptographicHash::Md5);
+      hash.addData (resolved.toUtf8 ());
+      hash.addData (QByteArray::number (info.size ()));
 
-    /*! Convert QQmlError to string */
-    QString toString (const QQmlError& error)
-    {
-      return error.toString ();
+      if (resolved.startsWith (':'))
+        {
+          QFile file (resolved);
+          if (file.open (QIODevice::ReadOnly))
+            hash.addData (&file);
+        }
+      else
+        hash.addData (QByteArray::number (info.lastModified ().toMSecsSinceEpoch ()));
+
+      return hash.result ();
     }
 
     /*! Load string resource either from resource file or from the local file system */
@@ -70,6 +96,21 @@ namespace HIP {
       return text;
     }
 
+    /*! Load raw binary resource either from resource file or from the local file system */
+    template <>
+    QByteArray loadResource<QByteArray> (const QString& name)
+    {
+      QFile file (getResolvedFileName (name));
+
+      if (!file.open (QFile::ReadOnly))
+        throw Exception (QObject::tr ("Unable to open resource file '%1'").arg (name));
+
+      QByteArray data = file.readAll ();
+
+      file.close ();
+      return data;
+    }
+
     /*! Load image resource either from resource file or from the local file system*/
     template <>
     QImage loadResource<QImage> (const QString& name)
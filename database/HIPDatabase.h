@@ -7,15 +7,31 @@
 #ifndef __HIPDatabase_h__
 #define __HIPDatabase_h__
 
+#include "database/HIPDatabaseFilterIndex.h"
+#include "database/HIPDatabaseSpatialIndex.h"
+#include "database/HIPDatabaseTextIndex.h"
+#include "gl/HIPGLBoundingVolumeHierarchy.h"
+#include "gl/HIPGLGeodesics.h"
+
 #include <QObject>
+#include <QBitArray>
 #include <QColor>
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QString>
+#include <QHash>
 #include <QList>
 #include <QMap>
+#include <QPair>
+#include <QSet>
+#include <QSharedDataPointer>
+#include <QSharedPointer>
 #include <QFile>
 #include <QVector3D>
 
 class QDomNode;
+class QIODevice;
+class QXmlStreamReader;
 
 namespace HIP {
 
@@ -25,20 +41,28 @@ namespace HIP {
 
   namespace Database {
 
+    class PointData;
+
     /*!
      * Object keeping the data of a single point
      *
      * A point resembles a complete accupuncture point including the location,
      * description, visualization and state (selection, ...)
+     *
+     * Points are implicitly shared values. Copying a point just increases a
+     * reference count, the data is copied only when a shared point is modified.
+     *
+     * The position is kept as given in the database file, in the coordinates of the
+     * model file. The surface position and normal are the closest location on the model
+     * surface in model coordinates. They are computed when the point is placed onto the
+     * surface and are not stored in the database file.
      */
-    class Point : public QObject
+    class Point
     {
-      Q_OBJECT
-
     public:
       Point ();
       Point (const Point& toCopy);
-      virtual ~Point ();
+      ~Point ();
 
       bool isValid () const;
       bool matches (const QString& tag) const;
@@ -55,6 +79,12 @@ namespace HIP {
       const QVector3D& getPosition () const;
       void setPosition (const QVector3D& position);
 
+      const QVector3D& getSurfacePosition () const;
+      void setSurfacePosition (const QVector3D& position);
+
+      const QVector3D& getSurfaceNormal () const;
+      void setSurfaceNormal (const QVector3D& normal);
+
       const QColor& getColor () const;
       void setColor (const QColor& color);
 
@@ -64,15 +94,17 @@ namespace HIP {
       Point& operator= (const Point& toCopy);
 
     private:
-      QString _id;
-      QString _description;
-      QList<QString> _tags;
-      QVector3D _position;
-      QColor _color;
-
-      bool _selected;
+      QSharedDataPointer<PointData> _data;
     };
 
+  }
+}
+
+Q_DECLARE_TYPEINFO (HIP::Database::Point, Q_MOVABLE_TYPE)
+
+namespace HIP {
+  namespace Database {
+
     /*!
      * Single view of the object consisting of multiple object groups
      *
@@ -96,8 +128,73 @@ namespace HIP {
       QList<QString> _groups;
     };
 
+    class Snapshot;
+
+    /*!
+     * Set of point rows stored as ascending ranges of consecutive rows
+     *
+     * Used as the payload of selection change notifications, so that a change of
+     * many points results in a single notification.
+     */
+    class RowRanges
+    {
+    public:
+      typedef QPair<int, int> Range; // First and last row (inclusive)
+
+    public:
+      RowRanges ();
+
+      bool isEmpty () const                  { return _ranges.isEmpty (); }
+      const QList<Range>& getRanges () const { return _ranges; }
+      int getNumberOfRows () const;
+
+      void add (int row);
+
+    private:
+      QList<Range> _ranges;
+    };
+
+    /*!
+     * Change of a single point
+     *
+     * Used as the payload of point change notifications. If the id of the point
+     * changed, the point might have been moved to another row to keep the points
+     * sorted. The rows in between are shifted by one row then.
+     */
+    class PointChange
+    {
+    public:
+      PointChange ();
+      PointChange (const QString& id, int old_row, int new_row);
+
+      const QString& getId () const { return _id; }
+      int getOldRow () const        { return _old_row; }
+      int getNewRow () const        { return _new_row; }
+      bool isMoved () const         { return _old_row != _new_row; }
+
+    private:
+      QString _id;
+      int _old_row;
+      int _new_row;
+    };
+
     /*!
      * Database keeping all relevant data structures and the related states
+     *
+     * Selection changes are notified with a single 'databaseChanged (SELECTION, ranges)'
+     * signal per operation, where 'ranges' is a 'RowRanges' object containing all
+     * rows whose selection state changed.
+     *
+     * Changes of a single point are notified with 'databaseChanged (POINT, change)',
+     * where 'change' is a 'PointChange' object. The caches are patched for the changed
+     * point only instead of being rebuilt.
+     *
+     * The bounding volume hierarchy of the model is built in the background after
+     * loading. When it is ready, all points are placed onto the model surface and a
+     * 'databaseChanged (PLACEMENT)' signal is emitted. Only the surface positions and
+     * normals changed then, so the point rows stay as they are. Afterwards the geodesic
+     * distance engine is prepared in the background. Surface distances and paths are not
+     * available before, the queries do not wait for it.
      */
     class Database : public QObject
     {
@@ -107,7 +204,7 @@ namespace HIP {
       Database (const Database& toCopy) { Q_UNUSED (toCopy); }
 
     public:
-      struct Reason { enum Type_t { POINT, SELECTION, DATA, FILTER, VIEW }; };
+      struct Reason { enum Type_t { POINT, SELECTION, DATA, FILTER, VIEW, PLACEMENT }; };
       typedef Reason::Type_t Reason_t;
 
     public:
@@ -115,20 +212,32 @@ namespace HIP {
       virtual ~Database ();
 
       void load (const QString& data); // throws Exception
+      void load (QIODevice* device); // throws Exception
+      void load (const QSharedPointer<Snapshot>& snapshot);
+      void loadFile (const QString& path); // throws Exception
 
+      const QString& getName () const;
       const QList<Point>& getPoints () const;
       const QList<QString>& getTags () const;
       const QList<View>& getViews () const;
       const GL::Data* getModel () const;
+      const QString& getModelFile () const;
 
       const Point& getPoint (const QString& id) const;
       void setPoint (const Point& point);
+      void setPoint (const QString& id, const Point& point);
+
+      int findIndex (const QString& id) const;
 
       //
       // Point selection
       //
       void select (const QString& id);
       void deselect (const QString& id);
+
+      void select (const QSet<QString>& ids);
+      void deselect (const QSet<QString>& ids);
+      void setSelection (const QSet<QString>& ids);
       void clearSelection ();
 
       //
@@ -137,6 +246,33 @@ namespace HIP {
       const QString& getFilter () const;
       void setFilter (const QString& filter);
 
+      const QBitArray& getFilterMatches () const;
+      bool isFilterNarrowed () const;
+      const FilterIndex& getFilterIndex () const;
+
+      QBitArray match (const QString& text) const;
+
+      //
+      // Full text search in point descriptions
+      //
+      bool isTextIndexReady () const;
+      QList<TextIndex::Match> search (const QString& query) const;
+
+      //
+      // Spatial queries on the point positions
+      //
+      QList<SpatialIndex::Match> findNearest (const QVector3D& position, int count) const;
+      QList<SpatialIndex::Match> findInRadius (const QVector3D& position, float radius) const;
+      QList<QString> findInBox (const QVector3D& minimum, const QVector3D& maximum) const;
+
+      //
+      // Distances and paths on the model surface
+      //
+      bool isGeodesicsReady () const;
+      float computeSurfaceDistance (const QString& from, const QString& to,
+                                    GL::Geodesics::Method_t method=GL::Geodesics::Method::HEAT) const;
+      QVector<QVector3D> computeSurfacePath (const QString& from, const QString& to) const;
+
       //
       // Visible groups
       //
@@ -144,6 +280,10 @@ namespace HIP {
       void setCurrentView (const QString& view);
 
       QString toXML () const;
+      void toXML (QIODevice* device) const;
+
+      void save (const QString& path) const; // throws Exception
+      QFuture<QString> saveAsync (const QString& path) const;
 
       //
       // Signals
@@ -154,12 +294,30 @@ namespace HIP {
       void databaseChanged (Reason_t reason, const QVariant& data);
       void viewChanged (const QVariant& data);
 
+    private slots:
+      void onTextIndexBuilt ();
+      void onHierarchyBuilt ();
+
     private:
-      void computeTags ();
       void computeIndices ();
+      void updateFilterMatches ();
       void throwDOMException (const QDomNode& node, const QString& message) const;
 
-      int findIndex (const QString& id) const;
+      View readView (QXmlStreamReader& in) const;
+      Point readPoint (QXmlStreamReader& in) const;
+      QString readCharacters (QXmlStreamReader& in, const QString& message) const;
+      void throwXMLException (const QXmlStreamReader& in, const QString& message) const;
+      void throwXMLException (qint64 line, const QString& message) const;
+
+      void setContent (const QString& name, QList<Point>& points, const QList<View>& views,
+                       const QString& model_name);
+
+      void changeSelection (const QList<int>& rows, bool selected);
+      bool match (const Point& point, const QString& text) const;
+
+      void placeOnSurface ();
+      void placeOnSurface (Point* point) const;
+      GL::SurfacePoint toSurfacePoint (const QString& id) const;
 
     private:
       //
@@ -168,17 +326,39 @@ namespace HIP {
       QString _name;
 
       QList<Point> _points;
-      QList<QString> _tags;
       QList<View> _views;
 
       GL::Data* _model;
+      QString _model_file;
+      QFutureWatcher<GL::BoundingVolumeHierarchyPtr>* _hierarchy_watcher;
 
       //
-      // Database cached data
+      // Database cached data. Maps point ids to the index in the (sorted) point list.
       //
-      typedef QMap<QString, int> PointIndexMap;
+      typedef QHash<QString, int> PointIndexMap;
       PointIndexMap _point_indices;
 
+      //
+      // Index for point filtering and the matches of the current filter. The flag is set if
+      // the last update of the matches did not add any matching points.
+      //
+      FilterIndex _filter_index;
+      QBitArray _filter_matches;
+      bool _filter_narrowed;
+
+      //
+      // Full text index over the point descriptions. The index is built in the background
+      // after loading. Points changed in the meantime are updated when it is ready.
+      //
+      TextIndexPtr _text_index;
+      QFutureWatcher<TextIndexPtr>* _text_index_watcher;
+      QSet<QString> _pending_text_updates;
+
+      //
+      // Spatial index over the point positions
+      //
+      SpatialIndex _spatial_index;
+
       //
       // Database state
       //
@@ -192,6 +372,8 @@ namespace HIP {
 }
 
 Q_DECLARE_METATYPE (HIP::Database::Point)
+Q_DECLARE_METATYPE (HIP::Database::RowRanges)
+Q_DECLARE_METATYPE (HIP::Database::PointChange)
 Q_DECLARE_METATYPE (HIP::Database::Database::Reason_t)
 
 #endif
@@ -0,0 +1,99 @@
+/*
+ * HIPDatabaseFilterIndex.h - Index for filtering points by id and tag prefixes
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPDatabaseFilterIndex_h__
+#define __HIPDatabaseFilterIndex_h__
+
+#include <QBitArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+namespace HIP {
+  namespace Database {
+
+    class Point;
+
+    /*!
+     * Index for filtering points by id and tag prefixes
+     *
+     * The index keeps the interned list of all tags, a bitset of the matching point
+     * rows per tag and a prefix trie over the case folded point ids and tags. A filter
+     * text resolves to the bitset of all points whose id or any of whose tags start
+     * with the text, which is the same as testing 'Point::matches ()' for each point.
+     *
+     * Each trie node ending a key references the tags and point rows matched by the key,
+     * so a prefix matches all keys in the subtree of its node. Changed points are patched
+     * into the index in place. Keys not matching anything anymore after a change are kept
+     * in the trie until the index is built again.
+     */
+    class FilterIndex
+    {
+    public:
+      FilterIndex ();
+      ~FilterIndex ();
+
+      void build (const QList<Point>& points);
+      void clear ();
+
+      int getNumberOfPoints () const                { return _number_of_points; }
+
+      const QList<QString>& getTags () const        { return _tags; }
+      int getTagId (const QString& tag) const       { return _tag_ids.value (tag, -1); }
+      const QBitArray& getTagPoints (int tag) const { return _tag_points[tag]; }
+
+      void update (int from, int to, const Point& old_point, const QList<Point>& points);
+
+      QBitArray match (const QString& text) const;
+
+      static void moveBit (QBitArray* bits, int from, int to);
+
+    private:
+      /*
+       * Trie node. Siblings are linked in ascending character order.
+       */
+      struct Node
+      {
+        Node (QChar character=QChar ());
+
+        QChar _character;
+        int _first_child;
+        int _next_sibling;
+        int _key;
+      };
+
+      /*
+       * Trie key with the tags and point rows matched by it
+       */
+      struct Key
+      {
+        QVector<int> _tags;
+        QVector<int> _rows;
+      };
+
+      Key& getKey (const QString& text);
+      int findNode (const QString& text) const;
+
+      int addTag (const QString& tag);
+      void removeTag (int tag);
+
+    private:
+      int _number_of_points;
+
+      QList<QString> _tags;
+      QHash<QString, int> _tag_ids;
+      QVector<QBitArray> _tag_points;
+      QVector<int> _tag_counts;
+
+      QVector<Node> _nodes;
+      QVector<Key> _keys;
+    };
+
+  }
+}
+
+#endif
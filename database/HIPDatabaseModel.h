@@ -8,7 +8,9 @@
 #define __HIPDatabaseModel_h__
 
 #include <QAbstractItemModel>
-#include <QSortFilterProxyModel>
+#include <QAbstractProxyModel>
+#include <QItemSelection>
+#include <QVector>
 
 #include "database/HIPDatabase.h"
 
@@ -18,9 +20,17 @@ namespace HIP {
     /*!
      * Proxy model for filtered database access
      *
-     * The sorting model will connect to the database and react on changes in the filter tag setup
+     * The proxy model will connect to the database and react on changes in the filter tag setup.
+     * The rows passing the filter are taken from the filter matches computed by the database.
+     *
+     * Filter changes are applied incrementally: rows leaving or entering the filtered set are
+     * removed or inserted in ranges, so selection and scroll position of attached views are kept.
+     * If the database reports that the new matches are a subset of the previous ones, only the
+     * previously visible rows are checked.
+     *
+     * Single changed points are inserted, removed or moved according to their filter match.
      */
-    class DatabaseFilterProxyModel : public QSortFilterProxyModel
+    class DatabaseFilterProxyModel : public QAbstractProxyModel
     {
       Q_OBJECT
 
@@ -28,14 +38,46 @@ namespace HIP {
       DatabaseFilterProxyModel (const Database* database, QObject* parent);
       virtual ~DatabaseFilterProxyModel ();
 
-    protected:
-      virtual bool filterAcceptsRow (int source_row, const QModelIndex & source_parent) const;
+      virtual void setSourceModel (QAbstractItemModel* model);
+
+      virtual QModelIndex mapToSource (const QModelIndex& proxy_index) const;
+      virtual QModelIndex mapFromSource (const QModelIndex& source_index) const;
+      virtual QItemSelection mapSelectionFromSource (const QItemSelection& selection) const;
+
+      virtual int columnCount (const QModelIndex& parent) const;
+      virtual int rowCount (const QModelIndex& parent) const;
+
+      virtual QModelIndex index (int row, int column, const QModelIndex& parent) const;
+      virtual QModelIndex parent (const QModelIndex& index) const;
 
     private slots:
       void onDatabaseChanged (Database::Reason_t reason, const QVariant& data);
+      void onSourceAboutToBeReset ();
+      void onSourceReset ();
+      void onSourceDataChanged (const QModelIndex& top_left, const QModelIndex& bottom_right, const QVector<int>& roles);
+      void onSourceRowsMoved (const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row);
+
+    private:
+      int getSourceRow (int row) const;
+      int findRow (int source_row) const;
+
+      void computeRows ();
+      void updateRow (int source_row);
+      void updateFilter ();
+      void flushInsertions (QVector<int>& rows);
+      void flushRemovals (int& count);
 
     private:
-      QString _tag;
+      const Database* _database;
+
+      //
+      // Source rows passing the filter in ascending order. During an update, the rows are
+      // split into the already updated part '_rows' and the remaining old rows '_tail',
+      // starting at '_tail_offset'.
+      //
+      QVector<int> _rows;
+      QVector<int> _tail;
+      int _tail_offset;
     };
 
     /*!
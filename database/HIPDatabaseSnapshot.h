@@ -0,0 +1,98 @@
+/*
+ * HIPDatabaseSnapshot.h - Binary snapshot of the points database
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPDatabaseSnapshot_h__
+#define __HIPDatabaseSnapshot_h__
+
+#include "database/HIPDatabase.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+namespace HIP {
+  namespace Database {
+
+    /*!
+     * Binary snapshot of the points database
+     *
+     * The snapshot file keeps the database in a compact, memory mappable layout:
+     * a string table with all ids, tags and descriptions, packed point records
+     * with position and color, the points in their final sort order and an index
+     * mapping each tag to the rows of the points carrying it.
+     *
+     * Strings are not decoded on loading. Each distinct string is copied out of the
+     * mapped file when it is accessed for the first time and shared by all points
+     * referencing it afterwards, so the returned data stays valid after the snapshot
+     * has been closed.
+     */
+    class Snapshot
+    {
+    public:
+      Snapshot ();
+      ~Snapshot ();
+
+      bool load (const QString& path, const QByteArray& key);
+      static bool save (const QString& path, const QByteArray& key, const Database& database);
+
+      static QString getCacheFileName (const QString& source);
+
+      const QString& getName () const        { return _name; }
+      const QString& getModelName () const   { return _model_name; }
+      const QList<View>& getViews () const   { return _views; }
+
+      int getNumberOfPoints () const;
+      Point getPoint (int index) const;
+
+      int getNumberOfTags () const;
+      QString getTag (int index) const;
+      QList<int> getTagRows (int index) const;
+
+    private:
+      struct StringRecord;
+      struct PointRecord;
+      struct TagRecord;
+
+      bool validate () const;
+      const QString& getString (quint32 index) const;
+
+    private:
+      QFile _file;
+
+      QString _name;
+      QString _model_name;
+      QList<View> _views;
+
+      const StringRecord* _strings;
+      quint32 _number_of_strings;
+
+      const QChar* _characters;
+      quint64 _number_of_characters;
+
+      const PointRecord* _points;
+      quint32 _number_of_points;
+
+      const quint32* _references;
+      quint64 _number_of_references;
+
+      const TagRecord* _tags;
+      quint32 _number_of_tags;
+
+      const quint32* _rows;
+      quint64 _number_of_rows;
+
+      mutable QVector<QString> _string_cache;
+    };
+
+    typedef QSharedPointer<Snapshot> SnapshotPtr;
+
+  }
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * HIPDatabaseSpatialIndex.h - Spatial index over point positions
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPDatabaseSpatialIndex_h__
+#define __HIPDatabaseSpatialIndex_h__
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <QVector3D>
+
+namespace HIP {
+  namespace Database {
+
+    class Point;
+
+    /*!
+     * Spatial index over point positions
+     *
+     * The points are sorted into a uniform grid of cubic cells. Only occupied cells are
+     * stored, keyed by their packed cell coordinates, so the grid is unbounded and points
+     * can be added, moved and removed without rebuilding it. The cell size is chosen when
+     * the index is built so that the occupied cells hold a few points each.
+     *
+     * Points are identified by their id, so the index is independent of the point order.
+     * 'build ()' indexes the surface positions of the points, which are given in model
+     * coordinates.
+     */
+    class SpatialIndex
+    {
+    public:
+      typedef QPair<QString, float> Match; // Point id and distance
+
+    public:
+      SpatialIndex ();
+      ~SpatialIndex ();
+
+      void build (const QList<Point>& points);
+      void clear ();
+
+      void add (const QString& id, const QVector3D& position);
+      void remove (const QString& id);
+
+      int getNumberOfPoints () const { return _entry_ids.size (); }
+      float getCellSize () const     { return _cell_size; }
+
+      QList<Match> findNearest (const QVector3D& position, int count) const;
+      QList<Match> findInRadius (const QVector3D& position, float radius) const;
+      QList<QString> findInBox (const QVector3D& minimum, const QVector3D& maximum) const;
+
+    private:
+      typedef quint64 CellKey;
+
+      /*
+       * Indexed point
+       */
+      struct Entry
+      {
+        QString _id;
+        QVector3D _position;
+      };
+
+      /*
+       * Integer cell coordinates
+       */
+      struct Cell
+      {
+        int _x;
+        int _y;
+        int _z;
+      };
+
+      typedef QHash<CellKey, QVector<int> > CellMap;
+
+      Cell computeCell (const QVector3D& position) const;
+      static CellKey computeKey (int x, int y, int z);
+
+      void insert (int entry);
+      void collect (const QVector<int>& entries, const QVector3D& position, float max_distance,
+                    QVector<QPair<float, int> >* candidates) const;
+
+    private:
+      QVector<Entry> _entries;
+      QVector<int> _free_entries;
+      QHash<QString, int> _entry_ids;
+
+      CellMap _cells;
+      float _cell_size;
+      float _inverse_cell_size;
+    };
+
+  }
+}
+
+#endif
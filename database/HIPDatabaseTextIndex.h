@@ -0,0 +1,86 @@
+/*
+ * HIPDatabaseTextIndex.h - Full text index over point descriptions
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPDatabaseTextIndex_h__
+#define __HIPDatabaseTextIndex_h__
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace HIP {
+  namespace Database {
+
+    /*!
+     * Full text index over point descriptions
+     *
+     * Descriptions are split into case folded words, which are kept in an inverted
+     * index mapping each word to the points containing it. A query consists of one or
+     * more words, each matching all indexed words starting with it. Points must match
+     * all query words and are ranked using BM25 scoring.
+     *
+     * Points are identified by their id, so the index is independent of the point order
+     * and single points can be updated without rebuilding the index.
+     */
+    class TextIndex
+    {
+    public:
+      typedef QPair<QString, float> Match; // Point id and score
+
+    public:
+      TextIndex ();
+      ~TextIndex ();
+
+      void add (const QString& id, const QString& text);
+      void remove (const QString& id);
+
+      int getNumberOfDocuments () const { return _document_ids.size (); }
+
+      QList<Match> search (const QString& query) const;
+      bool matches (const QString& id, const QString& query) const;
+
+      static QStringList tokenize (const QString& text);
+
+    private:
+      /*
+       * Occurrence of a word in a single document
+       */
+      struct Posting
+      {
+        int _document;
+        int _frequency;
+      };
+
+      /*
+       * Indexed document
+       */
+      struct Document
+      {
+        QString _id;
+        QStringList _words;
+        int _length;
+      };
+
+    private:
+      QVector<Document> _documents;
+      QVector<int> _free_documents;
+      QHash<QString, int> _document_ids;
+      qint64 _total_length;
+
+      QMap<QString, QVector<Posting> > _postings;
+    };
+
+    typedef QSharedPointer<TextIndex> TextIndexPtr;
+
+  }
+}
+
+#endif
@@ -5,20 +5,36 @@
  */
 
 #include "HIPDatabase.h"
+#include "HIPDatabaseSnapshot.h"
 #include "core/HIPException.h"
+#include "core/HIPTools.h"
 #include "gl/HIPGLData.h"
+#include "gl/HIPGLMesh.h"
 
 #include <QtGlobal>
 
 #include <QColor>
 #include <QDebug>
+#include <QBuffer>
 #include <QDomDocument>
+#include <QElapsedTimer>
 #include <QFile>
-#include <QTime>
+#include <QSaveFile>
+#include <QXmlStreamReader>
 #include <QXmlStreamWriter>
-
-#undef HIP_USE_FAKE_POSITIONS
-#define HIP_USE_FAKE_POSITIONS
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <limits>
+
+#ifdef HIP_PRINT_STATISTICS
+#  if defined (Q_OS_WIN)
+#    include <windows.h>
+#    include <psapi.h>
+#  elif defined (Q_OS_UNIX)
+#    include <sys/resource.h>
+#  endif
+#endif
 
 namespace HIP {
 
@@ -58,6 +74,9 @@ namespace HIP {
       case Database::Database::Reason::VIEW:
         stream << "VIEW";
         break;
+      case Database::Database::Reason::PLACEMENT:
+        stream << "PLACEMENT";
+        break;
       }
 
     return stream;
@@ -112,6 +131,164 @@ namespace HIP {
         static const char* const PATH    = "path";
       }
 
+
+#ifdef HIP_PRINT_STATISTICS
+      /*
+       * Return peak memory usage of the process in bytes
+       *
+       * This is a high water mark. The growth during a load operation is the memory
+       * the loader needed beyond what the process ever used before.
+       */
+      qint64 getPeakMemoryUsage ()
+      {
+#  if defined (Q_OS_WIN)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo (GetCurrentProcess (), &counters, sizeof (counters)))
+          return counters.PeakWorkingSetSize;
+        return 0;
+#  elif defined (Q_OS_MAC)
+        struct rusage usage;
+        return getrusage (RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+#  elif defined (Q_OS_UNIX)
+        struct rusage usage;
+        return getrusage (RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss * 1024 : 0;
+#  else
+        return 0;
+#  endif
+      }
+
+      /* Print loader statistics */
+      void printLoadStatistics (const char* loader, qint64 bytes, int points, qint64 ms, qint64 memory)
+      {
+        double seconds = qMax (ms, qint64 (1)) / 1000.0;
+
+        qDebug () << "* Database:" << loader << "loader";
+        qDebug () << "  " << points << "points," << bytes << "bytes parsed in" << ms << "ms";
+        qDebug () << "  " << points / seconds << "points/s," << bytes / seconds / (1024 * 1024) << "MB/s";
+        qDebug () << "  peak memory growth" << memory / 1024 << "kB";
+      }
+#endif
+
+    }
+
+    //#**********************************************************************
+    // Local functions
+    //#**********************************************************************
+
+    namespace {
+
+      /*
+       * Write XML representation of the database
+       *
+       * Works on copies of the database content only, so it can be called from
+       * other threads.
+       */
+      void writeXML (QIODevice* device, const QString& name, const QString& model_name, const QList<Point>& points)
+      {
+        QXmlStreamWriter out (device);
+        out.setAutoFormatting (true);
+
+        out.writeStartDocument ();
+        out.writeStartElement (Tags::DATABASE);
+        out.writeAttribute (Attributes::VERSION, QString (XML_VERSION));
+        out.writeAttribute (Attributes::NAME, name);
+
+        out.writeComment (Database::tr ("Model"));
+        out.writeStartElement (Tags::MODEL);
+        out.writeStartElement (Tags::FILE);
+        out.writeCharacters (model_name);
+        out.writeEndElement ();
+        out.writeEndElement ();
+
+        out.writeComment (Database::tr ("List of points"));
+
+        {
+          out.writeStartElement (Tags::POINTS);
+
+          foreach (const Point& point, points)
+            {
+              out.writeStartElement (Tags::POINT);
+              out.writeAttribute (Attributes::ID, point.getId ());
+
+              {
+                out.writeStartElement (Tags::TAGS);
+
+                foreach (const QString& tag, point.getTags ())
+                  {
+                    out.writeStartElement (Tags::TAG);
+                    out.writeAttribute (Attributes::NAME, tag);
+                    out.writeEndElement ();
+                  }
+
+                out.writeEndElement ();
+
+                out.writeStartElement (Tags::POSITION);
+                out.writeAttribute (Attributes::X, QString::number (point.getPosition ().x ()));
+                out.writeAttribute (Attributes::Y, QString::number (point.getPosition ().y ()));
+                out.writeAttribute (Attributes::Z, QString::number (point.getPosition ().z ()));
+                out.writeEndElement ();
+
+                out.writeStartElement (Tags::DESCRIPTION);
+                out.writeCharacters (point.getDescription ());
+                out.writeEndElement ();
+
+                out.writeStartElement (Tags::COLOR);
+                out.writeCharacters (point.getColor ().name ());
+                out.writeEndElement ();
+              }
+
+              out.writeEndElement ();
+            }
+
+          out.writeEndElement ();
+        }
+
+        out.writeEndElement ();
+        out.writeEndDocument ();
+      }
+
+      /*
+       * Write XML representation of the database atomically into a file
+       *
+       * @return Error message or empty string on success
+       */
+      QString saveXML (const QString& path, const QString& name, const QString& model_name, const QList<Point>& points)
+      {
+        QSaveFile file (path);
+        if (!file.open (QIODevice::WriteOnly))
+          return Database::tr ("Unable to write database file '%1': %2").arg (path).arg (file.errorString ());
+
+        writeXML (&file, name, model_name, points);
+
+        if (!file.commit ())
+          return Database::tr ("Unable to write database file '%1': %2").arg (path).arg (file.errorString ());
+
+        return QString ();
+      }
+
+      /*
+       * Build full text index over the point descriptions. Called in a background thread.
+       */
+      TextIndexPtr buildTextIndex (const QList<Point>& points)
+      {
+#ifdef HIP_PRINT_STATISTICS
+        QElapsedTimer timer;
+        timer.start ();
+#endif
+
+        TextIndexPtr index (new TextIndex);
+
+        foreach (const Point& point, points)
+          index->add (point.getId (), point.getDescription ());
+
+#ifdef HIP_PRINT_STATISTICS
+        qDebug () << "* Database: Text index with" << index->getNumberOfDocuments ()
+                  << "descriptions built in" << timer.elapsed () << "ms";
+#endif
+
+        return index;
+      }
+
     }
 
     //#**********************************************************************
@@ -148,30 +325,52 @@ namespace HIP {
 
     }
 
+    //#**********************************************************************
+    // CLASS HIP::Database::PointData
+    //#**********************************************************************
+
+    /*
+     * Shared data of a point
+     */
+    class PointData : public QSharedData
+    {
+    public:
+      PointData ()
+        : _id               (),
+          _description      (),
+          _tags             (),
+          _position         (),
+          _surface_position (),
+          _surface_normal   (),
+          _color            (),
+          _selected         (false)
+      {
+      }
+
+      QString _id;
+      QString _description;
+      QList<QString> _tags;
+      QVector3D _position;
+      QVector3D _surface_position;
+      QVector3D _surface_normal;
+      QColor _color;
+
+      bool _selected;
+    };
+
     //#**********************************************************************
     // CLASS HIP::Database::Point
     //#**********************************************************************
 
     /*! Constructor */
     Point::Point ()
-      : _id          (),
-        _description (),
-        _tags        (),
-        _position    (),
-        _color       (),
-        _selected    (false)
+      : _data (new PointData)
     {
     }
 
     /*! Copy constructor */
     Point::Point (const Point& toCopy)
-      : QObject (),
-        _id          (toCopy._id),
-        _description (toCopy._description),
-        _tags        (toCopy._tags),
-        _position    (toCopy._position),
-        _color       (toCopy._color),
-        _selected    (toCopy._selected)
+      : _data (toCopy._data)
     {
     }
 
@@ -183,7 +382,7 @@ namespace HIP {
     /*! Check if this is a valid point */
     bool Point::isValid () const
     {
-      return !_id.isEmpty ();
+      return !_data->_id.isEmpty ();
     }
 
     /*! Check if the point matches the given tag */
@@ -200,7 +399,7 @@ namespace HIP {
       //
       // Case 2: Check if the tag matches the points name
       //
-      else if (_id.startsWith (tag, Qt::CaseInsensitive))
+      else if (_data->_id.startsWith (tag, Qt::CaseInsensitive))
         match = true;
 
       //
@@ -208,7 +407,7 @@ namespace HIP {
       //
       else
         {
-          foreach (const QString& t, _tags)
+          foreach (const QString& t, _data->_tags)
             if (t.startsWith (tag, Qt::CaseInsensitive))
               match = true;
         }
@@ -216,29 +415,27 @@ namespace HIP {
       return match;
     }
 
-    const QString&        Point::getId ()          const { return _id; }
-    const QString&        Point::getDescription () const { return _description; }
-    const QList<QString>& Point::getTags ()        const { return _tags; }
-    const QVector3D&      Point::getPosition ()    const { return _position; }
-    const QColor&         Point::getColor ()       const { return _color; }
-    bool                  Point::getSelected ()    const { return _selected; }
-
-    void Point::setId          (const QString& id)          { _id = id; }
-    void Point::setDescription (const QString& description) { _description = description; }
-    void Point::setTags        (const QList<QString>& tags) { _tags = tags; }
-    void Point::setPosition    (const QVector3D& position)  { _position = position; }
-    void Point::setColor       (const QColor& color)        { _color = color; }
-    void Point::setSelected    (bool state)                 { _selected = state; }
+    const QString&        Point::getId ()              const { return _data->_id; }
+    const QString&        Point::getDescription ()     const { return _data->_description; }
+    const QList<QString>& Point::getTags ()            const { return _data->_tags; }
+    const QVector3D&      Point::getPosition ()        const { return _data->_position; }
+    const QVector3D&      Point::getSurfacePosition () const { return _data->_surface_position; }
+    const QVector3D&      Point::getSurfaceNormal ()   const { return _data->_surface_normal; }
+    const QColor&         Point::getColor ()           const { return _data->_color; }
+    bool                  Point::getSelected ()        const { return _data->_selected; }
+
+    void Point::setId              (const QString& id)          { _data->_id = id; }
+    void Point::setDescription     (const QString& description) { _data->_description = description; }
+    void Point::setTags            (const QList<QString>& tags) { _data->_tags = tags; }
+    void Point::setPosition        (const QVector3D& position)  { _data->_position = position; }
+    void Point::setSurfacePosition (const QVector3D& position)  { _data->_surface_position = position; }
+    void Point::setSurfaceNormal   (const QVector3D& normal)    { _data->_surface_normal = normal; }
+    void Point::setColor           (const QColor& color)        { _data->_color = color; }
+    void Point::setSelected        (bool state)                 { _data->_selected = state; }
 
     Point& Point::operator= (const Point& toCopy)
     {
-      _id          = toCopy._id;
-      _description = toCopy._description;
-      _tags        = toCopy._tags;
-      _position    = toCopy._position;
-      _color       = toCopy._color;
-      _selected    = toCopy._selected;
-
+      _data = toCopy._data;
       return *this;
     }
 
@@ -263,37 +460,124 @@ namespace HIP {
     void View::addGroup (const QString& group) { _groups.push_back (group); }
 
 
+    //#**********************************************************************
+    // CLASS HIP::Database::RowRanges
+    //#**********************************************************************
+
+    /*! Constructor */
+    RowRanges::RowRanges ()
+      : _ranges ()
+    {
+    }
+
+    /*! Return total number of rows in all ranges */
+    int RowRanges::getNumberOfRows () const
+    {
+      int rows = 0;
+
+      foreach (const Range& range, _ranges)
+        rows += range.second - range.first + 1;
+
+      return rows;
+    }
+
+    /*!
+     * Add row
+     *
+     * Rows must be added in ascending order. Consecutive rows are merged into a
+     * single range.
+     */
+    void RowRanges::add (int row)
+    {
+      Q_ASSERT (_ranges.isEmpty () || row > _ranges.back ().second);
+
+      if (!_ranges.isEmpty () && _ranges.back ().second == row - 1)
+        _ranges.back ().second = row;
+      else
+        _ranges.push_back (Range (row, row));
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::Database::PointChange
+    //#**********************************************************************
+
+    /*! Constructor */
+    PointChange::PointChange ()
+      : _id      (),
+        _old_row (-1),
+        _new_row (-1)
+    {
+    }
+
+    /*!
+     * Constructor
+     *
+     * @param id      Id of the point after the change
+     * @param old_row Row of the point before the change
+     * @param new_row Row of the point after the change
+     */
+    PointChange::PointChange (const QString& id, int old_row, int new_row)
+      : _id      (id),
+        _old_row (old_row),
+        _new_row (new_row)
+    {
+    }
+
+
     //#**********************************************************************
     // CLASS HIP::Database::Database
     //#**********************************************************************
 
     /*! Constructor */
     Database::Database ()
-      : _points        (),
-        _tags          (),
-        _views         (),
-        _model         (0),
-        _point_indices (),
-        _filter        (),
-        _current_view  ()
+      : _points               (),
+        _views                (),
+        _model                (0),
+        _model_file           (),
+        _hierarchy_watcher    (new QFutureWatcher<GL::BoundingVolumeHierarchyPtr> (this)),
+        _point_indices        (),
+        _filter_index         (),
+        _filter_matches       (),
+        _filter_narrowed      (false),
+        _text_index           (),
+        _text_index_watcher   (new QFutureWatcher<TextIndexPtr> (this)),
+        _pending_text_updates (),
+        _spatial_index        (),
+        _filter               (),
+        _current_view         ()
     {
+      connect (_text_index_watcher, SIGNAL (finished ()), SLOT (onTextIndexBuilt ()));
+      connect (_hierarchy_watcher, SIGNAL (finished ()), SLOT (onHierarchyBuilt ()));
     }
 
-    const QList<Point>&   Database::getPoints () const { return _points; }
-    const QList<QString>& Database::getTags ()   const { return _tags; }
-    const QList<View>&    Database::getViews ()  const { return _views; }
-    const GL::Data*       Database::getModel ()  const { return _model; }
+    const QString&        Database::getName ()      const { return _name; }
+    const QList<Point>&   Database::getPoints ()    const { return _points; }
+    const QList<QString>& Database::getTags ()      const { return _filter_index.getTags (); }
+    const QList<View>&    Database::getViews ()     const { return _views; }
+    const GL::Data*       Database::getModel ()     const { return _model; }
+    const QString&        Database::getModelFile () const { return _model_file; }
 
     /*!
      * Load XML based database
      *
+     * The whole document is parsed into a DOM tree first. For large databases,
+     * the streaming variant 'load (QIODevice*)' should be preferred.
+     *
      * @param data XML test containing the database information
      */
     void Database::load (const QString& data)
     {
+#ifdef HIP_PRINT_STATISTICS
+      QElapsedTimer timer;
+      timer.start ();
+
+      qint64 memory = getPeakMemoryUsage ();
+#endif
+
       QString database_name;
       QList<Point> database_points;
-      QList<QString> database_tags;
+      QList<View> database_views;
       QString database_model_name;
 
       QDomDocument doc;
@@ -365,7 +649,7 @@ namespace HIP {
                           view.addGroup (group_e.firstChild ().toCharacterData ().data ());
                         }
 
-                      _views.push_back (view);
+                      database_views.push_back (view);
                     }
                 }
 
@@ -469,249 +753,1055 @@ namespace HIP {
       else
         throw Exception (tr ("Error parsing points database in line %1: %2").arg (error_line).arg (error_message));
 
-      std::sort (database_points.begin (), database_points.end (), PointComparator ());
-
-      //
-      // Load matching GL model file
-      //
-      delete _model;
-      _model = new GL::Data (database_model_name);
-
-      //
-      // At this point everything went OK, loaded data can be assigned
-      //
-      _name = database_name;
-      _points = database_points;
-      _tags = database_tags;
-      _filter = QString ();
-      _current_view = QString ();
+#ifdef HIP_PRINT_STATISTICS
+      printLoadStatistics ("DOM", data.size () * sizeof (QChar), database_points.size (),
+                           timer.elapsed (), getPeakMemoryUsage () - memory);
+#endif
 
-      computeIndices ();
-      computeTags ();
+      std::sort (database_points.begin (), database_points.end (), PointComparator ());
+      setContent (database_name, database_points, database_views, database_model_name);
+    }
 
-#ifdef HIP_USE_FAKE_POSITIONS
-      qsrand (QTime::currentTime ().msec ());
+    /*!
+     * Load XML based database from a device
+     *
+     * The document is parsed in a single pass with a pull parser, so the memory usage
+     * does not depend on the size of the document. The same structure is validated as
+     * with the DOM based loader.
+     *
+     * @param device Opened device delivering the XML document
+     */
+    void Database::load (QIODevice* device)
+    {
+#ifdef HIP_PRINT_STATISTICS
+      QElapsedTimer timer;
+      timer.start ();
 
-      for (int i=0; i < _points.size (); ++i)
-        _points[i].setPosition (_model->getVertices ()[qrand () % _model->getVertices ().size ()]);
+      qint64 memory = getPeakMemoryUsage ();
 #endif
 
-      emit databaseChanged (Reason::DATA, QVariant ());
-    }
+      QString database_name;
+      QList<Point> database_points;
+      QList<View> database_views;
+      QString database_model_name;
 
-    /*! Destructor */
-    Database::~Database ()
-    {
-      delete _model;
-    }
+      QXmlStreamReader in (device);
 
-    /* Access point with the given id */
-    const Point& Database::getPoint (const QString& id) const
-    {
-      Q_ASSERT (_point_indices.contains (id));
-      return _points.at (_point_indices.value (id));
-    }
+      if (!in.readNextStartElement () || in.name () != Tags::DATABASE)
+        {
+          if (in.hasError ())
+            throw Exception (tr ("Error parsing points database in line %1: %2").arg (in.lineNumber ()).arg (in.errorString ()));
 
-    /*! Set point value */
-    void Database::setPoint (const Point& point)
-    {
-      int index = findIndex (point.getId ());
+          throwXMLException (in, tr ("Illegal points database format"));
+        }
 
-      Q_ASSERT (index >= 0 && index < _points.size () && "Adding points is not supported here.");
+      if (!in.attributes ().hasAttribute (Attributes::NAME))
+        throwXMLException (in, tr ("Database name missing"));
 
-      bool selected = _points[index].getSelected ();
-      _points[index] = point;
-      _points[index].setSelected (selected);
+      database_name = in.attributes ().value (Attributes::NAME).toString ();
 
-      std::sort (_points.begin (), _points.end (), PointComparator ());
+      while (in.readNextStartElement ())
+        {
+          //
+          // Load model information
+          //
+          if (in.name () == Tags::MODEL)
+            {
+              qint64 model_line = in.lineNumber ();
+              bool has_file = false;
 
-      computeIndices ();
-      computeTags ();
+              while (in.readNextStartElement ())
+                {
+                  if (in.name () == Tags::FILE && !has_file)
+                    {
+                      database_model_name = readCharacters (in, tr ("Character data expected for file name"));
+                      has_file = true;
+                    }
+                  else
+                    in.skipCurrentElement ();
+                }
 
-      emit databaseChanged (Reason::DATA, QVariant ());
-    }
+              if (!has_file && !in.hasError ())
+                throwXMLException (model_line, tr ("Model entry must have a file name"));
+            }
 
-    /*! Set point selected */
-    void Database::select (const QString& id)
-    {
-      int index = findIndex (id);
-      Q_ASSERT (index >= 0 && index < _points.size ());
+          //
+          // Load view information
+          //
+          else if (in.name () == Tags::VIEWS)
+            {
+              while (in.readNextStartElement ())
+                database_views.push_back (readView (in));
+            }
 
-      Point& point = _points[index];
+          //
+          // Load points
+          //
+          else if (in.name () == Tags::POINTS)
+            {
+              while (in.readNextStartElement ())
+                database_points.push_back (readPoint (in));
+            }
 
-      if (!point.getSelected ())
-        {
-          point.setSelected (true);
-          emit databaseChanged (Reason::SELECTION, qVariantFromValue (point.getId ()));
+          else
+            in.skipCurrentElement ();
         }
-    }
 
-    /*! Set point deselected */
-    void Database::deselect (const QString& id)
-    {
-      int index = findIndex (id);
-      Q_ASSERT (index >= 0 && index < _points.size ());
+      if (in.hasError ())
+        throw Exception (tr ("Error parsing points database in line %1: %2").arg (in.lineNumber ()).arg (in.errorString ()));
 
-      Point& point = _points[index];
+#ifdef HIP_PRINT_STATISTICS
+      printLoadStatistics ("Streaming", device->pos (), database_points.size (),
+                           timer.elapsed (), getPeakMemoryUsage () - memory);
+#endif
 
-      if (point.getSelected ())
-        {
-          point.setSelected (false);
-          emit databaseChanged (Reason::SELECTION, qVariantFromValue (point.getId ()));
-        }
+      std::sort (database_points.begin (), database_points.end (), PointComparator ());
+      setContent (database_name, database_points, database_views, database_model_name);
     }
 
-    /*! Return the current filter configuration */
-    const QString& Database::getFilter () const
+    /*!
+     * Load database from a mapped binary snapshot
+     *
+     * The points are stored in their final order, so no sorting is necessary.
+     *
+     * @param snapshot Successfully loaded snapshot
+     */
+    void Database::load (const QSharedPointer<Snapshot>& snapshot)
     {
-      return _filter;
-    }
+#ifdef HIP_PRINT_STATISTICS
+      QElapsedTimer timer;
+      timer.start ();
+#endif
 
-    /*! Set filter configuration */
-    void Database::setFilter (const QString &filter)
-    {
-      _filter = filter;
-      emit databaseChanged (Reason::FILTER, qVariantFromValue (_filter));
-    }
+      QList<Point> database_points;
+      database_points.reserve (snapshot->getNumberOfPoints ());
 
-    /*! Get currently active view */
-    const QString& Database::getCurrentView () const
-    {
-      return _current_view;
-    }
+      for (int i=0; i < snapshot->getNumberOfPoints (); ++i)
+        database_points.push_back (snapshot->getPoint (i));
 
-    /*! Set currently active view */
-    void Database::setCurrentView (const QString& view)
-    {
-      _current_view = view;
-      emit databaseChanged (Reason::VIEW, qVariantFromValue (_current_view));
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "* Database: Snapshot loader";
+      qDebug () << "  " << database_points.size () << "points in" << timer.elapsed () << "ms";
+#endif
+
+      setContent (snapshot->getName (), database_points, snapshot->getViews (), snapshot->getModelName ());
     }
 
-    /*! Clear selection */
-    void Database::clearSelection ()
+    /*!
+     * Load database file
+     *
+     * A binary snapshot of the database is kept in the cache directory. If the snapshot
+     * matches the current state of the file, it is used instead of parsing the XML data.
+     * Otherwise the XML file is loaded and the snapshot is updated.
+     *
+     * @param path Path of the XML database file (resource or local file)
+     */
+    void Database::loadFile (const QString& path)
     {
-      for (int i=0; i < _points.size (); ++i)
-        {
-          Point& point = _points[i];
+      QByteArray key = Tools::getResourceKey (path);
+      QString snapshot_path = Snapshot::getCacheFileName (path);
 
-          if (point.getSelected ())
-            {
-              point.setSelected (false);
-              emit databaseChanged (Reason::SELECTION, qVariantFromValue (point.getId ()));
-            }
+      QSharedPointer<Snapshot> snapshot (new Snapshot);
+      if (snapshot->load (snapshot_path, key))
+        {
+          load (snapshot);
+          return;
         }
-    }
-
-    /*! Emit view changed signal */
-    void Database::emitViewChanged (const QVariant& data)
-    {
-      emit viewChanged (data);
-    }
 
-    /*! Compute list of all existing tags */
-    void Database::computeTags ()
-    {
-      QSet<QString> tags;
-      foreach (const Point& point, _points)
-        tags.unite (point.getTags ().toSet ());
+      QFile file (Tools::getResolvedFileName (path));
+      if (!file.open (QFile::ReadOnly))
+        throw Exception (tr ("Unable to open resource file '%1'").arg (path));
 
-      _tags = tags.toList ();
+      load (&file);
 
-      std::sort (_tags.begin (), _tags.end ());
+      Snapshot::save (snapshot_path, key, *this);
     }
 
-
-    /*! Compute point index list */
-    void Database::computeIndices ()
+    /*
+     * Read 'view' element. The reader must be positioned at the start element.
+     */
+    View Database::readView (QXmlStreamReader& in) const
     {
-      _point_indices.clear ();
+      if (in.name () != Tags::VIEW)
+        throwXMLException (in, tr ("View element expected, but got %1").arg (in.name ().toString ()));
+      if (!in.attributes ().hasAttribute (Attributes::NAME))
+        throwXMLException (in, tr ("View entry does not have an id"));
 
-      for (int i=0; i < _points.size (); ++i)
+      View view;
+      view.setName (in.attributes ().value (Attributes::NAME).toString ());
+
+      while (in.readNextStartElement ())
         {
-          const Point& point = _points[i];
-          _point_indices.insert (point.getId (), i);
+          if (in.name () != Tags::GROUP)
+            throwXMLException (in, tr ("Group element expected, but got %1").arg (in.name ().toString ()));
+
+          view.addGroup (readCharacters (in, tr ("Character data expected for group name")));
         }
+
+      return view;
     }
 
-    /*! Find index of the point matching a given id */
-    int Database::findIndex (const QString &id) const
+    /*
+     * Read 'point' element. The reader must be positioned at the start element.
+     */
+    Point Database::readPoint (QXmlStreamReader& in) const
     {
-      int index = -1;
+      if (in.name () != Tags::POINT)
+        throwXMLException (in, tr ("Point element expected, but got %1").arg (in.name ().toString ()));
+      if (!in.attributes ().hasAttribute (Attributes::ID))
+        throwXMLException (in, tr ("Point entry does not have an id"));
 
-      for (int i=0; i < _points.size () && index == -1; ++i)
-        if (_points[i].getId () == id)
-          index = i;
+      qint64 point_line = in.lineNumber ();
 
-      return index;
-    }
+      Point point;
+      point.setId (in.attributes ().value (Attributes::ID).toString ());
 
-    /*! Generate XML representation of the database */
-    QString Database::toXML () const
-    {
-      QString text;
+      QList<QString> tags;
+      bool has_position = false;
+      bool has_description = false;
+      bool has_color = false;
 
-      QXmlStreamWriter out (&text);
-      out.setAutoFormatting (true);
+      while (in.readNextStartElement ())
+        {
+          //
+          // Category: Point::Tags
+          //
+          if (in.name () == Tags::TAGS)
+            {
+              while (in.readNextStartElement ())
+                {
+                  if (in.name () == Tags::TAG)
+                    {
+                      if (!in.attributes ().hasAttribute (Attributes::NAME))
+                        throwXMLException (in, tr ("Tag entry does not have an name"));
 
-      out.writeStartDocument ();
-      out.writeStartElement (Tags::DATABASE);
-      out.writeAttribute (Attributes::VERSION, QString (XML_VERSION));
-      out.writeAttribute (Attributes::NAME, _name);
+                      tags.push_back (in.attributes ().value (Attributes::NAME).toString ());
+                    }
 
-      out.writeComment (tr ("Model"));
-      out.writeStartElement (Tags::MODEL);
-      out.writeStartElement (Tags::FILE);
-      out.writeCharacters (_model->getName ());
-      out.writeEndElement ();
-      out.writeEndElement ();
+                  in.skipCurrentElement ();
+                }
+            }
 
-      out.writeComment (tr ("List of points"));
+          //
+          // Attribute: Point::Position
+          //
+          else if (in.name () == Tags::POSITION && !has_position)
+            {
+              QXmlStreamAttributes attributes = in.attributes ();
+
+              if (!attributes.hasAttribute (Attributes::X))
+                throwXMLException (in, tr ("Position must specify an x coordinate"));
+              if (!attributes.hasAttribute (Attributes::Y))
+                throwXMLException (in, tr ("Position must specify a y coordinate"));
+              if (!attributes.hasAttribute (Attributes::Z))
+                throwXMLException (in, tr ("Position must specify a z coordinate"));
+
+              bool x_ok = true;
+              bool y_ok = true;
+              bool z_ok = true;
+
+              point.setPosition (QVector3D (attributes.value (Attributes::X).toDouble (&x_ok),
+                                            attributes.value (Attributes::Y).toDouble (&y_ok),
+                                            attributes.value (Attributes::Z).toDouble (&z_ok)));
+
+              if (!x_ok)
+                throwXMLException (in, tr ("X coordinate is not a number"));
+              if (!y_ok)
+                throwXMLException (in, tr ("Y coordinate is not a number"));
+              if (!z_ok)
+                throwXMLException (in, tr ("Z coordinate is not a number"));
+
+              has_position = true;
+              in.skipCurrentElement ();
+            }
 
-      {
-        out.writeStartElement (Tags::POINTS);
-
-        foreach (const Point& point, _points)
-          {
-            out.writeStartElement (Tags::POINT);
-            out.writeAttribute (Attributes::ID, point.getId ());
+          //
+          // Attribute: Point::Description
+          //
+          else if (in.name () == Tags::DESCRIPTION && !has_description)
+            {
+              point.setDescription (readCharacters (in, tr ("Character data expected for point description")));
+              has_description = true;
+            }
 
+          //
+          // Attribute: Point::Color
+          //
+          else if (in.name () == Tags::COLOR && !has_color)
             {
-              out.writeStartElement (Tags::TAGS);
+              qint64 color_line = in.lineNumber ();
+
+              QString color_name = readCharacters (in, tr ("Character data expected for point color"));
+              QColor color (color_name);
+              if (!color.isValid ())
+                throwXMLException (color_line, tr ("Invalid point color '%1'").arg (color_name));
+
+              point.setColor (color);
+              has_color = true;
+            }
+
+          else
+            in.skipCurrentElement ();
+        }
+
+      if (in.hasError ())
+        return point;
+
+      if (!has_position)
+        throwXMLException (point_line, tr ("Point entry does not have a position"));
+      if (!has_description)
+        throwXMLException (point_line, tr ("Point entry does not have a description"));
+      if (!has_color)
+        throwXMLException (point_line, tr ("Point entry does not have a color"));
+
+      point.setTags (tags);
+
+      return point;
+    }
+
+    /*
+     * Read character content of the current element
+     *
+     * @param in      Reader positioned at the start element
+     * @param message Error message if the element does not contain character data
+     */
+    QString Database::readCharacters (QXmlStreamReader& in, const QString& message) const
+    {
+      qint64 line = in.lineNumber ();
+
+      QString text = in.readElementText ();
+      if (text.isEmpty () && !in.hasError ())
+        throwXMLException (line, message);
+
+      return text;
+    }
+
+    /*
+     * Assign loaded database content
+     *
+     * Called by the loaders after everything has been parsed successfully.
+     *
+     * @param points Points in database order. The list is taken over and will be empty afterwards.
+     */
+    void Database::setContent (const QString& name, QList<Point>& points, const QList<View>& views,
+                               const QString& model_name)
+    {
+      //
+      // Load matching GL model file
+      //
+      delete _model;
+      _model = new GL::Data (model_name, GL::Data::Loader::PARALLEL, true);
+      _model_file = model_name;
+
+      //
+      // At this point everything went OK, loaded data can be assigned
+      //
+      _name = name;
+      _points.clear ();
+      _points.swap (points);
+
+      //
+      // Intern tags, so equal tags of different points share their string data
+      //
+      QHash<QString, QString> tag_pool;
 
-              foreach (const QString& tag, point.getTags ())
+      for (int i=0; i < _points.size (); ++i)
+        {
+          QList<QString> point_tags = _points[i].getTags ();
+          bool interned = false;
+
+          for (int j=0; j < point_tags.size (); ++j)
+            {
+              QHash<QString, QString>::const_iterator pos = tag_pool.find (point_tags[j]);
+              if (pos == tag_pool.end ())
+                tag_pool.insert (point_tags[j], point_tags[j]);
+              else if (!pos.value ().isSharedWith (point_tags[j]))
                 {
-                  out.writeStartElement (Tags::TAG);
-                  out.writeAttribute (Attributes::NAME, tag);
-                  out.writeEndElement ();
+                  point_tags[j] = pos.value ();
+                  interned = true;
                 }
+            }
 
-              out.writeEndElement ();
+          if (interned)
+            _points[i].setTags (point_tags);
+        }
 
-              out.writeStartElement (Tags::POSITION);
-              out.writeAttribute (Attributes::X, QString::number (point.getPosition ().x ()));
-              out.writeAttribute (Attributes::Y, QString::number (point.getPosition ().y ()));
-              out.writeAttribute (Attributes::Z, QString::number (point.getPosition ().z ()));
-              out.writeEndElement ();
+      //
+      // The points are placed onto the model surface when the bounding volume hierarchy
+      // has been built in the background. Until then, the positions are just mapped into
+      // model coordinates.
+      //
+      const QMatrix4x4& transform = _model->getTransform ();
 
-              out.writeStartElement (Tags::DESCRIPTION);
-              out.writeCharacters (point.getDescription ());
-              out.writeEndElement ();
+      for (int i=0; i < _points.size (); ++i)
+        _points[i].setSurfacePosition (transform.map (_points[i].getPosition ()));
 
-              out.writeStartElement (Tags::COLOR);
-              out.writeCharacters (point.getColor ().name ());
-              out.writeEndElement ();
+      _views = views;
+      _filter = QString ();
+      _current_view = QString ();
+
+      //
+      // The text index is built in the background. A still running build for the
+      // previous content is not watched anymore.
+      //
+      _text_index.clear ();
+      _pending_text_updates.clear ();
+      _text_index_watcher->setFuture (QtConcurrent::run (buildTextIndex, _points));
+
+      computeIndices ();
+
+      _hierarchy_watcher->setFuture (_model->buildHierarchy ());
+
+      emit databaseChanged (Reason::DATA, QVariant ());
+    }
+
+    /*
+     * Place all points onto the closest location of the model surface
+     *
+     * The point positions are given in the coordinates of the model file and are mapped
+     * into model coordinates first. The surface normal is kept for orienting the pins.
+     * The queries are distributed over all cores. Nothing is done as long as the bounding
+     * volume hierarchy of the model is not ready.
+     */
+    void Database::placeOnSurface ()
+    {
+      const GL::BoundingVolumeHierarchy* hierarchy = _model != 0 ? _model->getHierarchy () : 0;
+      if (hierarchy == 0 || _points.isEmpty ())
+        return;
+
+#ifdef HIP_PRINT_STATISTICS
+      QElapsedTimer timer;
+      timer.start ();
+#endif
+
+      const QMatrix4x4& transform = _model->getTransform ();
+
+      QVector<QVector3D> positions;
+      positions.reserve (_points.size ());
+
+      foreach (const Point& point, _points)
+        positions.push_back (transform.map (point.getPosition ()));
+
+      QVector<GL::Hit> hits = hierarchy->findClosest (positions);
+
+      for (int i=0; i < _points.size (); ++i)
+        if (hits[i].isValid ())
+          {
+            _points[i].setSurfacePosition (hits[i].getPosition ());
+            _points[i].setSurfaceNormal (hits[i].getNormal ());
+          }
+
+#ifdef HIP_PRINT_STATISTICS
+      qint64 elapsed = qMax (timer.nsecsElapsed (), Q_INT64_C (1));
+
+      qDebug () << "* Database: Surface placement";
+      qDebug () << "  " << _points.size () << "points in" << elapsed / 1000000 << "ms,"
+                << qint64 (_points.size () * 1e9 / elapsed) << "points/s";
+#endif
+    }
+
+    /*
+     * Place single point onto the closest location of the model surface
+     *
+     * If the bounding volume hierarchy is still being built, the position is just mapped
+     * into model coordinates. The point is placed together with all others when the build
+     * has finished.
+     */
+    void Database::placeOnSurface (Point* point) const
+    {
+      if (_model == 0)
+        return;
+
+      point->setSurfacePosition (_model->getTransform ().map (point->getPosition ()));
+      point->setSurfaceNormal (QVector3D ());
+
+      const GL::BoundingVolumeHierarchy* hierarchy = _model->getHierarchy ();
+
+      GL::Hit hit;
+      if (hierarchy != 0 && hierarchy->findClosest (point->getSurfacePosition (), &hit))
+        {
+          point->setSurfacePosition (hit.getPosition ());
+          point->setSurfaceNormal (hit.getNormal ());
+        }
+    }
+
+    /*! Destructor */
+    Database::~Database ()
+    {
+      delete _model;
+    }
+
+    /* Access point with the given id */
+    const Point& Database::getPoint (const QString& id) const
+    {
+      int index = findIndex (id);
+      Q_ASSERT (index >= 0);
+
+      return _points.at (index);
+    }
+
+    /*! Set point value */
+    void Database::setPoint (const Point& point)
+    {
+      setPoint (point.getId (), point);
+    }
+
+    /*!
+     * Replace point
+     *
+     * The point is moved to the row matching its new id, so no complete resorting
+     * and reindexing is necessary. The selection state of the replaced point is kept.
+     *
+     * @param id    Id of the point to be replaced
+     * @param point New point value. The id might differ from the replaced one.
+     */
+    void Database::setPoint (const QString& id, const Point& point)
+    {
+      int from = findIndex (id);
+
+      Q_ASSERT (from >= 0 && from < _points.size () && "Adding points is not supported here.");
+      Q_ASSERT ((point.getId () == id || findIndex (point.getId ()) == -1) && "Point ids are not unique.");
+
+      Point old_point = _points[from];
+
+      _points[from] = point;
+      _points[from].setSelected (old_point.getSelected ());
+
+      if (point.getPosition () != old_point.getPosition ())
+        placeOnSurface (&_points[from]);
+      else
+        {
+          _points[from].setSurfacePosition (old_point.getSurfacePosition ());
+          _points[from].setSurfaceNormal (old_point.getSurfaceNormal ());
+        }
+
+      //
+      // Find new row. Apart from the replaced point, the list is still sorted.
+      //
+      PointComparator comparator;
+      int to = from;
+
+      if (from > 0 && comparator (point, _points[from - 1]))
+        to = std::upper_bound (_points.begin (), _points.begin () + from, point, comparator) - _points.begin ();
+      else if (from + 1 < _points.size () && comparator (_points[from + 1], point))
+        to = std::lower_bound (_points.begin () + from + 1, _points.end (), point, comparator) - _points.begin () - 1;
+
+      if (to != from)
+        _points.move (from, to);
+
+      //
+      // Patch point indices of the rows shifted by the move
+      //
+      if (point.getId () != id)
+        _point_indices.remove (id);
+
+      for (int i=qMin (from, to); i <= qMax (from, to); ++i)
+        _point_indices[_points[i].getId ()] = i;
+
+      _filter_index.update (from, to, old_point, _points);
+
+      if (!_text_index.isNull ())
+        {
+          _text_index->remove (id);
+          _text_index->add (point.getId (), point.getDescription ());
+        }
+      else
+        {
+          _pending_text_updates.insert (id);
+          _pending_text_updates.insert (point.getId ());
+        }
+
+      if (point.getId () != id || _points[to].getSurfacePosition () != old_point.getSurfacePosition ())
+        {
+          _spatial_index.remove (id);
+          _spatial_index.add (point.getId (), _points[to].getSurfacePosition ());
+        }
+
+      //
+      // The filter matches of the shifted rows do not change, only the changed point has
+      // to be matched again
+      //
+      FilterIndex::moveBit (&_filter_matches, from, to);
+      _filter_matches.setBit (to, match (_points[to], _filter));
+
+      emit databaseChanged (Reason::POINT, qVariantFromValue (PointChange (point.getId (), from, to)));
+    }
+
+    /*! Set point selected */
+    void Database::select (const QString& id)
+    {
+      int index = findIndex (id);
+      Q_ASSERT (index >= 0 && index < _points.size ());
+
+      changeSelection (QList<int> () << index, true);
+    }
+
+    /*! Set point deselected */
+    void Database::deselect (const QString& id)
+    {
+      int index = findIndex (id);
+      Q_ASSERT (index >= 0 && index < _points.size ());
+
+      changeSelection (QList<int> () << index, false);
+    }
+
+    /*! Add set of points to the selection */
+    void Database::select (const QSet<QString>& ids)
+    {
+      QList<int> rows;
+      rows.reserve (ids.size ());
+
+      foreach (const QString& id, ids)
+        {
+          int index = findIndex (id);
+          Q_ASSERT (index >= 0 && index < _points.size ());
+          rows.push_back (index);
+        }
+
+      changeSelection (rows, true);
+    }
+
+    /*! Remove set of points from the selection */
+    void Database::deselect (const QSet<QString>& ids)
+    {
+      QList<int> rows;
+      rows.reserve (ids.size ());
+
+      foreach (const QString& id, ids)
+        {
+          int index = findIndex (id);
+          Q_ASSERT (index >= 0 && index < _points.size ());
+          rows.push_back (index);
+        }
+
+      changeSelection (rows, false);
+    }
+
+    /*!
+     * Replace selection
+     *
+     * @param ids Ids of the points forming the new selection
+     */
+    void Database::setSelection (const QSet<QString>& ids)
+    {
+      RowRanges changed;
+
+      for (int i=0; i < _points.size (); ++i)
+        {
+          Point& point = _points[i];
+          bool selected = ids.contains (point.getId ());
+
+          if (point.getSelected () != selected)
+            {
+              point.setSelected (selected);
+              changed.add (i);
+            }
+        }
+
+      if (!changed.isEmpty ())
+        emit databaseChanged (Reason::SELECTION, qVariantFromValue (changed));
+    }
+
+    /*
+     * Set selection state of the given rows and notify about all rows actually changed
+     */
+    void Database::changeSelection (const QList<int>& rows, bool selected)
+    {
+      QList<int> sorted_rows = rows;
+      std::sort (sorted_rows.begin (), sorted_rows.end ());
+
+      RowRanges changed;
+
+      foreach (int row, sorted_rows)
+        {
+          Point& point = _points[row];
+
+          if (point.getSelected () != selected)
+            {
+              point.setSelected (selected);
+              changed.add (row);
             }
+        }
 
-            out.writeEndElement ();
+      if (!changed.isEmpty ())
+        emit databaseChanged (Reason::SELECTION, qVariantFromValue (changed));
+    }
+
+    /*! Return the current filter configuration */
+    const QString& Database::getFilter () const
+    {
+      return _filter;
+    }
+
+    /*!
+     * Return rows of the points matching the current filter
+     *
+     * The bitset is updated before the filter change notification is emitted.
+     */
+    const QBitArray& Database::getFilterMatches () const
+    {
+      return _filter_matches;
+    }
+
+    /*!
+     * Check if the last filter change removed matches only
+     *
+     * A longer filter text does not necessarily narrow the matches, because the
+     * description matches of the text index are added to the id and tag matches.
+     * If this flag is set, only the previously matching rows have to be checked.
+     */
+    bool Database::isFilterNarrowed () const
+    {
+      return _filter_narrowed;
+    }
+
+    /*! Return index for point filtering */
+    const FilterIndex& Database::getFilterIndex () const
+    {
+      return _filter_index;
+    }
+
+    /*!
+     * Compute points matching a filter text
+     *
+     * A point matches if its id or any of its tags starts with the text or, as soon as
+     * the text index is available, if its description contains all words of the text.
+     *
+     * @param text Filter text
+     * @return Bitset with one bit per point row
+     */
+    QBitArray Database::match (const QString& text) const
+    {
+      QBitArray matches = _filter_index.match (text);
+
+      if (!_text_index.isNull () && !text.isEmpty ())
+        foreach (const TextIndex::Match& match, _text_index->search (text))
+          {
+            int index = findIndex (match.first);
+            if (index >= 0)
+              matches.setBit (index);
           }
 
-        out.writeEndElement ();
-      }
+      return matches;
+    }
 
-      out.writeEndElement ();
-      out.writeEndDocument ();
+    /*
+     * Check if a single point matches a filter text. Same as testing its bit in the
+     * result of 'match (text)'.
+     */
+    bool Database::match (const Point& point, const QString& text) const
+    {
+      bool result = point.matches (text);
 
-      return text;
+      if (!result && !_text_index.isNull () && !text.isEmpty ())
+        result = _text_index->matches (point.getId (), text);
+
+      return result;
+    }
+
+    /*! Check if the full text index has been built */
+    bool Database::isTextIndexReady () const
+    {
+      return !_text_index.isNull ();
+    }
+
+    /*!
+     * Search point descriptions
+     *
+     * @param query Search text. Each word matches all description words starting with it.
+     * @return Ids of the points matching all words with their score, best matches first.
+     *         The result is empty as long as the text index is not ready.
+     */
+    QList<TextIndex::Match> Database::search (const QString& query) const
+    {
+      return !_text_index.isNull () ? _text_index->search (query) : QList<TextIndex::Match> ();
+    }
+
+    /*!
+     * Find the points nearest to a position
+     *
+     * @param position Position in model coordinates
+     * @param count    Maximum number of points to be returned
+     * @return Ids and distances of the nearest points, sorted by ascending distance
+     */
+    QList<SpatialIndex::Match> Database::findNearest (const QVector3D& position, int count) const
+    {
+      return _spatial_index.findNearest (position, count);
+    }
+
+    /*!
+     * Find all points within a distance to a position
+     *
+     * @param position Position in model coordinates
+     * @param radius   Maximum distance
+     * @return Ids and distances of the matching points, sorted by ascending distance
+     */
+    QList<SpatialIndex::Match> Database::findInRadius (const QVector3D& position, float radius) const
+    {
+      return _spatial_index.findInRadius (position, radius);
+    }
+
+    /*!
+     * Find all points within an axis aligned box
+     *
+     * @param minimum Minimum box corner in model coordinates
+     * @param maximum Maximum box corner in model coordinates
+     * @return Ids of the points inside of the box, unordered
+     */
+    QList<QString> Database::findInBox (const QVector3D& minimum, const QVector3D& maximum) const
+    {
+      return _spatial_index.findInBox (minimum, maximum);
+    }
+
+    /*!
+     * Check if the geodesic distance engine of the model has been prepared
+     *
+     * Surface distances and paths can be computed only if the engine is ready.
+     */
+    bool Database::isGeodesicsReady () const
+    {
+      return _model != 0 && _model->getHierarchy () != 0 && _model->getGeodesics () != 0;
+    }
+
+    /*!
+     * Compute the distance between two points along the model surface
+     *
+     * The distance field of the source point is cached, so computing the distances from
+     * one point to many others is cheap after the first query.
+     *
+     * @param from   Id of the source point
+     * @param to     Id of the target point
+     * @param method Computation method
+     * @return Distance in model coordinates or infinity if the points are not connected
+     *         by the surface or the geodesic distance engine is not ready yet
+     */
+    float Database::computeSurfaceDistance (const QString& from, const QString& to, GL::Geodesics::Method_t method) const
+    {
+      if (!isGeodesicsReady ())
+        return std::numeric_limits<float>::infinity ();
+
+      GL::SurfacePoint source = toSurfacePoint (from);
+      GL::SurfacePoint target = toSurfacePoint (to);
+
+      if (!source.isValid () || !target.isValid ())
+        return std::numeric_limits<float>::infinity ();
+
+      return _model->getGeodesics ()->computeDistance (source, target, method);
+    }
+
+    /*!
+     * Compute the shortest path between two points along the model surface
+     *
+     * @param from Id of the source point
+     * @param to   Id of the target point
+     * @return Path in model coordinates or an empty path if the points are not connected
+     *         by the surface or the geodesic distance engine is not ready yet
+     */
+    QVector<QVector3D> Database::computeSurfacePath (const QString& from, const QString& to) const
+    {
+      if (!isGeodesicsReady ())
+        return QVector<QVector3D> ();
+
+      GL::SurfacePoint source = toSurfacePoint (from);
+      GL::SurfacePoint target = toSurfacePoint (to);
+
+      if (!source.isValid () || !target.isValid ())
+        return QVector<QVector3D> ();
+
+      return _model->getGeodesics ()->computePath (source, target);
+    }
+
+    /*
+     * Locate point on the model surface
+     */
+    GL::SurfacePoint Database::toSurfacePoint (const QString& id) const
+    {
+      int index = findIndex (id);
+      const GL::BoundingVolumeHierarchy* hierarchy = _model != 0 ? _model->getHierarchy () : 0;
+
+      GL::Hit hit;
+      if (index < 0 || hierarchy == 0 || !hierarchy->findClosest (_points[index].getSurfacePosition (), &hit))
+        return GL::SurfacePoint ();
+
+      return GL::SurfacePoint (hit.getTriangle (), hit.getPosition ());
+    }
+
+    /*
+     * Background text index build finished
+     *
+     * Points changed during the build are updated and the filter matches are
+     * recomputed, because description matches might have been added.
+     */
+    void Database::onTextIndexBuilt ()
+    {
+      _text_index = _text_index_watcher->result ();
+
+      foreach (const QString& id, _pending_text_updates)
+        {
+          int index = findIndex (id);
+          if (index >= 0)
+            _text_index->add (id, _points[index].getDescription ());
+          else
+            _text_index->remove (id);
+        }
+
+      _pending_text_updates.clear ();
+
+      if (!_filter.isEmpty ())
+        {
+          updateFilterMatches ();
+          emit databaseChanged (Reason::FILTER, qVariantFromValue (_filter));
+        }
+    }
+
+    /*
+     * Background build of the model bounding volume hierarchy finished
+     *
+     * The points are placed onto the model surface now. Only the surface positions
+     * change, so the point rows are kept. The geodesic distance engine needs the
+     * mesh only, but is prepared after the hierarchy so both builds do not compete
+     * for the cores.
+     */
+    void Database::onHierarchyBuilt ()
+    {
+      placeOnSurface ();
+      _spatial_index.build (_points);
+
+      _model->buildGeodesics ();
+
+      emit databaseChanged (Reason::PLACEMENT, QVariant ());
+    }
+
+    /*! Set filter configuration */
+    void Database::setFilter (const QString &filter)
+    {
+      _filter = filter;
+      updateFilterMatches ();
+
+      emit databaseChanged (Reason::FILTER, qVariantFromValue (_filter));
+    }
+
+    /*! Get currently active view */
+    const QString& Database::getCurrentView () const
+    {
+      return _current_view;
+    }
+
+    /*! Set currently active view */
+    void Database::setCurrentView (const QString& view)
+    {
+      _current_view = view;
+      emit databaseChanged (Reason::VIEW, qVariantFromValue (_current_view));
+    }
+
+    /*! Clear selection */
+    void Database::clearSelection ()
+    {
+      setSelection (QSet<QString> ());
+    }
+
+    /*! Emit view changed signal */
+    void Database::emitViewChanged (const QVariant& data)
+    {
+      emit viewChanged (data);
+    }
+
+    /*!
+     * Compute point index list and filter index
+     *
+     * Must be called whenever the point list is changed or reordered.
+     */
+    void Database::computeIndices ()
+    {
+      _point_indices.clear ();
+      _point_indices.reserve (_points.size ());
+
+      for (int i=0; i < _points.size (); ++i)
+        {
+          const Point& point = _points[i];
+          _point_indices.insert (point.getId (), i);
+        }
+
+      Q_ASSERT (_point_indices.size () == _points.size () && "Point ids are not unique.");
+
+      _filter_index.build (_points);
+      updateFilterMatches ();
+
+      _spatial_index.build (_points);
+    }
+
+    /*
+     * Recompute the matches of the current filter and check if matches have been added
+     */
+    void Database::updateFilterMatches ()
+    {
+      QBitArray matches = match (_filter);
+
+      _filter_narrowed = matches.size () == _filter_matches.size () &&
+        (matches & ~_filter_matches).count (true) == 0;
+
+      _filter_matches = matches;
+    }
+
+    /*!
+     * Find index of the point matching a given id
+     *
+     * @param id Point id
+     * @return Index of the point in the point list or -1 if there is no such point
+     */
+    int Database::findIndex (const QString &id) const
+    {
+      return _point_indices.value (id, -1);
+    }
+
+    /*! Generate XML representation of the database */
+    QString Database::toXML () const
+    {
+      QBuffer buffer;
+      buffer.open (QIODevice::WriteOnly);
+
+      toXML (&buffer);
+
+      return QString::fromUtf8 (buffer.data ());
+    }
+
+    /*!
+     * Write UTF-8 encoded XML representation of the database into a device
+     *
+     * @param device Opened device the document is streamed into
+     */
+    void Database::toXML (QIODevice* device) const
+    {
+      writeXML (device, _name, _model_file, _points);
+    }
+
+    /*!
+     * Save database as XML file
+     *
+     * The file is written into a temporary file first and renamed afterwards, so an
+     * existing file is never left in a partially written state.
+     *
+     * @param path Path of the XML file
+     */
+    void Database::save (const QString& path) const
+    {
+      QString error = saveXML (path, _name, _model_file, _points);
+      if (!error.isEmpty ())
+        throw Exception (error);
+    }
+
+    /*!
+     * Save database as XML file in a background thread
+     *
+     * The points are captured at the time of the call. Later database changes do not
+     * affect the written file.
+     *
+     * @param path Path of the XML file
+     * @return Future delivering the error message or an empty string on success
+     */
+    QFuture<QString> Database::saveAsync (const QString& path) const
+    {
+      return QtConcurrent::run (saveXML, path, _name, _model_file, _points);
     }
 
     /*
@@ -728,6 +1818,24 @@ namespace HIP {
 
     }
 
+    /*
+     * Throw exception with a line numbered message for the current reader position
+     */
+    void Database::throwXMLException (const QXmlStreamReader& in, const QString& message) const
+    {
+      throwXMLException (in.lineNumber (), message);
+    }
+
+    /*
+     * Throw exception with a line numbered message
+     */
+    void Database::throwXMLException (qint64 line, const QString& message) const
+    {
+      throw Exception (tr ("Error in line %1: %2")
+                       .arg (line)
+                       .arg (message));
+    }
+
 
   }
 }
@@ -0,0 +1,378 @@
+/*
+ * hip_database_filter_index.cpp - Index for filtering points by id and tag prefixes
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPDatabaseFilterIndex.h"
+#include "database/HIPDatabase.h"
+
+#include <QSet>
+
+#include <algorithm>
+
+namespace HIP {
+  namespace Database {
+
+    //#**********************************************************************
+    // CLASS HIP::Database::FilterIndex::Node
+    //#**********************************************************************
+
+    /*! Constructor */
+    FilterIndex::Node::Node (QChar character)
+      : _character    (character),
+        _first_child  (-1),
+        _next_sibling (-1),
+        _key          (-1)
+    {
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::Database::FilterIndex
+    //#**********************************************************************
+
+    /*! Constructor */
+    FilterIndex::FilterIndex ()
+      : _number_of_points (0),
+        _tags             (),
+        _tag_ids          (),
+        _tag_points       (),
+        _tag_counts       (),
+        _nodes            (),
+        _keys             ()
+    {
+      clear ();
+    }
+
+    /*! Destructor */
+    FilterIndex::~FilterIndex ()
+    {
+    }
+
+    /*! Clear index */
+    void FilterIndex::clear ()
+    {
+      _number_of_points = 0;
+
+      _tags.clear ();
+      _tag_ids.clear ();
+      _tag_points.clear ();
+      _tag_counts.clear ();
+
+      _nodes.clear ();
+      _nodes.push_back (Node ());
+
+      _keys.clear ();
+    }
+
+    /*!
+     * Build index for the given points
+     *
+     * @param points Points in database order. The bit positions in the resulting bitsets
+     *               are the indices into this list.
+     */
+    void FilterIndex::build (const QList<Point>& points)
+    {
+      clear ();
+
+      _number_of_points = points.size ();
+
+      //
+      // Intern tags. Tag ids are assigned in alphabetical order.
+      //
+      QSet<QString> tag_set;
+      foreach (const Point& point, points)
+        foreach (const QString& tag, point.getTags ())
+          tag_set.insert (tag);
+
+      _tags = tag_set.toList ();
+      std::sort (_tags.begin (), _tags.end ());
+
+      _tag_ids.reserve (_tags.size ());
+      _tag_points.resize (_tags.size ());
+
+      for (int i=0; i < _tags.size (); ++i)
+        {
+          _tag_ids.insert (_tags[i], i);
+          _tag_points[i] = QBitArray (_number_of_points);
+        }
+
+      for (int i=0; i < points.size (); ++i)
+        foreach (const QString& tag, points[i].getTags ())
+          _tag_points[_tag_ids.value (tag)].setBit (i);
+
+      _tag_counts.resize (_tags.size ());
+      for (int i=0; i < _tags.size (); ++i)
+        _tag_counts[i] = _tag_points[i].count (true);
+
+      //
+      // Build trie from the case folded keys. Different ids or tags might fold into the
+      // same key.
+      //
+      _keys.reserve (_tags.size () + points.size ());
+
+      for (int i=0; i < _tags.size (); ++i)
+        getKey (_tags[i].toCaseFolded ())._tags.push_back (i);
+
+      for (int i=0; i < points.size (); ++i)
+        getKey (points[i].getId ().toCaseFolded ())._rows.push_back (i);
+    }
+
+    /*!
+     * Update index for a changed point
+     *
+     * The point might have been moved to another row, the rows in between are shifted
+     * by one row then. Tags which are not used by any point anymore are removed, new
+     * tags are inserted at their alphabetical position, so the ids of the following
+     * tags change.
+     *
+     * @param from      Row of the point before the change
+     * @param to        Row of the point after the change
+     * @param old_point Point before the change
+     * @param points    Points in database order after the change
+     */
+    void FilterIndex::update (int from, int to, const Point& old_point, const QList<Point>& points)
+    {
+      Q_ASSERT (points.size () == _number_of_points);
+      Q_ASSERT (from >= 0 && from < _number_of_points && to >= 0 && to < _number_of_points);
+
+      const Point& new_point = points[to];
+
+      QSet<QString> old_tags = old_point.getTags ().toSet ();
+      QSet<QString> new_tags = new_point.getTags ().toSet ();
+
+      QSet<QString> added_tags = QSet<QString> (new_tags).subtract (old_tags);
+      QSet<QString> removed_tags = QSet<QString> (old_tags).subtract (new_tags);
+
+      //
+      // Patch tags in the old row. Tags kept by the point keep their bit set.
+      //
+      foreach (const QString& tag, removed_tags)
+        {
+          int id = getTagId (tag);
+          Q_ASSERT (id >= 0);
+
+          _tag_points[id].clearBit (from);
+
+          if (--_tag_counts[id] == 0)
+            removeTag (id);
+        }
+
+      foreach (const QString& tag, added_tags)
+        {
+          int id = getTagId (tag);
+          if (id == -1)
+            id = addTag (tag);
+
+          _tag_points[id].setBit (from);
+          ++_tag_counts[id];
+        }
+
+      //
+      // Move the row. The rows of the points in between are shifted by one.
+      //
+      getKey (old_point.getId ().toCaseFolded ())._rows.removeOne (from);
+
+      if (from != to)
+        {
+          for (int i=0; i < _tag_points.size (); ++i)
+            moveBit (&_tag_points[i], from, to);
+
+          int step = from < to ? 1 : -1;
+
+          for (int i=from; i != to; i += step)
+            {
+              QVector<int>& rows = getKey (points[i].getId ().toCaseFolded ())._rows;
+
+              int index = rows.indexOf (i + step);
+              Q_ASSERT (index >= 0);
+
+              rows[index] = i;
+            }
+        }
+
+      getKey (new_point.getId ().toCaseFolded ())._rows.push_back (to);
+    }
+
+    /*!
+     * Move bit to another position
+     *
+     * The bits between the old and the new position are shifted by one position, like the
+     * elements of a list in 'QList::move ()'.
+     *
+     * @param bits Bitset to modify
+     * @param from Old position of the bit
+     * @param to   New position of the bit
+     */
+    void FilterIndex::moveBit (QBitArray* bits, int from, int to)
+    {
+      bool value = bits->testBit (from);
+
+      if (from < to)
+        for (int i=from; i < to; ++i)
+          bits->setBit (i, bits->testBit (i + 1));
+      else
+        for (int i=from; i > to; --i)
+          bits->setBit (i, bits->testBit (i - 1));
+
+      bits->setBit (to, value);
+    }
+
+    /*
+     * Insert tag at its alphabetical position, returns the id of the new tag
+     */
+    int FilterIndex::addTag (const QString& tag)
+    {
+      int id = std::lower_bound (_tags.begin (), _tags.end (), tag) - _tags.begin ();
+
+      _tags.insert (id, tag);
+      _tag_points.insert (id, QBitArray (_number_of_points));
+      _tag_counts.insert (id, 0);
+
+      for (int i=id; i < _tags.size (); ++i)
+        _tag_ids[_tags[i]] = i;
+
+      for (int i=0; i < _keys.size (); ++i)
+        for (int j=0; j < _keys[i]._tags.size (); ++j)
+          if (_keys[i]._tags[j] >= id)
+            ++_keys[i]._tags[j];
+
+      getKey (tag.toCaseFolded ())._tags.push_back (id);
+
+      return id;
+    }
+
+    /*
+     * Remove tag. The ids of the following tags are decreased by one.
+     */
+    void FilterIndex::removeTag (int tag)
+    {
+      getKey (_tags[tag].toCaseFolded ())._tags.removeOne (tag);
+
+      for (int i=0; i < _keys.size (); ++i)
+        for (int j=0; j < _keys[i]._tags.size (); ++j)
+          if (_keys[i]._tags[j] > tag)
+            --_keys[i]._tags[j];
+
+      _tag_ids.remove (_tags[tag]);
+
+      _tags.removeAt (tag);
+      _tag_points.remove (tag);
+      _tag_counts.remove (tag);
+
+      for (int i=tag; i < _tags.size (); ++i)
+        _tag_ids[_tags[i]] = i;
+    }
+
+    /*
+     * Return key for the given case folded text. Missing nodes and the key are created.
+     */
+    FilterIndex::Key& FilterIndex::getKey (const QString& text)
+    {
+      int node = 0;
+
+      for (int i=0; i < text.size (); ++i)
+        {
+          int previous = -1;
+          int child = _nodes[node]._first_child;
+
+          while (child != -1 && _nodes[child]._character < text[i])
+            {
+              previous = child;
+              child = _nodes[child]._next_sibling;
+            }
+
+          if (child == -1 || _nodes[child]._character != text[i])
+            {
+              Node inserted (text[i]);
+              inserted._next_sibling = child;
+
+              child = _nodes.size ();
+              _nodes.push_back (inserted);
+
+              if (previous == -1)
+                _nodes[node]._first_child = child;
+              else
+                _nodes[previous]._next_sibling = child;
+            }
+
+          node = child;
+        }
+
+      if (_nodes[node]._key == -1)
+        {
+          _nodes[node]._key = _keys.size ();
+          _keys.push_back (Key ());
+        }
+
+      return _keys[_nodes[node]._key];
+    }
+
+    /*
+     * Find trie node for the given case folded text, returns -1 if there is none
+     */
+    int FilterIndex::findNode (const QString& text) const
+    {
+      int node = 0;
+
+      for (int i=0; i < text.size () && node != -1; ++i)
+        {
+          int child = _nodes[node]._first_child;
+          while (child != -1 && _nodes[child]._character < text[i])
+            child = _nodes[child]._next_sibling;
+
+          node = child != -1 && _nodes[child]._character == text[i] ? child : -1;
+        }
+
+      return node;
+    }
+
+    /*!
+     * Compute points matching a filter text
+     *
+     * @param text Filter text. An empty text matches all points.
+     * @return Bitset with one bit per point row
+     */
+    QBitArray FilterIndex::match (const QString& text) const
+    {
+      if (text.isEmpty ())
+        return QBitArray (_number_of_points, true);
+
+      QBitArray result (_number_of_points);
+
+      int node = findNode (text.toCaseFolded ());
+      if (node == -1)
+        return result;
+
+      //
+      // Collect all keys in the subtree of the prefix node
+      //
+      QVector<int> stack;
+      stack.push_back (node);
+
+      while (!stack.isEmpty ())
+        {
+          node = stack.back ();
+          stack.pop_back ();
+
+          if (_nodes[node]._key != -1)
+            {
+              const Key& key = _keys[_nodes[node]._key];
+
+              foreach (int tag, key._tags)
+                result |= _tag_points[tag];
+
+              foreach (int row, key._rows)
+                result.setBit (row);
+            }
+
+          for (int child=_nodes[node]._first_child; child != -1; child = _nodes[child]._next_sibling)
+            stack.push_back (child);
+        }
+
+      return result;
+    }
+
+  }
+}
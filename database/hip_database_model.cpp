@@ -17,8 +17,11 @@ namespace HIP {
 
     /* Constructor */
     DatabaseFilterProxyModel::DatabaseFilterProxyModel (const Database* database, QObject* parent)
-      : QSortFilterProxyModel (parent),
-        _tag ()
+      : QAbstractProxyModel (parent),
+        _database    (database),
+        _rows        (),
+        _tail        (),
+        _tail_offset (0)
     {
       connect (database, &Database::databaseChanged, this, &DatabaseFilterProxyModel::onDatabaseChanged);
     }
@@ -28,11 +31,91 @@ namespace HIP {
     {
     }
 
-    /* Check if row is filtered */
-    bool DatabaseFilterProxyModel::filterAcceptsRow (int source_row, const QModelIndex& source_parent) const
+    /*! Set source model. Must be a model with one row per database point. */
+    void DatabaseFilterProxyModel::setSourceModel (QAbstractItemModel* model)
     {
-      QModelIndex index = sourceModel ()->index (source_row, 0, source_parent);
-      return sourceModel ()->data (index, DatabaseModel::Role::POINT).value<Point> ().matches (_tag);
+      beginResetModel ();
+
+      if (sourceModel () != 0)
+        disconnect (sourceModel (), 0, this, 0);
+
+      QAbstractProxyModel::setSourceModel (model);
+
+      connect (model, &QAbstractItemModel::modelAboutToBeReset, this, &DatabaseFilterProxyModel::onSourceAboutToBeReset);
+      connect (model, &QAbstractItemModel::modelReset, this, &DatabaseFilterProxyModel::onSourceReset);
+      connect (model, &QAbstractItemModel::dataChanged, this, &DatabaseFilterProxyModel::onSourceDataChanged);
+      connect (model, &QAbstractItemModel::rowsMoved, this, &DatabaseFilterProxyModel::onSourceRowsMoved);
+
+      computeRows ();
+      endResetModel ();
+    }
+
+    QModelIndex DatabaseFilterProxyModel::mapToSource (const QModelIndex& proxy_index) const
+    {
+      QModelIndex index;
+
+      if (proxy_index.isValid () && sourceModel () != 0)
+        index = sourceModel ()->index (getSourceRow (proxy_index.row ()), proxy_index.column (), QModelIndex ());
+
+      return index;
+    }
+
+    QModelIndex DatabaseFilterProxyModel::mapFromSource (const QModelIndex& source_index) const
+    {
+      QModelIndex index;
+
+      if (source_index.isValid ())
+        {
+          int row = findRow (source_index.row ());
+          if (row < rowCount (QModelIndex ()) && getSourceRow (row) == source_index.row ())
+            index = createIndex (row, source_index.column ());
+        }
+
+      return index;
+    }
+
+    /*!
+     * Map selection from the source model
+     *
+     * The visible rows of a source range are always consecutive in the proxy model, so
+     * each source range maps to at most one proxy range.
+     */
+    QItemSelection DatabaseFilterProxyModel::mapSelectionFromSource (const QItemSelection& selection) const
+    {
+      QItemSelection result;
+
+      foreach (const QItemSelectionRange& range, selection)
+        {
+          int first = findRow (range.top ());
+          int last = findRow (range.bottom () + 1) - 1;
+
+          if (first <= last)
+            result.append (QItemSelectionRange (createIndex (first, range.left ()), createIndex (last, range.right ())));
+        }
+
+      return result;
+    }
+
+    int DatabaseFilterProxyModel::columnCount (const QModelIndex& parent) const
+    {
+      return sourceModel () != 0 ? sourceModel ()->columnCount (mapToSource (parent)) : 0;
+    }
+
+    int DatabaseFilterProxyModel::rowCount (const QModelIndex& parent) const
+    {
+      return !parent.isValid () ? _rows.size () + _tail.size () - _tail_offset : 0;
+    }
+
+    QModelIndex DatabaseFilterProxyModel::index (int row, int column, const QModelIndex& parent) const
+    {
+      Q_UNUSED (parent);
+      return createIndex (row, column);
+    }
+
+    QModelIndex DatabaseFilterProxyModel::parent (const QModelIndex& index) const
+    {
+      Q_UNUSED (index);
+      return QModelIndex ();
     }
 
     /* Database change listener */
@@ -41,10 +124,278 @@ namespace HIP {
       if (reason == Database::Reason::FILTER)
         {
           Q_ASSERT (data.type () == QVariant::String);
+          updateFilter ();
+        }
+      else if (reason == Database::Reason::POINT)
+        {
+          Q_ASSERT (data.canConvert<PointChange> ());
+
+          //
+          // Moved points are handled when the source model reports the move
+          //
+          PointChange change = data.value<PointChange> ();
+          if (!change.isMoved ())
+            updateRow (change.getNewRow ());
+        }
+    }
 
-          beginResetModel ();
-          _tag = data.toString ();
-          endResetModel ();
+    /* Source model is going to be reset */
+    void DatabaseFilterProxyModel::onSourceAboutToBeReset ()
+    {
+      beginResetModel ();
+    }
+
+    /* Source model has been reset */
+    void DatabaseFilterProxyModel::onSourceReset ()
+    {
+      computeRows ();
+      endResetModel ();
+    }
+
+    /*
+     * Compute rows from scratch using the current filter matches
+     */
+    void DatabaseFilterProxyModel::computeRows ()
+    {
+      const QBitArray& matches = _database->getFilterMatches ();
+
+      _rows.clear ();
+      _rows.reserve (matches.count (true));
+
+      for (int i=0; i < matches.size (); ++i)
+        if (matches.testBit (i))
+          _rows.push_back (i);
+    }
+
+    /* Source data changed. The visible part of the source range is forwarded. */
+    void DatabaseFilterProxyModel::onSourceDataChanged (const QModelIndex& top_left, const QModelIndex& bottom_right,
+                                                        const QVector<int>& roles)
+    {
+      int first = findRow (top_left.row ());
+      int last = findRow (bottom_right.row () + 1) - 1;
+
+      if (first <= last)
+        emit dataChanged (createIndex (first, top_left.column ()), createIndex (last, bottom_right.column ()), roles);
+    }
+
+    /*
+     * Source row has been moved
+     *
+     * The source rows between the old and the new position are shifted by one. The moved
+     * row is moved, removed or inserted in the proxy depending on its new filter match.
+     */
+    void DatabaseFilterProxyModel::onSourceRowsMoved (const QModelIndex& parent, int start, int end,
+                                                      const QModelIndex& destination, int row)
+    {
+      Q_UNUSED (parent);
+      Q_UNUSED (destination);
+      Q_ASSERT (start == end && "Only single rows can be moved.");
+      Q_ASSERT (_tail.isEmpty ());
+
+      int from = start;
+      int to = row > start ? row - 1 : row;
+
+      int old_position = findRow (from);
+      bool was_visible = old_position < _rows.size () && _rows[old_position] == from;
+      bool is_visible = _database->getFilterMatches ().testBit (to);
+
+      //
+      // Proxy position of the row after the move, not counting the row itself
+      //
+      int new_position = from < to ? findRow (to + 1) - (was_visible ? 1 : 0) : findRow (to);
+
+      bool moving = false;
+
+      if (was_visible && is_visible)
+        moving = beginMoveRows (QModelIndex (), old_position, old_position, QModelIndex (),
+                                new_position > old_position ? new_position + 1 : new_position);
+      else if (was_visible)
+        beginRemoveRows (QModelIndex (), old_position, old_position);
+
+      if (was_visible)
+        _rows.remove (old_position);
+
+      int shift = from < to ? -1 : 1;
+
+      for (int i=findRow (qMin (from, to)); i < _rows.size () && _rows[i] <= qMax (from, to); ++i)
+        _rows[i] += shift;
+
+      if (is_visible && !was_visible)
+        beginInsertRows (QModelIndex (), new_position, new_position);
+
+      if (is_visible)
+        _rows.insert (new_position, to);
+
+      if (moving)
+        endMoveRows ();
+      else if (was_visible && !is_visible)
+        endRemoveRows ();
+      else if (is_visible && !was_visible)
+        endInsertRows ();
+
+      Q_ASSERT (_rows.size () == _database->getFilterMatches ().count (true));
+    }
+
+    /*
+     * Insert or remove a single source row whose filter match might have changed
+     */
+    void DatabaseFilterProxyModel::updateRow (int source_row)
+    {
+      Q_ASSERT (_tail.isEmpty ());
+
+      int position = findRow (source_row);
+      bool was_visible = position < _rows.size () && _rows[position] == source_row;
+      bool is_visible = _database->getFilterMatches ().testBit (source_row);
+
+      if (was_visible && !is_visible)
+        {
+          beginRemoveRows (QModelIndex (), position, position);
+          _rows.remove (position);
+          endRemoveRows ();
+        }
+      else if (is_visible && !was_visible)
+        {
+          beginInsertRows (QModelIndex (), position, position);
+          _rows.insert (position, source_row);
+          endInsertRows ();
+        }
+    }
+
+    /*
+     * Return source row of the given proxy row
+     */
+    int DatabaseFilterProxyModel::getSourceRow (int row) const
+    {
+      Q_ASSERT (row >= 0 && row < rowCount (QModelIndex ()));
+      return row < _rows.size () ? _rows[row] : _tail[_tail_offset + row - _rows.size ()];
+    }
+
+    /*
+     * Return first proxy row whose source row is not less than the given one
+     */
+    int DatabaseFilterProxyModel::findRow (int source_row) const
+    {
+      int first = 0;
+      int count = rowCount (QModelIndex ());
+
+      while (count > 0)
+        {
+          int step = count / 2;
+
+          if (getSourceRow (first + step) < source_row)
+            {
+              first += step + 1;
+              count -= step + 1;
+            }
+          else
+            count = step;
+        }
+
+      return first;
+    }
+
+    /*
+     * Apply changed filter matches
+     *
+     * The old and new matches are merged in ascending source row order. Consecutive
+     * rows entering or leaving the filtered set are inserted or removed as a single
+     * range at the border between the updated rows and the remaining old rows.
+     */
+    void DatabaseFilterProxyModel::updateFilter ()
+    {
+      const QBitArray& matches = _database->getFilterMatches ();
+
+      //
+      // Matches can be added even if the filter text has been extended, for example by
+      // description matches of the text index
+      //
+      bool narrowing = _database->isFilterNarrowed ();
+
+      Q_ASSERT (_tail.isEmpty () && _tail_offset == 0);
+
+      _tail.swap (_rows);
+      _rows.reserve (_tail.size ());
+
+      QVector<int> insertions;
+      int removals = 0;
+      int source = 0;
+
+      while (_tail_offset + removals < _tail.size ())
+        {
+          int next = _tail[_tail_offset + removals];
+
+          if (!narrowing)
+            for (; source < next; ++source)
+              if (matches.testBit (source))
+                {
+                  flushRemovals (removals);
+                  insertions.push_back (source);
+                }
+
+          if (matches.testBit (next))
+            {
+              flushRemovals (removals);
+              flushInsertions (insertions);
+
+              _rows.push_back (next);
+              ++_tail_offset;
+            }
+          else
+            {
+              flushInsertions (insertions);
+              ++removals;
+            }
+
+          source = next + 1;
+        }
+
+      flushRemovals (removals);
+
+      if (!narrowing)
+        for (; source < matches.size (); ++source)
+          if (matches.testBit (source))
+            insertions.push_back (source);
+
+      flushInsertions (insertions);
+
+      Q_ASSERT (_tail_offset == _tail.size ());
+      Q_ASSERT (_rows.size () == matches.count (true));
+
+      _tail.clear ();
+      _tail_offset = 0;
+    }
+
+    /*
+     * Insert collected rows at the border between updated and old rows
+     */
+    void DatabaseFilterProxyModel::flushInsertions (QVector<int>& rows)
+    {
+      if (!rows.isEmpty ())
+        {
+          int position = _rows.size ();
+
+          beginInsertRows (QModelIndex (), position, position + rows.size () - 1);
+          _rows += rows;
+          endInsertRows ();
+
+          rows.clear ();
+        }
+    }
+
+    /*
+     * Remove the given number of old rows at the border between updated and old rows
+     */
+    void DatabaseFilterProxyModel::flushRemovals (int& count)
+    {
+      if (count > 0)
+        {
+          int position = _rows.size ();
+
+          beginRemoveRows (QModelIndex (), position, position + count - 1);
+          _tail_offset += count;
+          endRemoveRows ();
+
+          count = 0;
         }
     }
 
@@ -66,13 +417,14 @@ namespace HIP {
     {
     }
 
+    /*! Get model index of the point with the given id */
     QModelIndex DatabaseModel::getIndex (const QString& id) const
     {
       QModelIndex index;
 
-      for (int i=0; i < _database->getPoints ().size () && !index.isValid (); ++i)
-        if (_database->getPoints ()[i].getId () == id)
-          index = this->index (i, 0, QModelIndex ());
+      int row = _database->findIndex (id);
+      if (row >= 0)
+        index = this->index (row, 0, QModelIndex ());
 
       return index;
     }
@@ -169,15 +521,6 @@ namespace HIP {
 
     void DatabaseModel::onDatabaseChanged (Database::Reason_t reason, const QVariant& data)
     {
-      QModelIndex index;
-
-      if (data.type () == QVariant::String)
-        {
-          for (int i=0; i < _database->getPoints ().size (); ++i)
-            if (_database->getPoints ()[i].getId () == data.toString ())
-              index = this->index (i, 0, QModelIndex ());
-        }
-
       switch (reason)
         {
         case Database::Reason::DATA:
@@ -187,17 +530,40 @@ namespace HIP {
           break;
 
         case Database::Reason::POINT:
-          Q_ASSERT (index.isValid ());
-          emit dataChanged (index, index);
+          {
+            Q_ASSERT (data.canConvert<PointChange> ());
+            PointChange change = data.value<PointChange> ();
+
+            //
+            // The database has already been changed when the move is announced. This is
+            // fine as long as the move itself is the only change listeners react on.
+            //
+            if (change.isMoved ())
+              {
+                int from = change.getOldRow ();
+                int to = change.getNewRow ();
+
+                if (beginMoveRows (QModelIndex (), from, from, QModelIndex (), to > from ? to + 1 : to))
+                  endMoveRows ();
+              }
+
+            QModelIndex index = this->index (change.getNewRow (), 0, QModelIndex ());
+            emit dataChanged (index, index);
+          }
           break;
 
         case Database::Reason::SELECTION:
-          Q_ASSERT (index.isValid ());
-          emit dataChanged (index, index);
+          {
+            Q_ASSERT (data.canConvert<RowRanges> ());
+
+            foreach (const RowRanges::Range& range, data.value<RowRanges> ().getRanges ())
+              emit dataChanged (this->index (range.first, 0), this->index (range.second, 0));
+          }
           break;
 
         case Database::Reason::FILTER:
         case Database::Reason::VIEW:
+        case Database::Reason::PLACEMENT:
           break;
         }
     }
@@ -0,0 +1,575 @@
+/*
+ * hip_database_snapshot.cpp - Binary snapshot of the points database
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPDatabaseSnapshot.h"
+#include "core/HIPTools.h"
+#include "gl/HIPGLData.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+
+#include <cstring>
+#include <limits>
+
+namespace HIP {
+  namespace Database {
+
+    //#**********************************************************************
+    // Local definitions
+    //#**********************************************************************
+
+    /*
+     * Entry of the string table. The offset and length are given in UTF-16 characters.
+     */
+    struct Snapshot::StringRecord
+    {
+      quint32 _offset;
+      quint32 _length;
+    };
+
+    /*
+     * Packed point. Tags are stored as a range of string references.
+     */
+    struct Snapshot::PointRecord
+    {
+      quint32 _id;
+      quint32 _description;
+      quint32 _first_tag;
+      quint32 _number_of_tags;
+      float _position[3];
+      quint32 _color;
+    };
+
+    /*
+     * Tag index entry. The rows of the points carrying the tag are stored as a range
+     * of the row table.
+     */
+    struct Snapshot::TagRecord
+    {
+      quint32 _name;
+      quint32 _first_row;
+      quint32 _number_of_rows;
+    };
+
+    namespace {
+
+      //
+      // File identification and format version. The version must be increased
+      // whenever the layout of the file or of the stored structures changes.
+      //
+      const char MAGIC[8] = { 'H', 'I', 'P', 'P', 'N', 'T', 'D', 'B' };
+      const quint32 VERSION = 2;
+
+      //
+      // Alignment of the memory mapped data blocks
+      //
+      const quint64 ALIGNMENT = 16;
+
+      /*
+       * Snapshot file header
+       *
+       * The header is followed by a QDataStream serialized block with the database
+       * name, model name and views and the raw tables referenced by the header.
+       */
+      struct Header
+      {
+        char _magic[8];
+        quint32 _version;
+        quint32 _point_size;
+        char _key[16];
+        quint64 _meta_offset;
+        quint64 _meta_size;
+        quint64 _string_offset;
+        quint64 _number_of_strings;
+        quint64 _character_offset;
+        quint64 _number_of_characters;
+        quint64 _point_offset;
+        quint64 _number_of_points;
+        quint64 _reference_offset;
+        quint64 _number_of_references;
+        quint64 _tag_offset;
+        quint64 _number_of_tags;
+        quint64 _row_offset;
+        quint64 _number_of_rows;
+      };
+
+      /* Align offset to the block alignment */
+      quint64 align (quint64 offset)
+      {
+        return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+      }
+
+      /* Check if a table of the given size fits into the file */
+      bool fits (quint64 offset, quint64 number, quint64 size, quint64 file_size)
+      {
+        return offset % ALIGNMENT == 0 &&
+          number <= static_cast<quint64> (std::numeric_limits<qint32>::max ()) &&
+          offset + number * size <= file_size;
+      }
+
+      /*
+       * String table builder. Each distinct string is stored only once.
+       */
+      class StringTable
+      {
+      public:
+        quint32 add (const QString& text)
+        {
+          QHash<QString, quint32>::const_iterator pos = _indices.find (text);
+          if (pos != _indices.end ())
+            return pos.value ();
+
+          quint32 index = _offsets.size ();
+
+          _offsets.push_back (_characters.size ());
+          _lengths.push_back (text.size ());
+          _characters.append (text);
+          _indices.insert (text, index);
+
+          return index;
+        }
+
+        QVector<quint32> _offsets;
+        QVector<quint32> _lengths;
+        QString _characters;
+
+      private:
+        QHash<QString, quint32> _indices;
+      };
+
+      /* Write zero bytes until the file position matches the given offset */
+      void pad (QSaveFile& file, quint64 offset)
+      {
+        Q_ASSERT (static_cast<quint64> (file.pos ()) <= offset);
+        file.write (QByteArray (static_cast<int> (offset - file.pos ()), '\0'));
+      }
+
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::Database::Snapshot
+    //#**********************************************************************
+
+    /*! Constructor */
+    Snapshot::Snapshot ()
+      : _file                 (),
+        _name                 (),
+        _model_name           (),
+        _views                (),
+        _strings              (0),
+        _number_of_strings    (0),
+        _characters           (0),
+        _number_of_characters (0),
+        _points               (0),
+        _number_of_points     (0),
+        _references           (0),
+        _number_of_references (0),
+        _tags                 (0),
+        _number_of_tags       (0),
+        _rows                 (0),
+        _number_of_rows       (0),
+        _string_cache         ()
+    {
+    }
+
+    /*! Destructor */
+    Snapshot::~Snapshot ()
+    {
+    }
+
+    /*!
+     * Return path of the snapshot file caching the given database source file
+     */
+    QString Snapshot::getCacheFileName (const QString& source)
+    {
+      QByteArray id = QCryptographicHash::hash (Tools::getResolvedFileName (source).toUtf8 (), QCryptographicHash::Md5);
+
+      return QString ("%1/databases/%2.db")
+        .arg (QStandardPaths::writableLocation (QStandardPaths::CacheLocation))
+        .arg (QString::fromLatin1 (id.toHex ()));
+    }
+
+    /*!
+     * Map snapshot file
+     *
+     * @param path Path of the snapshot file
+     * @param key  Key the snapshot must have been stored with
+     * @return 'true' if a valid snapshot file with a matching key exists
+     */
+    bool Snapshot::load (const QString& path, const QByteArray& key)
+    {
+      Q_ASSERT (!_file.isOpen ());
+
+      _file.setFileName (path);
+
+      if (!_file.open (QIODevice::ReadOnly) || _file.size () < static_cast<qint64> (sizeof (Header)))
+        return false;
+
+      const uchar* base = _file.map (0, _file.size ());
+      if (base == 0)
+        return false;
+
+      Header header;
+      memcpy (&header, base, sizeof (Header));
+
+      if ( memcmp (header._magic, MAGIC, sizeof (MAGIC)) != 0 ||
+           header._version != VERSION ||
+           header._point_size != sizeof (PointRecord) ||
+           key.size () != static_cast<int> (sizeof (header._key)) ||
+           memcmp (header._key, key.constData (), sizeof (header._key)) != 0 )
+        return false;
+
+      quint64 file_size = _file.size ();
+
+      if ( header._meta_offset + header._meta_size > file_size ||
+           !fits (header._string_offset, header._number_of_strings, sizeof (StringRecord), file_size) ||
+           !fits (header._character_offset, header._number_of_characters, sizeof (QChar), file_size) ||
+           !fits (header._point_offset, header._number_of_points, sizeof (PointRecord), file_size) ||
+           !fits (header._reference_offset, header._number_of_references, sizeof (quint32), file_size) ||
+           !fits (header._tag_offset, header._number_of_tags, sizeof (TagRecord), file_size) ||
+           !fits (header._row_offset, header._number_of_rows, sizeof (quint32), file_size) )
+        return false;
+
+      //
+      // Meta data
+      //
+      QByteArray meta = QByteArray::fromRawData (reinterpret_cast<const char*> (base + header._meta_offset),
+                                                 static_cast<int> (header._meta_size));
+      QDataStream in (meta);
+      in.setVersion (QDataStream::Qt_5_0);
+
+      QString name, model_name;
+      in >> name >> model_name;
+
+      qint32 number_of_views = 0;
+      in >> number_of_views;
+
+      QList<View> views;
+      for (int i=0; i < number_of_views && in.status () == QDataStream::Ok; ++i)
+        {
+          QString view_name;
+          QList<QString> groups;
+          in >> view_name >> groups;
+
+          View view;
+          view.setName (view_name);
+          foreach (const QString& group, groups)
+            view.addGroup (group);
+
+          views.push_back (view);
+        }
+
+      if (in.status () != QDataStream::Ok)
+        return false;
+
+      _name = name;
+      _model_name = model_name;
+      _views = views;
+
+      //
+      // Tables are used directly from the mapped file
+      //
+      _strings = reinterpret_cast<const StringRecord*> (base + header._string_offset);
+      _number_of_strings = header._number_of_strings;
+      _characters = reinterpret_cast<const QChar*> (base + header._character_offset);
+      _number_of_characters = header._number_of_characters;
+      _points = reinterpret_cast<const PointRecord*> (base + header._point_offset);
+      _number_of_points = header._number_of_points;
+      _references = reinterpret_cast<const quint32*> (base + header._reference_offset);
+      _number_of_references = header._number_of_references;
+      _tags = reinterpret_cast<const TagRecord*> (base + header._tag_offset);
+      _number_of_tags = header._number_of_tags;
+      _rows = reinterpret_cast<const quint32*> (base + header._row_offset);
+      _number_of_rows = header._number_of_rows;
+
+      _string_cache.resize (static_cast<int> (_number_of_strings));
+
+      return validate ();
+    }
+
+    /*
+     * Check that all table references are in range, so the accessors do not have to
+     */
+    bool Snapshot::validate () const
+    {
+      for (quint32 i=0; i < _number_of_strings; ++i)
+        if (static_cast<quint64> (_strings[i]._offset) + _strings[i]._length > _number_of_characters)
+          return false;
+
+      for (quint32 i=0; i < _number_of_points; ++i)
+        {
+          const PointRecord& point = _points[i];
+
+          if ( point._id >= _number_of_strings ||
+               point._description >= _number_of_strings ||
+               static_cast<quint64> (point._first_tag) + point._number_of_tags > _number_of_references )
+            return false;
+        }
+
+      for (quint64 i=0; i < _number_of_references; ++i)
+        if (_references[i] >= _number_of_strings)
+          return false;
+
+      for (quint32 i=0; i < _number_of_tags; ++i)
+        {
+          const TagRecord& tag = _tags[i];
+
+          if ( tag._name >= _number_of_strings ||
+               static_cast<quint64> (tag._first_row) + tag._number_of_rows > _number_of_rows )
+            return false;
+        }
+
+      for (quint64 i=0; i < _number_of_rows; ++i)
+        if (_rows[i] >= _number_of_points)
+          return false;
+
+      return true;
+    }
+
+    /*!
+     * Store database snapshot
+     *
+     * The file is written atomically, so concurrently running instances never see
+     * partially written snapshot files.
+     *
+     * @param path     Path of the snapshot file
+     * @param key      Key identifying the state of the database source
+     * @param database Database to store
+     * @return 'true' if the snapshot file has been written successfully
+     */
+    bool Snapshot::save (const QString& path, const QByteArray& key, const Database& database)
+    {
+      Q_ASSERT (key.size () == static_cast<int> (sizeof (Header::_key)));
+
+      const QList<Point>& points = database.getPoints ();
+      const QList<QString>& tags = database.getTags ();
+
+      StringTable strings;
+
+      //
+      // Points, stored in the sort order of the database
+      //
+      QVector<PointRecord> point_records;
+      point_records.reserve (points.size ());
+
+      QVector<quint32> references;
+      QHash<QString, QVector<quint32> > tag_rows;
+
+      for (int i=0; i < points.size (); ++i)
+        {
+          const Point& point = points[i];
+
+          PointRecord record;
+          record._id = strings.add (point.getId ());
+          record._description = strings.add (point.getDescription ());
+          record._first_tag = references.size ();
+          record._number_of_tags = point.getTags ().size ();
+          record._position[0] = point.getPosition ().x ();
+          record._position[1] = point.getPosition ().y ();
+          record._position[2] = point.getPosition ().z ();
+          record._color = point.getColor ().rgba ();
+
+          foreach (const QString& tag, point.getTags ())
+            {
+              references.push_back (strings.add (tag));
+
+              QVector<quint32>& rows = tag_rows[tag];
+              if (rows.isEmpty () || rows.back () != static_cast<quint32> (i))
+                rows.push_back (i);
+            }
+
+          point_records.push_back (record);
+        }
+
+      //
+      // Tag index in the (sorted) order of the database tags
+      //
+      QVector<TagRecord> tag_records;
+      QVector<quint32> rows;
+
+      foreach (const QString& tag, tags)
+        {
+          const QVector<quint32>& tag_row_list = tag_rows[tag];
+
+          TagRecord record;
+          record._name = strings.add (tag);
+          record._first_row = rows.size ();
+          record._number_of_rows = tag_row_list.size ();
+
+          rows += tag_row_list;
+          tag_records.push_back (record);
+        }
+
+      QVector<StringRecord> string_records (strings._offsets.size ());
+      for (int i=0; i < string_records.size (); ++i)
+        {
+          string_records[i]._offset = strings._offsets[i];
+          string_records[i]._length = strings._lengths[i];
+        }
+
+      //
+      // Meta data
+      //
+      QByteArray meta;
+
+      {
+        QDataStream out (&meta, QIODevice::WriteOnly);
+        out.setVersion (QDataStream::Qt_5_0);
+
+        out << database.getName () << database.getModelFile ();
+
+        out << static_cast<qint32> (database.getViews ().size ());
+        foreach (const View& view, database.getViews ())
+          out << view.getName () << view.getGroups ();
+      }
+
+      Header header;
+      memset (&header, 0, sizeof (Header));
+      memcpy (header._magic, MAGIC, sizeof (MAGIC));
+      memcpy (header._key, key.constData (), sizeof (header._key));
+
+      header._version = VERSION;
+      header._point_size = sizeof (PointRecord);
+      header._meta_offset = sizeof (Header);
+      header._meta_size = meta.size ();
+      header._string_offset = align (header._meta_offset + header._meta_size);
+      header._number_of_strings = string_records.size ();
+      header._character_offset = align (header._string_offset + header._number_of_strings * sizeof (StringRecord));
+      header._number_of_characters = strings._characters.size ();
+      header._point_offset = align (header._character_offset + header._number_of_characters * sizeof (QChar));
+      header._number_of_points = point_records.size ();
+      header._reference_offset = align (header._point_offset + header._number_of_points * sizeof (PointRecord));
+      header._number_of_references = references.size ();
+      header._tag_offset = align (header._reference_offset + header._number_of_references * sizeof (quint32));
+      header._number_of_tags = tag_records.size ();
+      header._row_offset = align (header._tag_offset + header._number_of_tags * sizeof (TagRecord));
+      header._number_of_rows = rows.size ();
+
+      QDir ().mkpath (QFileInfo (path).absolutePath ());
+
+      QSaveFile file (path);
+      if (!file.open (QIODevice::WriteOnly))
+        {
+          qWarning () << "Unable to write database snapshot" << path << ":" << file.errorString ();
+          return false;
+        }
+
+      file.write (reinterpret_cast<const char*> (&header), sizeof (Header));
+      file.write (meta);
+
+      pad (file, header._string_offset);
+      file.write (reinterpret_cast<const char*> (string_records.constData ()), header._number_of_strings * sizeof (StringRecord));
+      pad (file, header._character_offset);
+      file.write (reinterpret_cast<const char*> (strings._characters.constData ()), header._number_of_characters * sizeof (QChar));
+      pad (file, header._point_offset);
+      file.write (reinterpret_cast<const char*> (point_records.constData ()), header._number_of_points * sizeof (PointRecord));
+      pad (file, header._reference_offset);
+      file.write (reinterpret_cast<const char*> (references.constData ()), header._number_of_references * sizeof (quint32));
+      pad (file, header._tag_offset);
+      file.write (reinterpret_cast<const char*> (tag_records.constData ()), header._number_of_tags * sizeof (TagRecord));
+      pad (file, header._row_offset);
+      file.write (reinterpret_cast<const char*> (rows.constData ()), header._number_of_rows * sizeof (quint32));
+
+      if (!file.commit ())
+        {
+          qWarning () << "Unable to write database snapshot" << path << ":" << file.errorString ();
+          return false;
+        }
+
+      return true;
+    }
+
+    /*! Return number of points in the snapshot */
+    int Snapshot::getNumberOfPoints () const
+    {
+      return static_cast<int> (_number_of_points);
+    }
+
+    /*!
+     * Return point with the given index
+     */
+    Point Snapshot::getPoint (int index) const
+    {
+      Q_ASSERT (index >= 0 && static_cast<quint32> (index) < _number_of_points);
+
+      const PointRecord& record = _points[index];
+
+      QList<QString> tags;
+      tags.reserve (record._number_of_tags);
+
+      for (quint32 i=0; i < record._number_of_tags; ++i)
+        tags.push_back (getString (_references[record._first_tag + i]));
+
+      Point point;
+      point.setId (getString (record._id));
+      point.setDescription (getString (record._description));
+      point.setTags (tags);
+      point.setPosition (QVector3D (record._position[0], record._position[1], record._position[2]));
+      point.setColor (QColor::fromRgba (record._color));
+
+      return point;
+    }
+
+    /*! Return number of distinct tags in the snapshot */
+    int Snapshot::getNumberOfTags () const
+    {
+      return static_cast<int> (_number_of_tags);
+    }
+
+    /*! Return name of the tag with the given index. Tags are sorted alphabetically. */
+    QString Snapshot::getTag (int index) const
+    {
+      Q_ASSERT (index >= 0 && static_cast<quint32> (index) < _number_of_tags);
+      return getString (_tags[index]._name);
+    }
+
+    /*! Return ascending rows of all points carrying the tag with the given index */
+    QList<int> Snapshot::getTagRows (int index) const
+    {
+      Q_ASSERT (index >= 0 && static_cast<quint32> (index) < _number_of_tags);
+
+      const TagRecord& tag = _tags[index];
+
+      QList<int> rows;
+      rows.reserve (tag._number_of_rows);
+
+      for (quint32 i=0; i < tag._number_of_rows; ++i)
+        rows.push_back (_rows[tag._first_row + i]);
+
+      return rows;
+    }
+
+    /*
+     * Return string from the string table
+     *
+     * The character data is copied from the mapped file on first access only, all
+     * further accesses share the copy.
+     */
+    const QString& Snapshot::getString (quint32 index) const
+    {
+      Q_ASSERT (index < _number_of_strings);
+
+      QString& text = _string_cache[index];
+
+      if (text.isNull ())
+        {
+          const StringRecord& record = _strings[index];
+          text = QString (_characters + record._offset, record._length);
+        }
+
+      return text;
+    }
+
+  }
+}
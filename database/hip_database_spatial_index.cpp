@@ -0,0 +1,506 @@
+/*
+ * hip_database_spatial_index.cpp - Spatial index over point positions
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPDatabaseSpatialIndex.h"
+#include "HIPDatabase.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSet>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace HIP {
+  namespace Database {
+
+    //#**********************************************************************
+    // Local definitions
+    //#**********************************************************************
+
+    namespace {
+
+      //
+      // Average number of points per occupied cell aimed at when building the index.
+      // The initial cell size assumes points filling the bounding volume. Points on a
+      // surface occupy fewer cells, so the size is refined until the cells are small
+      // enough or the refinement limit has been reached.
+      //
+      const int POINTS_PER_CELL = 4;
+      const int MAX_REFINEMENTS = 4;
+
+      //
+      // Cell coordinates are packed into 21 bits per axis
+      //
+      const int CELL_BITS = 21;
+      const int CELL_OFFSET = 1 << (CELL_BITS - 1);
+
+      typedef QPair<float, int> Candidate; // Squared distance and entry index
+
+      /* Order candidates by ascending distance, ties by entry */
+      bool compareCandidates (const Candidate& c1, const Candidate& c2)
+      {
+        return c1.first < c2.first || (c1.first == c2.first && c1.second < c2.second);
+      }
+
+      /* Add candidate to a max heap keeping the 'count' best candidates */
+      void pushCandidate (QVector<Candidate>* heap, const Candidate& candidate, int count)
+      {
+        if (heap->size () == count && !compareCandidates (candidate, heap->front ()))
+          return;
+
+        heap->push_back (candidate);
+        std::push_heap (heap->begin (), heap->end (), compareCandidates);
+
+        if (heap->size () > count)
+          {
+            std::pop_heap (heap->begin (), heap->end (), compareCandidates);
+            heap->pop_back ();
+          }
+      }
+
+      /* Check if a position is inside of a box */
+      inline bool isInside (const QVector3D& p, const QVector3D& minimum, const QVector3D& maximum)
+      {
+        return p.x () >= minimum.x () && p.y () >= minimum.y () && p.z () >= minimum.z () &&
+               p.x () <= maximum.x () && p.y () <= maximum.y () && p.z () <= maximum.z ();
+      }
+
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::Database::SpatialIndex
+    //#**********************************************************************
+
+    /*! Constructor */
+    SpatialIndex::SpatialIndex ()
+      : _entries           (),
+        _free_entries      (),
+        _entry_ids         (),
+        _cells             (),
+        _cell_size         (1.0f),
+        _inverse_cell_size (1.0f)
+    {
+    }
+
+    /*! Destructor */
+    SpatialIndex::~SpatialIndex ()
+    {
+    }
+
+    /*!
+     * Build index for a list of points
+     *
+     * @param points Points to be indexed. The point ids must be unique.
+     */
+    void SpatialIndex::build (const QList<Point>& points)
+    {
+#ifdef HIP_PRINT_STATISTICS
+      QElapsedTimer timer;
+      timer.start ();
+#endif
+
+      clear ();
+
+      if (points.isEmpty ())
+        return;
+
+      QVector3D minimum = points.front ().getSurfacePosition ();
+      QVector3D maximum = minimum;
+
+      _entries.resize (points.size ());
+
+      for (int i=0; i < points.size (); ++i)
+        {
+          const QVector3D& position = points[i].getSurfacePosition ();
+
+          minimum = QVector3D (qMin (minimum.x (), position.x ()), qMin (minimum.y (), position.y ()),
+                               qMin (minimum.z (), position.z ()));
+          maximum = QVector3D (qMax (maximum.x (), position.x ()), qMax (maximum.y (), position.y ()),
+                               qMax (maximum.z (), position.z ()));
+
+          _entries[i]._id = points[i].getId ();
+          _entries[i]._position = position;
+
+          _entry_ids.insert (points[i].getId (), i);
+        }
+
+      //
+      // Initial cell size from the bounding volume. Flat extents are widened, so planar
+      // or linear point sets do not end up with a cell size of 0.
+      //
+      QVector3D extent = maximum - minimum;
+      float max_extent = qMax (extent.x (), qMax (extent.y (), extent.z ()));
+
+      if (max_extent > 0.0f)
+        {
+          float min_extent = max_extent / 100.0f;
+          float volume = qMax (extent.x (), min_extent) * qMax (extent.y (), min_extent) * qMax (extent.z (), min_extent);
+
+          _cell_size = std::pow (volume * POINTS_PER_CELL / points.size (), 1.0f / 3.0f);
+
+          for (int i=0; i < MAX_REFINEMENTS; ++i)
+            {
+              _inverse_cell_size = 1.0f / _cell_size;
+
+              QSet<CellKey> occupied;
+              foreach (const Entry& entry, _entries)
+                {
+                  Cell cell = computeCell (entry._position);
+                  occupied.insert (computeKey (cell._x, cell._y, cell._z));
+                }
+
+              if (points.size () <= 2 * POINTS_PER_CELL * occupied.size ())
+                break;
+
+              _cell_size /= 2.0f;
+            }
+        }
+
+      _inverse_cell_size = 1.0f / _cell_size;
+
+      for (int i=0; i < _entries.size (); ++i)
+        insert (i);
+
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "* Spatial index:" << points.size () << "points," << _cells.size () << "cells of size"
+                << _cell_size << ", built in" << timer.elapsed () << "ms";
+#endif
+    }
+
+    /*! Remove all points from the index */
+    void SpatialIndex::clear ()
+    {
+      _entries.clear ();
+      _free_entries.clear ();
+      _entry_ids.clear ();
+      _cells.clear ();
+    }
+
+    /*!
+     * Add point to the index
+     *
+     * An already indexed point with the same id is replaced. The cell size is kept, so
+     * the index should be rebuilt if the point distribution changes significantly.
+     *
+     * @param id       Point id
+     * @param position Point position
+     */
+    void SpatialIndex::add (const QString& id, const QVector3D& position)
+    {
+      remove (id);
+
+      int entry = -1;
+      if (!_free_entries.isEmpty ())
+        {
+          entry = _free_entries.back ();
+          _free_entries.pop_back ();
+        }
+      else
+        {
+          entry = _entries.size ();
+          _entries.push_back (Entry ());
+        }
+
+      _entries[entry]._id = id;
+      _entries[entry]._position = position;
+      _entry_ids.insert (id, entry);
+
+      insert (entry);
+    }
+
+    /*!
+     * Remove point from the index
+     *
+     * @param id Id of the point to be removed
+     */
+    void SpatialIndex::remove (const QString& id)
+    {
+      int entry = _entry_ids.value (id, -1);
+      if (entry == -1)
+        return;
+
+      Cell cell = computeCell (_entries[entry]._position);
+
+      CellMap::iterator pos = _cells.find (computeKey (cell._x, cell._y, cell._z));
+      Q_ASSERT (pos != _cells.end ());
+
+      QVector<int>& entries = pos.value ();
+      int index = entries.indexOf (entry);
+      Q_ASSERT (index >= 0);
+
+      entries[index] = entries.back ();
+      entries.pop_back ();
+
+      if (entries.isEmpty ())
+        _cells.erase (pos);
+
+      _entry_ids.remove (id);
+      _entries[entry] = Entry ();
+      _free_entries.push_back (entry);
+    }
+
+    /*!
+     * Find the points nearest to a position
+     *
+     * The grid is searched in shells of cells around the cell containing the position
+     * until no unvisited cell can contain a point nearer than the found ones.
+     *
+     * @param position Query position
+     * @param count    Maximum number of points to be returned
+     * @return Nearest points, sorted by ascending distance
+     */
+    QList<SpatialIndex::Match> SpatialIndex::findNearest (const QVector3D& position, int count) const
+    {
+      QList<Match> matches;
+
+      if (count <= 0 || _entry_ids.isEmpty ())
+        return matches;
+
+      count = qMin (count, _entry_ids.size ());
+
+      //
+      // Max heap of the best candidates found so far
+      //
+      QVector<Candidate> heap;
+      heap.reserve (count + 1);
+
+      Cell center = computeCell (position);
+      int visited = 0;
+
+      for (int r=0; ; ++r)
+        {
+          //
+          // If the shells grew larger than the occupied part of the grid, scanning all
+          // cells is cheaper
+          //
+          qint64 shell_size = qint64 (2 * r + 1) * (2 * r + 1) * (2 * r + 1);
+
+          if (r > 0 && shell_size > 2 * _cells.size ())
+            {
+              heap.clear ();
+
+              for (CellMap::const_iterator i = _cells.begin (); i != _cells.end (); ++i)
+                foreach (int entry, i.value ())
+                  pushCandidate (&heap, Candidate ((_entries[entry]._position - position).lengthSquared (), entry), count);
+
+              break;
+            }
+
+          //
+          // Visit the cells with a Chebyshev distance of exactly 'r' to the center cell
+          //
+          for (int dx=-r; dx <= r; ++dx)
+            for (int dy=-r; dy <= r; ++dy)
+              {
+                bool on_border = dx == -r || dx == r || dy == -r || dy == r;
+                int step = on_border ? 1 : qMax (2 * r, 1);
+
+                for (int dz=-r; dz <= r; dz += step)
+                  {
+                    CellMap::const_iterator pos = _cells.find (computeKey (center._x + dx, center._y + dy, center._z + dz));
+                    if (pos == _cells.end ())
+                      continue;
+
+                    foreach (int entry, pos.value ())
+                      pushCandidate (&heap, Candidate ((_entries[entry]._position - position).lengthSquared (), entry), count);
+
+                    visited += pos.value ().size ();
+                  }
+              }
+
+          if (visited == _entry_ids.size ())
+            break;
+
+          //
+          // Distance from the position to the border of the visited cell cube. Points
+          // outside of the cube are at least that far away.
+          //
+          if (heap.size () == count)
+            {
+              float border = std::numeric_limits<float>::max ();
+
+              for (int axis=0; axis < 3; ++axis)
+                {
+                  int c = axis == 0 ? center._x : (axis == 1 ? center._y : center._z);
+
+                  border = qMin (border, position[axis] - (c - r) * _cell_size);
+                  border = qMin (border, (c + r + 1) * _cell_size - position[axis]);
+                }
+
+              border = qMax (border, 0.0f);
+
+              if (heap.front ().first <= border * border)
+                break;
+            }
+        }
+
+      std::sort (heap.begin (), heap.end (), compareCandidates);
+
+      matches.reserve (heap.size ());
+      foreach (const Candidate& candidate, heap)
+        matches.push_back (Match (_entries[candidate.second]._id, std::sqrt (candidate.first)));
+
+      return matches;
+    }
+
+    /*!
+     * Find all points within a distance to a position
+     *
+     * @param position Query position
+     * @param radius   Maximum distance
+     * @return Matching points, sorted by ascending distance
+     */
+    QList<SpatialIndex::Match> SpatialIndex::findInRadius (const QVector3D& position, float radius) const
+    {
+      QList<Match> matches;
+
+      if (radius < 0.0f || _entry_ids.isEmpty ())
+        return matches;
+
+      QVector<Candidate> candidates;
+
+      Cell minimum = computeCell (position - QVector3D (radius, radius, radius));
+      Cell maximum = computeCell (position + QVector3D (radius, radius, radius));
+
+      qint64 range_size = qint64 (maximum._x - minimum._x + 1) * (maximum._y - minimum._y + 1) * (maximum._z - minimum._z + 1);
+
+      if (range_size > _cells.size ())
+        {
+          for (CellMap::const_iterator i = _cells.begin (); i != _cells.end (); ++i)
+            collect (i.value (), position, radius, &candidates);
+        }
+      else
+        {
+          for (int x=minimum._x; x <= maximum._x; ++x)
+            for (int y=minimum._y; y <= maximum._y; ++y)
+              for (int z=minimum._z; z <= maximum._z; ++z)
+                {
+                  CellMap::const_iterator pos = _cells.find (computeKey (x, y, z));
+                  if (pos != _cells.end ())
+                    collect (pos.value (), position, radius, &candidates);
+                }
+        }
+
+      std::sort (candidates.begin (), candidates.end (), compareCandidates);
+
+      matches.reserve (candidates.size ());
+      foreach (const Candidate& candidate, candidates)
+        matches.push_back (Match (_entries[candidate.second]._id, std::sqrt (candidate.first)));
+
+      return matches;
+    }
+
+    /*!
+     * Find all points within an axis aligned box
+     *
+     * @param minimum Minimum box corner
+     * @param maximum Maximum box corner
+     * @return Ids of the points inside of the box (including its border), unordered
+     */
+    QList<QString> SpatialIndex::findInBox (const QVector3D& minimum, const QVector3D& maximum) const
+    {
+      QList<QString> ids;
+
+      if (_entry_ids.isEmpty () ||
+          minimum.x () > maximum.x () || minimum.y () > maximum.y () || minimum.z () > maximum.z ())
+        return ids;
+
+      Cell first = computeCell (minimum);
+      Cell last = computeCell (maximum);
+
+      qint64 range_size = qint64 (last._x - first._x + 1) * (last._y - first._y + 1) * (last._z - first._z + 1);
+
+      if (range_size > _cells.size ())
+        {
+          for (CellMap::const_iterator i = _cells.begin (); i != _cells.end (); ++i)
+            foreach (int entry, i.value ())
+              if (isInside (_entries[entry]._position, minimum, maximum))
+                ids.push_back (_entries[entry]._id);
+        }
+      else
+        {
+          for (int x=first._x; x <= last._x; ++x)
+            for (int y=first._y; y <= last._y; ++y)
+              for (int z=first._z; z <= last._z; ++z)
+                {
+                  CellMap::const_iterator pos = _cells.find (computeKey (x, y, z));
+                  if (pos == _cells.end ())
+                    continue;
+
+                  //
+                  // Only the points of border cells have to be tested
+                  //
+                  bool inner = x > first._x && x < last._x && y > first._y && y < last._y && z > first._z && z < last._z;
+
+                  foreach (int entry, pos.value ())
+                    if (inner || isInside (_entries[entry]._position, minimum, maximum))
+                      ids.push_back (_entries[entry]._id);
+                }
+        }
+
+      return ids;
+    }
+
+    /*
+     * Compute coordinates of the cell containing a position
+     */
+    SpatialIndex::Cell SpatialIndex::computeCell (const QVector3D& position) const
+    {
+      Cell cell;
+
+      cell._x = qBound (-CELL_OFFSET, static_cast<int> (std::floor (position.x () * _inverse_cell_size)), CELL_OFFSET - 1);
+      cell._y = qBound (-CELL_OFFSET, static_cast<int> (std::floor (position.y () * _inverse_cell_size)), CELL_OFFSET - 1);
+      cell._z = qBound (-CELL_OFFSET, static_cast<int> (std::floor (position.z () * _inverse_cell_size)), CELL_OFFSET - 1);
+
+      return cell;
+    }
+
+    /*
+     * Pack cell coordinates into a hash key. Coordinates outside of the grid range
+     * map to cells which are never occupied.
+     */
+    SpatialIndex::CellKey SpatialIndex::computeKey (int x, int y, int z)
+    {
+      if ( x < -CELL_OFFSET || x >= CELL_OFFSET ||
+           y < -CELL_OFFSET || y >= CELL_OFFSET ||
+           z < -CELL_OFFSET || z >= CELL_OFFSET )
+        return std::numeric_limits<CellKey>::max ();
+
+      return (CellKey (x + CELL_OFFSET) << (2 * CELL_BITS)) |
+             (CellKey (y + CELL_OFFSET) << CELL_BITS) |
+              CellKey (z + CELL_OFFSET);
+    }
+
+    /*
+     * Insert entry into the cell containing its position
+     */
+    void SpatialIndex::insert (int entry)
+    {
+      Cell cell = computeCell (_entries[entry]._position);
+      _cells[computeKey (cell._x, cell._y, cell._z)].push_back (entry);
+    }
+
+    /*
+     * Collect entries within a distance to a position
+     */
+    void SpatialIndex::collect (const QVector<int>& entries, const QVector3D& position, float max_distance,
+                                QVector<Candidate>* candidates) const
+    {
+      float max_distance_squared = max_distance * max_distance;
+
+      foreach (int entry, entries)
+        {
+          float distance = (_entries[entry]._position - position).lengthSquared ();
+          if (distance <= max_distance_squared)
+            candidates->push_back (Candidate (distance, entry));
+        }
+    }
+
+  }
+}
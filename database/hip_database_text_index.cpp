@@ -0,0 +1,284 @@
+/*
+ * hip_database_text_index.cpp - Full text index over point descriptions
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPDatabaseTextIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace HIP {
+  namespace Database {
+
+    //#**********************************************************************
+    // Local definitions
+    //#**********************************************************************
+
+    namespace {
+
+      //
+      // BM25 ranking parameters
+      //
+      const float BM25_K1 = 1.2f;
+      const float BM25_B  = 0.75f;
+
+      /* Sort matches by descending score, ties by id */
+      bool compareMatches (const TextIndex::Match& m1, const TextIndex::Match& m2)
+      {
+        return m1.second > m2.second || (m1.second == m2.second && m1.first < m2.first);
+      }
+
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::Database::TextIndex
+    //#**********************************************************************
+
+    /*! Constructor */
+    TextIndex::TextIndex ()
+      : _documents      (),
+        _free_documents (),
+        _document_ids   (),
+        _total_length   (0),
+        _postings       ()
+    {
+    }
+
+    /*! Destructor */
+    TextIndex::~TextIndex ()
+    {
+    }
+
+    /*!
+     * Split text into case folded words
+     *
+     * Words are maximal sequences of letters and digits.
+     */
+    QStringList TextIndex::tokenize (const QString& text)
+    {
+      QStringList words;
+
+      int start = -1;
+      for (int i=0; i <= text.size (); ++i)
+        {
+          bool inside = i < text.size () && text[i].isLetterOrNumber ();
+
+          if (inside && start == -1)
+            start = i;
+          else if (!inside && start != -1)
+            {
+              words.push_back (text.mid (start, i - start).toCaseFolded ());
+              start = -1;
+            }
+        }
+
+      return words;
+    }
+
+    /*!
+     * Add document to the index
+     *
+     * An already indexed document with the same id is replaced.
+     *
+     * @param id   Id of the point the text belongs to
+     * @param text Text to be indexed
+     */
+    void TextIndex::add (const QString& id, const QString& text)
+    {
+      remove (id);
+
+      QStringList words = tokenize (text);
+
+      QHash<QString, int> frequencies;
+      foreach (const QString& word, words)
+        ++frequencies[word];
+
+      int document = -1;
+      if (!_free_documents.isEmpty ())
+        {
+          document = _free_documents.back ();
+          _free_documents.pop_back ();
+        }
+      else
+        {
+          document = _documents.size ();
+          _documents.push_back (Document ());
+        }
+
+      Document& entry = _documents[document];
+      entry._id = id;
+      entry._words = frequencies.keys ();
+      entry._length = words.size ();
+
+      _document_ids.insert (id, document);
+      _total_length += entry._length;
+
+      for (QHash<QString, int>::const_iterator i = frequencies.begin (); i != frequencies.end (); ++i)
+        {
+          Posting posting;
+          posting._document = document;
+          posting._frequency = i.value ();
+
+          _postings[i.key ()].push_back (posting);
+        }
+    }
+
+    /*!
+     * Remove document from the index
+     *
+     * @param id Id of the point whose text should be removed
+     */
+    void TextIndex::remove (const QString& id)
+    {
+      int document = _document_ids.value (id, -1);
+      if (document == -1)
+        return;
+
+      Document& entry = _documents[document];
+
+      foreach (const QString& word, entry._words)
+        {
+          QMap<QString, QVector<Posting> >::iterator pos = _postings.find (word);
+          Q_ASSERT (pos != _postings.end ());
+
+          QVector<Posting>& postings = pos.value ();
+          for (int i=0; i < postings.size (); ++i)
+            if (postings[i]._document == document)
+              {
+                postings.remove (i);
+                break;
+              }
+
+          if (postings.isEmpty ())
+            _postings.erase (pos);
+        }
+
+      _total_length -= entry._length;
+      _document_ids.remove (id);
+
+      entry = Document ();
+      _free_documents.push_back (document);
+    }
+
+    /*!
+     * Search for documents matching a query
+     *
+     * @param query Query text. Each word of the query matches all indexed words starting
+     *              with it. Documents must match all query words.
+     * @return Matching point ids, sorted by descending score
+     */
+    QList<TextIndex::Match> TextIndex::search (const QString& query) const
+    {
+      QList<Match> matches;
+
+      QStringList words = tokenize (query);
+      words.removeDuplicates ();
+
+      if (words.isEmpty () || _document_ids.isEmpty ())
+        return matches;
+
+      float number_of_documents = _document_ids.size ();
+      float average_length = qMax (float (_total_length) / number_of_documents, 1.0f);
+
+      QHash<int, float> scores;
+
+      for (int i=0; i < words.size (); ++i)
+        {
+          QHash<int, float> word_scores;
+
+          for ( QMap<QString, QVector<Posting> >::const_iterator pos = _postings.lowerBound (words[i]);
+                pos != _postings.end () && pos.key ().startsWith (words[i]); ++pos )
+            {
+              const QVector<Posting>& postings = pos.value ();
+
+              float df = postings.size ();
+              float idf = std::log (1.0f + (number_of_documents - df + 0.5f) / (df + 0.5f));
+
+              foreach (const Posting& posting, postings)
+                {
+                  float tf = posting._frequency;
+                  float length = _documents[posting._document]._length;
+                  float score = idf * tf * (BM25_K1 + 1.0f) /
+                    (tf + BM25_K1 * (1.0f - BM25_B + BM25_B * length / average_length));
+
+                  float& best = word_scores[posting._document];
+                  best = qMax (best, score);
+                }
+            }
+
+          //
+          // Documents must match all query words
+          //
+          if (i == 0)
+            scores = word_scores;
+          else
+            {
+              for (QHash<int, float>::iterator j = scores.begin (); j != scores.end (); )
+                {
+                  QHash<int, float>::const_iterator word_score = word_scores.find (j.key ());
+
+                  if (word_score == word_scores.end ())
+                    j = scores.erase (j);
+                  else
+                    {
+                      j.value () += word_score.value ();
+                      ++j;
+                    }
+                }
+            }
+
+          if (scores.isEmpty ())
+            break;
+        }
+
+      matches.reserve (scores.size ());
+
+      for (QHash<int, float>::const_iterator i = scores.begin (); i != scores.end (); ++i)
+        matches.push_back (Match (_documents[i.key ()]._id, i.value ()));
+
+      std::sort (matches.begin (), matches.end (), compareMatches);
+
+      return matches;
+    }
+
+    /*!
+     * Check if a single document matches a query
+     *
+     * Same as checking if the document is part of the 'search ()' result, but without
+     * looking at any other document.
+     *
+     * @param id    Id of the point the document belongs to
+     * @param query Query text
+     * @return 'true' if the document contains words starting with each query word
+     */
+    bool TextIndex::matches (const QString& id, const QString& query) const
+    {
+      QHash<QString, int>::const_iterator document = _document_ids.find (id);
+      if (document == _document_ids.end ())
+        return false;
+
+      const QStringList& document_words = _documents[document.value ()]._words;
+
+      QStringList words = tokenize (query);
+      bool match = !words.isEmpty ();
+
+      for (int i=0; i < words.size () && match; ++i)
+        {
+          match = false;
+
+          foreach (const QString& word, document_words)
+            if (word.startsWith (words[i]))
+              {
+                match = true;
+                break;
+              }
+        }
+
+      return match;
+    }
+
+  }
+}
@@ -103,6 +103,7 @@ namespace HIP {
         case Database::Database::Reason::SELECTION:
         case Database::Database::Reason::FILTER:
         case Database::Database::Reason::VIEW:
+        case Database::Database::Reason::PLACEMENT:
           break;
         }
     }
@@ -215,9 +216,16 @@ namespace HIP {
     /*! Filter text changed */
     void TagSelector::onTextChanged (const QString& text)
     {
-      foreach (const Database::Point& point, _database->getPoints ())
-        if (point.getSelected () && !point.matches (text))
-          _database->deselect (point.getId ());
+      const QList<Database::Point>& points = _database->getPoints ();
+      QBitArray matches = _database->match (text);
+
+      QSet<QString> ids;
+
+      for (int i=0; i < points.size (); ++i)
+        if (points[i].getSelected () && !matches.testBit (i))
+          ids.insert (points[i].getId ());
+
+      _database->deselect (ids);
 
       if (_database->getFilter () != text)
         _database->setFilter (text);
@@ -146,21 +146,17 @@ namespace HIP {
      */
     void PointExplorerView::onSelectionChanged (const QItemSelection& selected, const QItemSelection& deselected)
     {
-      foreach (QModelIndex index, selected.indexes ())
-        {
-          QString id = _filter->data (index, Database::DatabaseModel::Role::ID).toString ();
+      QSet<QString> selected_ids;
+      QSet<QString> deselected_ids;
 
-          if (!_database->getPoint (id).getSelected ())
-            _database->select (id);
-        }
+      foreach (QModelIndex index, selected.indexes ())
+        selected_ids.insert (_filter->data (index, Database::DatabaseModel::Role::ID).toString ());
 
       foreach (QModelIndex index, deselected.indexes ())
-        {
-          QString id = _filter->data (index, Database::DatabaseModel::Role::ID).toString ();
+        deselected_ids.insert (_filter->data (index, Database::DatabaseModel::Role::ID).toString ());
 
-          if (_database->getPoint (id).getSelected ())
-            _database->deselect (id);
-        }
+      _database->deselect (deselected_ids);
+      _database->select (selected_ids);
     }
 
     /*!
@@ -177,18 +173,40 @@ namespace HIP {
       {
         case Database::Database::Reason::SELECTION:
           {
-            Q_ASSERT (data.type () == QVariant::String);
-
-            QString id = data.toString ();
-            Q_ASSERT (!id.isEmpty ());
-
-            QModelIndex index = _filter->mapFromSource (_model->getIndex (id));
-            Q_ASSERT (index.isValid ());
-
-            if (_database->getPoint (id).getSelected ())
-              _ui->_tree_w->selectionModel ()->select (index, QItemSelectionModel::Select | QItemSelectionModel::Rows);
-            else
-              _ui->_tree_w->selectionModel ()->select (index, QItemSelectionModel::Deselect | QItemSelectionModel::Rows);
+            Q_ASSERT (data.canConvert<Database::RowRanges> ());
+
+            //
+            // Split the changed rows into selected and deselected source ranges and
+            // apply each set with a single selection model update
+            //
+            QItemSelection selected;
+            QItemSelection deselected;
+
+            foreach (const Database::RowRanges::Range& range, data.value<Database::RowRanges> ().getRanges ())
+              {
+                int first = range.first;
+                bool state = _database->getPoints ()[first].getSelected ();
+
+                for (int row=range.first; row <= range.second + 1; ++row)
+                  if (row > range.second || _database->getPoints ()[row].getSelected () != state)
+                    {
+                      QItemSelection& target = state ? selected : deselected;
+                      target.select (_model->index (first, 0), _model->index (row - 1, 0));
+
+                      if (row <= range.second)
+                        {
+                          first = row;
+                          state = !state;
+                        }
+                    }
+              }
+
+            if (!selected.isEmpty ())
+              _ui->_tree_w->selectionModel ()->select (_filter->mapSelectionFromSource (selected),
+                                                       QItemSelectionModel::Select | QItemSelectionModel::Rows);
+            if (!deselected.isEmpty ())
+              _ui->_tree_w->selectionModel ()->select (_filter->mapSelectionFromSource (deselected),
+                                                       QItemSelectionModel::Deselect | QItemSelectionModel::Rows);
           }
           break;
 
@@ -196,6 +214,7 @@ namespace HIP {
         case Database::Database::Reason::POINT:
         case Database::Database::Reason::FILTER:
         case Database::Database::Reason::VIEW:
+        case Database::Database::Reason::PLACEMENT:
           break;
       }
     }
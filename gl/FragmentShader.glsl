@@ -1,6 +1,8 @@
 
 uniform sampler2D in_texture;
 uniform bool has_texture;
+uniform bool in_pick_mode;
+uniform highp vec4 in_pick_id;
 
 varying mediump vec4 fragment_color;
 varying mediump vec2 fragment_texture;
@@ -22,6 +24,12 @@ const float specular_reflection = 1.0;
 
 void main(void)
 {
+  if (in_pick_mode)
+    {
+      gl_FragColor = in_pick_id;
+      return;
+    }
+
   vec3 n = normalize (fragment_normal);
   vec3 light_direction = normalize (fragment_light_direction);
   vec3 viewer_direction = normalize (fragment_viewer_direction);
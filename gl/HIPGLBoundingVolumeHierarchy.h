@@ -0,0 +1,135 @@
+/*
+ * HIPGLBoundingVolumeHierarchy.h - Acceleration structure for ray and closest point queries on meshes
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPGLBoundingVolumeHierarchy_h__
+#define __HIPGLBoundingVolumeHierarchy_h__
+
+#include "gl/HIPGLMesh.h"
+
+#include <QBitArray>
+#include <QSharedPointer>
+#include <QVector>
+#include <QVector3D>
+
+namespace HIP {
+  namespace GL {
+
+    /*!
+     * Ray with normalized direction
+     */
+    class Ray
+    {
+    public:
+      Ray (const QVector3D& origin, const QVector3D& direction);
+
+      const QVector3D& getOrigin () const    { return _origin; }
+      const QVector3D& getDirection () const { return _direction; }
+
+      QVector3D getPoint (float distance) const { return _origin + _direction * distance; }
+
+    private:
+      QVector3D _origin;
+      QVector3D _direction;
+    };
+
+    /*!
+     * Location on a mesh triangle found by a ray or closest point query
+     */
+    class Hit
+    {
+    public:
+      Hit ();
+      Hit (int group, int triangle, float distance, const QVector3D& position, const QVector3D& normal);
+
+      bool isValid () const                { return _triangle >= 0; }
+
+      int getGroup () const                { return _group; }
+      int getTriangle () const             { return _triangle; }
+      float getDistance () const           { return _distance; }
+      const QVector3D& getPosition () const { return _position; }
+      const QVector3D& getNormal () const   { return _normal; }
+
+    private:
+      int _group;
+      int _triangle;
+      float _distance;
+      QVector3D _position;
+      QVector3D _normal;
+    };
+
+    /*!
+     * Bounding volume hierarchy over the triangles of a mesh
+     *
+     * The hierarchy is a binary tree of axis aligned boxes, built top down by splitting
+     * the triangles at the position with the lowest estimated traversal cost according
+     * to the surface area heuristic (SAH). The split candidates are evaluated in a fixed
+     * number of bins per axis, so the build runs in O (n log n).
+     *
+     * Besides ray intersections, the hierarchy answers closest point queries, which are
+     * used to place points onto the mesh surface. Batches of closest point queries are
+     * distributed over all cores.
+     *
+     * The triangles are referenced by their index in the mesh index buffer, so the mesh
+     * is kept alive by the hierarchy. Queries are read only and can be run from multiple
+     * threads at once.
+     */
+    class BoundingVolumeHierarchy
+    {
+    public:
+      BoundingVolumeHierarchy (const MeshPtr& mesh);
+      ~BoundingVolumeHierarchy ();
+
+      const MeshPtr& getMesh () const { return _mesh; }
+
+      int getNumberOfNodes () const   { return _nodes.size (); }
+      int getDepth () const           { return _depth; }
+
+      int findGroup (int triangle) const;
+
+      bool intersect (const Ray& ray, Hit* hit, const QBitArray& groups=QBitArray ()) const;
+
+      bool findClosest (const QVector3D& point, Hit* hit, const QBitArray& groups=QBitArray ()) const;
+      QVector<Hit> findClosest (const QVector<QVector3D>& points, const QBitArray& groups=QBitArray ()) const;
+
+    private:
+      /*
+       * Tree node. Inner nodes have a triangle count of 0 and '_first' is the index of the
+       * left child, the right child directly follows. Leaf nodes reference the range
+       * '[_first, _first + _count)' in the reordered triangle list.
+       */
+      struct Node
+      {
+        QVector3D _minimum;
+        int _first;
+        QVector3D _maximum;
+        int _count;
+      };
+
+      void build ();
+
+      bool intersectBox (const Node& node, const QVector3D& origin, const QVector3D& inverse_direction,
+                         float max_distance, float* distance) const;
+      bool intersectTriangle (int triangle, const Ray& ray, float max_distance, float* distance) const;
+
+      float computeBoxDistance (const Node& node, const QVector3D& point) const;
+      QVector3D computeClosestPoint (int triangle, const QVector3D& point) const;
+      QVector3D computeNormal (int triangle, const QVector3D& position) const;
+
+    private:
+      MeshPtr _mesh;
+
+      QVector<Node> _nodes;
+      QVector<int> _triangles;
+      QVector<int> _group_offsets;
+      int _depth;
+    };
+
+    typedef QSharedPointer<BoundingVolumeHierarchy> BoundingVolumeHierarchyPtr;
+
+  }
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * HIPGLBounds.h - Bounding volumes and view frustum
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPGLBounds_h__
+#define __HIPGLBounds_h__
+
+#include <QMatrix4x4>
+#include <QVector>
+#include <QVector3D>
+#include <QVector4D>
+
+namespace HIP {
+  namespace GL {
+
+    /*!
+     * Axis aligned bounding box together with an enclosing sphere
+     */
+    class Bounds
+    {
+    public:
+      Bounds ();
+      Bounds (const QVector3D& minimum, const QVector3D& maximum, const QVector3D& center, float radius);
+
+      bool isValid () const                 { return _radius >= 0.0f; }
+
+      const QVector3D& getMinimum () const  { return _minimum; }
+      const QVector3D& getMaximum () const  { return _maximum; }
+      const QVector3D& getCenter () const   { return _center; }
+      float getRadius () const              { return _radius; }
+
+      static Bounds compute (const QVector<QVector3D>& vertices, const int* indices, int number_of_indices);
+
+    private:
+      QVector3D _minimum;
+      QVector3D _maximum;
+      QVector3D _center;
+      float _radius;
+    };
+
+    /*!
+     * View frustum for visibility tests
+     *
+     * The frustum planes are extracted from a combined model view projection matrix,
+     * so the tested volumes are expected in model coordinates.
+     */
+    class Frustum
+    {
+    public:
+      Frustum (const QMatrix4x4& mvp);
+
+      bool intersects (const Bounds& bounds) const;
+
+    private:
+      QVector4D _planes[6];
+    };
+
+  }
+}
+
+#endif
@@ -7,8 +7,14 @@
 #ifndef __HIPGLData_h__
 #define __HIPGLData_h__
 
+#include "gl/HIPGLBounds.h"
+#include "gl/HIPGLBoundingVolumeHierarchy.h"
+#include "gl/HIPGLGeodesics.h"
+
+#include <QFuture>
 #include <QList>
 #include <QMap>
+#include <QMatrix4x4>
 #include <QString>
 #include <QVector>
 #include <QVector2D>
@@ -35,6 +41,7 @@ namespace HIP {
       void setNormalIndex (int index) { _normal_index = index; }
       void setTextureIndex (int index) { _texture_index = index; }
 
+      bool operator== (const Point& point) const;
       bool operator< (const Point& point) const;
 
     private:
@@ -44,23 +51,6 @@ namespace HIP {
     };
 
 
-    /*!
-     * Single face definition
-     */
-    class Face
-    {
-    public:
-      Face (const QList<Point>& points);
-      ~Face ();
-
-      const QList<Point>& getPoints () const { return _points; }
-
-      void setNormalIndex (int index);
-
-    private:
-      QList<Point> _points;
-    };
-
     /*!
      * Class keeping material information
      */
@@ -101,6 +91,10 @@ namespace HIP {
 
     /*!
      * Single group
+     *
+     * The triangles of a group are stored as flat structure-of-arrays index lists with
+     * three consecutive entries per triangle, one list each for the vertex, normal and
+     * texture indices. Missing indices are -1.
      */
     class Group
     {
@@ -110,29 +104,64 @@ namespace HIP {
 
       const QString& getName () const      { return _name; }
       const QString& getMaterial () const  { return _material; }
-      const QList<Face>& getFaces () const { return _faces; }
+
+      int getNumberOfTriangles () const             { return _vertex_indices.size () / 3; }
+      const QVector<int>& getVertexIndices () const  { return _vertex_indices; }
+      const QVector<int>& getNormalIndices () const  { return _normal_indices; }
+      const QVector<int>& getTextureIndices () const { return _texture_indices; }
+
+      Point getPoint (int triangle, int corner) const;
 
       void setName (const QString& name)         { _name = name; }
       void setMaterial (const QString& material) { _material = material; }
-      void addFace (const Face& face)            { _faces.push_back (face); }
 
-      void setNormalIndex (int face_index, int index);
+      void reserve (int number_of_triangles);
+      void addTriangle (const Point& p0, const Point& p1, const Point& p2);
+      void addTriangles (const int* vertex_indices, const int* normal_indices, const int* texture_indices,
+                         int number_of_triangles);
+
+      void setNormalIndex (int triangle, int index);
+
+      const Bounds& getBounds () const { return _bounds; }
+      void updateBounds (const QVector<QVector3D>& vertices);
+
+      int getMemoryUsage () const;
 
     private:
       QString _name;
       QString _material;
-      QList<Face> _faces;
+
+      QVector<int> _vertex_indices;
+      QVector<int> _normal_indices;
+      QVector<int> _texture_indices;
+
+      Bounds _bounds;
     };
 
     typedef QSharedPointer<Group> GroupPtr;
 
     /*!
      * Class for loading and keeping a GL model dataset
+     *
+     * If the binary mesh cache is used and a valid cache file exists, only the name,
+     * materials, bounding box and the render ready mesh are loaded. The raw OBJ data
+     * (vertices, normals, textures and group faces) is empty in this case.
+     *
+     * The vertices are scaled into the unit sphere when loading. The transformation
+     * from the coordinates of the OBJ file into model coordinates is kept, so positions
+     * given in file coordinates can be mapped onto the model.
      */
     class Data
     {
     public:
-      Data (const QString& path); // throws Exception
+      struct Loader { enum Type_t { TEXT, STREAMING, PARALLEL }; };
+      typedef Loader::Type_t Loader_t;
+
+      typedef QPair<QVector3D, QVector3D> Cube;
+      typedef QMap<QString, Material> MaterialMap;
+
+    public:
+      Data (const QString& path, Loader_t loader=Loader::STREAMING, bool use_cache=false); // throws Exception
       ~Data ();
 
       const QString& getName () const                { return _name; }
@@ -140,15 +169,31 @@ namespace HIP {
       const QVector<QVector3D>& getNormals () const  { return _normals; }
       const QVector<QVector2D>& getTextures () const { return _textures; }
       const QVector<GroupPtr>& getGroups () const    { return _groups; }
+      const MaterialMap& getMaterials () const       { return _materials; }
+      const QString& getMaterialLibrary () const     { return _material_library; }
 
-      typedef QPair<QVector3D, QVector3D> Cube;
-      const Cube& getBoundingBox () const { return _bounding_box; }
+      const Cube& getBoundingBox () const      { return _bounding_box; }
+      const QMatrix4x4& getTransform () const  { return _transform; }
       const Material& getMaterial (const QString& name) const;
 
+      const Mesh& getMesh () const;
+
+      QFuture<BoundingVolumeHierarchyPtr> buildHierarchy () const;
+      const BoundingVolumeHierarchy* getHierarchy () const;
+
+      QFuture<GeodesicsPtr> buildGeodesics () const;
+      const Geodesics* getGeodesics () const;
+
       void normalize ();
       void scale (double factor);
 
     private:
+      void load (const QString& path, Loader_t loader); // throws Exception
+      bool loadCache (const QString& path);
+      void saveCache (const QString& path) const;
+
+      void parseText (const QString& path, QString* material_library); // throws Exception
+      void parseStreaming (const QString& path, bool parallel, QString* material_library); // throws Exception
       void loadMaterial (const QString& path); // throws Exception
       void updateBoundingBox ();
 
@@ -160,16 +205,19 @@ namespace HIP {
       QVector<QVector3D> _normals;
       QVector<QVector2D> _textures;
       QVector<GroupPtr> _groups;
-
-      typedef QMap<QString, Material> MaterialMap;
       MaterialMap _materials;
+      QString _material_library;
 
       Cube _bounding_box;
+      QMatrix4x4 _transform;
+
+      mutable QSharedPointer<Mesh> _mesh;
+      mutable QFuture<BoundingVolumeHierarchyPtr> _hierarchy;
+      mutable QFuture<GeodesicsPtr> _geodesics;
     };
 
   }
 
-  QDebug& operator<< (QDebug& stream, const GL::Face& face);
   QDebug& operator<< (QDebug& stream, const GL::Point& point);
   QDebug& operator<< (QDebug& stream, const GL::Material& material);
   QDebug& operator<< (QDebug& stream, const GL::Group& group);
@@ -0,0 +1,133 @@
+/*
+ * HIPGLGeodesics.h - Geodesic distances and shortest paths on the mesh surface
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPGLGeodesics_h__
+#define __HIPGLGeodesics_h__
+
+#include "gl/HIPGLMesh.h"
+#include "gl/HIPGLSparseMatrix.h"
+
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+#include <QVector3D>
+
+namespace HIP {
+  namespace GL {
+
+    /*!
+     * Location on the mesh surface
+     */
+    class SurfacePoint
+    {
+    public:
+      SurfacePoint ();
+      SurfacePoint (int triangle, const QVector3D& position);
+
+      bool isValid () const                 { return _triangle >= 0; }
+
+      int getTriangle () const              { return _triangle; }
+      const QVector3D& getPosition () const { return _position; }
+
+      bool operator== (const SurfacePoint& point) const;
+
+    private:
+      int _triangle;
+      QVector3D _position;
+    };
+
+    /*!
+     * Geodesic distances and shortest paths on the mesh surface
+     *
+     * The render mesh duplicates vertices with differing normals or texture coordinates,
+     * so the vertices are welded by position first. Two methods are provided:
+     *
+     * - GRAPH: Dijkstra's algorithm on the mesh edge graph. Exact for paths along the
+     *   edges, so it overestimates the true surface distance by a few percent.
+     * - HEAT: The heat method (Crane et al., 2013). Heat is diffused from the source for
+     *   a short time, the normalized heat gradient is integrated by solving a Poisson
+     *   equation. Both linear systems are factorized once per mesh, so each query is a
+     *   pair of forward and backward substitutions.
+     *
+     * The factorizations are computed on the first heat query or in advance by calling
+     * 'prepare ()', e.g. in a background thread. The distance fields of
+     * the most recent sources are cached, so repeated queries from the same source are
+     * answered by interpolation only. Queries can be run from multiple threads; they
+     * are serialized internally.
+     */
+    class Geodesics
+    {
+    public:
+      struct Method { enum Type_t { GRAPH, HEAT }; };
+      typedef Method::Type_t Method_t;
+
+    public:
+      Geodesics (const MeshPtr& mesh);
+      ~Geodesics ();
+
+      const MeshPtr& getMesh () const         { return _mesh; }
+      int getNumberOfVertices () const        { return _positions.size (); }
+
+      void prepare () const;
+
+      QVector<float> computeDistances (const SurfacePoint& source, Method_t method) const;
+      float computeDistance (const SurfacePoint& source, const SurfacePoint& target, Method_t method) const;
+      QVector<QVector3D> computePath (const SurfacePoint& source, const SurfacePoint& target) const;
+
+    private:
+      /*
+       * Cached distance field of a single source
+       */
+      struct Field
+      {
+        SurfacePoint _source;
+        Method_t _method;
+        QVector<float> _distances;
+      };
+
+      void weld ();
+      void computeGraph ();
+      void computeComponents ();
+
+      void computeOperators () const;
+      QVector<int> computeOrdering () const;
+      void dissect (int* vertices, int count, QVector<int>* sides, int* tag, QVector<int>* order) const;
+
+      QVector<float> computeGraphDistances (const SurfacePoint& source) const;
+      QVector<float> computeHeatDistances (const SurfacePoint& source) const;
+
+      const QVector<float>& getDistances (const SurfacePoint& source, Method_t method) const;
+      float interpolate (const QVector<float>& distances, const SurfacePoint& point, Method_t method) const;
+      void computeWeights (const SurfacePoint& point, float* weights) const;
+
+    private:
+      MeshPtr _mesh;
+
+      QVector<QVector3D> _positions;       // Welded vertex positions
+      QVector<int> _triangles;             // Welded vertex indices, three per mesh triangle
+      QVector<int> _components;            // Connected component of each vertex
+
+      QVector<int> _adjacency_offsets;     // Edge graph in compressed row storage
+      QVector<int> _adjacency;
+      QVector<float> _edge_lengths;
+      float _mean_edge_length;
+
+      mutable QMutex _mutex;
+      mutable bool _operators_computed;
+      mutable QVector<double> _cotangents;  // Cotangent of the angle at each triangle corner
+      mutable SparseLDLT _heat_solver;      // M + t L
+      mutable SparseLDLT _poisson_solver;   // L + e M
+
+      mutable QList<Field> _fields;
+    };
+
+    typedef QSharedPointer<Geodesics> GeodesicsPtr;
+
+  }
+}
+
+#endif
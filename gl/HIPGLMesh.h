@@ -0,0 +1,145 @@
+/*
+ * HIPGLMesh.h - Render ready mesh data
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPGLMesh_h__
+#define __HIPGLMesh_h__
+
+#include "gl/HIPGLBounds.h"
+
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include <QVector2D>
+#include <QVector3D>
+
+#include <qopengl.h>
+
+class QFile;
+
+namespace HIP {
+  namespace GL {
+
+    class Data;
+    class Point;
+
+    /*!
+     * Single interleaved vertex as uploaded into the vertex buffer
+     */
+    struct VertexData
+    {
+      VertexData () {}
+      VertexData (const QVector3D& vertex, const QVector3D& normal, const QVector2D& texture);
+
+      QVector3D _vertex;
+      QVector3D _normal;
+      QVector2D _texture;
+    };
+
+    /*!
+     * Hash map assigning consecutive indices to unique OBJ face points
+     *
+     * Open addressing hash table with linear probing. Each slot keeps the packed
+     * (vertex, normal, texture) index triple together with the assigned index, so
+     * a lookup usually touches a single cache line and insertions do not allocate.
+     */
+    class PointIndexMap
+    {
+    public:
+      PointIndexMap (int expected_size=0);
+
+      int insert (const Point& point, bool* inserted=0);
+      int find (const Point& point) const;
+
+      int size () const     { return _size; }
+      int capacity () const { return _slots.size () / SLOT_SIZE; }
+
+    private:
+      static const int SLOT_SIZE = 4;
+
+      static quint64 computeHash (qint32 vertex_index, qint32 normal_index, qint32 texture_index);
+      void rehash (int capacity);
+
+    private:
+      QVector<qint32> _slots;
+      int _mask;
+      int _size;
+    };
+
+    /*!
+     * Range of the index buffer belonging to a single model group
+     */
+    class MeshGroup
+    {
+    public:
+      MeshGroup ();
+      MeshGroup (const QString& name, const QString& material, int first_index, int number_of_indices,
+                 const Bounds& bounds);
+
+      const QString& getName () const     { return _name; }
+      const QString& getMaterial () const { return _material; }
+      int getFirstIndex () const          { return _first_index; }
+      int getNumberOfIndices () const     { return _number_of_indices; }
+      const Bounds& getBounds () const    { return _bounds; }
+
+    private:
+      QString _name;
+      QString _material;
+      int _first_index;
+      int _number_of_indices;
+      Bounds _bounds;
+    };
+
+    /*!
+     * Render ready mesh
+     *
+     * The mesh keeps the deduplicated, interleaved vertex array, the triangle index
+     * buffer and the index ranges of the model groups. The data is either computed
+     * from a parsed OBJ model or memory mapped from a binary mesh cache file. Computed
+     * meshes are optimized for vertex cache and vertex fetch efficiency by default.
+     */
+    class Mesh
+    {
+    public:
+      Mesh (const Data* data, bool optimize=true);
+      Mesh (const QSharedPointer<QFile>& mapping,
+            const VertexData* vertex_data, int number_of_vertices,
+            const GLuint* index_data, int number_of_indices,
+            const QVector<MeshGroup>& groups);
+      ~Mesh ();
+
+      const VertexData* getVertexData () const     { return _vertex_data; }
+      int getNumberOfVertices () const             { return _number_of_vertices; }
+
+      const GLuint* getIndexData () const          { return _index_data; }
+      int getNumberOfIndices () const              { return _number_of_indices; }
+
+      const QVector<MeshGroup>& getGroups () const { return _groups; }
+
+    private:
+      void optimizeBuffers ();
+
+    private:
+      QVector<VertexData> _vertex_storage;
+      QVector<GLuint> _index_storage;
+      QSharedPointer<QFile> _mapping;
+
+      const VertexData* _vertex_data;
+      int _number_of_vertices;
+
+      const GLuint* _index_data;
+      int _number_of_indices;
+
+      QVector<MeshGroup> _groups;
+    };
+
+    typedef QSharedPointer<Mesh> MeshPtr;
+
+  }
+}
+
+Q_DECLARE_TYPEINFO (HIP::GL::VertexData, Q_PRIMITIVE_TYPE)
+
+#endif
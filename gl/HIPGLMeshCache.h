@@ -0,0 +1,65 @@
+/*
+ * HIPGLMeshCache.h - Binary cache for render ready meshes
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPGLMeshCache_h__
+#define __HIPGLMeshCache_h__
+
+#include "gl/HIPGLData.h"
+#include "gl/HIPGLMesh.h"
+
+#include <QByteArray>
+#include <QMatrix4x4>
+#include <QString>
+
+namespace HIP {
+  namespace GL {
+
+    /*!
+     * Binary cache for render ready meshes
+     *
+     * The cache file keeps everything needed to display a model without parsing the
+     * OBJ file again: the interleaved vertex array, the index buffer, the group index
+     * ranges, the materials, the bounding box and the transformation into model
+     * coordinates. The vertex and index buffers are memory mapped on loading and can
+     * be uploaded to the GPU directly.
+     *
+     * Cache files are stored in the users cache directory and are keyed by the path, size
+     * and modification time of the source file and of its material library. For files
+     * compiled into the resources, a hash of the content is used instead of the
+     * modification time.
+     */
+    class MeshCache
+    {
+    public:
+      MeshCache (const QString& source);
+      ~MeshCache ();
+
+      bool load ();
+      bool save (const Data& data);
+
+      const QString& getName () const                { return _name; }
+      const Data::MaterialMap& getMaterials () const { return _materials; }
+      const QString& getMaterialLibrary () const     { return _material_library; }
+      const Data::Cube& getBoundingBox () const      { return _bounding_box; }
+      const QMatrix4x4& getTransform () const        { return _transform; }
+      const MeshPtr& getMesh () const                { return _mesh; }
+
+    private:
+      QString _source;
+      QString _path;
+
+      QString _name;
+      Data::MaterialMap _materials;
+      QString _material_library;
+      Data::Cube _bounding_box;
+      QMatrix4x4 _transform;
+      MeshPtr _mesh;
+    };
+
+  }
+}
+
+#endif
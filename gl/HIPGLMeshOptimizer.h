@@ -0,0 +1,46 @@
+/*
+ * HIPGLMeshOptimizer.h - Index buffer optimization for GPU vertex processing
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPGLMeshOptimizer_h__
+#define __HIPGLMeshOptimizer_h__
+
+#include <QVector>
+
+#include <qopengl.h>
+
+namespace HIP {
+  namespace GL {
+    namespace MeshOptimizer {
+
+      //#**********************************************************************
+      // Reordering
+      //#**********************************************************************
+
+      /*!
+       * Default size of the simulated post transform vertex cache
+       */
+      const int DEFAULT_CACHE_SIZE = 16;
+
+      void optimizeVertexCache (GLuint* indices, int number_of_indices, int number_of_vertices,
+                                int cache_size=DEFAULT_CACHE_SIZE);
+
+      QVector<int> optimizeVertexFetch (GLuint* indices, int number_of_indices, int number_of_vertices);
+
+      //#**********************************************************************
+      // Statistics
+      //#**********************************************************************
+
+      int countCacheMisses (const GLuint* indices, int number_of_indices, int cache_size=DEFAULT_CACHE_SIZE);
+
+      double computeACMR (const GLuint* indices, int number_of_indices, int cache_size=DEFAULT_CACHE_SIZE);
+      double computeATVR (const GLuint* indices, int number_of_indices, int number_of_vertices,
+                          int cache_size=DEFAULT_CACHE_SIZE);
+
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * HIPGLPickBuffer.h - Offscreen id buffer for picking pins and model groups
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPGLPickBuffer_h__
+#define __HIPGLPickBuffer_h__
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFramebufferObject>
+#include <QPoint>
+#include <QRect>
+#include <QScopedPointer>
+#include <QSize>
+#include <QVector>
+#include <QVector4D>
+
+namespace HIP {
+  namespace GL {
+
+    /*!
+     * Offscreen id buffer for picking pins and model groups
+     *
+     * The scene is rendered into the buffer with each fragment colored by the id of the
+     * object it belongs to. The id is packed into the RGBA channels of the color attachment:
+     * the object index occupies the red, green and blue channels, the object type the alpha
+     * channel. A cleared pixel (type NONE) is background.
+     *
+     * Reading back is asynchronous if pixel buffer objects are supported. Only a small region
+     * around the requested position is read into one of two alternating pixel buffers and is
+     * mapped one frame later, when the GPU has finished the transfer, so the render pipeline
+     * is never stalled.
+     */
+    class PickBuffer
+    {
+    public:
+      struct Type { enum Type_t { NONE = 0, GROUP = 1, PIN = 2 }; };
+      typedef Type::Type_t Type_t;
+
+      /*!
+       * Picked object
+       */
+      class Pick
+      {
+      public:
+        Pick ();
+        Pick (Type_t type, int id, const QPoint& position, int tag);
+
+        bool isValid () const                { return _type != Type::NONE; }
+
+        Type_t getType () const              { return _type; }
+        int getId () const                   { return _id; }
+        const QPoint& getPosition () const   { return _position; }
+        int getTag () const                  { return _tag; }
+
+      private:
+        Type_t _type;
+        int _id;
+        QPoint _position;
+        int _tag;
+      };
+
+    public:
+      PickBuffer ();
+      ~PickBuffer ();
+
+      void initialize ();
+      void destroy ();
+
+      bool isValid () const     { return _valid; }
+      void invalidate ()        { _valid = false; }
+
+      void bind (const QSize& size);
+      void release ();
+
+      void read (const QPoint& position, int tag=0);
+      bool isReadPending () const;
+      bool fetch (Pick* pick);
+
+      static QVector4D encode (Type_t type, int id);
+
+    private:
+      /*
+       * Pending read of a buffer region
+       */
+      struct Request
+      {
+        Request ();
+
+        bool _pending;
+        QRect _region;
+        QPoint _position;
+        int _tag;
+      };
+
+      Pick decode (const uchar* pixels, const Request& request) const;
+
+    private:
+      QScopedPointer<QOpenGLFramebufferObject> _framebuffer;
+      bool _valid;
+
+      bool _use_pixel_buffers;
+      QOpenGLBuffer _pixel_buffers[2];
+      QVector<uchar> _pixels;
+
+      Request _requests[2];
+      int _next_request;
+      int _fresh_request;
+    };
+
+
+    /*!
+     * Pick requests of a view
+     *
+     * Hovering requests a pick with each mouse move, a click requests one pick only. The
+     * click request is kept apart from the hover requests, so a following mouse move
+     * cannot replace it, and is read first. Each click read is tagged with a serial
+     * number: a pick answers the click only if it carries the serial of the last click,
+     * never because a hover pick happens to be at the clicked position.
+     */
+    class PickRequests
+    {
+    public:
+      PickRequests ();
+
+      void requestHover (const QPoint& position);
+      void requestClick (const QPoint& position, Qt::KeyboardModifiers modifiers);
+
+      bool hasRequest () const;
+      bool takeRequest (QPoint* position, int* tag);
+
+      bool isClick (const PickBuffer::Pick& pick, Qt::KeyboardModifiers* modifiers);
+
+    private:
+      QPoint _hover_position;
+      bool _hover_requested;
+
+      QPoint _click_position;
+      Qt::KeyboardModifiers _click_modifiers;
+      bool _click_requested;
+      bool _click_pending;
+      int _click_serial;
+    };
+
+  }
+}
+
+#endif
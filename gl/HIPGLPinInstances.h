@@ -0,0 +1,119 @@
+/*
+ * HIPGLPinInstances.h - Instanced rendering of all database pins
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPGLPinInstances_h__
+#define __HIPGLPinInstances_h__
+
+#include <QList>
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QSharedPointer>
+#include <QVector>
+#include <QVector3D>
+
+#include <qopengl.h>
+
+namespace HIP {
+
+  namespace Database {
+    class Point;
+  }
+
+  namespace GL {
+
+    class Data;
+
+    /*!
+     * Renderer drawing the pins of all database points
+     *
+     * The pin mesh is uploaded once. The per pin attributes (position, color and
+     * selection state) are kept in a separate instance buffer which is updated only
+     * if the points changed, so all pins are drawn with a single instanced draw call.
+     * If instancing is not supported by the GL implementation, the pins are drawn
+     * one by one with the same shader.
+     *
+     * The pins are oriented along the surface normals of their points.
+     *
+     * Each instance carries its index in the point list as id. In pick mode, the pins
+     * are drawn with their ids packed into the color channels (see 'PickBuffer').
+     */
+    class PinInstances
+    {
+    public:
+      PinInstances (const Data* data);
+      ~PinInstances ();
+
+      void initialize ();
+
+      void setPoints (const QList<Database::Point>& points);
+      void setHighlighted (int index);
+      int getHighlighted () const { return _highlighted; }
+
+      void paint (const QMatrix4x4& mvp, const QMatrix4x4& mv, bool pick_mode=false);
+
+      bool isInstancingSupported () const;
+
+    private:
+      struct Instance
+      {
+        QVector3D _position;
+        QVector3D _normal;
+        QVector3D _color;
+        float _selected;
+        float _id;
+      };
+
+      typedef void (QOPENGLF_APIENTRYP DrawElementsInstancedFunc) (GLenum mode, GLsizei count, GLenum type,
+                                                                   const void* indices, GLsizei primcount);
+      typedef void (QOPENGLF_APIENTRYP VertexAttribDivisorFunc) (GLuint index, GLuint divisor);
+
+      void setupAttributes ();
+      void releaseAttributes ();
+      void updateInstanceBuffer ();
+
+    private:
+      const Data* _data;
+
+      QOpenGLShaderProgram _shader;
+      QOpenGLBuffer _vertex_buffer;
+      QOpenGLBuffer _index_buffer;
+      QOpenGLBuffer _instance_buffer;
+      QOpenGLVertexArrayObject _vertex_array;
+
+      int _vertex_attr;
+      int _normal_attr;
+      int _position_attr;
+      int _normal_instance_attr;
+      int _color_attr;
+      int _selected_attr;
+      int _id_attr;
+      int _mvp_matrix_attr;
+      int _n_matrix_attr;
+      int _highlighted_attr;
+      int _pick_mode_attr;
+
+      int _number_of_indices;
+      QMatrix4x4 _mvp_matrix;
+      bool _uniforms_valid;
+
+      int _highlighted;
+      bool _highlighted_changed;
+
+      QVector<Instance> _instances;
+      bool _instances_changed;
+
+      DrawElementsInstancedFunc _draw_elements_instanced;
+      VertexAttribDivisorFunc _vertex_attrib_divisor;
+    };
+
+    typedef QSharedPointer<PinInstances> PinInstancesPtr;
+
+  }
+}
+
+#endif
@@ -11,11 +11,13 @@
 #include "database/HIPDatabase.h"
 
 #include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
 #include <QMap>
 #include <QMatrix4x4>
 #include <QSet>
 #include <QSharedPointer>
 
+class QOpenGLShaderProgram;
 class QOpenGLTexture;
 class QString;
 class QVector3D;
@@ -24,7 +26,6 @@ namespace HIP {
   namespace GL {
 
     class Data;
-    struct VertexCollector;
 
     /*
      * Renderable paint configuration
@@ -43,22 +44,47 @@ namespace HIP {
       bool getTransparent () const;
       void setTransparent (bool transparent);
 
+      bool getPickMode () const;
+      void setPickMode (bool pick_mode);
+
     private:
       QVector3D _position;
       QSet<QString> _visible_groups;
       bool _transparent;
+      bool _pick_mode;
     };
 
     /*
      * Renderable object
+     *
+     * The vertex attribute setup is recorded once in a vertex array object, if
+     * supported, so binding the renderable for drawing is a single call. Groups
+     * outside of the view frustum are skipped while painting.
+     *
+     * In pick mode, each group is drawn with its packed group index as color
+     * (see 'PickBuffer').
      */
     class Renderable
     {
+      public:
+        /*
+         * Culling statistics of the last paint call
+         */
+        struct Statistics
+        {
+          Statistics ();
+
+          int _drawn_groups;
+          int _culled_groups;
+          int _drawn_triangles;
+          int _culled_triangles;
+        };
+
       public:
         Renderable (const Data* data);
         ~Renderable ();
 
-        void initialize ();
+        void initialize (QOpenGLShaderProgram* shader, int vertex_attr, int normal_attr, int texture_attr);
         void paint (const QMatrix4x4& mvp, const RenderableParameters& parameters);
 
         void bind ();
@@ -69,8 +95,10 @@ namespace HIP {
         Data::Cube getBoundingBox () const { return _data->getBoundingBox (); }
         int getElementSize () const;
 
+        const Statistics& getStatistics () const { return _statistics; }
+
       private:
-        void addVertex (VertexCollector* collector, const Point& point) const;
+        void setupAttributes ();
         void setLightParameter (uint parameter, const QVector3D& value);
 
       private:
@@ -79,10 +107,20 @@ namespace HIP {
 
         QOpenGLBuffer _vertex_buffer;
         QOpenGLBuffer _index_buffer;
+        QOpenGLVertexArrayObject _vertex_array;
+
+        QOpenGLShaderProgram* _shader;
+        int _vertex_attr;
+        int _normal_attr;
+        int _texture_attr;
+        int _pick_id_attr;
+
         QMatrix4x4 _model_matrix;
 
         typedef QMap<QString, QOpenGLTexture*> TextureMap;
         TextureMap _textures;
+
+        Statistics _statistics;
     };
 
     typedef QSharedPointer<Renderable> RenderablePtr;
@@ -0,0 +1,83 @@
+/*
+ * HIPGLSparseMatrix.h - Sparse symmetric matrices and their factorization
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPGLSparseMatrix_h__
+#define __HIPGLSparseMatrix_h__
+
+#include <QVector>
+
+namespace HIP {
+  namespace GL {
+
+    /*!
+     * Sparse square matrix in compressed column storage
+     *
+     * Symmetric matrices are stored with both triangles.
+     */
+    class SparseMatrix
+    {
+    public:
+      /*!
+       * Single matrix entry used for assembling the matrix
+       */
+      struct Entry
+      {
+        int _row;
+        int _column;
+        double _value;
+      };
+
+    public:
+      SparseMatrix ();
+      SparseMatrix (int size, const QVector<Entry>& entries);
+
+      int getSize () const                           { return _column_offsets.size () - 1; }
+      int getNumberOfEntries () const                { return _rows.size (); }
+
+      const QVector<int>& getColumnOffsets () const  { return _column_offsets; }
+      const QVector<int>& getRows () const           { return _rows; }
+      const QVector<double>& getValues () const      { return _values; }
+
+      void multiply (const QVector<double>& x, QVector<double>* y) const;
+
+    private:
+      QVector<int> _column_offsets;
+      QVector<int> _rows;
+      QVector<double> _values;
+    };
+
+    /*!
+     * Sparse LDL^T factorization of a symmetric positive definite matrix
+     *
+     * The matrix is factorized once in a fill reducing order given by the caller,
+     * afterwards each solve is a forward and a backward substitution only. The
+     * factorization follows the up-looking algorithm of T. Davis (LDL package).
+     */
+    class SparseLDLT
+    {
+    public:
+      SparseLDLT ();
+
+      bool factorize (const SparseMatrix& matrix, const QVector<int>& permutation);
+      void clear ();
+
+      bool isValid () const               { return !_diagonal.isEmpty (); }
+      int getNumberOfEntries () const     { return _rows.size (); }
+
+      void solve (const QVector<double>& b, QVector<double>* x) const;
+
+    private:
+      QVector<int> _permutation;
+      QVector<int> _column_offsets;
+      QVector<int> _rows;
+      QVector<double> _values;
+      QVector<double> _diagonal;
+    };
+
+  }
+}
+
+#endif
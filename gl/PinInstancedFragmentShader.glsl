@@ -0,0 +1,25 @@
+varying mediump vec4 fragment_color;
+varying mediump vec3 fragment_normal;
+varying highp vec4 fragment_id;
+
+uniform bool in_pick_mode;
+
+//
+// Configuration
+//
+const float ambient_reflection = 0.3;
+const float diffuse_reflection = 0.7;
+
+void main(void)
+{
+  if (in_pick_mode)
+    {
+      gl_FragColor = fragment_id;
+      return;
+    }
+
+  vec3 n = normalize (fragment_normal);
+  float diffuse = diffuse_reflection * abs (n.z);
+
+  gl_FragColor = vec4 (fragment_color.rgb * (ambient_reflection + diffuse), fragment_color.a);
+}
@@ -0,0 +1,56 @@
+attribute highp vec4 in_vertex;
+attribute mediump vec3 in_normal;
+
+attribute highp vec3 in_instance_position;
+attribute mediump vec3 in_instance_normal;
+attribute mediump vec3 in_instance_color;
+attribute mediump float in_instance_selected;
+attribute highp float in_instance_id;
+
+uniform mediump mat4 in_mvp_matrix;
+uniform mediump mat3 in_n_matrix;
+uniform highp float in_highlighted_id;
+
+varying mediump vec4 fragment_color;
+varying mediump vec3 fragment_normal;
+varying highp vec4 fragment_id;
+
+//
+// Rotate pin model so that its y axis points along the surface normal. Pins without
+// a normal keep their orientation.
+//
+vec3 orient (vec3 v)
+{
+  if (dot (in_instance_normal, in_instance_normal) < 0.5)
+    return v;
+
+  vec3 n = normalize (in_instance_normal);
+  float c = n.y;
+
+  if (c < -0.9999)
+    return vec3 (v.x, -v.y, -v.z);
+
+  vec3 axis = vec3 (n.z, 0.0, -n.x);
+  return v * c + cross (axis, v) + axis * (dot (axis, v) / (1.0 + c));
+}
+
+void main (void)
+{
+  fragment_normal = in_n_matrix * orient (in_normal);
+  fragment_color = vec4 (in_instance_color, in_instance_selected > 0.5 ? 1.0 : 0.3);
+
+  //
+  // Highlight pin below the cursor
+  //
+  if (abs (in_instance_id - in_highlighted_id) < 0.5)
+    fragment_color = vec4 (mix (fragment_color.rgb, vec3 (1.0, 1.0, 1.0), 0.5), 1.0);
+
+  //
+  // Instance id packed into the color channels for the pick pass. The alpha channel
+  // contains the object type (pin).
+  //
+  highp float id = floor (in_instance_id + 0.5);
+  fragment_id = vec4 (mod (id, 256.0), mod (floor (id / 256.0), 256.0), floor (id / 65536.0), 2.0) / 255.0;
+
+  gl_Position = in_mvp_matrix * vec4 (orient (in_vertex.xyz) + in_instance_position, 1.0);
+}
@@ -0,0 +1,875 @@
+/*
+ * hip_gl_bounding_volume_hierarchy.cpp - Acceleration structure for ray and closest point queries on meshes
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPGLBoundingVolumeHierarchy.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QVarLengthArray>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace HIP {
+  namespace GL {
+
+    //#**********************************************************************
+    // Local definitions
+    //#**********************************************************************
+
+    namespace {
+
+      //
+      // Build parameters. Nodes with up to MIN_LEAF_SIZE triangles are always leaves,
+      // larger nodes become leaves if splitting is not cheaper according to the SAH,
+      // but never hold more than MAX_LEAF_SIZE triangles. The traversal cost is
+      // relative to the cost of a single triangle test.
+      //
+      const int NUMBER_OF_BINS = 16;
+      const int MIN_LEAF_SIZE = 2;
+      const int MAX_LEAF_SIZE = 16;
+      const float TRAVERSAL_COST = 1.0f;
+
+      //
+      // Number of points processed by a single task of a batched closest point query
+      //
+      const int CLOSEST_POINT_CHUNK_SIZE = 1024;
+
+      /* Component wise minimum */
+      inline QVector3D minimum (const QVector3D& v1, const QVector3D& v2)
+      {
+        return QVector3D (qMin (v1.x (), v2.x ()), qMin (v1.y (), v2.y ()), qMin (v1.z (), v2.z ()));
+      }
+
+      /* Component wise maximum */
+      inline QVector3D maximum (const QVector3D& v1, const QVector3D& v2)
+      {
+        return QVector3D (qMax (v1.x (), v2.x ()), qMax (v1.y (), v2.y ()), qMax (v1.z (), v2.z ()));
+      }
+
+      /*
+       * Axis aligned box used while building the hierarchy
+       */
+      struct Box
+      {
+        Box ()
+          : _minimum (std::numeric_limits<float>::max (), std::numeric_limits<float>::max (),
+                      std::numeric_limits<float>::max ()),
+            _maximum (-std::numeric_limits<float>::max (), -std::numeric_limits<float>::max (),
+                      -std::numeric_limits<float>::max ())
+        {
+        }
+
+        void extend (const QVector3D& point)
+        {
+          _minimum = minimum (_minimum, point);
+          _maximum = maximum (_maximum, point);
+        }
+
+        void extend (const Box& box)
+        {
+          _minimum = minimum (_minimum, box._minimum);
+          _maximum = maximum (_maximum, box._maximum);
+        }
+
+        float getArea () const
+        {
+          if (_minimum.x () > _maximum.x ())
+            return 0.0f;
+
+          QVector3D size = _maximum - _minimum;
+          return 2.0f * (size.x () * size.y () + size.y () * size.z () + size.z () * size.x ());
+        }
+
+        QVector3D _minimum;
+        QVector3D _maximum;
+      };
+
+      /*
+       * Pending build step: node and the range of triangles it contains
+       */
+      struct Task
+      {
+        int _node;
+        int _begin;
+        int _end;
+        int _depth;
+      };
+
+      /*
+       * Entry of the traversal stack with the distance at which the ray enters the node
+       * or, for closest point queries, the squared distance of the node box to the point
+       */
+      struct StackEntry
+      {
+        int _node;
+        float _distance;
+      };
+
+      /*
+       * Chunk of a batched closest point query
+       */
+      struct ClosestPointTask
+      {
+        const BoundingVolumeHierarchy* _hierarchy;
+        const QVector<QVector3D>* _points;
+        const QBitArray* _groups;
+        Hit* _hits;
+        int _begin;
+        int _end;
+      };
+
+      /* Process chunk of a batched closest point query. Called in a worker thread. */
+      void computeClosestPoints (const ClosestPointTask& task)
+      {
+        for (int i=task._begin; i < task._end; ++i)
+          task._hierarchy->findClosest ((*task._points)[i], task._hits + i, *task._groups);
+      }
+
+      /* Compute bin of a centroid coordinate */
+      inline int computeBin (float value, float offset, float scale)
+      {
+        return qBound (0, static_cast<int> ((value - offset) * scale), NUMBER_OF_BINS - 1);
+      }
+
+      /*
+       * Predicate selecting the triangles left of a bin border
+       */
+      class BinPredicate
+      {
+      public:
+        BinPredicate (const QVector<QVector3D>& centroids, int axis, float offset, float scale, int split)
+          : _centroids (centroids), _axis (axis), _offset (offset), _scale (scale), _split (split) {}
+
+        bool operator () (int triangle) const
+        {
+          return computeBin (_centroids[triangle][_axis], _offset, _scale) < _split;
+        }
+
+      private:
+        const QVector<QVector3D>& _centroids;
+        int _axis;
+        float _offset;
+        float _scale;
+        int _split;
+      };
+
+      /*
+       * Comparator ordering triangles by a centroid coordinate
+       */
+      class CentroidComparator
+      {
+      public:
+        CentroidComparator (const QVector<QVector3D>& centroids, int axis)
+          : _centroids (centroids), _axis (axis) {}
+
+        bool operator () (int triangle1, int triangle2) const
+        {
+          return _centroids[triangle1][_axis] < _centroids[triangle2][_axis];
+        }
+
+      private:
+        const QVector<QVector3D>& _centroids;
+        int _axis;
+      };
+
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::Ray
+    //#**********************************************************************
+
+    /*! Constructor. The direction is normalized, so distances are in model units. */
+    Ray::Ray (const QVector3D& origin, const QVector3D& direction)
+      : _origin    (origin),
+        _direction (direction.normalized ())
+    {
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::Hit
+    //#**********************************************************************
+
+    /*! Constructor for an invalid hit */
+    Hit::Hit ()
+      : _group    (-1),
+        _triangle (-1),
+        _distance (0.0f),
+        _position (),
+        _normal   ()
+    {
+    }
+
+    /*!
+     * Constructor
+     *
+     * @param group    Index of the mesh group containing the triangle
+     * @param triangle Index of the hit triangle in the mesh index buffer (counted in triangles)
+     * @param distance Distance from the ray origin or from the query point
+     * @param position Hit position on the triangle
+     * @param normal   Normalized surface normal at the hit position
+     */
+    Hit::Hit (int group, int triangle, float distance, const QVector3D& position, const QVector3D& normal)
+      : _group    (group),
+        _triangle (triangle),
+        _distance (distance),
+        _position (position),
+        _normal   (normal)
+    {
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::BoundingVolumeHierarchy
+    //#**********************************************************************
+
+    /*!
+     * Constructor
+     *
+     * Builds the hierarchy, which takes a while for large meshes. Should be called
+     * from a background thread.
+     *
+     * @param mesh Mesh whose triangles are indexed
+     */
+    BoundingVolumeHierarchy::BoundingVolumeHierarchy (const MeshPtr& mesh)
+      : _mesh          (mesh),
+        _nodes         (),
+        _triangles     (),
+        _group_offsets (),
+        _depth         (0)
+    {
+      Q_ASSERT (!_mesh.isNull ());
+
+      foreach (const MeshGroup& group, _mesh->getGroups ())
+        {
+          Q_ASSERT (group.getFirstIndex () % 3 == 0);
+          Q_ASSERT (_group_offsets.isEmpty () || _group_offsets.back () <= group.getFirstIndex () / 3);
+
+          _group_offsets.push_back (group.getFirstIndex () / 3);
+        }
+
+#ifdef HIP_PRINT_STATISTICS
+      QElapsedTimer timer;
+      timer.start ();
+#endif
+
+      build ();
+
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "* Bounding volume hierarchy:" << _triangles.size () << "triangles,"
+                << _nodes.size () << "nodes, depth" << _depth << ", built in" << timer.elapsed () << "ms";
+#endif
+    }
+
+    /*! Destructor */
+    BoundingVolumeHierarchy::~BoundingVolumeHierarchy ()
+    {
+    }
+
+    /*
+     * Build tree top down using the binned surface area heuristic
+     */
+    void BoundingVolumeHierarchy::build ()
+    {
+      const VertexData* vertices = _mesh->getVertexData ();
+      const GLuint* indices = _mesh->getIndexData ();
+      int number_of_triangles = _mesh->getNumberOfIndices () / 3;
+
+      if (number_of_triangles == 0)
+        return;
+
+      //
+      // Triangle bounds and centroids
+      //
+      QVector<Box> boxes (number_of_triangles);
+      QVector<QVector3D> centroids (number_of_triangles);
+
+      _triangles.resize (number_of_triangles);
+
+      for (int i=0; i < number_of_triangles; ++i)
+        {
+          Box& box = boxes[i];
+
+          box.extend (vertices[indices[i * 3 + 0]]._vertex);
+          box.extend (vertices[indices[i * 3 + 1]]._vertex);
+          box.extend (vertices[indices[i * 3 + 2]]._vertex);
+
+          centroids[i] = (box._minimum + box._maximum) * 0.5f;
+          _triangles[i] = i;
+        }
+
+      _nodes.push_back (Node ());
+
+      QVector<Task> tasks;
+
+      Task root = { 0, 0, number_of_triangles, 1 };
+      tasks.push_back (root);
+
+      while (!tasks.isEmpty ())
+        {
+          Task task = tasks.back ();
+          tasks.pop_back ();
+
+          _depth = qMax (_depth, task._depth);
+
+          Box bounds;
+          Box centroid_bounds;
+
+          for (int i=task._begin; i < task._end; ++i)
+            {
+              bounds.extend (boxes[_triangles[i]]);
+              centroid_bounds.extend (centroids[_triangles[i]]);
+            }
+
+          int count = task._end - task._begin;
+
+          Node& node = _nodes[task._node];
+          node._minimum = bounds._minimum;
+          node._maximum = bounds._maximum;
+          node._first = task._begin;
+          node._count = count;
+
+          if (count <= MIN_LEAF_SIZE)
+            continue;
+
+          //
+          // Find the bin border with the lowest split cost. Keeping the node as a leaf
+          // costs one triangle test per triangle.
+          //
+          float area = bounds.getArea ();
+          float inverse_area = area > 0.0f ? 1.0f / area : 0.0f;
+
+          float best_cost = count;
+          int best_axis = -1;
+          int best_split = -1;
+
+          for (int axis=0; axis < 3; ++axis)
+            {
+              float offset = centroid_bounds._minimum[axis];
+              float extent = centroid_bounds._maximum[axis] - offset;
+
+              if (extent <= 0.0f)
+                continue;
+
+              float scale = NUMBER_OF_BINS / extent;
+
+              Box bin_boxes[NUMBER_OF_BINS];
+              int bin_counts[NUMBER_OF_BINS] = { 0 };
+
+              for (int i=task._begin; i < task._end; ++i)
+                {
+                  int triangle = _triangles[i];
+                  int bin = computeBin (centroids[triangle][axis], offset, scale);
+
+                  bin_boxes[bin].extend (boxes[triangle]);
+                  ++bin_counts[bin];
+                }
+
+              //
+              // Border 'i' splits into the bins [0, i) and [i, NUMBER_OF_BINS)
+              //
+              float right_areas[NUMBER_OF_BINS];
+              int right_counts[NUMBER_OF_BINS];
+
+              Box right;
+              int right_count = 0;
+
+              for (int i=NUMBER_OF_BINS - 1; i > 0; --i)
+                {
+                  right.extend (bin_boxes[i]);
+                  right_count += bin_counts[i];
+
+                  right_areas[i] = right.getArea ();
+                  right_counts[i] = right_count;
+                }
+
+              Box left;
+              int left_count = 0;
+
+              for (int i=1; i < NUMBER_OF_BINS; ++i)
+                {
+                  left.extend (bin_boxes[i - 1]);
+                  left_count += bin_counts[i - 1];
+
+                  if (left_count == 0 || right_counts[i] == 0)
+                    continue;
+
+                  float cost = TRAVERSAL_COST +
+                    (left.getArea () * left_count + right_areas[i] * right_counts[i]) * inverse_area;
+
+                  if (cost < best_cost)
+                    {
+                      best_cost = cost;
+                      best_axis = axis;
+                      best_split = i;
+                    }
+                }
+            }
+
+          //
+          // Partition triangles. If no split is cheaper than a leaf but the node is too
+          // large, the triangles are split at the median of the widest centroid axis.
+          //
+          int middle = -1;
+
+          if (best_axis >= 0)
+            {
+              float offset = centroid_bounds._minimum[best_axis];
+              float scale = NUMBER_OF_BINS / (centroid_bounds._maximum[best_axis] - offset);
+
+              middle = std::partition (_triangles.begin () + task._begin, _triangles.begin () + task._end,
+                                       BinPredicate (centroids, best_axis, offset, scale, best_split))
+                - _triangles.begin ();
+            }
+          else if (count > MAX_LEAF_SIZE)
+            {
+              QVector3D extent = centroid_bounds._maximum - centroid_bounds._minimum;
+
+              int axis = 0;
+              if (extent.y () > extent[axis])
+                axis = 1;
+              if (extent.z () > extent[axis])
+                axis = 2;
+
+              middle = task._begin + count / 2;
+              std::nth_element (_triangles.begin () + task._begin, _triangles.begin () + middle,
+                                _triangles.begin () + task._end, CentroidComparator (centroids, axis));
+            }
+
+          if (middle == -1)
+            continue;
+
+          Q_ASSERT (middle > task._begin && middle < task._end);
+
+          int left_child = _nodes.size ();
+
+          node._first = left_child;
+          node._count = 0;
+
+          _nodes.push_back (Node ());
+          _nodes.push_back (Node ());
+
+          Task left_task = { left_child, task._begin, middle, task._depth + 1 };
+          Task right_task = { left_child + 1, middle, task._end, task._depth + 1 };
+
+          tasks.push_back (right_task);
+          tasks.push_back (left_task);
+        }
+    }
+
+    /*!
+     * Find group of a triangle
+     *
+     * @param triangle Index of the triangle in the mesh index buffer (counted in triangles)
+     * @return Index of the mesh group containing the triangle
+     */
+    int BoundingVolumeHierarchy::findGroup (int triangle) const
+    {
+      return std::upper_bound (_group_offsets.begin (), _group_offsets.end (), triangle) - _group_offsets.begin () - 1;
+    }
+
+    /*!
+     * Find the closest intersection of a ray with the mesh
+     *
+     * @param ray    Ray to be tested. Only hits in front of the origin are reported.
+     * @param hit    Closest hit, if any. May be 0.
+     * @param groups Bitset with one bit per mesh group. If not empty, only triangles of
+     *               groups whose bit is set are tested.
+     * @return 'true' if the ray hits the mesh
+     */
+    bool BoundingVolumeHierarchy::intersect (const Ray& ray, Hit* hit, const QBitArray& groups) const
+    {
+      if (_nodes.isEmpty ())
+        return false;
+
+      const QVector3D& origin = ray.getOrigin ();
+      const QVector3D& direction = ray.getDirection ();
+
+      QVector3D inverse_direction (1.0f / direction.x (), 1.0f / direction.y (), 1.0f / direction.z ());
+
+      float closest = std::numeric_limits<float>::max ();
+      int closest_triangle = -1;
+
+      float distance = 0.0f;
+      if (!intersectBox (_nodes[0], origin, inverse_direction, closest, &distance))
+        return false;
+
+      QVarLengthArray<StackEntry, 64> stack;
+
+      StackEntry root = { 0, distance };
+      stack.append (root);
+
+      while (!stack.isEmpty ())
+        {
+          StackEntry entry = stack.last ();
+          stack.removeLast ();
+
+          //
+          // Nodes entered behind the closest hit found so far cannot contain a closer one
+          //
+          if (entry._distance >= closest)
+            continue;
+
+          const Node& node = _nodes[entry._node];
+
+          if (node._count > 0)
+            {
+              for (int i=node._first; i < node._first + node._count; ++i)
+                {
+                  int triangle = _triangles[i];
+
+                  if (!groups.isEmpty () && !groups.testBit (findGroup (triangle)))
+                    continue;
+
+                  if (intersectTriangle (triangle, ray, closest, &distance))
+                    {
+                      closest = distance;
+                      closest_triangle = triangle;
+                    }
+                }
+            }
+          else
+            {
+              StackEntry left = { node._first, 0.0f };
+              StackEntry right = { node._first + 1, 0.0f };
+
+              bool left_hit = intersectBox (_nodes[left._node], origin, inverse_direction, closest, &left._distance);
+              bool right_hit = intersectBox (_nodes[right._node], origin, inverse_direction, closest, &right._distance);
+
+              //
+              // The nearer child is pushed last, so it is visited first
+              //
+              if (left_hit && right_hit)
+                {
+                  if (left._distance < right._distance)
+                    {
+                      stack.append (right);
+                      stack.append (left);
+                    }
+                  else
+                    {
+                      stack.append (left);
+                      stack.append (right);
+                    }
+                }
+              else if (left_hit)
+                stack.append (left);
+              else if (right_hit)
+                stack.append (right);
+            }
+        }
+
+      if (closest_triangle == -1)
+        return false;
+
+      if (hit != 0)
+        {
+          QVector3D position = ray.getPoint (closest);
+          *hit = Hit (findGroup (closest_triangle), closest_triangle, closest, position,
+                      computeNormal (closest_triangle, position));
+        }
+
+      return true;
+    }
+
+    /*!
+     * Find the point on the mesh surface closest to a given point
+     *
+     * @param point  Query point
+     * @param hit    Closest surface point. The distance is the distance to the query point.
+     * @param groups Bitset with one bit per mesh group. If not empty, only triangles of
+     *               groups whose bit is set are considered.
+     * @return 'true' if a surface point has been found, which fails for empty meshes only
+     */
+    bool BoundingVolumeHierarchy::findClosest (const QVector3D& point, Hit* hit, const QBitArray& groups) const
+    {
+      Q_ASSERT (hit != 0);
+
+      if (_nodes.isEmpty ())
+        return false;
+
+      float closest = std::numeric_limits<float>::max ();
+      int closest_triangle = -1;
+      QVector3D closest_point;
+
+      QVarLengthArray<StackEntry, 64> stack;
+
+      StackEntry root = { 0, computeBoxDistance (_nodes[0], point) };
+      stack.append (root);
+
+      while (!stack.isEmpty ())
+        {
+          StackEntry entry = stack.last ();
+          stack.removeLast ();
+
+          //
+          // Nodes farther away than the closest triangle found so far cannot contain a closer one
+          //
+          if (entry._distance >= closest)
+            continue;
+
+          const Node& node = _nodes[entry._node];
+
+          if (node._count > 0)
+            {
+              for (int i=node._first; i < node._first + node._count; ++i)
+                {
+                  int triangle = _triangles[i];
+
+                  if (!groups.isEmpty () && !groups.testBit (findGroup (triangle)))
+                    continue;
+
+                  QVector3D candidate = computeClosestPoint (triangle, point);
+                  float distance = (candidate - point).lengthSquared ();
+
+                  if (distance < closest)
+                    {
+                      closest = distance;
+                      closest_triangle = triangle;
+                      closest_point = candidate;
+                    }
+                }
+            }
+          else
+            {
+              StackEntry left = { node._first, computeBoxDistance (_nodes[node._first], point) };
+              StackEntry right = { node._first + 1, computeBoxDistance (_nodes[node._first + 1], point) };
+
+              //
+              // The nearer child is pushed last, so it is visited first
+              //
+              if (left._distance < right._distance)
+                {
+                  stack.append (right);
+                  stack.append (left);
+                }
+              else
+                {
+                  stack.append (left);
+                  stack.append (right);
+                }
+            }
+        }
+
+      if (closest_triangle == -1)
+        return false;
+
+      *hit = Hit (findGroup (closest_triangle), closest_triangle, std::sqrt (closest), closest_point,
+                  computeNormal (closest_triangle, closest_point));
+
+      return true;
+    }
+
+    /*!
+     * Find the closest surface points for a batch of points
+     *
+     * The queries are distributed over all available cores. Blocks until all points
+     * have been processed.
+     *
+     * @param points Query points
+     * @param groups Bitset with one bit per mesh group. If not empty, only triangles of
+     *               groups whose bit is set are considered.
+     * @return Closest surface point for each query point. Invalid for empty meshes.
+     */
+    QVector<Hit> BoundingVolumeHierarchy::findClosest (const QVector<QVector3D>& points, const QBitArray& groups) const
+    {
+      QVector<Hit> hits (points.size ());
+
+      QVector<ClosestPointTask> tasks;
+      tasks.reserve (points.size () / CLOSEST_POINT_CHUNK_SIZE + 1);
+
+      for (int i=0; i < points.size (); i += CLOSEST_POINT_CHUNK_SIZE)
+        {
+          ClosestPointTask task = { this, &points, &groups, hits.data (), i,
+                                    qMin (i + CLOSEST_POINT_CHUNK_SIZE, points.size ()) };
+          tasks.push_back (task);
+        }
+
+      QtConcurrent::blockingMap (tasks, computeClosestPoints);
+
+      return hits;
+    }
+
+    /*
+     * Intersect ray with the box of a node (slab test)
+     */
+    bool BoundingVolumeHierarchy::intersectBox (const Node& node, const QVector3D& origin,
+                                                const QVector3D& inverse_direction, float max_distance,
+                                                float* distance) const
+    {
+      float entry = 0.0f;
+      float exit = max_distance;
+
+      for (int axis=0; axis < 3; ++axis)
+        {
+          float t0 = (node._minimum[axis] - origin[axis]) * inverse_direction[axis];
+          float t1 = (node._maximum[axis] - origin[axis]) * inverse_direction[axis];
+
+          if (t0 > t1)
+            std::swap (t0, t1);
+
+          entry = qMax (entry, t0);
+          exit = qMin (exit, t1);
+
+          if (entry > exit)
+            return false;
+        }
+
+      *distance = entry;
+      return true;
+    }
+
+    /*
+     * Intersect ray with a single triangle (Moeller-Trumbore). Both triangle sides are hit.
+     */
+    bool BoundingVolumeHierarchy::intersectTriangle (int triangle, const Ray& ray, float max_distance,
+                                                     float* distance) const
+    {
+      const VertexData* vertices = _mesh->getVertexData ();
+      const GLuint* indices = _mesh->getIndexData () + triangle * 3;
+
+      const QVector3D& p0 = vertices[indices[0]]._vertex;
+      QVector3D e1 = vertices[indices[1]]._vertex - p0;
+      QVector3D e2 = vertices[indices[2]]._vertex - p0;
+
+      QVector3D p = QVector3D::crossProduct (ray.getDirection (), e2);
+
+      float determinant = QVector3D::dotProduct (e1, p);
+      if (determinant == 0.0f)
+        return false;
+
+      float inverse_determinant = 1.0f / determinant;
+
+      QVector3D s = ray.getOrigin () - p0;
+      float u = QVector3D::dotProduct (s, p) * inverse_determinant;
+      if (u < 0.0f || u > 1.0f)
+        return false;
+
+      QVector3D q = QVector3D::crossProduct (s, e1);
+      float v = QVector3D::dotProduct (ray.getDirection (), q) * inverse_determinant;
+      if (v < 0.0f || u + v > 1.0f)
+        return false;
+
+      float t = QVector3D::dotProduct (e2, q) * inverse_determinant;
+      if (t < 0.0f || t >= max_distance)
+        return false;
+
+      *distance = t;
+      return true;
+    }
+
+    /*
+     * Compute squared distance of a point to the box of a node. Points inside have distance 0.
+     */
+    float BoundingVolumeHierarchy::computeBoxDistance (const Node& node, const QVector3D& point) const
+    {
+      float distance = 0.0f;
+
+      for (int axis=0; axis < 3; ++axis)
+        {
+          float delta = qMax (qMax (node._minimum[axis] - point[axis], point[axis] - node._maximum[axis]), 0.0f);
+          distance += delta * delta;
+        }
+
+      return distance;
+    }
+
+    /*
+     * Compute the point of a triangle closest to a given point
+     *
+     * The point is classified against the voronoi regions of the triangle vertices,
+     * edges and face (Ericson, Real-Time Collision Detection, 5.1.5).
+     */
+    QVector3D BoundingVolumeHierarchy::computeClosestPoint (int triangle, const QVector3D& point) const
+    {
+      const VertexData* vertices = _mesh->getVertexData ();
+      const GLuint* indices = _mesh->getIndexData () + triangle * 3;
+
+      const QVector3D& a = vertices[indices[0]]._vertex;
+      const QVector3D& b = vertices[indices[1]]._vertex;
+      const QVector3D& c = vertices[indices[2]]._vertex;
+
+      QVector3D ab = b - a;
+      QVector3D ac = c - a;
+      QVector3D ap = point - a;
+
+      float d1 = QVector3D::dotProduct (ab, ap);
+      float d2 = QVector3D::dotProduct (ac, ap);
+      if (d1 <= 0.0f && d2 <= 0.0f)
+        return a;
+
+      QVector3D bp = point - b;
+      float d3 = QVector3D::dotProduct (ab, bp);
+      float d4 = QVector3D::dotProduct (ac, bp);
+      if (d3 >= 0.0f && d4 <= d3)
+        return b;
+
+      float vc = d1 * d4 - d3 * d2;
+      if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return a + ab * (d1 / (d1 - d3));
+
+      QVector3D cp = point - c;
+      float d5 = QVector3D::dotProduct (ab, cp);
+      float d6 = QVector3D::dotProduct (ac, cp);
+      if (d6 >= 0.0f && d5 <= d6)
+        return c;
+
+      float vb = d5 * d2 - d1 * d6;
+      if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return a + ac * (d2 / (d2 - d6));
+
+      float va = d3 * d6 - d5 * d4;
+      if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+      float denominator = va + vb + vc;
+      if (denominator <= 0.0f)
+        return a;
+
+      return a + ab * (vb / denominator) + ac * (vc / denominator);
+    }
+
+    /*
+     * Compute surface normal at a position on a triangle
+     *
+     * The vertex normals are interpolated. If they cancel out, the face normal is used.
+     */
+    QVector3D BoundingVolumeHierarchy::computeNormal (int triangle, const QVector3D& position) const
+    {
+      const VertexData* vertices = _mesh->getVertexData ();
+      const GLuint* indices = _mesh->getIndexData () + triangle * 3;
+
+      const VertexData& v0 = vertices[indices[0]];
+      const VertexData& v1 = vertices[indices[1]];
+      const VertexData& v2 = vertices[indices[2]];
+
+      QVector3D face_normal = QVector3D::crossProduct (v1._vertex - v0._vertex, v2._vertex - v0._vertex);
+
+      float area = face_normal.lengthSquared ();
+      if (area <= 0.0f)
+        return QVector3D ();
+
+      //
+      // Barycentric coordinates of the position from the sub triangle areas
+      //
+      float w1 = QVector3D::dotProduct (face_normal, QVector3D::crossProduct (position - v0._vertex, v2._vertex - v0._vertex)) / area;
+      float w2 = QVector3D::dotProduct (face_normal, QVector3D::crossProduct (v1._vertex - v0._vertex, position - v0._vertex)) / area;
+      float w0 = 1.0f - w1 - w2;
+
+      QVector3D normal = v0._normal * w0 + v1._normal * w1 + v2._normal * w2;
+
+      if (normal.lengthSquared () <= 0.0f)
+        normal = face_normal;
+
+      return normal.normalized ();
+    }
+
+  }
+}
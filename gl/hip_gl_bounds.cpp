@@ -0,0 +1,153 @@
+/*
+ * hip_gl_bounds.cpp - Bounding volumes and view frustum
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPGLBounds.h"
+
+#include <cmath>
+#include <limits>
+
+namespace HIP {
+  namespace GL {
+
+    //#**********************************************************************
+    // CLASS HIP::GL::Bounds
+    //#**********************************************************************
+
+    /*! Constructor for invalid (empty) bounds */
+    Bounds::Bounds ()
+      : _minimum (),
+        _maximum (),
+        _center  (),
+        _radius  (-1.0f)
+    {
+    }
+
+    /*! Constructor */
+    Bounds::Bounds (const QVector3D& minimum, const QVector3D& maximum, const QVector3D& center, float radius)
+      : _minimum (minimum),
+        _maximum (maximum),
+        _center  (center),
+        _radius  (radius)
+    {
+    }
+
+    /*!
+     * Compute bounds of a set of indexed vertices
+     *
+     * The sphere is centered in the box and encloses all referenced vertices, which
+     * is usually much tighter than the sphere around the box.
+     *
+     * @param vertices          Vertex array
+     * @param indices           Indices of the vertices to include
+     * @param number_of_indices Number of indices
+     * @return Bounds, invalid if there are no indices
+     */
+    Bounds Bounds::compute (const QVector<QVector3D>& vertices, const int* indices, int number_of_indices)
+    {
+      if (number_of_indices == 0)
+        return Bounds ();
+
+      QVector3D minimum (std::numeric_limits<float>::max (),
+                         std::numeric_limits<float>::max (),
+                         std::numeric_limits<float>::max ());
+      QVector3D maximum (-std::numeric_limits<float>::max (),
+                         -std::numeric_limits<float>::max (),
+                         -std::numeric_limits<float>::max ());
+
+      for (int i=0; i < number_of_indices; ++i)
+        {
+          const QVector3D& v = vertices[indices[i]];
+
+          minimum.setX (qMin (minimum.x (), v.x ()));
+          minimum.setY (qMin (minimum.y (), v.y ()));
+          minimum.setZ (qMin (minimum.z (), v.z ()));
+
+          maximum.setX (qMax (maximum.x (), v.x ()));
+          maximum.setY (qMax (maximum.y (), v.y ()));
+          maximum.setZ (qMax (maximum.z (), v.z ()));
+        }
+
+      QVector3D center = (minimum + maximum) / 2;
+      float radius_squared = 0.0f;
+
+      for (int i=0; i < number_of_indices; ++i)
+        radius_squared = qMax (radius_squared, (vertices[indices[i]] - center).lengthSquared ());
+
+      return Bounds (minimum, maximum, center, std::sqrt (radius_squared));
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::Frustum
+    //#**********************************************************************
+
+    /*!
+     * Constructor
+     *
+     * Extracts the six clipping planes (Gribb/Hartmann). The plane normals point into
+     * the frustum and are normalized, so plane distances are in model units.
+     *
+     * @param mvp Model view projection matrix
+     */
+    Frustum::Frustum (const QMatrix4x4& mvp)
+    {
+      QVector4D x = mvp.row (0);
+      QVector4D y = mvp.row (1);
+      QVector4D z = mvp.row (2);
+      QVector4D w = mvp.row (3);
+
+      _planes[0] = w + x; // Left
+      _planes[1] = w - x; // Right
+      _planes[2] = w + y; // Bottom
+      _planes[3] = w - y; // Top
+      _planes[4] = w + z; // Near
+      _planes[5] = w - z; // Far
+
+      for (int i=0; i < 6; ++i)
+        {
+          float length = _planes[i].toVector3D ().length ();
+          if (length > 0.0f)
+            _planes[i] /= length;
+        }
+    }
+
+    /*!
+     * Check if the bounds are (partially) inside of the frustum
+     *
+     * The test is conservative: volumes near the frustum corners may be reported as
+     * visible even if they are not. Invalid bounds are always visible.
+     */
+    bool Frustum::intersects (const Bounds& bounds) const
+    {
+      if (!bounds.isValid ())
+        return true;
+
+      for (int i=0; i < 6; ++i)
+        {
+          const QVector4D& plane = _planes[i];
+
+          //
+          // Sphere test first, it is cheaper and rejects most volumes
+          //
+          if (QVector3D::dotProduct (plane.toVector3D (), bounds.getCenter ()) + plane.w () < -bounds.getRadius ())
+            return false;
+
+          //
+          // Box test with the box corner farthest along the plane normal
+          //
+          QVector3D p (plane.x () >= 0 ? bounds.getMaximum ().x () : bounds.getMinimum ().x (),
+                       plane.y () >= 0 ? bounds.getMaximum ().y () : bounds.getMinimum ().y (),
+                       plane.z () >= 0 ? bounds.getMaximum ().z () : bounds.getMinimum ().z ());
+
+          if (QVector3D::dotProduct (plane.toVector3D (), p) + plane.w () < 0.0f)
+            return false;
+        }
+
+      return true;
+    }
+
+  }
+}
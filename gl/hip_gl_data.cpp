@@ -5,12 +5,22 @@
  */
 
 #include "HIPGLData.h"
+#include "HIPGLBoundingVolumeHierarchy.h"
+#include "HIPGLMesh.h"
+#include "HIPGLMeshCache.h"
 #include "core/HIPException.h"
 #include "core/HIPTools.h"
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QOpenGLContext>
 #include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 
 namespace HIP {
@@ -19,16 +29,6 @@ namespace HIP {
   // Debug
   //#************************************************************************
 
-  QDebug& operator<< (QDebug& stream, const GL::Face& face)
-  {
-    stream << "f";
-
-    foreach (const GL::Point& point, face.getPoints ())
-      stream << " " << point;
-
-    return stream;
-  }
-
   QDebug& operator<< (QDebug& stream, const GL::Point& point)
   {
     stream << point.getVertexIndex () << "/" << point.getTextureIndex () << "/" << point.getNormalIndex ();
@@ -39,7 +39,7 @@ namespace HIP {
   {
     stream << "Group (name=" << group.getName ()
            << ", material=" << group.getMaterial ()
-           << "," << group.getFaces ().size () << " faces)";
+           << "," << group.getNumberOfTriangles () << " triangles)";
     return stream;
   }
 
@@ -102,60 +102,316 @@ namespace HIP {
         return QVector2D (toReal (x), toReal (y));
       }
 
-    }
+      /* Exact powers of ten used by the fast number conversion */
+      const double POWERS_OF_TEN[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+      };
 
+      /* Check for whitespace characters within a line */
+      inline bool isSpace (char c)
+      {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+      }
 
-    //#**********************************************************************
-    // CLASS HIP::GL::Point
-    //#**********************************************************************
+      /* Check for decimal digit */
+      inline bool isDigit (char c)
+      {
+        return c >= '0' && c <= '9';
+      }
 
-    /*! Constructor */
-    Point::Point (int vertex_index, int normal_index, int texture_index)
-      : _vertex_index  (vertex_index),
-        _normal_index  (normal_index),
-        _texture_index (texture_index)
-    {
-    }
+      /*
+       * Token referencing a range of raw bytes inside the loaded file content
+       */
+      struct Token
+      {
+        Token () : _begin (0), _end (0) {}
+        Token (const char* begin, const char* end) : _begin (begin), _end (end) {}
 
-    /*! Comparison operator */
-    bool Point::operator< (const Point& point) const
-    {
-      bool less = false;
+        bool isEmpty () const { return _begin == _end; }
+        int size () const     { return static_cast<int> (_end - _begin); }
 
-      if (_vertex_index == point._vertex_index)
+        /* Case insensitive comparison with a lower case keyword */
+        bool is (const char* keyword) const
         {
-          if (_normal_index < point._normal_index)
-            less = _texture_index < point._texture_index;
-          else
-            less = _normal_index < point._normal_index;
+          const char* c = _begin;
+          for (; c != _end && *keyword != 0; ++c, ++keyword)
+            if ((*c >= 'A' && *c <= 'Z' ? *c - 'A' + 'a' : *c) != *keyword)
+              return false;
+
+          return c == _end && *keyword == 0;
         }
-      else
-        less = _vertex_index < point._vertex_index;
 
-      return less;
+        QString toString () const { return QString::fromUtf8 (_begin, size ()); }
+
+        const char* _begin;
+        const char* _end;
+      };
+
+      /*
+       * Tokenizer working in place on a single line of raw UTF-8 OBJ data
+       *
+       * No intermediate string objects are created. Numbers are converted directly
+       * from the byte representation.
+       */
+      class LineTokenizer
+      {
+      public:
+        LineTokenizer (const char* begin, const char* end, int line)
+          : _pos (begin), _end (end), _line (line) {}
+
+        /* Return next whitespace separated token or an empty token at the end of the line */
+        Token nextToken ()
+        {
+          while (_pos != _end && isSpace (*_pos))
+            ++_pos;
+
+          const char* begin = _pos;
+          while (_pos != _end && !isSpace (*_pos))
+            ++_pos;
+
+          return Token (begin, _pos);
+        }
+
+        /* Read next token as floating point value */
+        float nextReal () // throws Exception
+        {
+          Token token = nextToken ();
+          float value = 0.0f;
+
+          if (!toReal (token, &value))
+            error (QObject::tr ("Double value expected"));
+
+          return value;
+        }
+
+        /* Read next three tokens as 3d vector */
+        QVector3D nextVector3d () // throws Exception
+        {
+          float x = nextReal ();
+          float y = nextReal ();
+          float z = nextReal ();
+
+          return QVector3D (x, y, z);
+        }
+
+        /* Read next two tokens as 2d vector */
+        QVector2D nextVector2d () // throws Exception
+        {
+          float x = nextReal ();
+          float y = nextReal ();
+
+          return QVector2D (x, y);
+        }
+
+        /*
+         * Parse face point token of the format 'v', 'v/t', 'v//n' or 'v/t/n'
+         *
+         * Relative (negative) indices are resolved against the given number of already
+         * read elements, the resulting indices are 0 based and -1 for missing entries.
+         */
+        Point toPoint (const Token& token, int vertices, int textures, int normals) const // throws Exception
+        {
+          int indices[3] = { -1, -1, -1 };
+          int counts[3] = { vertices, textures, normals };
+
+          const char* c = token._begin;
+          for (int i=0; i < 3 && c != token._end; ++i)
+            {
+              const char* part_end = c;
+              while (part_end != token._end && *part_end != '/')
+                ++part_end;
+
+              if (part_end != c)
+                {
+                  int index = 0;
+                  if (!toInt (Token (c, part_end), &index))
+                    error (QObject::tr ("Integer value expected"));
+
+                  indices[i] = index >= 0 ? index - 1 : counts[i] + index;
+                }
+
+              c = part_end != token._end ? part_end + 1 : part_end;
+            }
+
+          if (c != token._end)
+            error (QObject::tr ("Invalid face definition"));
+
+          return Point (indices[0], indices[2], indices[1]);
+        }
+
+        /* Throw exception with line information */
+        void error (const QString& message) const // throws Exception
+        {
+          throw Exception (QObject::tr ("Error in line %1: %2").arg (_line).arg (message));
+        }
+
+        /*
+         * Fast conversion of a token into a floating point number
+         *
+         * Handles the plain decimal / exponent notation written by modelling tools. Everything
+         * else (inf, nan, hex, ...) falls back to the Qt conversion.
+         */
+        static bool toReal (const Token& token, float* value)
+        {
+          const char* c = token._begin;
+          const char* end = token._end;
+
+          bool negative = false;
+          if (c != end && (*c == '-' || *c == '+'))
+            negative = *c++ == '-';
+
+          quint64 mantissa = 0;
+          int exponent = 0;
+          int digits = 0;
+
+          for (; c != end && isDigit (*c); ++c, ++digits)
+            {
+              if (mantissa < Q_UINT64_C (1000000000000000000))
+                mantissa = mantissa * 10 + (*c - '0');
+              else
+                ++exponent;
+            }
+
+          if (c != end && *c == '.')
+            {
+              for (++c; c != end && isDigit (*c); ++c, ++digits)
+                {
+                  if (mantissa < Q_UINT64_C (1000000000000000000))
+                    {
+                      mantissa = mantissa * 10 + (*c - '0');
+                      --exponent;
+                    }
+                }
+            }
+
+          if (digits > 0 && c != end && (*c == 'e' || *c == 'E'))
+            {
+              ++c;
+
+              bool negative_exponent = false;
+              if (c != end && (*c == '-' || *c == '+'))
+                negative_exponent = *c++ == '-';
+
+              if (c == end || !isDigit (*c))
+                digits = 0;
+
+              int e = 0;
+              for (; c != end && isDigit (*c); ++c)
+                if (e < 10000)
+                  e = e * 10 + (*c - '0');
+
+              exponent += negative_exponent ? -e : e;
+            }
+
+          if (digits == 0 || c != end)
+            {
+              bool ok = false;
+              *value = QByteArray::fromRawData (token._begin, token.size ()).toFloat (&ok);
+              return ok;
+            }
+
+          double v = static_cast<double> (mantissa);
+
+          if (exponent > 0)
+            v = exponent <= 22 ? v * POWERS_OF_TEN[exponent] : v * std::pow (10.0, exponent);
+          else if (exponent < 0)
+            v = exponent >= -22 ? v / POWERS_OF_TEN[-exponent] : v * std::pow (10.0, exponent);
+
+          *value = static_cast<float> (negative ? -v : v);
+          return true;
+        }
+
+        /* Fast conversion of a token into an integer */
+        static bool toInt (const Token& token, int* value)
+        {
+          const char* c = token._begin;
+
+          bool negative = false;
+          if (c != token._end && (*c == '-' || *c == '+'))
+            negative = *c++ == '-';
+
+          if (c == token._end)
+            return false;
+
+          qint64 v = 0;
+          for (; c != token._end; ++c)
+            {
+              if (!isDigit (*c))
+                return false;
+
+              v = v * 10 + (*c - '0');
+              if (v > std::numeric_limits<int>::max ())
+                return false;
+            }
+
+          *value = static_cast<int> (negative ? -v : v);
+          return true;
+        }
+
+      private:
+        const char* _pos;
+        const char* _end;
+        int _line;
+      };
+
+      /*
+       * Build bounding volume hierarchy for ray picking and closest point queries.
+       * Called in a background thread.
+       */
+      BoundingVolumeHierarchyPtr createHierarchy (const MeshPtr& mesh)
+      {
+        return BoundingVolumeHierarchyPtr (new BoundingVolumeHierarchy (mesh));
+      }
+
+      /*
+       * Create geodesic distance engine including the heat method operators.
+       * Called in a background thread.
+       */
+      GeodesicsPtr createGeodesics (const MeshPtr& mesh)
+      {
+        GeodesicsPtr geodesics (new Geodesics (mesh));
+        geodesics->prepare ();
+
+        return geodesics;
+      }
+
     }
 
 
     //#**********************************************************************
-    // CLASS HIP::GL::Face
+    // CLASS HIP::GL::Point
     //#**********************************************************************
 
     /*! Constructor */
-    Face::Face (const QList<Point>& points)
-      : _points (points)
+    Point::Point (int vertex_index, int normal_index, int texture_index)
+      : _vertex_index  (vertex_index),
+        _normal_index  (normal_index),
+        _texture_index (texture_index)
     {
     }
 
-    /*! Destructor */
-    Face::~Face ()
+    /*! Comparison operator */
+    bool Point::operator== (const Point& point) const
     {
+      return _vertex_index == point._vertex_index &&
+        _normal_index == point._normal_index &&
+        _texture_index == point._texture_index;
     }
 
-    /*! Set normal index of face points */
-    void Face::setNormalIndex (int index)
+    /*!
+     * Comparison operator
+     *
+     * Points are ordered lexicographically by vertex, normal and texture index.
+     */
+    bool Point::operator< (const Point& point) const
     {
-      for (int i=0; i < _points.size (); ++i)
-        _points[i].setNormalIndex (index);
+      if (_vertex_index != point._vertex_index)
+        return _vertex_index < point._vertex_index;
+      if (_normal_index != point._normal_index)
+        return _normal_index < point._normal_index;
+
+      return _texture_index < point._texture_index;
     }
 
 
@@ -187,9 +443,12 @@ namespace HIP {
 
     /*! Constructor */
     Group::Group ()
-      : _name     (),
-        _material (),
-        _faces    ()
+      : _name            (),
+        _material        (),
+        _vertex_indices  (),
+        _normal_indices  (),
+        _texture_indices (),
+        _bounds          ()
     {
     }
 
@@ -199,15 +458,320 @@ namespace HIP {
     }
 
     /*!
-     * Set index of the normals in the given face
+     * Return single point of a triangle
+     *
+     * \param triangle Index of the triangle
+     * \param corner   Triangle corner (0..2)
+     */
+    Point Group::getPoint (int triangle, int corner) const
+    {
+      Q_ASSERT (triangle >= 0 && triangle < getNumberOfTriangles ());
+      Q_ASSERT (corner >= 0 && corner < 3);
+
+      int i = triangle * 3 + corner;
+      return Point (_vertex_indices[i], _normal_indices[i], _texture_indices[i]);
+    }
+
+    /*! Reserve space for the given number of triangles */
+    void Group::reserve (int number_of_triangles)
+    {
+      _vertex_indices.reserve (number_of_triangles * 3);
+      _normal_indices.reserve (number_of_triangles * 3);
+      _texture_indices.reserve (number_of_triangles * 3);
+    }
+
+    /*! Add single triangle */
+    void Group::addTriangle (const Point& p0, const Point& p1, const Point& p2)
+    {
+      _vertex_indices << p0.getVertexIndex () << p1.getVertexIndex () << p2.getVertexIndex ();
+      _normal_indices << p0.getNormalIndex () << p1.getNormalIndex () << p2.getNormalIndex ();
+      _texture_indices << p0.getTextureIndex () << p1.getTextureIndex () << p2.getTextureIndex ();
+    }
+
+    /*!
+     * Add a block of triangles
+     *
+     * \param vertex_indices      Vertex indices, three per triangle
+     * \param normal_indices      Normal indices, three per triangle
+     * \param texture_indices     Texture indices, three per triangle
+     * \param number_of_triangles Number of triangles to add
+     */
+    void Group::addTriangles (const int* vertex_indices, const int* normal_indices, const int* texture_indices,
+                              int number_of_triangles)
+    {
+      int offset = _vertex_indices.size ();
+      int size = number_of_triangles * 3;
+
+      _vertex_indices.resize (offset + size);
+      _normal_indices.resize (offset + size);
+      _texture_indices.resize (offset + size);
+
+      std::copy (vertex_indices, vertex_indices + size, _vertex_indices.data () + offset);
+      std::copy (normal_indices, normal_indices + size, _normal_indices.data () + offset);
+      std::copy (texture_indices, texture_indices + size, _texture_indices.data () + offset);
+    }
+
+    /*!
+     * Set index of the normals of all points of the given triangle
+     *
+     * \param triangle Index of the triangle to access
+     * \param index    Normal index to set
+     */
+    void Group::setNormalIndex (int triangle, int index)
+    {
+      Q_ASSERT (triangle >= 0 && triangle < getNumberOfTriangles ());
+
+      int* normals = _normal_indices.data () + triangle * 3;
+      normals[0] = normals[1] = normals[2] = index;
+    }
+
+    /*!
+     * Recompute bounding volume of the group
      *
-     * \param face_index Index of the face to access
-     * \param index      Normal index to set
+     * \param vertices Vertex array of the model the group belongs to
      */
-    void Group::setNormalIndex (int face_index, int index)
+    void Group::updateBounds (const QVector<QVector3D>& vertices)
+    {
+      _bounds = Bounds::compute (vertices, _vertex_indices.constData (), _vertex_indices.size ());
+    }
+
+    /*! Return number of bytes allocated for the triangle index lists */
+    int Group::getMemoryUsage () const
     {
-      Q_ASSERT (face_index >= 0 && face_index < _faces.size ());
-      _faces[face_index].setNormalIndex (index);
+      return (_vertex_indices.capacity () + _normal_indices.capacity () + _texture_indices.capacity ()) * sizeof (int);
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::DataChunk
+    //#**********************************************************************
+
+    /*!
+     * Line aligned part of an OBJ file which is parsed independently
+     *
+     * Triangles are stored as flat vertex, normal and texture index lists with already
+     * resolved, absolute indices. Group and material statements are recorded as events
+     * together with the number of triangles preceding them, so that the group structure
+     * can be reconstructed in file order when the chunks are stitched together.
+     */
+    struct DataChunk
+    {
+      struct Event
+      {
+        struct Type { enum Type_t { OBJECT, GROUP, MATERIAL, MATERIAL_LIBRARY }; };
+        typedef Type::Type_t Type_t;
+
+        Event () : _type (Type::OBJECT), _triangle (0) {}
+        Event (Type_t type, const QString& name, int triangle) : _type (type), _name (name), _triangle (triangle) {}
+
+        Type_t _type;
+        QString _name;
+        int _triangle;
+      };
+
+      DataChunk ()
+        : _begin (0), _end (0), _first_line (1),
+          _vertex_base (0), _normal_base (0), _texture_base (0),
+          _number_of_vertices (0), _number_of_normals (0), _number_of_textures (0), _number_of_lines (0) {}
+
+      const char* _begin;
+      const char* _end;
+      int _first_line;
+
+      int _vertex_base;
+      int _normal_base;
+      int _texture_base;
+
+      int _number_of_vertices;
+      int _number_of_normals;
+      int _number_of_textures;
+      int _number_of_lines;
+
+      QVector<QVector3D> _vertices;
+      QVector<QVector3D> _normals;
+      QVector<QVector2D> _textures;
+      QVector<int> _vertex_indices;
+      QVector<int> _normal_indices;
+      QVector<int> _texture_indices;
+      QVector<Event> _events;
+
+      QString _error;
+    };
+
+    namespace {
+
+      /* Iterate over the lines of a chunk, calling 'process' for each line tokenizer */
+      template <class T>
+      void forEachLine (DataChunk& chunk, T& process)
+      {
+        const char* pos = chunk._begin;
+
+        for (int line=chunk._first_line; pos < chunk._end; ++line)
+          {
+            const char* line_end = static_cast<const char*> (memchr (pos, '\n', chunk._end - pos));
+            if (line_end == 0)
+              line_end = chunk._end;
+
+            LineTokenizer in (pos, line_end, line);
+            process (in, in.nextToken ());
+
+            pos = line_end + 1;
+          }
+      }
+
+      /*
+       * Line processor counting the elements of a chunk
+       */
+      struct ChunkCounter
+      {
+        ChunkCounter (DataChunk* chunk) : _chunk (chunk) {}
+
+        void operator () (LineTokenizer& in, const Token& tag)
+        {
+          Q_UNUSED (in);
+
+          if (tag.is ("v"))
+            ++_chunk->_number_of_vertices;
+          else if (tag.is ("vn"))
+            ++_chunk->_number_of_normals;
+          else if (tag.is ("vt"))
+            ++_chunk->_number_of_textures;
+
+          ++_chunk->_number_of_lines;
+        }
+
+        DataChunk* _chunk;
+      };
+
+      /*
+       * Line processor parsing the records of a chunk
+       */
+      struct ChunkParser
+      {
+        ChunkParser (DataChunk* chunk) : _chunk (chunk) {}
+
+        void operator () (LineTokenizer& in, const Token& tag)
+        {
+          typedef DataChunk::Event Event;
+
+          //
+          // Vertex
+          //
+          if (tag.is ("v"))
+            _chunk->_vertices.push_back (in.nextVector3d ());
+
+          //
+          // Vertex normal
+          //
+          else if (tag.is ("vn"))
+            _chunk->_normals.push_back (in.nextVector3d ());
+
+          //
+          // Vertex texture
+          //
+          else if (tag.is ("vt"))
+            _chunk->_textures.push_back (in.nextVector2d ());
+
+          //
+          // Face
+          //
+          else if (tag.is ("f"))
+            {
+              Token t[5];
+
+              int number_of_points = 0;
+              for (Token token = in.nextToken (); !token.isEmpty () && number_of_points < 5; token = in.nextToken ())
+                t[number_of_points++] = token;
+
+              if (number_of_points != 3 && number_of_points != 4)
+                in.error (QObject::tr ("Only triangular or rectangular faces supported."));
+
+              addPoint (in, t[0]);
+              addPoint (in, t[1]);
+              addPoint (in, t[2]);
+
+              if (number_of_points == 4)
+                {
+                  addPoint (in, t[1]);
+                  addPoint (in, t[2]);
+                  addPoint (in, t[3]);
+                }
+            }
+
+          //
+          // Object name
+          //
+          else if (tag.is ("o"))
+            addEvent (Event::Type::OBJECT, in.nextToken ());
+
+          //
+          // Group
+          //
+          else if (tag.is ("g"))
+            addEvent (Event::Type::GROUP, in.nextToken ());
+
+          //
+          // Used material
+          //
+          else if (tag.is ("usemtl"))
+            addEvent (Event::Type::MATERIAL, in.nextToken ());
+
+          //
+          // Related material library
+          //
+          else if (tag.is ("mtllib"))
+            addEvent (Event::Type::MATERIAL_LIBRARY, in.nextToken ());
+        }
+
+        void addPoint (const LineTokenizer& in, const Token& token)
+        {
+          Point point = in.toPoint (token,
+                                    _chunk->_vertex_base + _chunk->_vertices.size (),
+                                    _chunk->_texture_base + _chunk->_textures.size (),
+                                    _chunk->_normal_base + _chunk->_normals.size ());
+
+          _chunk->_vertex_indices.push_back (point.getVertexIndex ());
+          _chunk->_normal_indices.push_back (point.getNormalIndex ());
+          _chunk->_texture_indices.push_back (point.getTextureIndex ());
+        }
+
+        void addEvent (DataChunk::Event::Type_t type, const Token& name)
+        {
+          _chunk->_events.push_back (DataChunk::Event (type, name.toString (), _chunk->_vertex_indices.size () / 3));
+        }
+
+        DataChunk* _chunk;
+      };
+
+      /* Count elements in a single chunk. Called from a worker thread. */
+      void countChunk (DataChunk& chunk)
+      {
+        ChunkCounter counter (&chunk);
+        forEachLine (chunk, counter);
+      }
+
+      /*
+       * Parse a single chunk. Called from a worker thread.
+       *
+       * Exceptions cannot leave the worker threads, so errors are stored in the chunk.
+       */
+      void parseChunk (DataChunk& chunk)
+      {
+        chunk._vertices.reserve (chunk._number_of_vertices);
+        chunk._normals.reserve (chunk._number_of_normals);
+        chunk._textures.reserve (chunk._number_of_textures);
+
+        try
+        {
+          ChunkParser parser (&chunk);
+          forEachLine (chunk, parser);
+        }
+        catch (const Exception& exception)
+        {
+          chunk._error = exception.getText ();
+        }
+      }
+
     }
 
 
@@ -215,19 +779,186 @@ namespace HIP {
     // CLASS HIP::GL::Data
     //#**********************************************************************
 
-    /*! Constructor */
-    Data::Data (const QString& path)
-      : _name         (),
-        _vertices     (),
-        _normals      (),
-        _textures     (),
-        _groups       (),
-        _materials    (),
-        _bounding_box ()
+    /*!
+     * Constructor
+     *
+     * @param path      Path of the OBJ file to load
+     * @param loader    Parser used for reading the OBJ file content
+     * @param use_cache If set, the render ready mesh is taken from / stored in the binary mesh cache
+     */
+    Data::Data (const QString& path, Loader_t loader, bool use_cache)
+      : _name             (),
+        _vertices         (),
+        _normals          (),
+        _textures         (),
+        _groups           (),
+        _materials        (),
+        _material_library (),
+        _bounding_box     (),
+        _transform        (),
+        _mesh             (),
+        _hierarchy        (),
+        _geodesics        ()
+    {
+      if (!use_cache || !loadCache (path))
+        {
+          load (path, loader);
+
+          if (use_cache)
+            saveCache (path);
+        }
+    }
+
+    /*!
+     * Load and preprocess model data from the OBJ file
+     *
+     * @param path   Path of the OBJ file to load
+     * @param loader Parser used for reading the OBJ file content
+     */
+    void Data::load (const QString& path, Loader_t loader)
     {
-      QString content = Tools::loadResource<QString> (path);
       QString material_library;
 
+      QElapsedTimer timer;
+      timer.start ();
+
+      switch (loader)
+        {
+        case Loader::TEXT:
+          parseText (path, &material_library);
+          break;
+
+        case Loader::STREAMING:
+          parseStreaming (path, false, &material_library);
+          break;
+
+        case Loader::PARALLEL:
+          parseStreaming (path, true, &material_library);
+          break;
+        }
+
+      qint64 parse_time = timer.elapsed ();
+      Q_UNUSED (parse_time);
+
+      //
+      // Normalize vertices
+      //
+      float max_length = 0.0f;
+
+      foreach (const QVector3D& vertex, _vertices)
+        if (vertex.length () > max_length)
+          max_length = vertex.length ();
+
+      for (int i=0; i < _vertices.size (); ++i)
+        _vertices[i] /= max_length;
+
+      _transform.setToIdentity ();
+      _transform.scale (1.0f / max_length);
+
+      //
+      // Add missing normals
+      //
+      for (int i=0; i < _groups.size (); ++i)
+        {
+          GroupPtr group = _groups[i];
+
+          const QVector<int>& vertex_indices = group->getVertexIndices ();
+          const QVector<int>& normal_indices = group->getNormalIndices ();
+
+          for (int j=0; j < group->getNumberOfTriangles (); ++j)
+            {
+              if (normal_indices[j * 3] == -1)
+                {
+                  Q_ASSERT (normal_indices[j * 3 + 1] == -1);
+                  Q_ASSERT (normal_indices[j * 3 + 2] == -1);
+
+                  QVector3D p0 = _vertices[vertex_indices[j * 3 + 0]];
+                  QVector3D p1 = _vertices[vertex_indices[j * 3 + 1]];
+                  QVector3D p2 = _vertices[vertex_indices[j * 3 + 2]];
+                  QVector3D n = QVector3D::crossProduct (p1 - p0, p2 - p0);
+
+                  _normals.push_back (n);
+                  group->setNormalIndex (j, _normals.size () - 1);
+                }
+            }
+        }
+
+      //
+      // Sanity check
+      //
+      Q_ASSERT (!_vertices.isEmpty ());
+      Q_ASSERT (!_normals.isEmpty ());
+
+#ifndef QT_NO_DEBUG
+      foreach (const GroupPtr& group, _groups)
+        {
+          Q_ASSERT (group->getVertexIndices ().size () == group->getNumberOfTriangles () * 3);
+          Q_ASSERT (group->getNormalIndices ().size () == group->getNumberOfTriangles () * 3);
+          Q_ASSERT (group->getTextureIndices ().size () == group->getNumberOfTriangles () * 3);
+
+          for (int j=0; j < group->getNumberOfTriangles () * 3; ++j)
+            {
+              Q_ASSERT (group->getVertexIndices ()[j] >= -1 &&
+                        group->getVertexIndices ()[j] < _vertices.size ());
+              Q_ASSERT (group->getNormalIndices ()[j] >= -1 &&
+                        group->getNormalIndices ()[j] < _normals.size ());
+              Q_ASSERT (group->getTextureIndices ()[j] >= -1 &&
+                        group->getTextureIndices ()[j] < _textures.size ());
+            }
+        }
+#endif
+
+      //
+      // Statistics
+      //
+      if (_vertices.size () >= std::numeric_limits<GLushort>::max ())
+        qWarning ("Number of vertices > sizeof (GLushort)");
+
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "* Mesh: " << _name;
+      qDebug () << "  Parsed in" << parse_time << "ms (loader" << loader << ")";
+
+      int number_of_triangles = 0;
+      int face_memory = 0;
+
+      foreach (const GroupPtr& group, _groups)
+        {
+          qDebug () << "  Group " << group->getName ();
+          qDebug () << "    " << group->getNumberOfTriangles () << " triangles";
+
+          number_of_triangles += group->getNumberOfTriangles ();
+          face_memory += group->getMemoryUsage ();
+        }
+
+      qDebug () << "  " << _vertices.size () << " vertices";
+      qDebug () << "  " << number_of_triangles << " triangles," << face_memory << "bytes face storage ("
+                << (number_of_triangles > 0 ? face_memory / number_of_triangles : 0) << "bytes/triangle)";
+      qDebug () << "  limit (GLushort)=" << std::numeric_limits<GLushort>::max ();
+
+#endif
+
+      //
+      // Load material
+      //
+      if (!material_library.isEmpty ())
+        {
+          QStringList p = path.split ('/');
+          Q_ASSERT (!p.isEmpty ());
+          p[p.size () - 1] = material_library;
+
+          _material_library = p.join ('/');
+          loadMaterial (_material_library);
+        }
+
+      updateBoundingBox ();
+    }
+
+    /*
+     * Parse OBJ file using the QString/QTextStream based reference parser
+     */
+    void Data::parseText (const QString& path, QString* material_library)
+    {
+      QString content = Tools::loadResource<QString> (path);
       QTextStream file (&content, QIODevice::ReadOnly);
 
       GroupPtr group (new Group ());
@@ -289,16 +1020,11 @@ namespace HIP {
                 points.push_back (toPoint (tag));
 
               if (points.size () == 3)
-                group->addFace (Face (points));
+                group->addTriangle (points[0], points[1], points[2]);
               else if (points.size () == 4)
                 {
-                  QList<Point> points1;
-                  points1 << points[0] << points[1] << points[2];
-                  group->addFace (Face (points1));
-
-                  QList<Point> points2;
-                  points2 << points[1] << points[2] << points[3];
-                  group->addFace (Face (points2));
+                  group->addTriangle (points[0], points[1], points[2]);
+                  group->addTriangle (points[1], points[2], points[3]);
                 }
               else
                 throw Exception (QObject::tr ("Only triangular or rectangular faces supported."));
@@ -312,7 +1038,7 @@ namespace HIP {
               QString name;
               in >> name;
 
-              if (!group->getFaces ().isEmpty ())
+              if (group->getNumberOfTriangles () > 0)
                 _groups.push_back (group);
 
               group = GroupPtr (new Group ());
@@ -334,112 +1060,302 @@ namespace HIP {
           //
           else if (tag == "mtllib")
             {
-              in >> material_library;
+              in >> *material_library;
             }
         }
 
       _groups.push_back (group);
+    }
 
-      //
-      // Normalize vertices
-      //
-      float max_length = 0.0f;
+    /*
+     * Parse OBJ file by tokenizing the raw file content in place
+     *
+     * This parser produces the same result as the text based one, but works on the
+     * UTF-8 bytes of the file directly without creating intermediate strings per line
+     * or token. In parallel mode, the file is split into line aligned chunks which are
+     * parsed on the global thread pool:
+     *
+     * 1. Count phase: Number of vertices, normals and textures per chunk. This gives the
+     *    absolute index base of each chunk needed to resolve relative face indices.
+     * 2. Parse phase: Each chunk is parsed into its own vertex / face buffers.
+     * 3. Stitch phase: Chunk buffers are concatenated and the group / material state
+     *    is replayed in file order.
+     */
+    void Data::parseStreaming (const QString& path, bool parallel, QString* material_library)
+    {
+      QElapsedTimer timer;
+      timer.start ();
 
-      foreach (const QVector3D& vertex, _vertices)
-        if (vertex.length () > max_length)
-          max_length = vertex.length ();
+      QByteArray content = Tools::loadResource<QByteArray> (path);
 
-      for (int i=0; i < _vertices.size (); ++i)
-        _vertices[i] /= max_length;
+      qint64 load_time = timer.restart ();
+
+      const char* begin = content.constData ();
+      const char* end = begin + content.size ();
 
       //
-      // Add missing normals
+      // Split file into line aligned chunks
       //
-      for (int i=0; i < _groups.size (); ++i)
-        {
-          GroupPtr group = _groups[i];
+      static const int MIN_CHUNK_SIZE = 256 * 1024;
 
-          for (int j=0; j < group->getFaces ().size (); ++j)
-            {
-              const Face& face = group->getFaces ()[j];
+      int number_of_chunks = 1;
+      if (parallel)
+        number_of_chunks = qBound (1, content.size () / MIN_CHUNK_SIZE, 4 * qMax (QThreadPool::globalInstance ()->maxThreadCount (), 1));
 
-              Q_ASSERT (face.getPoints ().size () == 3);
+      QVector<DataChunk> chunks (number_of_chunks);
 
-              if (face.getPoints ()[0].getNormalIndex () == -1)
-                {
-                  Q_ASSERT (face.getPoints ()[1].getNormalIndex () == -1);
-                  Q_ASSERT (face.getPoints ()[2].getNormalIndex () == -1);
+      const char* pos = begin;
+      for (int i=0; i < chunks.size (); ++i)
+        {
+          const char* chunk_end = i < chunks.size () - 1 ? begin + (content.size () / number_of_chunks) * (i + 1) : end;
 
-                  QVector3D p0 = _vertices[face.getPoints ()[0].getVertexIndex ()];
-                  QVector3D p1 = _vertices[face.getPoints ()[1].getVertexIndex ()];
-                  QVector3D p2 = _vertices[face.getPoints ()[2].getVertexIndex ()];
-                  QVector3D n = QVector3D::crossProduct (p1 - p0, p2 - p0);
+          if (chunk_end < pos)
+            chunk_end = pos;
 
-                  _normals.push_back (n);
-                  group->setNormalIndex (j, _normals.size () - 1);
-                }
+          if (chunk_end != end)
+            {
+              chunk_end = static_cast<const char*> (memchr (chunk_end, '\n', end - chunk_end));
+              chunk_end = chunk_end != 0 ? chunk_end + 1 : end;
             }
+
+          chunks[i]._begin = pos;
+          chunks[i]._end = chunk_end;
+
+          pos = chunk_end;
         }
 
       //
-      // Sanity check
+      // Phase 1: Count elements to compute the absolute index base of each chunk
       //
-      Q_ASSERT (!_vertices.isEmpty ());
-      Q_ASSERT (!_normals.isEmpty ());
-
-      foreach (const GroupPtr& group, _groups)
+      if (chunks.size () > 1)
         {
-          foreach (const Face& face, group->getFaces ())
+          QtConcurrent::blockingMap (chunks, countChunk);
+
+          for (int i=1; i < chunks.size (); ++i)
             {
-              Q_ASSERT (!face.getPoints ().isEmpty ());
+              const DataChunk& previous = chunks[i - 1];
+              DataChunk& chunk = chunks[i];
 
-              foreach (const Point& point, face.getPoints ())
-                {
-                  Q_UNUSED (point);
-
-                  Q_ASSERT (point.getVertexIndex () >= -1 &&
-                            point.getVertexIndex () < _vertices.size ());
-                  Q_ASSERT (point.getNormalIndex () >= -1 &&
-                            point.getNormalIndex () < _normals.size ());
-                  Q_ASSERT (point.getTextureIndex () >= -1 &&
-                            point.getTextureIndex () < _textures.size ());
-                }
+              chunk._first_line = previous._first_line + previous._number_of_lines;
+              chunk._vertex_base = previous._vertex_base + previous._number_of_vertices;
+              chunk._normal_base = previous._normal_base + previous._number_of_normals;
+              chunk._texture_base = previous._texture_base + previous._number_of_textures;
             }
         }
 
+      qint64 count_time = timer.restart ();
+
       //
-      // Statistics
+      // Phase 2: Parse chunks
       //
-      if (_vertices.size () >= std::numeric_limits<GLushort>::max ())
-        qWarning ("Number of vertices > sizeof (GLushort)");
+      if (chunks.size () > 1)
+        QtConcurrent::blockingMap (chunks, parseChunk);
+      else
+        parseChunk (chunks[0]);
 
-#if 0
-      qDebug () << "* Mesh: " << _name;
+      foreach (const DataChunk& chunk, chunks)
+        if (!chunk._error.isEmpty ())
+          throw Exception (chunk._error);
 
-      foreach (const GroupPtr& group, _groups)
+      qint64 parse_time = timer.restart ();
+
+      //
+      // Phase 3: Stitch chunks together in file order
+      //
+      int number_of_vertices = 0;
+      int number_of_normals = 0;
+      int number_of_textures = 0;
+
+      foreach (const DataChunk& chunk, chunks)
         {
-          qDebug () << "  Group " << group->getName ();
-          qDebug () << "    " << group->getFaces ().size () << " faces";
+          number_of_vertices += chunk._vertices.size ();
+          number_of_normals += chunk._normals.size ();
+          number_of_textures += chunk._textures.size ();
         }
 
-      qDebug () << "  " << _vertices.size () << " vertices";
-      qDebug () << "  limit (GLushort)=" << std::numeric_limits<GLushort>::max ();
+      _vertices.reserve (number_of_vertices);
+      _normals.reserve (number_of_normals);
+      _textures.reserve (number_of_textures);
 
-#endif
+      GroupPtr group (new Group ());
 
-      //
-      // Load material
-      //
-      if (!material_library.isEmpty ())
+      for (int i=0; i < chunks.size (); ++i)
         {
-          QStringList p = path.split ('/');
-          Q_ASSERT (!p.isEmpty ());
-          p[p.size () - 1] = material_library;
+          DataChunk& chunk = chunks[i];
 
-          loadMaterial (p.join ('/'));
+          _vertices += chunk._vertices;
+          _normals += chunk._normals;
+          _textures += chunk._textures;
+
+          int number_of_triangles = chunk._vertex_indices.size () / 3;
+          int triangle = 0;
+
+          for (int j=0; j <= chunk._events.size (); ++j)
+            {
+              int triangle_end = j < chunk._events.size () ? chunk._events[j]._triangle : number_of_triangles;
+
+              group->addTriangles (chunk._vertex_indices.constData () + triangle * 3,
+                                   chunk._normal_indices.constData () + triangle * 3,
+                                   chunk._texture_indices.constData () + triangle * 3,
+                                   triangle_end - triangle);
+              triangle = triangle_end;
+
+              if (j < chunk._events.size ())
+                {
+                  const DataChunk::Event& event = chunk._events[j];
+
+                  switch (event._type)
+                    {
+                    case DataChunk::Event::Type::OBJECT:
+                      _name = event._name;
+                      break;
+
+                    case DataChunk::Event::Type::GROUP:
+                      if (group->getNumberOfTriangles () > 0)
+                        _groups.push_back (group);
+
+                      group = GroupPtr (new Group ());
+                      group->setName (event._name);
+                      break;
+
+                    case DataChunk::Event::Type::MATERIAL:
+                      group->setMaterial (event._name);
+                      break;
+
+                    case DataChunk::Event::Type::MATERIAL_LIBRARY:
+                      *material_library = event._name;
+                      break;
+                    }
+                }
+            }
+
+          chunk = DataChunk ();
         }
 
-      updateBoundingBox ();
+      _groups.push_back (group);
+
+      qint64 stitch_time = timer.elapsed ();
+
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "* Streaming OBJ parser:" << path;
+      qDebug () << "  " << chunks.size () << "chunks," << QThreadPool::globalInstance ()->maxThreadCount () << "threads";
+      qDebug () << "  load" << load_time << "ms, count" << count_time << "ms, parse" << parse_time
+                << "ms, stitch" << stitch_time << "ms";
+#else
+      Q_UNUSED (load_time);
+      Q_UNUSED (count_time);
+      Q_UNUSED (parse_time);
+      Q_UNUSED (stitch_time);
+#endif
+    }
+
+    /*!
+     * Load render ready mesh and model information from the binary mesh cache
+     *
+     * @param path Path of the OBJ file the cache belongs to
+     * @return 'true' if a valid cache entry has been found
+     */
+    bool Data::loadCache (const QString& path)
+    {
+      QElapsedTimer timer;
+      timer.start ();
+
+      MeshCache cache (path);
+      if (!cache.load ())
+        return false;
+
+      _name = cache.getName ();
+      _materials = cache.getMaterials ();
+      _material_library = cache.getMaterialLibrary ();
+      _bounding_box = cache.getBoundingBox ();
+      _transform = cache.getTransform ();
+      _mesh = cache.getMesh ();
+
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "* Mesh: " << _name << "loaded from cache in" << timer.elapsed () << "ms";
+      qDebug () << "  " << _mesh->getNumberOfVertices () << "vertices," << _mesh->getNumberOfIndices () / 3 << "triangles";
+#endif
+
+      return true;
+    }
+
+    /*!
+     * Store render ready mesh and model information in the binary mesh cache
+     *
+     * @param path Path of the OBJ file the cache belongs to
+     */
+    void Data::saveCache (const QString& path) const
+    {
+      MeshCache cache (path);
+      cache.save (*this);
+    }
+
+    /*!
+     * Return render ready mesh
+     *
+     * The mesh is computed on first access if it has not been loaded from the cache.
+     */
+    const Mesh& Data::getMesh () const
+    {
+      if (_mesh.isNull ())
+        _mesh = QSharedPointer<Mesh> (new Mesh (this));
+
+      return *_mesh;
+    }
+
+    /*!
+     * Start building the bounding volume hierarchy for ray picking in the background
+     *
+     * The render ready mesh is computed in the calling thread if necessary. The hierarchy
+     * keeps a reference to the mesh, so the model might be destroyed during the build.
+     *
+     * @return Future of the build, e.g. for watching its completion
+     */
+    QFuture<BoundingVolumeHierarchyPtr> Data::buildHierarchy () const
+    {
+      getMesh ();
+      _hierarchy = QtConcurrent::run (createHierarchy, _mesh);
+
+      return _hierarchy;
+    }
+
+    /*!
+     * Return bounding volume hierarchy over the mesh triangles
+     *
+     * @return Hierarchy or 0 if 'buildHierarchy ()' has not been called or the build is
+     *         still running
+     */
+    const BoundingVolumeHierarchy* Data::getHierarchy () const
+    {
+      return _hierarchy.isFinished () && _hierarchy.resultCount () > 0 ? _hierarchy.result ().data () : 0;
+    }
+
+    /*!
+     * Start creating the geodesic distance engine in the background
+     *
+     * The operators of the heat method are computed in the background, too, so the
+     * first distance query is not delayed. The render ready mesh is computed in the
+     * calling thread if necessary.
+     *
+     * @return Future of the build, e.g. for watching its completion
+     */
+    QFuture<GeodesicsPtr> Data::buildGeodesics () const
+    {
+      getMesh ();
+      _geodesics = QtConcurrent::run (createGeodesics, _mesh);
+
+      return _geodesics;
+    }
+
+    /*!
+     * Return geodesic distance engine of the mesh surface
+     *
+     * @return Engine or 0 if 'buildGeodesics ()' has not been called or the build is
+     *         still running
+     */
+    const Geodesics* Data::getGeodesics () const
+    {
+      return _geodesics.isFinished () && _geodesics.resultCount () > 0 ? _geodesics.result ().data () : 0;
     }
 
     /*
@@ -459,6 +1375,14 @@ namespace HIP {
           _vertices[i] /= max_axis;
         }
 
+      QMatrix4x4 transform;
+      transform.scale (1.0f / max_axis);
+      transform.translate (-center);
+      _transform = transform * _transform;
+
+      _mesh.clear ();
+      _hierarchy = QFuture<BoundingVolumeHierarchyPtr> ();
+      _geodesics = QFuture<GeodesicsPtr> ();
       updateBoundingBox ();
     }
 
@@ -470,14 +1394,24 @@ namespace HIP {
       for (int i=0; i < _vertices.size (); ++i)
         _vertices[i] *= factor;
 
+      QMatrix4x4 transform;
+      transform.scale (factor);
+      _transform = transform * _transform;
+
+      _mesh.clear ();
+      _hierarchy = QFuture<BoundingVolumeHierarchyPtr> ();
+      _geodesics = QFuture<GeodesicsPtr> ();
       updateBoundingBox ();
     }
 
     /*
-     * Compute bounding box
+     * Compute bounding box of the model and bounding volumes of the groups
      */
     void Data::updateBoundingBox ()
     {
+      foreach (const GroupPtr& group, _groups)
+        group->updateBounds (_vertices);
+
       _bounding_box.first = QVector3D (std::numeric_limits<float>::max (),
                                        std::numeric_limits<float>::max (),
                                        std::numeric_limits<float>::max ());
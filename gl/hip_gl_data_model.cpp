@@ -133,6 +133,7 @@ namespace HIP {
         case Database::Database::Reason::SELECTION:
         case Database::Database::Reason::FILTER:
         case Database::Database::Reason::VIEW:
+        case Database::Database::Reason::PLACEMENT:
           break;
         }
     }
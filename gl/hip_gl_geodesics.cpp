@@ -0,0 +1,890 @@
+/*
+ * hip_gl_geodesics.cpp - Geodesic distances and shortest paths on the mesh surface
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPGLGeodesics.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QPair>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace HIP {
+  namespace GL {
+
+    //#**********************************************************************
+    // Local definitions
+    //#**********************************************************************
+
+    namespace {
+
+      //
+      // Number of distance fields kept for repeated queries from the same source
+      //
+      const int MAX_CACHED_FIELDS = 8;
+
+      //
+      // Maximum number of vertices in a leaf of the nested dissection. Leaves are
+      // eliminated in their natural order.
+      //
+      const int DISSECTION_LEAF_SIZE = 64;
+
+      //
+      // Regularization of the Poisson system relative to the mass matrix. The cotangent
+      // Laplacian is singular, the shift makes it positive definite without noticeably
+      // changing the solution, which is fixed up to a constant anyway.
+      //
+      const double POISSON_REGULARIZATION = 1e-8;
+
+      const float INFINITE_DISTANCE = std::numeric_limits<float>::infinity ();
+
+      typedef QPair<float, int> HeapEntry; // Key and vertex index
+
+      /*
+       * Lexicographic order of mesh vertex positions used for welding
+       */
+      struct PositionComparator
+      {
+        PositionComparator (const VertexData* vertices)
+          : _vertices (vertices) {}
+
+        bool operator () (int v1, int v2) const
+        {
+          const QVector3D& p1 = _vertices[v1]._vertex;
+          const QVector3D& p2 = _vertices[v2]._vertex;
+
+          if (p1.x () != p2.x ())
+            return p1.x () < p2.x ();
+          if (p1.y () != p2.y ())
+            return p1.y () < p2.y ();
+          return p1.z () < p2.z ();
+        }
+
+        const VertexData* _vertices;
+      };
+
+      /*
+       * Order of vertices along a coordinate axis used for the nested dissection
+       */
+      struct AxisComparator
+      {
+        AxisComparator (const QVector<QVector3D>& positions, int axis)
+          : _positions (positions), _axis (axis) {}
+
+        bool operator () (int v1, int v2) const
+        {
+          return _positions[v1][_axis] < _positions[v2][_axis];
+        }
+
+        const QVector<QVector3D>& _positions;
+        int _axis;
+      };
+
+      /* Add entry to a matrix under assembly */
+      void addEntry (QVector<SparseMatrix::Entry>* entries, int row, int column, double value)
+      {
+        SparseMatrix::Entry entry = { row, column, value };
+        entries->push_back (entry);
+      }
+
+      /* Push entry onto a min heap */
+      void pushHeap (QVector<HeapEntry>* heap, float key, int vertex)
+      {
+        heap->push_back (qMakePair (key, vertex));
+        std::push_heap (heap->begin (), heap->end (), std::greater<HeapEntry> ());
+      }
+
+      /* Pop entry with the smallest key from a min heap */
+      HeapEntry popHeap (QVector<HeapEntry>* heap)
+      {
+        std::pop_heap (heap->begin (), heap->end (), std::greater<HeapEntry> ());
+        HeapEntry entry = heap->back ();
+        heap->pop_back ();
+        return entry;
+      }
+
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::SurfacePoint
+    //#**********************************************************************
+
+    /*! Constructor for an invalid surface point */
+    SurfacePoint::SurfacePoint ()
+      : _triangle (-1),
+        _position ()
+    {
+    }
+
+    /*!
+     * Constructor
+     *
+     * @param triangle Index of the mesh triangle the point is located on
+     * @param position Position on the triangle
+     */
+    SurfacePoint::SurfacePoint (int triangle, const QVector3D& position)
+      : _triangle (triangle),
+        _position (position)
+    {
+    }
+
+    /*! Comparison operator */
+    bool SurfacePoint::operator== (const SurfacePoint& point) const
+    {
+      return _triangle == point._triangle && _position == point._position;
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::Geodesics
+    //#**********************************************************************
+
+    /*!
+     * Constructor
+     *
+     * Welds the mesh vertices and computes the edge graph. The operators of the heat
+     * method are computed on the first heat query.
+     *
+     * @param mesh Mesh the distances are computed on
+     */
+    Geodesics::Geodesics (const MeshPtr& mesh)
+      : _mesh               (mesh),
+        _positions          (),
+        _triangles          (),
+        _components         (),
+        _adjacency_offsets  (),
+        _adjacency          (),
+        _edge_lengths       (),
+        _mean_edge_length   (0.0f),
+        _mutex              (),
+        _operators_computed (false),
+        _cotangents         (),
+        _heat_solver        (),
+        _poisson_solver     (),
+        _fields             ()
+    {
+#ifdef HIP_PRINT_STATISTICS
+      QElapsedTimer timer;
+      timer.start ();
+#endif
+
+      weld ();
+      computeGraph ();
+      computeComponents ();
+
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "* Geodesics: Precomputation";
+      qDebug () << "  " << _positions.size () << "welded vertices," << _adjacency.size () / 2 << "edges in"
+                << timer.elapsed () << "ms";
+#endif
+    }
+
+    /*! Destructor */
+    Geodesics::~Geodesics ()
+    {
+    }
+
+    /*!
+     * Compute the operators of the heat method in advance
+     *
+     * Otherwise they are computed on the first heat query, which takes seconds for
+     * large meshes.
+     */
+    void Geodesics::prepare () const
+    {
+      QMutexLocker locker (&_mutex);
+
+      if (!_operators_computed)
+        computeOperators ();
+    }
+
+    /*!
+     * Compute geodesic distances from a source point to all mesh vertices
+     *
+     * @param source Source point on the mesh surface
+     * @param method Computation method
+     * @return Distance of each welded vertex. Vertices not connected to the source have
+     *         an infinite distance.
+     */
+    QVector<float> Geodesics::computeDistances (const SurfacePoint& source, Method_t method) const
+    {
+      QMutexLocker locker (&_mutex);
+      return getDistances (source, method);
+    }
+
+    /*!
+     * Compute geodesic distance between two surface points
+     *
+     * @param source Source point on the mesh surface
+     * @param target Target point on the mesh surface
+     * @param method Computation method
+     * @return Distance or infinity if the points are not connected by the surface
+     */
+    float Geodesics::computeDistance (const SurfacePoint& source, const SurfacePoint& target, Method_t method) const
+    {
+      if (!source.isValid () || !target.isValid ())
+        return INFINITE_DISTANCE;
+
+      if (source.getTriangle () == target.getTriangle ())
+        return (target.getPosition () - source.getPosition ()).length ();
+
+      QMutexLocker locker (&_mutex);
+      return interpolate (getDistances (source, method), target, method);
+    }
+
+    /*!
+     * Compute shortest path between two surface points
+     *
+     * The path is searched with A* on the edge graph using the straight line distance as
+     * heuristic, so only a small part of the mesh is visited for close points. It follows
+     * the mesh edges between the triangles of the end points.
+     *
+     * @param source Source point on the mesh surface
+     * @param target Target point on the mesh surface
+     * @return Path from the source to the target or an empty path if the points are not
+     *         connected by the surface
+     */
+    QVector<QVector3D> Geodesics::computePath (const SurfacePoint& source, const SurfacePoint& target) const
+    {
+      QVector<QVector3D> path;
+
+      if (!source.isValid () || !target.isValid ())
+        return path;
+
+      if (source.getTriangle () == target.getTriangle ())
+        {
+          path.push_back (source.getPosition ());
+          path.push_back (target.getPosition ());
+          return path;
+        }
+
+      const int* source_corners = _triangles.constData () + source.getTriangle () * 3;
+      const int* target_corners = _triangles.constData () + target.getTriangle () * 3;
+
+      QVector<float> distances (_positions.size (), INFINITE_DISTANCE);
+      QVector<int> predecessors (_positions.size (), -1);
+      QVector<HeapEntry> heap;
+
+      for (int i=0; i < 3; ++i)
+        {
+          int vertex = source_corners[i];
+          float distance = (_positions[vertex] - source.getPosition ()).length ();
+
+          if (distance < distances[vertex])
+            {
+              distances[vertex] = distance;
+              pushHeap (&heap, distance + (_positions[vertex] - target.getPosition ()).length (), vertex);
+            }
+        }
+
+      float best_distance = INFINITE_DISTANCE;
+      int best_vertex = -1;
+
+      while (!heap.isEmpty ())
+        {
+          HeapEntry entry = popHeap (&heap);
+          if (entry.first >= best_distance)
+            break;
+
+          int vertex = entry.second;
+          float remaining = (_positions[vertex] - target.getPosition ()).length ();
+
+          if (entry.first > distances[vertex] + remaining)
+            continue;
+
+          //
+          // The heuristic is exact for the corners of the target triangle
+          //
+          if (vertex == target_corners[0] || vertex == target_corners[1] || vertex == target_corners[2])
+            {
+              best_distance = entry.first;
+              best_vertex = vertex;
+            }
+
+          for (int i=_adjacency_offsets[vertex]; i < _adjacency_offsets[vertex + 1]; ++i)
+            {
+              int neighbour = _adjacency[i];
+              float distance = distances[vertex] + _edge_lengths[i];
+
+              if (distance < distances[neighbour])
+                {
+                  distances[neighbour] = distance;
+                  predecessors[neighbour] = vertex;
+                  pushHeap (&heap, distance + (_positions[neighbour] - target.getPosition ()).length (), neighbour);
+                }
+            }
+        }
+
+      if (best_vertex == -1)
+        return path;
+
+      path.push_back (target.getPosition ());
+      for (int vertex=best_vertex; vertex != -1; vertex = predecessors[vertex])
+        path.push_back (_positions[vertex]);
+      path.push_back (source.getPosition ());
+
+      std::reverse (path.begin (), path.end ());
+
+      return path;
+    }
+
+    /*
+     * Weld mesh vertices with identical positions
+     */
+    void Geodesics::weld ()
+    {
+      int number_of_vertices = _mesh->getNumberOfVertices ();
+      const VertexData* vertices = _mesh->getVertexData ();
+
+      QVector<int> order (number_of_vertices);
+      for (int i=0; i < number_of_vertices; ++i)
+        order[i] = i;
+
+      std::sort (order.begin (), order.end (), PositionComparator (vertices));
+
+      QVector<int> welded (number_of_vertices);
+      _positions.reserve (number_of_vertices);
+
+      for (int i=0; i < number_of_vertices; ++i)
+        {
+          const QVector3D& position = vertices[order[i]]._vertex;
+
+          if (_positions.isEmpty () || _positions.back () != position)
+            _positions.push_back (position);
+
+          welded[order[i]] = _positions.size () - 1;
+        }
+
+      _positions.squeeze ();
+
+      const GLuint* indices = _mesh->getIndexData ();
+      _triangles.resize (_mesh->getNumberOfIndices ());
+
+      for (int i=0; i < _triangles.size (); ++i)
+        _triangles[i] = welded[indices[i]];
+    }
+
+    /*
+     * Compute edge graph of the welded mesh
+     */
+    void Geodesics::computeGraph ()
+    {
+      QVector<quint64> edges;
+      edges.reserve (_triangles.size () * 2);
+
+      for (int i=0; i < _triangles.size (); i += 3)
+        for (int j=0; j < 3; ++j)
+          {
+            quint64 v0 = _triangles[i + j];
+            quint64 v1 = _triangles[i + (j + 1) % 3];
+
+            if (v0 != v1)
+              {
+                edges.push_back ((v0 << 32) | v1);
+                edges.push_back ((v1 << 32) | v0);
+              }
+          }
+
+      std::sort (edges.begin (), edges.end ());
+      edges.erase (std::unique (edges.begin (), edges.end ()), edges.end ());
+
+      _adjacency_offsets.fill (0, _positions.size () + 1);
+      _adjacency.resize (edges.size ());
+      _edge_lengths.resize (edges.size ());
+
+      double total_length = 0.0;
+
+      for (int i=0; i < edges.size (); ++i)
+        {
+          int v0 = int (edges[i] >> 32);
+          int v1 = int (edges[i] & 0xffffffff);
+
+          ++_adjacency_offsets[v0 + 1];
+          _adjacency[i] = v1;
+          _edge_lengths[i] = (_positions[v1] - _positions[v0]).length ();
+
+          total_length += _edge_lengths[i];
+        }
+
+      for (int i=0; i < _positions.size (); ++i)
+        _adjacency_offsets[i + 1] += _adjacency_offsets[i];
+
+      _mean_edge_length = !edges.isEmpty () ? float (total_length / edges.size ()) : 0.0f;
+    }
+
+    /*
+     * Compute connected components of the edge graph
+     */
+    void Geodesics::computeComponents ()
+    {
+      _components.fill (-1, _positions.size ());
+
+      QVector<int> stack;
+      int component = 0;
+
+      for (int i=0; i < _positions.size (); ++i)
+        if (_components[i] == -1)
+          {
+            _components[i] = component;
+            stack.push_back (i);
+
+            while (!stack.isEmpty ())
+              {
+                int vertex = stack.back ();
+                stack.pop_back ();
+
+                for (int j=_adjacency_offsets[vertex]; j < _adjacency_offsets[vertex + 1]; ++j)
+                  if (_components[_adjacency[j]] == -1)
+                    {
+                      _components[_adjacency[j]] = component;
+                      stack.push_back (_adjacency[j]);
+                    }
+              }
+
+            ++component;
+          }
+    }
+
+    /*
+     * Compute and factorize the operators of the heat method
+     *
+     * The cotangent Laplacian L is positive semidefinite, the mass matrix M is lumped
+     * to the vertices. The heat flow time step is the squared mean edge length.
+     */
+    void Geodesics::computeOperators () const
+    {
+#ifdef HIP_PRINT_STATISTICS
+      QElapsedTimer timer;
+      timer.start ();
+#endif
+
+      int number_of_vertices = _positions.size ();
+
+      _cotangents.fill (0.0, _triangles.size ());
+
+      QVector<double> masses (number_of_vertices, 0.0);
+      QVector<SparseMatrix::Entry> laplacian;
+      laplacian.reserve (_triangles.size () * 4);
+
+      for (int i=0; i < _triangles.size (); i += 3)
+        {
+          const int* corners = _triangles.constData () + i;
+
+          double area = QVector3D::crossProduct (_positions[corners[1]] - _positions[corners[0]],
+                                                 _positions[corners[2]] - _positions[corners[0]]).length ();
+          if (area <= 0.0)
+            continue;
+
+          for (int j=0; j < 3; ++j)
+            {
+              int v0 = corners[j];
+              int v1 = corners[(j + 1) % 3];
+              int v2 = corners[(j + 2) % 3];
+
+              double cotangent = QVector3D::dotProduct (_positions[v1] - _positions[v0], _positions[v2] - _positions[v0]) / area;
+              double weight = 0.5 * cotangent;
+
+              _cotangents[i + j] = cotangent;
+
+              addEntry (&laplacian, v1, v1, weight);
+              addEntry (&laplacian, v2, v2, weight);
+              addEntry (&laplacian, v1, v2, -weight);
+              addEntry (&laplacian, v2, v1, -weight);
+
+              masses[v0] += area / 6.0;
+            }
+        }
+
+      double time = double (_mean_edge_length) * _mean_edge_length;
+      double epsilon = POISSON_REGULARIZATION / qMax (time, std::numeric_limits<double>::min ());
+
+      QVector<SparseMatrix::Entry> heat_entries;
+      QVector<SparseMatrix::Entry> poisson_entries;
+      heat_entries.reserve (laplacian.size () + number_of_vertices);
+      poisson_entries.reserve (laplacian.size () + number_of_vertices);
+
+      for (int i=0; i < laplacian.size (); ++i)
+        {
+          const SparseMatrix::Entry& entry = laplacian[i];
+          addEntry (&heat_entries, entry._row, entry._column, time * entry._value);
+          poisson_entries.push_back (entry);
+        }
+
+      //
+      // Vertices which are part of degenerated triangles only get a minimum mass to
+      // keep the systems positive definite
+      //
+      for (int i=0; i < number_of_vertices; ++i)
+        {
+          double mass = qMax (masses[i], 1e-6 * time);
+          addEntry (&heat_entries, i, i, mass);
+          addEntry (&poisson_entries, i, i, epsilon * mass);
+        }
+
+      QVector<int> ordering = computeOrdering ();
+
+#ifdef HIP_PRINT_STATISTICS
+      qint64 assembly_time = timer.restart ();
+#endif
+
+      if (!_heat_solver.factorize (SparseMatrix (number_of_vertices, heat_entries), ordering))
+        qWarning () << "Geodesics: Heat flow system is not positive definite";
+
+      if (!_poisson_solver.factorize (SparseMatrix (number_of_vertices, poisson_entries), ordering))
+        qWarning () << "Geodesics: Poisson system is not positive definite";
+
+      _operators_computed = true;
+
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "* Geodesics: Heat method operators";
+      qDebug () << "  Assembly and ordering:" << assembly_time << "ms";
+      qDebug () << "  Factorization:" << timer.elapsed () << "ms,"
+                << _heat_solver.getNumberOfEntries () + _poisson_solver.getNumberOfEntries () << "factor entries";
+#endif
+    }
+
+    /*
+     * Compute fill reducing order of the vertices by geometric nested dissection
+     */
+    QVector<int> Geodesics::computeOrdering () const
+    {
+      QVector<int> vertices (_positions.size ());
+      for (int i=0; i < vertices.size (); ++i)
+        vertices[i] = i;
+
+      QVector<int> sides (_positions.size (), 0);
+      QVector<int> order;
+      order.reserve (_positions.size ());
+
+      int tag = 0;
+      dissect (vertices.data (), vertices.size (), &sides, &tag, &order);
+
+      return order;
+    }
+
+    /*
+     * Order vertices by nested dissection
+     *
+     * The vertices are split at the median of the longest extent of their bounding box.
+     * The vertices of the lower half which are connected to the upper half form the
+     * separator, which is ordered after both halves.
+     *
+     * @param vertices Vertices to be ordered. The array is rearranged.
+     * @param count    Number of vertices
+     * @param sides    Side tag of each vertex
+     * @param tag      Last used side tag
+     * @param order    Vertex order the vertices are appended to
+     */
+    void Geodesics::dissect (int* vertices, int count, QVector<int>* sides, int* tag, QVector<int>* order) const
+    {
+      if (count <= DISSECTION_LEAF_SIZE)
+        {
+          for (int i=0; i < count; ++i)
+            order->push_back (vertices[i]);
+          return;
+        }
+
+      QVector3D minimum = _positions[vertices[0]];
+      QVector3D maximum = minimum;
+
+      for (int i=1; i < count; ++i)
+        for (int j=0; j < 3; ++j)
+          {
+            minimum[j] = qMin (minimum[j], _positions[vertices[i]][j]);
+            maximum[j] = qMax (maximum[j], _positions[vertices[i]][j]);
+          }
+
+      QVector3D extent = maximum - minimum;
+      int axis = 0;
+      if (extent.y () > extent[axis])
+        axis = 1;
+      if (extent.z () > extent[axis])
+        axis = 2;
+
+      int half = count / 2;
+      std::nth_element (vertices, vertices + half, vertices + count, AxisComparator (_positions, axis));
+
+      int lower_tag = ++*tag;
+      int upper_tag = ++*tag;
+
+      for (int i=0; i < count; ++i)
+        (*sides)[vertices[i]] = i < half ? lower_tag : upper_tag;
+
+      //
+      // Move separator vertices to the end of the lower half
+      //
+      int interior = 0;
+
+      for (int i=0; i < half; ++i)
+        {
+          int vertex = vertices[i];
+          bool is_separator = false;
+
+          for (int j=_adjacency_offsets[vertex]; j < _adjacency_offsets[vertex + 1] && !is_separator; ++j)
+            is_separator = (*sides)[_adjacency[j]] == upper_tag;
+
+          if (!is_separator)
+            std::swap (vertices[interior++], vertices[i]);
+        }
+
+      dissect (vertices, interior, sides, tag, order);
+      dissect (vertices + half, count - half, sides, tag, order);
+
+      for (int i=interior; i < half; ++i)
+        order->push_back (vertices[i]);
+    }
+
+    /*
+     * Compute distances with Dijkstra's algorithm on the edge graph
+     */
+    QVector<float> Geodesics::computeGraphDistances (const SurfacePoint& source) const
+    {
+      QVector<float> distances (_positions.size (), INFINITE_DISTANCE);
+      QVector<HeapEntry> heap;
+
+      const int* corners = _triangles.constData () + source.getTriangle () * 3;
+
+      for (int i=0; i < 3; ++i)
+        {
+          float distance = (_positions[corners[i]] - source.getPosition ()).length ();
+
+          if (distance < distances[corners[i]])
+            {
+              distances[corners[i]] = distance;
+              pushHeap (&heap, distance, corners[i]);
+            }
+        }
+
+      while (!heap.isEmpty ())
+        {
+          HeapEntry entry = popHeap (&heap);
+          int vertex = entry.second;
+
+          if (entry.first > distances[vertex])
+            continue;
+
+          for (int i=_adjacency_offsets[vertex]; i < _adjacency_offsets[vertex + 1]; ++i)
+            {
+              int neighbour = _adjacency[i];
+              float distance = entry.first + _edge_lengths[i];
+
+              if (distance < distances[neighbour])
+                {
+                  distances[neighbour] = distance;
+                  pushHeap (&heap, distance, neighbour);
+                }
+            }
+        }
+
+      return distances;
+    }
+
+    /*
+     * Compute distances with the heat method
+     */
+    QVector<float> Geodesics::computeHeatDistances (const SurfacePoint& source) const
+    {
+      if (!_operators_computed)
+        computeOperators ();
+
+      int number_of_vertices = _positions.size ();
+
+      if (!_heat_solver.isValid () || !_poisson_solver.isValid ())
+        return QVector<float> (number_of_vertices, INFINITE_DISTANCE);
+
+      const int* source_corners = _triangles.constData () + source.getTriangle () * 3;
+
+      //
+      // Step 1: Diffuse heat from the source, which is distributed onto the corners of
+      //         its triangle
+      //
+      float weights[3];
+      computeWeights (source, weights);
+
+      QVector<double> heat (number_of_vertices, 0.0);
+      for (int i=0; i < 3; ++i)
+        heat[source_corners[i]] += weights[i];
+
+      _heat_solver.solve (heat, &heat);
+
+      //
+      // Step 2: Integrated divergence of the normalized heat gradient, which points
+      //         away from the source
+      //
+      QVector<double> divergence (number_of_vertices, 0.0);
+
+      for (int i=0; i < _triangles.size (); i += 3)
+        {
+          const int* corners = _triangles.constData () + i;
+
+          const QVector3D& p0 = _positions[corners[0]];
+          const QVector3D& p1 = _positions[corners[1]];
+          const QVector3D& p2 = _positions[corners[2]];
+
+          QVector3D normal = QVector3D::crossProduct (p1 - p0, p2 - p0);
+          float area = normal.length ();
+          if (area <= 0.0f)
+            continue;
+
+          normal /= area;
+
+          //
+          // The heat decays exponentially with the distance, so it is scaled per triangle
+          // before converting it to single precision. Only the gradient direction is used.
+          //
+          double scale = qMax (qAbs (heat[corners[0]]), qMax (qAbs (heat[corners[1]]), qAbs (heat[corners[2]])));
+          if (scale <= 0.0)
+            continue;
+
+          QVector3D gradient = QVector3D::crossProduct (normal, p2 - p1) * float (heat[corners[0]] / scale) +
+                               QVector3D::crossProduct (normal, p0 - p2) * float (heat[corners[1]] / scale) +
+                               QVector3D::crossProduct (normal, p1 - p0) * float (heat[corners[2]] / scale);
+
+          float length = gradient.length ();
+          if (length <= 0.0f)
+            continue;
+
+          QVector3D direction = -gradient / length;
+
+          for (int j=0; j < 3; ++j)
+            {
+              int v0 = corners[j];
+              int v1 = corners[(j + 1) % 3];
+              int v2 = corners[(j + 2) % 3];
+
+              divergence[v0] += 0.5 * (_cotangents[i + (j + 2) % 3] * QVector3D::dotProduct (_positions[v1] - _positions[v0], direction) +
+                                       _cotangents[i + (j + 1) % 3] * QVector3D::dotProduct (_positions[v2] - _positions[v0], direction));
+            }
+        }
+
+      //
+      // Step 3: Recover the distance from its gradient field and shift it so that the
+      //         distance at the source is zero
+      //
+      for (int i=0; i < number_of_vertices; ++i)
+        divergence[i] = -divergence[i];
+
+      QVector<double> potential;
+      _poisson_solver.solve (divergence, &potential);
+
+      double offset = 0.0;
+      for (int i=0; i < 3; ++i)
+        offset += weights[i] * potential[source_corners[i]];
+
+      int component = _components[source_corners[0]];
+
+      QVector<float> distances (number_of_vertices);
+      for (int i=0; i < number_of_vertices; ++i)
+        distances[i] = _components[i] == component ? float (qMax (potential[i] - offset, 0.0)) : INFINITE_DISTANCE;
+
+      return distances;
+    }
+
+    /*
+     * Return distance field of a source, computing it if not cached
+     *
+     * Must be called with the mutex being locked.
+     */
+    const QVector<float>& Geodesics::getDistances (const SurfacePoint& source, Method_t method) const
+    {
+      Q_ASSERT (source.isValid () && source.getTriangle () < _triangles.size () / 3);
+
+      for (int i=0; i < _fields.size (); ++i)
+        if (_fields[i]._method == method && _fields[i]._source == source)
+          {
+            _fields.move (i, 0);
+            return _fields.front ()._distances;
+          }
+
+#ifdef HIP_PRINT_STATISTICS
+      QElapsedTimer timer;
+      timer.start ();
+#endif
+
+      Field field;
+      field._source = source;
+      field._method = method;
+      field._distances = method == Method::HEAT ? computeHeatDistances (source) : computeGraphDistances (source);
+
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "* Geodesics:" << (method == Method::HEAT ? "Heat method" : "Graph") << "query in"
+                << timer.nsecsElapsed () / 1000 << "us";
+#endif
+
+      _fields.push_front (field);
+
+      while (_fields.size () > MAX_CACHED_FIELDS)
+        _fields.pop_back ();
+
+      return _fields.front ()._distances;
+    }
+
+    /*
+     * Interpolate distance field at a surface point
+     */
+    float Geodesics::interpolate (const QVector<float>& distances, const SurfacePoint& point, Method_t method) const
+    {
+      const int* corners = _triangles.constData () + point.getTriangle () * 3;
+      float distance = method == Method::HEAT ? 0.0f : INFINITE_DISTANCE;
+
+      if (method == Method::HEAT)
+        {
+          float weights[3];
+          computeWeights (point, weights);
+
+          for (int i=0; i < 3; ++i)
+            distance += weights[i] * distances[corners[i]];
+        }
+      else
+        {
+          for (int i=0; i < 3; ++i)
+            distance = qMin (distance, distances[corners[i]] + (_positions[corners[i]] - point.getPosition ()).length ());
+        }
+
+      return distance;
+    }
+
+    /*
+     * Compute barycentric weights of a surface point in its triangle
+     *
+     * Points outside of the triangle are clamped onto it.
+     */
+    void Geodesics::computeWeights (const SurfacePoint& point, float* weights) const
+    {
+      const int* corners = _triangles.constData () + point.getTriangle () * 3;
+
+      QVector3D e0 = _positions[corners[1]] - _positions[corners[0]];
+      QVector3D e1 = _positions[corners[2]] - _positions[corners[0]];
+      QVector3D d = point.getPosition () - _positions[corners[0]];
+
+      float d00 = QVector3D::dotProduct (e0, e0);
+      float d01 = QVector3D::dotProduct (e0, e1);
+      float d11 = QVector3D::dotProduct (e1, e1);
+      float d20 = QVector3D::dotProduct (d, e0);
+      float d21 = QVector3D::dotProduct (d, e1);
+      float denominator = d00 * d11 - d01 * d01;
+
+      if (denominator <= 0.0f)
+        {
+          weights[0] = weights[1] = weights[2] = 1.0f / 3.0f;
+          return;
+        }
+
+      weights[1] = qMax ((d11 * d20 - d01 * d21) / denominator, 0.0f);
+      weights[2] = qMax ((d00 * d21 - d01 * d20) / denominator, 0.0f);
+      weights[0] = qMax (1.0f - weights[1] - weights[2], 0.0f);
+
+      float sum = weights[0] + weights[1] + weights[2];
+      for (int i=0; i < 3; ++i)
+        weights[i] /= sum;
+    }
+
+  }
+}
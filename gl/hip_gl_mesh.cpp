@@ -0,0 +1,391 @@
+/*
+ * hip_gl_mesh.cpp - Render ready mesh data
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPGLMesh.h"
+#include "HIPGLData.h"
+#include "HIPGLMeshOptimizer.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <algorithm>
+
+namespace HIP {
+  namespace GL {
+
+    //#**********************************************************************
+    // CLASS HIP::GL::VertexData
+    //#**********************************************************************
+
+    /*! Constructor */
+    VertexData::VertexData (const QVector3D& vertex, const QVector3D& normal, const QVector2D& texture)
+      : _vertex  (vertex),
+        _normal  (normal),
+        _texture (texture)
+    {
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::PointIndexMap
+    //#**********************************************************************
+
+    /*!
+     * Constructor
+     *
+     * @param expected_size Expected number of unique points. Used to size the table
+     *                      so that no rehashing is necessary while inserting.
+     */
+    PointIndexMap::PointIndexMap (int expected_size)
+      : _slots (),
+        _mask  (0),
+        _size  (0)
+    {
+      int capacity = 16;
+      while (capacity < expected_size * 2)
+        capacity <<= 1;
+
+      rehash (capacity);
+    }
+
+    /*!
+     * Insert point into the map
+     *
+     * @param point    Point to insert
+     * @param inserted If set, receives if the point has been added or was already present
+     * @return Index of the point. New points get consecutive indices starting with 0.
+     */
+    int PointIndexMap::insert (const Point& point, bool* inserted)
+    {
+      if ((_size + 1) * 2 > capacity ())
+        rehash (capacity () * 2);
+
+      qint32 vertex_index = point.getVertexIndex ();
+      qint32 normal_index = point.getNormalIndex ();
+      qint32 texture_index = point.getTextureIndex ();
+
+      qint32* slots = _slots.data ();
+      int slot = static_cast<int> (computeHash (vertex_index, normal_index, texture_index) & _mask);
+
+      for (;;)
+        {
+          qint32* s = slots + slot * SLOT_SIZE;
+
+          if (s[3] == -1)
+            {
+              s[0] = vertex_index;
+              s[1] = normal_index;
+              s[2] = texture_index;
+              s[3] = _size++;
+
+              if (inserted != 0)
+                *inserted = true;
+
+              return s[3];
+            }
+
+          if (s[0] == vertex_index && s[1] == normal_index && s[2] == texture_index)
+            {
+              if (inserted != 0)
+                *inserted = false;
+
+              return s[3];
+            }
+
+          slot = (slot + 1) & _mask;
+        }
+    }
+
+    /*!
+     * Lookup point
+     *
+     * @param point Point to look up
+     * @return Index of the point or -1 if the point is not part of the map
+     */
+    int PointIndexMap::find (const Point& point) const
+    {
+      qint32 vertex_index = point.getVertexIndex ();
+      qint32 normal_index = point.getNormalIndex ();
+      qint32 texture_index = point.getTextureIndex ();
+
+      const qint32* slots = _slots.constData ();
+      int slot = static_cast<int> (computeHash (vertex_index, normal_index, texture_index) & _mask);
+
+      for (;;)
+        {
+          const qint32* s = slots + slot * SLOT_SIZE;
+
+          if (s[3] == -1)
+            return -1;
+
+          if (s[0] == vertex_index && s[1] == normal_index && s[2] == texture_index)
+            return s[3];
+
+          slot = (slot + 1) & _mask;
+        }
+    }
+
+    /*
+     * Compute hash of the packed (vertex, normal, texture) index triple
+     *
+     * The final mixing step spreads the bits of all three indices over the low bits
+     * used for addressing the table.
+     */
+    quint64 PointIndexMap::computeHash (qint32 vertex_index, qint32 normal_index, qint32 texture_index)
+    {
+      quint64 h = (static_cast<quint64> (static_cast<quint32> (vertex_index)) << 32) |
+        static_cast<quint32> (normal_index);
+      h ^= static_cast<quint64> (static_cast<quint32> (texture_index)) * Q_UINT64_C (0x9e3779b97f4a7c15);
+
+      h ^= h >> 33;
+      h *= Q_UINT64_C (0xff51afd7ed558ccd);
+      h ^= h >> 33;
+      h *= Q_UINT64_C (0xc4ceb9fe1a85ec53);
+      h ^= h >> 33;
+
+      return h;
+    }
+
+    /*
+     * Resize table to the given number of slots (power of two) and reinsert all entries
+     */
+    void PointIndexMap::rehash (int capacity)
+    {
+      Q_ASSERT ((capacity & (capacity - 1)) == 0);
+
+      QVector<qint32> old_slots (capacity * SLOT_SIZE, -1);
+      _slots.swap (old_slots);
+      _mask = capacity - 1;
+
+      qint32* slots = _slots.data ();
+
+      for (int i=0; i < old_slots.size (); i += SLOT_SIZE)
+        {
+          const qint32* s = old_slots.constData () + i;
+          if (s[3] == -1)
+            continue;
+
+          int slot = static_cast<int> (computeHash (s[0], s[1], s[2]) & _mask);
+          while (slots[slot * SLOT_SIZE + 3] != -1)
+            slot = (slot + 1) & _mask;
+
+          std::copy (s, s + SLOT_SIZE, slots + slot * SLOT_SIZE);
+        }
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::MeshGroup
+    //#**********************************************************************
+
+    /*! Constructor */
+    MeshGroup::MeshGroup ()
+      : _name              (),
+        _material          (),
+        _first_index       (0),
+        _number_of_indices (0),
+        _bounds            ()
+    {
+    }
+
+    /*! Constructor */
+    MeshGroup::MeshGroup (const QString& name, const QString& material, int first_index, int number_of_indices,
+                          const Bounds& bounds)
+      : _name              (name),
+        _material          (material),
+        _first_index       (first_index),
+        _number_of_indices (number_of_indices),
+        _bounds            (bounds)
+    {
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::Mesh
+    //#**********************************************************************
+
+    /*!
+     * Constructor
+     *
+     * Builds the render ready vertex and index buffers from the parsed model data.
+     *
+     * @param data     Model data to convert
+     * @param optimize If set, the buffers are reordered for vertex cache and vertex fetch efficiency
+     */
+    Mesh::Mesh (const Data* data, bool optimize)
+      : _vertex_storage     (),
+        _index_storage      (),
+        _mapping            (),
+        _vertex_data        (0),
+        _number_of_vertices (0),
+        _index_data         (0),
+        _number_of_indices  (0),
+        _groups             ()
+    {
+      QElapsedTimer timer;
+      timer.start ();
+
+      int number_of_indices = 0;
+      foreach (const GroupPtr& group, data->getGroups ())
+        number_of_indices += group->getNumberOfTriangles () * 3;
+
+      //
+      // Deduplicate the face points. Each unique (vertex, normal, texture) triple
+      // becomes a single entry in the interleaved vertex array.
+      //
+      const QVector<QVector3D>& vertices = data->getVertices ();
+      const QVector<QVector3D>& normals = data->getNormals ();
+      const QVector<QVector2D>& textures = data->getTextures ();
+
+      PointIndexMap point_indices (qMax (vertices.size (), normals.size ()));
+
+      _index_storage.reserve (number_of_indices);
+
+      foreach (const GroupPtr& group, data->getGroups ())
+        {
+          _groups.push_back (MeshGroup (group->getName (), group->getMaterial (),
+                                        _index_storage.size (), group->getNumberOfTriangles () * 3,
+                                        group->getBounds ()));
+
+          const QVector<int>& vertex_indices = group->getVertexIndices ();
+          const QVector<int>& normal_indices = group->getNormalIndices ();
+          const QVector<int>& texture_indices = group->getTextureIndices ();
+
+          for (int i=0; i < group->getNumberOfTriangles () * 3; ++i)
+            {
+              bool inserted = false;
+              int index = point_indices.insert (Point (vertex_indices[i], normal_indices[i], texture_indices[i]),
+                                                &inserted);
+
+              if (inserted)
+                {
+                  Q_ASSERT (index == _vertex_storage.size ());
+                  _vertex_storage.push_back (VertexData (vertices[vertex_indices[i]],
+                                                         normals[normal_indices[i]],
+                                                         texture_indices[i] >= 0 ? textures[texture_indices[i]] : QVector2D (0, 0)));
+                }
+
+              _index_storage.push_back (index);
+            }
+        }
+
+#ifndef QT_NO_DEBUG
+      //
+      // Verify deduplication: every index must reference a vertex with exactly the
+      // attributes of the original face point.
+      //
+      int corner = 0;
+      foreach (const GroupPtr& group, data->getGroups ())
+        for (int i=0; i < group->getNumberOfTriangles () * 3; ++i, ++corner)
+          {
+            const VertexData& vertex = _vertex_storage[_index_storage[corner]];
+            int texture_index = group->getTextureIndices ()[i];
+
+            Q_UNUSED (vertex);
+            Q_UNUSED (texture_index);
+
+            Q_ASSERT (vertex._vertex == vertices[group->getVertexIndices ()[i]]);
+            Q_ASSERT (vertex._normal == normals[group->getNormalIndices ()[i]]);
+            Q_ASSERT (vertex._texture == (texture_index >= 0 ? textures[texture_index] : QVector2D (0, 0)));
+          }
+
+      Q_ASSERT (point_indices.size () == _vertex_storage.size ());
+#endif
+
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "* Mesh buffers:" << number_of_indices / 3 << "triangles," << _vertex_storage.size ()
+                << "unique vertices, built in" << timer.elapsed () << "ms";
+#endif
+
+      if (optimize)
+        optimizeBuffers ();
+
+      _vertex_data = _vertex_storage.constData ();
+      _number_of_vertices = _vertex_storage.size ();
+      _index_data = _index_storage.constData ();
+      _number_of_indices = _index_storage.size ();
+    }
+
+    /*!
+     * Constructor
+     *
+     * Creates a mesh referencing externally stored (memory mapped) buffers.
+     *
+     * @param mapping            File the buffers are mapped from. Kept open as long as the mesh exists.
+     * @param vertex_data        Interleaved vertex data
+     * @param number_of_vertices Number of vertices in the vertex data array
+     * @param index_data         Triangle index data
+     * @param number_of_indices  Number of indices in the index data array
+     * @param groups             Group index ranges
+     */
+    Mesh::Mesh (const QSharedPointer<QFile>& mapping,
+                const VertexData* vertex_data, int number_of_vertices,
+                const GLuint* index_data, int number_of_indices,
+                const QVector<MeshGroup>& groups)
+      : _vertex_storage     (),
+        _index_storage      (),
+        _mapping            (mapping),
+        _vertex_data        (vertex_data),
+        _number_of_vertices (number_of_vertices),
+        _index_data         (index_data),
+        _number_of_indices  (number_of_indices),
+        _groups             (groups)
+    {
+    }
+
+    /*! Destructor */
+    Mesh::~Mesh ()
+    {
+    }
+
+    /*
+     * Reorder the owned vertex and index buffers for efficient vertex processing
+     *
+     * The triangles of each group are reordered for post transform vertex cache
+     * reuse first. Afterwards the vertices are laid out in order of their first use.
+     * The group index ranges stay the same.
+     */
+    void Mesh::optimizeBuffers ()
+    {
+      QElapsedTimer timer;
+      timer.start ();
+
+#ifdef HIP_PRINT_STATISTICS
+      double acmr = MeshOptimizer::computeACMR (_index_storage.constData (), _index_storage.size ());
+      double atvr = MeshOptimizer::computeATVR (_index_storage.constData (), _index_storage.size (), _vertex_storage.size ());
+#endif
+
+      foreach (const MeshGroup& group, _groups)
+        MeshOptimizer::optimizeVertexCache (_index_storage.data () + group.getFirstIndex (),
+                                            group.getNumberOfIndices (), _vertex_storage.size ());
+
+      QVector<int> remap = MeshOptimizer::optimizeVertexFetch (_index_storage.data (), _index_storage.size (),
+                                                               _vertex_storage.size ());
+
+      QVector<VertexData> vertices (_vertex_storage.size ());
+      int number_of_vertices = 0;
+
+      for (int i=0; i < remap.size (); ++i)
+        if (remap[i] >= 0)
+          {
+            vertices[remap[i]] = _vertex_storage[i];
+            number_of_vertices = qMax (number_of_vertices, remap[i] + 1);
+          }
+
+      vertices.resize (number_of_vertices);
+      _vertex_storage.swap (vertices);
+
+#ifdef HIP_PRINT_STATISTICS
+      qDebug () << "  Optimized in" << timer.elapsed () << "ms";
+      qDebug () << "    ACMR" << acmr << "->" << MeshOptimizer::computeACMR (_index_storage.constData (), _index_storage.size ());
+      qDebug () << "    ATVR" << atvr << "->" << MeshOptimizer::computeATVR (_index_storage.constData (), _index_storage.size (),
+                                                                            _vertex_storage.size ());
+#endif
+    }
+
+  }
+}
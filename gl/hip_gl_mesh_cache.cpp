@@ -0,0 +1,358 @@
+/*
+ * hip_gl_mesh_cache.cpp - Binary cache for render ready meshes
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPGLMeshCache.h"
+#include "core/HIPTools.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstring>
+#include <limits>
+
+namespace HIP {
+  namespace GL {
+
+    //#**********************************************************************
+    // Local definitions
+    //#**********************************************************************
+
+    namespace {
+
+      //
+      // File identification and format version. The version must be increased
+      // whenever the layout of the file or of the stored structures changes.
+      //
+      const char MAGIC[8] = { 'H', 'I', 'P', 'M', 'E', 'S', 'H', '\0' };
+      const quint32 VERSION = 5;
+
+      //
+      // Alignment of the memory mapped data blocks
+      //
+      const quint64 ALIGNMENT = 16;
+
+      /*
+       * Cache file header
+       *
+       * The header is followed by a QDataStream serialized block with the model name,
+       * material library path, bounding box, transformation into model coordinates, group
+       * ranges and materials and the raw vertex and index arrays. The material library key
+       * is all zero if the model does not use a material library.
+       */
+      struct Header
+      {
+        char _magic[8];
+        quint32 _version;
+        quint32 _vertex_size;
+        char _key[16];
+        char _material_key[16];
+        quint64 _meta_offset;
+        quint64 _meta_size;
+        quint64 _vertex_offset;
+        quint64 _number_of_vertices;
+        quint64 _index_offset;
+        quint64 _number_of_indices;
+      };
+
+      /* Align offset to the block alignment */
+      quint64 align (quint64 offset)
+      {
+        return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+      }
+
+      /* Write material into stream */
+      void writeMaterial (QDataStream& out, const Material& material)
+      {
+        out << material.getName ()
+            << material.getAmbient ()
+            << material.getDiffuse ()
+            << material.getSpecular ()
+            << material.getDissolved ()
+            << material.getSpecularExponent ()
+            << material.getOpticalDensity ()
+            << material.getTexture ();
+      }
+
+      /* Read material from stream */
+      Material readMaterial (QDataStream& in)
+      {
+        QString name;
+        QVector3D ambient, diffuse, specular;
+        float dissolved, specular_exponent, optical_density;
+        QString texture;
+
+        in >> name >> ambient >> diffuse >> specular >> dissolved >> specular_exponent >> optical_density >> texture;
+
+        Material material;
+        material.setName (name);
+        material.setAmbient (ambient);
+        material.setDiffuse (diffuse);
+        material.setSpecular (specular);
+        material.setDissolved (dissolved);
+        material.setSpecularExponent (specular_exponent);
+        material.setOpticalDensity (optical_density);
+        material.setTexture (texture);
+
+        return material;
+      }
+
+      /* Compute key of the material library, which is all zero for models without one */
+      QByteArray computeMaterialKey (const QString& material_library)
+      {
+        if (material_library.isEmpty ())
+          return QByteArray (sizeof (Header::_material_key), '\0');
+
+        return Tools::getResourceKey (material_library);
+      }
+
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::MeshCache
+    //#**********************************************************************
+
+    /*!
+     * Constructor
+     *
+     * @param source Path of the OBJ source file the cache belongs to
+     */
+    MeshCache::MeshCache (const QString& source)
+      : _source           (source),
+        _path             (),
+        _name             (),
+        _materials        (),
+        _material_library (),
+        _bounding_box     (),
+        _transform        (),
+        _mesh             ()
+    {
+      QByteArray id = QCryptographicHash::hash (Tools::getResolvedFileName (source).toUtf8 (), QCryptographicHash::Md5);
+
+      _path = QString ("%1/meshes/%2.mesh")
+        .arg (QStandardPaths::writableLocation (QStandardPaths::CacheLocation))
+        .arg (QString::fromLatin1 (id.toHex ()));
+    }
+
+    /*! Destructor */
+    MeshCache::~MeshCache ()
+    {
+    }
+
+    /*!
+     * Load mesh from the cache
+     *
+     * @return 'true' if a valid cache file for the current state of the source file and its
+     *         material library exists
+     */
+    bool MeshCache::load ()
+    {
+      QSharedPointer<QFile> file (new QFile (_path));
+
+      if (!file->open (QIODevice::ReadOnly) || file->size () < static_cast<qint64> (sizeof (Header)))
+        return false;
+
+      const uchar* base = file->map (0, file->size ());
+      if (base == 0)
+        return false;
+
+      Header header;
+      memcpy (&header, base, sizeof (Header));
+
+      QByteArray key = Tools::getResourceKey (_source);
+
+      if ( memcmp (header._magic, MAGIC, sizeof (MAGIC)) != 0 ||
+           header._version != VERSION ||
+           header._vertex_size != sizeof (VertexData) ||
+           key.size () != static_cast<int> (sizeof (header._key)) ||
+           memcmp (header._key, key.constData (), sizeof (header._key)) != 0 )
+        return false;
+
+      quint64 file_size = file->size ();
+
+      if ( header._meta_offset + header._meta_size > file_size ||
+           header._vertex_offset % ALIGNMENT != 0 ||
+           header._vertex_offset + header._number_of_vertices * sizeof (VertexData) > file_size ||
+           header._index_offset % ALIGNMENT != 0 ||
+           header._index_offset + header._number_of_indices * sizeof (GLuint) > file_size ||
+           header._number_of_vertices > static_cast<quint64> (std::numeric_limits<int>::max ()) ||
+           header._number_of_indices > static_cast<quint64> (std::numeric_limits<int>::max ()) )
+        return false;
+
+      //
+      // Meta data
+      //
+      QByteArray meta = QByteArray::fromRawData (reinterpret_cast<const char*> (base + header._meta_offset),
+                                                 static_cast<int> (header._meta_size));
+      QDataStream in (meta);
+      in.setVersion (QDataStream::Qt_5_0);
+
+      QString name;
+      QString material_library;
+      Data::Cube bounding_box;
+      QMatrix4x4 transform;
+      in >> name >> material_library >> bounding_box.first >> bounding_box.second >> transform;
+
+      qint32 number_of_groups = 0;
+      in >> number_of_groups;
+
+      QVector<MeshGroup> groups;
+      for (int i=0; i < number_of_groups && in.status () == QDataStream::Ok; ++i)
+        {
+          QString group_name, group_material;
+          qint32 first_index, number_of_indices;
+          QVector3D minimum, maximum, center;
+          float radius;
+          in >> group_name >> group_material >> first_index >> number_of_indices
+             >> minimum >> maximum >> center >> radius;
+
+          if ( first_index < 0 || number_of_indices < 0 ||
+               static_cast<quint64> (first_index) + number_of_indices > header._number_of_indices )
+            return false;
+
+          groups.push_back (MeshGroup (group_name, group_material, first_index, number_of_indices,
+                                       Bounds (minimum, maximum, center, radius)));
+        }
+
+      qint32 number_of_materials = 0;
+      in >> number_of_materials;
+
+      Data::MaterialMap materials;
+      for (int i=0; i < number_of_materials && in.status () == QDataStream::Ok; ++i)
+        {
+          Material material = readMaterial (in);
+          materials.insert (material.getName (), material);
+        }
+
+      if (in.status () != QDataStream::Ok)
+        return false;
+
+      //
+      // Materials are taken from the cache, so an edited material library invalidates it
+      //
+      QByteArray material_key = computeMaterialKey (material_library);
+
+      if ( material_key.size () != static_cast<int> (sizeof (header._material_key)) ||
+           memcmp (header._material_key, material_key.constData (), sizeof (header._material_key)) != 0 )
+        return false;
+
+      //
+      // Vertex and index data is used directly from the mapped file
+      //
+      _name = name;
+      _bounding_box = bounding_box;
+      _transform = transform;
+      _materials = materials;
+      _material_library = material_library;
+      _mesh = MeshPtr (new Mesh (file,
+                                 reinterpret_cast<const VertexData*> (base + header._vertex_offset),
+                                 static_cast<int> (header._number_of_vertices),
+                                 reinterpret_cast<const GLuint*> (base + header._index_offset),
+                                 static_cast<int> (header._number_of_indices),
+                                 groups));
+
+      return true;
+    }
+
+    /*!
+     * Store the render ready mesh of the given model in the cache
+     *
+     * The file is written atomically, so concurrently running instances never see
+     * partially written cache files.
+     *
+     * @param data Model data matching the cache source file
+     * @return 'true' if the cache file has been written successfully
+     */
+    bool MeshCache::save (const Data& data)
+    {
+      const Mesh& mesh = data.getMesh ();
+
+      QByteArray meta;
+
+      {
+        QDataStream out (&meta, QIODevice::WriteOnly);
+        out.setVersion (QDataStream::Qt_5_0);
+
+        out << data.getName () << data.getMaterialLibrary ()
+            << data.getBoundingBox ().first << data.getBoundingBox ().second
+            << data.getTransform ();
+
+        out << static_cast<qint32> (mesh.getGroups ().size ());
+        foreach (const MeshGroup& group, mesh.getGroups ())
+          out << group.getName ()
+              << group.getMaterial ()
+              << static_cast<qint32> (group.getFirstIndex ())
+              << static_cast<qint32> (group.getNumberOfIndices ())
+              << group.getBounds ().getMinimum ()
+              << group.getBounds ().getMaximum ()
+              << group.getBounds ().getCenter ()
+              << group.getBounds ().getRadius ();
+
+        out << static_cast<qint32> (data.getMaterials ().size ());
+        foreach (const Material& material, data.getMaterials ())
+          writeMaterial (out, material);
+      }
+
+      QByteArray key = Tools::getResourceKey (_source);
+      Q_ASSERT (key.size () == static_cast<int> (sizeof (Header::_key)));
+
+      QByteArray material_key = computeMaterialKey (data.getMaterialLibrary ());
+      Q_ASSERT (material_key.size () == static_cast<int> (sizeof (Header::_material_key)));
+
+      Header header;
+      memset (&header, 0, sizeof (Header));
+      memcpy (header._magic, MAGIC, sizeof (MAGIC));
+      memcpy (header._key, key.constData (), sizeof (header._key));
+      memcpy (header._material_key, material_key.constData (), sizeof (header._material_key));
+
+      header._version = VERSION;
+      header._vertex_size = sizeof (VertexData);
+      header._meta_offset = sizeof (Header);
+      header._meta_size = meta.size ();
+      header._vertex_offset = align (header._meta_offset + header._meta_size);
+      header._number_of_vertices = mesh.getNumberOfVertices ();
+      header._index_offset = align (header._vertex_offset + header._number_of_vertices * sizeof (VertexData));
+      header._number_of_indices = mesh.getNumberOfIndices ();
+
+      QDir ().mkpath (QFileInfo (_path).absolutePath ());
+
+      QSaveFile file (_path);
+      if (!file.open (QIODevice::WriteOnly))
+        {
+          qWarning () << "Unable to write mesh cache" << _path << ":" << file.errorString ();
+          return false;
+        }
+
+      quint64 vertex_size = header._number_of_vertices * sizeof (VertexData);
+      quint64 padding = header._vertex_offset - header._meta_offset - header._meta_size;
+
+      file.write (reinterpret_cast<const char*> (&header), sizeof (Header));
+      file.write (meta);
+      file.write (QByteArray (static_cast<int> (padding), '\0'));
+      file.write (reinterpret_cast<const char*> (mesh.getVertexData ()), vertex_size);
+
+      padding = header._index_offset - header._vertex_offset - vertex_size;
+
+      file.write (QByteArray (static_cast<int> (padding), '\0'));
+      file.write (reinterpret_cast<const char*> (mesh.getIndexData ()), header._number_of_indices * sizeof (GLuint));
+
+      if (!file.commit ())
+        {
+          qWarning () << "Unable to write mesh cache" << _path << ":" << file.errorString ();
+          return false;
+        }
+
+      return true;
+    }
+
+  }
+}
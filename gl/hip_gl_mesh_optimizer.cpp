@@ -0,0 +1,252 @@
+/*
+ * hip_gl_mesh_optimizer.cpp - Index buffer optimization for GPU vertex processing
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPGLMeshOptimizer.h"
+
+#include <algorithm>
+
+namespace HIP {
+  namespace GL {
+    namespace MeshOptimizer {
+
+      //#**********************************************************************
+      // Reordering
+      //#**********************************************************************
+
+      /*!
+       * Reorder triangles for post transform vertex cache efficiency
+       *
+       * Implements the 'Tipsify' algorithm (Sander, Nehab, Barczak: Fast Triangle
+       * Reordering for Vertex Locality and Reduced Overdraw, 2007). Triangles are
+       * emitted as fans around a sequence of vertices which are chosen so that their
+       * remaining triangles still hit the cache. The algorithm runs in linear time.
+       *
+       * @param indices            Triangle list indices, reordered in place
+       * @param number_of_indices  Number of indices (three per triangle)
+       * @param number_of_vertices Number of vertices the indices refer to
+       * @param cache_size         Size of the vertex cache to optimize for
+       */
+      void optimizeVertexCache (GLuint* indices, int number_of_indices, int number_of_vertices, int cache_size)
+      {
+        int number_of_triangles = number_of_indices / 3;
+        if (number_of_triangles == 0)
+          return;
+
+        //
+        // Map the referenced vertices to a compact local range, so that dead end
+        // handling only has to scan the vertices of this index range.
+        //
+        QVector<int> local_ids (number_of_vertices, -1);
+        QVector<int> local_indices (number_of_indices);
+        QVector<GLuint> global_ids;
+
+        for (int i=0; i < number_of_indices; ++i)
+          {
+            Q_ASSERT (indices[i] < static_cast<GLuint> (number_of_vertices));
+
+            int& id = local_ids[indices[i]];
+            if (id == -1)
+              {
+                id = global_ids.size ();
+                global_ids.push_back (indices[i]);
+              }
+
+            local_indices[i] = id;
+          }
+
+        int number_of_local_vertices = global_ids.size ();
+
+        //
+        // Vertex -> triangle adjacency
+        //
+        QVector<int> live (number_of_local_vertices, 0);
+        for (int i=0; i < number_of_indices; ++i)
+          ++live[local_indices[i]];
+
+        QVector<int> offsets (number_of_local_vertices + 1, 0);
+        for (int i=0; i < number_of_local_vertices; ++i)
+          offsets[i + 1] = offsets[i] + live[i];
+
+        QVector<int> adjacency (number_of_indices);
+        QVector<int> fill (offsets);
+
+        for (int i=0; i < number_of_indices; ++i)
+          adjacency[fill[local_indices[i]]++] = i / 3;
+
+        //
+        // Fan triangles around the chosen vertices
+        //
+        QVector<int> cache_time (number_of_local_vertices, 0);
+        QVector<bool> emitted (number_of_triangles, false);
+        QVector<int> dead_ends;
+        QVector<int> candidates;
+        QVector<GLuint> output;
+
+        dead_ends.reserve (number_of_indices);
+        output.reserve (number_of_indices);
+
+        int time = cache_size + 1;
+        int cursor = 0;
+        int fanning = local_indices[0];
+
+        while (fanning >= 0)
+          {
+            candidates.clear ();
+
+            for (int i=offsets[fanning]; i < offsets[fanning + 1]; ++i)
+              {
+                int triangle = adjacency[i];
+                if (emitted[triangle])
+                  continue;
+
+                for (int j=0; j < 3; ++j)
+                  {
+                    int vertex = local_indices[triangle * 3 + j];
+
+                    output.push_back (global_ids[vertex]);
+                    dead_ends.push_back (vertex);
+                    candidates.push_back (vertex);
+
+                    --live[vertex];
+
+                    if (time - cache_time[vertex] > cache_size)
+                      cache_time[vertex] = time++;
+                  }
+
+                emitted[triangle] = true;
+              }
+
+            //
+            // Next fanning vertex: the candidate which stays in the cache longest
+            // while its remaining triangles are emitted
+            //
+            int next = -1;
+            int best_priority = -1;
+
+            foreach (int vertex, candidates)
+              if (live[vertex] > 0)
+                {
+                  int priority = 0;
+                  if (time - cache_time[vertex] + 2 * live[vertex] <= cache_size)
+                    priority = time - cache_time[vertex];
+
+                  if (priority > best_priority)
+                    {
+                      best_priority = priority;
+                      next = vertex;
+                    }
+                }
+
+            //
+            // Dead end: continue with a recently used vertex or, if none is left,
+            // with the next vertex in input order which still has triangles
+            //
+            while (next == -1 && !dead_ends.isEmpty ())
+              {
+                int vertex = dead_ends.last ();
+                dead_ends.pop_back ();
+
+                if (live[vertex] > 0)
+                  next = vertex;
+              }
+
+            for (; next == -1 && cursor < number_of_local_vertices; ++cursor)
+              if (live[cursor] > 0)
+                next = cursor;
+
+            fanning = next;
+          }
+
+        Q_ASSERT (output.size () == number_of_triangles * 3);
+        std::copy (output.constBegin (), output.constEnd (), indices);
+      }
+
+      /*!
+       * Renumber vertices in order of their first use
+       *
+       * The vertex data must be reordered with the returned mapping afterwards, so
+       * that vertex fetches during rendering access memory mostly sequentially.
+       *
+       * @param indices            Triangle list indices, renumbered in place
+       * @param number_of_indices  Number of indices
+       * @param number_of_vertices Number of vertices the indices refer to
+       * @return Mapping from old to new vertex index. Unreferenced vertices are mapped to -1.
+       */
+      QVector<int> optimizeVertexFetch (GLuint* indices, int number_of_indices, int number_of_vertices)
+      {
+        QVector<int> remap (number_of_vertices, -1);
+        int next = 0;
+
+        for (int i=0; i < number_of_indices; ++i)
+          {
+            Q_ASSERT (indices[i] < static_cast<GLuint> (number_of_vertices));
+
+            int& index = remap[indices[i]];
+            if (index == -1)
+              index = next++;
+
+            indices[i] = index;
+          }
+
+        return remap;
+      }
+
+
+      //#**********************************************************************
+      // Statistics
+      //#**********************************************************************
+
+      /*!
+       * Count vertex cache misses while processing the index buffer
+       *
+       * Simulates a FIFO post transform cache like the one used by most GPUs.
+       */
+      int countCacheMisses (const GLuint* indices, int number_of_indices, int cache_size)
+      {
+        QVector<GLuint> cache (cache_size, ~0u);
+        int head = 0;
+        int misses = 0;
+
+        for (int i=0; i < number_of_indices; ++i)
+          if (std::find (cache.constBegin (), cache.constEnd (), indices[i]) == cache.constEnd ())
+            {
+              cache[head] = indices[i];
+              head = (head + 1) % cache_size;
+              ++misses;
+            }
+
+        return misses;
+      }
+
+      /*!
+       * Compute average cache miss ratio (vertex shader invocations per triangle)
+       *
+       * The optimum is about 0.5 for large regular meshes, the worst case is 3.0.
+       */
+      double computeACMR (const GLuint* indices, int number_of_indices, int cache_size)
+      {
+        if (number_of_indices < 3)
+          return 0.0;
+
+        return static_cast<double> (countCacheMisses (indices, number_of_indices, cache_size)) / (number_of_indices / 3);
+      }
+
+      /*!
+       * Compute average transformed vertex ratio (vertex shader invocations per vertex)
+       *
+       * The optimum is 1.0, i.e. each vertex is transformed exactly once.
+       */
+      double computeATVR (const GLuint* indices, int number_of_indices, int number_of_vertices, int cache_size)
+      {
+        if (number_of_vertices == 0)
+          return 0.0;
+
+        return static_cast<double> (countCacheMisses (indices, number_of_indices, cache_size)) / number_of_vertices;
+      }
+
+    }
+  }
+}
@@ -0,0 +1,451 @@
+/*
+ * hip_gl_pick_buffer.cpp - Offscreen id buffer for picking pins and model groups
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPGLPickBuffer.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#include <limits>
+
+namespace HIP {
+  namespace GL {
+
+    //#**********************************************************************
+    // Local definitions
+    //#**********************************************************************
+
+    namespace {
+
+      //
+      // Radius of the region read around the requested position. Pins within this
+      // distance are picked even if the position itself is slightly off.
+      //
+      const int PICK_RADIUS = 4;
+      const int PICK_REGION_SIZE = 2 * PICK_RADIUS + 1;
+
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::PickBuffer::Pick
+    //#**********************************************************************
+
+    /*! Constructor for an empty pick */
+    PickBuffer::Pick::Pick ()
+      : _type     (Type::NONE),
+        _id       (-1),
+        _position (),
+        _tag      (0)
+    {
+    }
+
+    /*!
+     * Constructor
+     *
+     * @param type     Type of the picked object
+     * @param id       Index of the picked object (pin or mesh group index)
+     * @param position Requested buffer position
+     * @param tag      Tag of the read request
+     */
+    PickBuffer::Pick::Pick (Type_t type, int id, const QPoint& position, int tag)
+      : _type     (type),
+        _id       (id),
+        _position (position),
+        _tag      (tag)
+    {
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::PickBuffer::Request
+    //#**********************************************************************
+
+    /*! Constructor */
+    PickBuffer::Request::Request ()
+      : _pending  (false),
+        _region   (),
+        _position (),
+        _tag      (0)
+    {
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::PickBuffer
+    //#**********************************************************************
+
+    /*! Constructor */
+    PickBuffer::PickBuffer ()
+      : _framebuffer       (),
+        _valid             (false),
+        _use_pixel_buffers (false),
+        _pixels            (),
+        _next_request      (0),
+        _fresh_request     (-1)
+    {
+      for (int i=0; i < 2; ++i)
+        _pixel_buffers[i] = QOpenGLBuffer (QOpenGLBuffer::PixelPackBuffer);
+    }
+
+    /*! Destructor */
+    PickBuffer::~PickBuffer ()
+    {
+    }
+
+    /*!
+     * Initialize GL structures
+     *
+     * Must be called with the GL context being current. Without pixel buffer object
+     * support, the buffer region is read synchronously.
+     */
+    void PickBuffer::initialize ()
+    {
+      QOpenGLContext* context = QOpenGLContext::currentContext ();
+      Q_ASSERT (context != 0);
+
+      _use_pixel_buffers = !context->isOpenGLES () &&
+        (context->format ().version () >= qMakePair (2, 1) || context->hasExtension ("GL_ARB_pixel_buffer_object"));
+
+      destroy ();
+
+      if (_use_pixel_buffers)
+        for (int i=0; i < 2; ++i)
+          {
+            _pixel_buffers[i].create ();
+            _pixel_buffers[i].setUsagePattern (QOpenGLBuffer::StreamRead);
+            _pixel_buffers[i].bind ();
+            _pixel_buffers[i].allocate (PICK_REGION_SIZE * PICK_REGION_SIZE * 4);
+            _pixel_buffers[i].release ();
+          }
+
+      _next_request = 0;
+    }
+
+    /*!
+     * Destroy GL structures
+     *
+     * Must be called with the GL context being current.
+     */
+    void PickBuffer::destroy ()
+    {
+      for (int i=0; i < 2; ++i)
+        {
+          _pixel_buffers[i].destroy ();
+          _requests[i] = Request ();
+        }
+
+      _framebuffer.reset ();
+      _valid = false;
+      _fresh_request = -1;
+    }
+
+    /*!
+     * Bind buffer for rendering the id pass
+     *
+     * The buffer is cleared to background. After rendering, the buffer is valid
+     * until it is invalidated again.
+     *
+     * @param size Size of the buffer in pixels
+     */
+    void PickBuffer::bind (const QSize& size)
+    {
+      if (_framebuffer.isNull () || _framebuffer->size () != size)
+        _framebuffer.reset (new QOpenGLFramebufferObject (size, QOpenGLFramebufferObject::CombinedDepthStencil));
+
+      QOpenGLFunctions gl (QOpenGLContext::currentContext ());
+
+      GLfloat clear_color[4];
+      gl.glGetFloatv (GL_COLOR_CLEAR_VALUE, clear_color);
+
+      _framebuffer->bind ();
+
+      gl.glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
+      gl.glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      gl.glClearColor (clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+    }
+
+    /*! Release buffer after rendering the id pass */
+    void PickBuffer::release ()
+    {
+      _framebuffer->release ();
+      _valid = true;
+    }
+
+    /*!
+     * Start reading the buffer region around a position
+     *
+     * @param position Buffer position with the origin in the upper left corner
+     * @param tag      Tag returned with the pick of this request
+     */
+    void PickBuffer::read (const QPoint& position, int tag)
+    {
+      Q_ASSERT (_valid && !_framebuffer.isNull ());
+
+      QRect region = QRect (position.x () - PICK_RADIUS, position.y () - PICK_RADIUS, PICK_REGION_SIZE, PICK_REGION_SIZE)
+        .intersected (QRect (QPoint (0, 0), _framebuffer->size ()));
+
+      if (region.isEmpty ())
+        return;
+
+      QOpenGLFunctions gl (QOpenGLContext::currentContext ());
+
+      //
+      // GL window coordinates have their origin in the lower left corner
+      //
+      int y = _framebuffer->height () - region.y () - region.height ();
+
+      _framebuffer->bind ();
+
+      if (_use_pixel_buffers)
+        {
+          _pixel_buffers[_next_request].bind ();
+          gl.glReadPixels (region.x (), y, region.width (), region.height (), GL_RGBA, GL_UNSIGNED_BYTE, 0);
+          _pixel_buffers[_next_request].release ();
+        }
+      else
+        {
+          _pixels.resize (region.width () * region.height () * 4);
+          gl.glReadPixels (region.x (), y, region.width (), region.height (), GL_RGBA, GL_UNSIGNED_BYTE, _pixels.data ());
+        }
+
+      _framebuffer->release ();
+
+      Request& request = _requests[_next_request];
+      request._pending = true;
+      request._region = region;
+      request._position = position;
+      request._tag = tag;
+
+      _fresh_request = _next_request;
+      _next_request = (_next_request + 1) % 2;
+    }
+
+    /*! Check if there are read requests which have not been fetched yet */
+    bool PickBuffer::isReadPending () const
+    {
+      return _requests[0]._pending || _requests[1]._pending;
+    }
+
+    /*!
+     * Fetch result of a previous read request
+     *
+     * The request issued by the last 'read ()' call is not mapped in the same frame
+     * to give the transfer time to complete. It is returned by the next 'fetch ()' call.
+     *
+     * @param pick Picked object. If a pin is located in the read region, the pin nearest
+     *             to the requested position is returned. Otherwise the object at the
+     *             position itself.
+     * @return 'true' if a result has been fetched
+     */
+    bool PickBuffer::fetch (Pick* pick)
+    {
+      int index = -1;
+
+      if (!_use_pixel_buffers)
+        index = _fresh_request;
+      else
+        {
+          //
+          // The older of the pending requests is the one following the fresh one
+          //
+          int older = (_fresh_request + 1) % 2;
+
+          if (_fresh_request == -1)
+            older = _requests[0]._pending ? 0 : 1;
+
+          if (_requests[older]._pending && older != _fresh_request)
+            index = older;
+        }
+
+      _fresh_request = -1;
+
+      if (index == -1 || !_requests[index]._pending)
+        return false;
+
+      Request& request = _requests[index];
+      request._pending = false;
+
+      if (!_use_pixel_buffers)
+        {
+          *pick = decode (_pixels.constData (), request);
+          return true;
+        }
+
+      QOpenGLBuffer& buffer = _pixel_buffers[index];
+      buffer.bind ();
+
+      const uchar* pixels = static_cast<const uchar*> (buffer.map (QOpenGLBuffer::ReadOnly));
+      if (pixels != 0)
+        {
+          *pick = decode (pixels, request);
+          buffer.unmap ();
+        }
+
+      buffer.release ();
+
+      return pixels != 0;
+    }
+
+    /*
+     * Decode read region
+     */
+    PickBuffer::Pick PickBuffer::decode (const uchar* pixels, const Request& request) const
+    {
+      Pick result (Type::NONE, -1, request._position, request._tag);
+      int pin_distance = std::numeric_limits<int>::max ();
+
+      for (int y=0; y < request._region.height (); ++y)
+        for (int x=0; x < request._region.width (); ++x)
+          {
+            //
+            // Rows are read bottom up
+            //
+            const uchar* pixel = pixels + ((request._region.height () - 1 - y) * request._region.width () + x) * 4;
+
+            Type_t type = static_cast<Type_t> (pixel[3]);
+            int id = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16);
+
+            QPoint position = request._region.topLeft () + QPoint (x, y);
+            QPoint delta = position - request._position;
+            int distance = delta.x () * delta.x () + delta.y () * delta.y ();
+
+            if (type == Type::PIN && distance < pin_distance)
+              {
+                result = Pick (type, id, request._position, request._tag);
+                pin_distance = distance;
+              }
+            else if (distance == 0 && result.getType () != Type::PIN && type != Type::NONE)
+              result = Pick (type, id, request._position, request._tag);
+          }
+
+      return result;
+    }
+
+    /*!
+     * Encode object id as the color written into the buffer
+     *
+     * @param type Object type
+     * @param id   Object index. Must be less than 2^24.
+     * @return Color with the packed id
+     */
+    QVector4D PickBuffer::encode (Type_t type, int id)
+    {
+      Q_ASSERT (id >= 0 && id < (1 << 24));
+
+      return QVector4D (id & 0xff, (id >> 8) & 0xff, (id >> 16) & 0xff, type) / 255.0f;
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::PickRequests
+    //#**********************************************************************
+
+    /*! Constructor */
+    PickRequests::PickRequests ()
+      : _hover_position  (0, 0),
+        _hover_requested (false),
+        _click_position  (0, 0),
+        _click_modifiers (Qt::NoModifier),
+        _click_requested (false),
+        _click_pending   (false),
+        _click_serial    (0)
+    {
+    }
+
+    /*!
+     * Request picking the object below the cursor
+     *
+     * A previous hover request which has not been read yet is replaced.
+     *
+     * @param position Buffer position
+     */
+    void PickRequests::requestHover (const QPoint& position)
+    {
+      _hover_position = position;
+      _hover_requested = true;
+    }
+
+    /*!
+     * Request picking the clicked object
+     *
+     * A previous click which has not been answered yet is dropped.
+     *
+     * @param position  Buffer position
+     * @param modifiers Keyboard modifiers at the time of the click
+     */
+    void PickRequests::requestClick (const QPoint& position, Qt::KeyboardModifiers modifiers)
+    {
+      _click_position = position;
+      _click_modifiers = modifiers;
+      _click_requested = true;
+      _click_pending = false;
+    }
+
+    /*! Check if there are requests which have not been read yet */
+    bool PickRequests::hasRequest () const
+    {
+      return _hover_requested || _click_requested;
+    }
+
+    /*!
+     * Take the next request to be read from the pick buffer
+     *
+     * A click request is taken first, a hover request remains for the next frame then.
+     *
+     * @param position Buffer position to read
+     * @param tag      Tag for the read request
+     * @return 'true' if there was a request
+     */
+    bool PickRequests::takeRequest (QPoint* position, int* tag)
+    {
+      if (_click_requested)
+        {
+          //
+          // Tag 0 is used for hover requests, so serial numbers are positive
+          //
+          _click_serial = _click_serial < std::numeric_limits<int>::max () ? _click_serial + 1 : 1;
+          _click_requested = false;
+          _click_pending = true;
+
+          *position = _click_position;
+          *tag = _click_serial;
+          return true;
+        }
+
+      if (_hover_requested)
+        {
+          _hover_requested = false;
+
+          *position = _hover_position;
+          *tag = 0;
+          return true;
+        }
+
+      return false;
+    }
+
+    /*!
+     * Check if a fetched pick answers the last click
+     *
+     * The click is answered once only.
+     *
+     * @param pick      Fetched pick
+     * @param modifiers Keyboard modifiers at the time of the click
+     * @return 'true' if the pick has been read for the last click
+     */
+    bool PickRequests::isClick (const PickBuffer::Pick& pick, Qt::KeyboardModifiers* modifiers)
+    {
+      if (!_click_pending || pick.getTag () != _click_serial)
+        return false;
+
+      _click_pending = false;
+      *modifiers = _click_modifiers;
+      return true;
+    }
+
+  }
+}
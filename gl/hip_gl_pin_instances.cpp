@@ -0,0 +1,389 @@
+/*
+ * hip_gl_pin_instances.cpp - Instanced rendering of all database pins
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPGLPinInstances.h"
+#include "HIPGLData.h"
+#include "HIPGLMesh.h"
+
+#include "core/HIPException.h"
+#include "database/HIPDatabase.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#include <cstddef>
+
+namespace HIP {
+  namespace GL {
+
+    //#**********************************************************************
+    // CLASS HIP::GL::PinInstances
+    //#**********************************************************************
+
+    /*!
+     * Constructor
+     *
+     * @param data Pin model. Must exist as long as the renderer exists.
+     */
+    PinInstances::PinInstances (const Data* data)
+      : _data                    (data),
+        _shader                  (),
+        _vertex_buffer           (QOpenGLBuffer::VertexBuffer),
+        _index_buffer            (QOpenGLBuffer::IndexBuffer),
+        _instance_buffer         (QOpenGLBuffer::VertexBuffer),
+        _vertex_array            (),
+        _vertex_attr             (-1),
+        _normal_attr             (-1),
+        _position_attr           (-1),
+        _normal_instance_attr    (-1),
+        _color_attr              (-1),
+        _selected_attr           (-1),
+        _id_attr                 (-1),
+        _mvp_matrix_attr         (-1),
+        _n_matrix_attr           (-1),
+        _highlighted_attr        (-1),
+        _pick_mode_attr          (-1),
+        _number_of_indices       (0),
+        _mvp_matrix              (),
+        _uniforms_valid          (false),
+        _highlighted             (-1),
+        _highlighted_changed     (true),
+        _instances               (),
+        _instances_changed       (false),
+        _draw_elements_instanced (0),
+        _vertex_attrib_divisor   (0)
+    {
+    }
+
+    /*! Destructor */
+    PinInstances::~PinInstances ()
+    {
+      _vertex_array.destroy ();
+      _instance_buffer.destroy ();
+      _index_buffer.destroy ();
+      _vertex_buffer.destroy ();
+    }
+
+    /*!
+     * Initialize GL structures
+     *
+     * Must be called with the GL context being current.
+     */
+    void PinInstances::initialize ()
+    {
+      //
+      // Init shaders
+      //
+      if (!_shader.addShaderFromSourceFile (QOpenGLShader::Vertex, ":/gl/PinInstancedVertexShader.glsl"))
+        throw Exception (QObject::tr ("Unable to initialize vertex shader: %1")
+                         .arg (_shader.log ()));
+
+      if (!_shader.addShaderFromSourceFile (QOpenGLShader::Fragment, ":/gl/PinInstancedFragmentShader.glsl"))
+        throw Exception (QObject::tr ("Unable to initialize fragment shader: %1")
+                         .arg (_shader.log ()));
+
+      if (!_shader.link ())
+        throw Exception (QObject::tr ("Shader linking failed: %1")
+                         .arg (_shader.log ()));
+
+      _vertex_attr = _shader.attributeLocation ("in_vertex");
+      Q_ASSERT (_vertex_attr >= 0);
+
+      _normal_attr = _shader.attributeLocation ("in_normal");
+      Q_ASSERT (_normal_attr >= 0);
+
+      _position_attr = _shader.attributeLocation ("in_instance_position");
+      Q_ASSERT (_position_attr >= 0);
+
+      _normal_instance_attr = _shader.attributeLocation ("in_instance_normal");
+      Q_ASSERT (_normal_instance_attr >= 0);
+
+      _color_attr = _shader.attributeLocation ("in_instance_color");
+      Q_ASSERT (_color_attr >= 0);
+
+      _selected_attr = _shader.attributeLocation ("in_instance_selected");
+      Q_ASSERT (_selected_attr >= 0);
+
+      _id_attr = _shader.attributeLocation ("in_instance_id");
+      Q_ASSERT (_id_attr >= 0);
+
+      _mvp_matrix_attr = _shader.uniformLocation ("in_mvp_matrix");
+      Q_ASSERT (_mvp_matrix_attr >= 0);
+
+      _n_matrix_attr = _shader.uniformLocation ("in_n_matrix");
+      Q_ASSERT (_n_matrix_attr >= 0);
+
+      _highlighted_attr = _shader.uniformLocation ("in_highlighted_id");
+      Q_ASSERT (_highlighted_attr >= 0);
+
+      _pick_mode_attr = _shader.uniformLocation ("in_pick_mode");
+      Q_ASSERT (_pick_mode_attr >= 0);
+
+      //
+      // Resolve instancing functions (core since OpenGL 3.3, ARB_instanced_arrays before)
+      //
+      QOpenGLContext* context = QOpenGLContext::currentContext ();
+      Q_ASSERT (context != 0);
+
+      _draw_elements_instanced = reinterpret_cast<DrawElementsInstancedFunc> (context->getProcAddress ("glDrawElementsInstanced"));
+      if (_draw_elements_instanced == 0)
+        _draw_elements_instanced = reinterpret_cast<DrawElementsInstancedFunc> (context->getProcAddress ("glDrawElementsInstancedARB"));
+
+      _vertex_attrib_divisor = reinterpret_cast<VertexAttribDivisorFunc> (context->getProcAddress ("glVertexAttribDivisor"));
+      if (_vertex_attrib_divisor == 0)
+        _vertex_attrib_divisor = reinterpret_cast<VertexAttribDivisorFunc> (context->getProcAddress ("glVertexAttribDivisorARB"));
+
+      //
+      // Upload pin mesh. All groups are drawn in one call, so the group ranges are not needed.
+      //
+      const Mesh& mesh = _data->getMesh ();
+
+      _vertex_buffer.create ();
+      _vertex_buffer.bind ();
+      _vertex_buffer.allocate (mesh.getVertexData (), mesh.getNumberOfVertices () * sizeof (VertexData));
+      _vertex_buffer.release ();
+
+      _index_buffer.create ();
+      _index_buffer.bind ();
+      _index_buffer.allocate (mesh.getIndexData (), mesh.getNumberOfIndices () * sizeof (GLuint));
+      _index_buffer.release ();
+
+      _number_of_indices = mesh.getNumberOfIndices ();
+
+      _instance_buffer.create ();
+      _instance_buffer.setUsagePattern (QOpenGLBuffer::DynamicDraw);
+      _instances_changed = true;
+      _uniforms_valid = false;
+      _highlighted_changed = true;
+
+      //
+      // Record the instanced attribute setup. The attribute divisors are part of
+      // the vertex array state, too.
+      //
+      if (isInstancingSupported () && _vertex_array.create ())
+        {
+          _vertex_array.bind ();
+          setupAttributes ();
+          _vertex_array.release ();
+
+          _index_buffer.release ();
+          _vertex_buffer.release ();
+        }
+    }
+
+    /*!
+     * Set points to be displayed
+     *
+     * The instance buffer is updated with the next paint call.
+     */
+    void PinInstances::setPoints (const QList<Database::Point>& points)
+    {
+      _instances.resize (points.size ());
+
+      for (int i=0; i < points.size (); ++i)
+        {
+          const Database::Point& point = points[i];
+          Instance& instance = _instances[i];
+
+          instance._position = point.getSurfacePosition ();
+          instance._normal = point.getSurfaceNormal ();
+          instance._color = QVector3D (point.getColor ().redF (), point.getColor ().greenF (), point.getColor ().blueF ());
+          instance._selected = point.getSelected () ? 1.0f : 0.0f;
+          instance._id = i;
+        }
+
+      _instances_changed = true;
+    }
+
+    /*!
+     * Set highlighted pin
+     *
+     * @param index Index of the pin in the point list or -1 if no pin is highlighted
+     */
+    void PinInstances::setHighlighted (int index)
+    {
+      if (index != _highlighted)
+        {
+          _highlighted = index;
+          _highlighted_changed = true;
+        }
+    }
+
+    /*! Check if all pins can be drawn with a single instanced draw call */
+    bool PinInstances::isInstancingSupported () const
+    {
+      return _draw_elements_instanced != 0 && _vertex_attrib_divisor != 0;
+    }
+
+    /*
+     * Upload instance data into the GPU buffer
+     */
+    void PinInstances::updateInstanceBuffer ()
+    {
+      _instance_buffer.bind ();
+      _instance_buffer.allocate (_instances.constData (), _instances.size () * sizeof (Instance));
+      _instance_buffer.release ();
+
+      _instances_changed = false;
+    }
+
+    /*
+     * Bind buffers and setup vertex attributes
+     *
+     * In instanced mode, the per instance attributes are sourced from the instance
+     * buffer. Otherwise they are set as constant attributes for each pin.
+     */
+    void PinInstances::setupAttributes ()
+    {
+      _vertex_buffer.bind ();
+      _index_buffer.bind ();
+
+      _shader.enableAttributeArray (_vertex_attr);
+      _shader.setAttributeBuffer (_vertex_attr, GL_FLOAT, offsetof (VertexData, _vertex), 3, sizeof (VertexData));
+
+      _shader.enableAttributeArray (_normal_attr);
+      _shader.setAttributeBuffer (_normal_attr, GL_FLOAT, offsetof (VertexData, _normal), 3, sizeof (VertexData));
+
+      if (isInstancingSupported ())
+        {
+          _instance_buffer.bind ();
+
+          _shader.enableAttributeArray (_position_attr);
+          _shader.setAttributeBuffer (_position_attr, GL_FLOAT, offsetof (Instance, _position), 3, sizeof (Instance));
+          _vertex_attrib_divisor (_position_attr, 1);
+
+          _shader.enableAttributeArray (_normal_instance_attr);
+          _shader.setAttributeBuffer (_normal_instance_attr, GL_FLOAT, offsetof (Instance, _normal), 3, sizeof (Instance));
+          _vertex_attrib_divisor (_normal_instance_attr, 1);
+
+          _shader.enableAttributeArray (_color_attr);
+          _shader.setAttributeBuffer (_color_attr, GL_FLOAT, offsetof (Instance, _color), 3, sizeof (Instance));
+          _vertex_attrib_divisor (_color_attr, 1);
+
+          _shader.enableAttributeArray (_selected_attr);
+          _shader.setAttributeBuffer (_selected_attr, GL_FLOAT, offsetof (Instance, _selected), 1, sizeof (Instance));
+          _vertex_attrib_divisor (_selected_attr, 1);
+
+          _shader.enableAttributeArray (_id_attr);
+          _shader.setAttributeBuffer (_id_attr, GL_FLOAT, offsetof (Instance, _id), 1, sizeof (Instance));
+          _vertex_attrib_divisor (_id_attr, 1);
+
+          _instance_buffer.release ();
+        }
+    }
+
+    /*
+     * Reset vertex attribute setup and release buffers
+     */
+    void PinInstances::releaseAttributes ()
+    {
+      if (isInstancingSupported ())
+        {
+          _vertex_attrib_divisor (_id_attr, 0);
+          _vertex_attrib_divisor (_selected_attr, 0);
+          _vertex_attrib_divisor (_color_attr, 0);
+          _vertex_attrib_divisor (_normal_instance_attr, 0);
+          _vertex_attrib_divisor (_position_attr, 0);
+
+          _shader.disableAttributeArray (_id_attr);
+          _shader.disableAttributeArray (_selected_attr);
+          _shader.disableAttributeArray (_color_attr);
+          _shader.disableAttributeArray (_normal_instance_attr);
+          _shader.disableAttributeArray (_position_attr);
+        }
+
+      _shader.disableAttributeArray (_normal_attr);
+      _shader.disableAttributeArray (_vertex_attr);
+
+      _index_buffer.release ();
+      _vertex_buffer.release ();
+    }
+
+    /*!
+     * Draw all pins
+     *
+     * @param mvp Model view projection matrix of the scene
+     * @param mv  Model view matrix of the scene
+     * @param pick_mode If set, the pins are drawn with their packed ids as color
+     *                  and without blending
+     */
+    void PinInstances::paint (const QMatrix4x4& mvp, const QMatrix4x4& mv, bool pick_mode)
+    {
+      if (_instances.isEmpty ())
+        return;
+
+      QOpenGLFunctions gl (QOpenGLContext::currentContext ());
+
+      if (!pick_mode)
+        {
+          gl.glEnable (GL_BLEND);
+          gl.glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+
+      _shader.bind ();
+      _shader.setUniformValue (_pick_mode_attr, pick_mode);
+
+      if (_highlighted_changed)
+        {
+          _shader.setUniformValue (_highlighted_attr, static_cast<GLfloat> (_highlighted));
+          _highlighted_changed = false;
+        }
+
+      if (!_uniforms_valid || mvp != _mvp_matrix)
+        {
+          _shader.setUniformValue (_mvp_matrix_attr, mvp);
+          _shader.setUniformValue (_n_matrix_attr, mv.normalMatrix ());
+          _mvp_matrix = mvp;
+          _uniforms_valid = true;
+        }
+
+      if (isInstancingSupported ())
+        {
+          if (_instances_changed)
+            updateInstanceBuffer ();
+
+          if (_vertex_array.isCreated ())
+            _vertex_array.bind ();
+          else
+            setupAttributes ();
+
+          _draw_elements_instanced (GL_TRIANGLES, _number_of_indices, GL_UNSIGNED_INT, 0, _instances.size ());
+
+          if (_vertex_array.isCreated ())
+            _vertex_array.release ();
+          else
+            releaseAttributes ();
+        }
+      else
+        {
+          //
+          // Fallback: per pin draw calls with the instance attributes set as constant
+          // vertex attributes
+          //
+          setupAttributes ();
+
+          foreach (const Instance& instance, _instances)
+            {
+              _shader.setAttributeValue (_position_attr, instance._position);
+              _shader.setAttributeValue (_normal_instance_attr, instance._normal);
+              _shader.setAttributeValue (_color_attr, instance._color);
+              _shader.setAttributeValue (_selected_attr, instance._selected);
+              _shader.setAttributeValue (_id_attr, instance._id);
+
+              gl.glDrawElements (GL_TRIANGLES, _number_of_indices, GL_UNSIGNED_INT, 0);
+            }
+
+          releaseAttributes ();
+        }
+
+      _shader.release ();
+
+      if (!pick_mode)
+        gl.glDisable (GL_BLEND);
+    }
+
+  }
+}
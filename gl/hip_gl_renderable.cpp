@@ -5,7 +5,10 @@
  */
 
 #include "HIPGLRenderable.h"
+#include "HIPGLBounds.h"
 #include "HIPGLData.h"
+#include "HIPGLMesh.h"
+#include "HIPGLPickBuffer.h"
 #include "ui_hip_gl_view.h"
 
 #include "core/HIPException.h"
@@ -15,53 +18,16 @@
 #include <QKeyEvent>
 #include <QOpenGLBuffer>
 #include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
 #include <QOpenGLWidget>
 #include <QOpenGLTexture>
 
+#include <cstddef>
+
 
 namespace HIP {
   namespace GL {
 
-    //#**********************************************************************
-    // CLASS HIP::GL::VertexData
-    //#**********************************************************************
-
-    namespace {
-
-      struct VertexData
-      {
-        VertexData () {}
-        VertexData (const QVector3D& vertex, const QVector3D& normal, const QVector3D& texture);
-
-        QVector3D _vertex;
-        QVector3D _normal;
-        QVector2D _texture;
-      };
-
-      VertexData::VertexData (const QVector3D& vertex, const QVector3D& normal, const QVector3D& texture)
-        : _vertex  (vertex),
-          _normal  (normal),
-          _texture (texture)
-      {
-      }
-
-    }
-
-
-    //#**********************************************************************
-    // CLASS HIP::GL::VertexCollector
-    //#**********************************************************************
-
-    struct VertexCollector
-    {
-      QVector<VertexData> _vertex_data;
-      QVector<GLuint> _index_data;
-
-      typedef QMap<Point, int> PointIndexMap;
-      PointIndexMap _point_indices;
-    };
-
-
     //#**********************************************************************
     // CLASS HIP::GL::RenderableParameters
     //#**********************************************************************
@@ -70,7 +36,8 @@ namespace HIP {
     RenderableParameters::RenderableParameters ()
       : _position       (0, 0, 0),
         _visible_groups (),
-        _transparent    ()
+        _transparent    (),
+        _pick_mode      (false)
     {
     }
 
@@ -104,6 +71,30 @@ namespace HIP {
       _transparent = transparent;
     }
 
+    bool RenderableParameters::getPickMode () const
+    {
+      return _pick_mode;
+    }
+
+    void RenderableParameters::setPickMode (bool pick_mode)
+    {
+      _pick_mode = pick_mode;
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::Renderable::Statistics
+    //#**********************************************************************
+
+    /*! Constructor */
+    Renderable::Statistics::Statistics ()
+      : _drawn_groups     (0),
+        _culled_groups    (0),
+        _drawn_triangles  (0),
+        _culled_triangles (0)
+    {
+    }
+
 
     //#**********************************************************************
     // CLASS HIP::GL::Renderable
@@ -115,8 +106,15 @@ namespace HIP {
         _has_texture   (false),
         _vertex_buffer (QOpenGLBuffer::VertexBuffer),
         _index_buffer  (QOpenGLBuffer::IndexBuffer),
+        _vertex_array  (),
+        _shader        (0),
+        _vertex_attr   (-1),
+        _normal_attr   (-1),
+        _texture_attr  (-1),
+        _pick_id_attr  (-1),
         _model_matrix  (),
-        _textures      ()
+        _textures      (),
+        _statistics    ()
     {
     }
 
@@ -126,29 +124,45 @@ namespace HIP {
       for (TextureMap::const_iterator i = _textures.begin (); i != _textures.end (); ++i)
         delete i.value ();
 
+      _vertex_array.destroy ();
       _index_buffer.destroy ();
       _vertex_buffer.destroy ();
     }
 
-    /*! Initialize for drawing */
-    void Renderable::initialize ()
+    /*!
+     * Initialize for drawing
+     *
+     * @param shader       Shader program the renderable is drawn with
+     * @param vertex_attr  Location of the vertex attribute
+     * @param normal_attr  Location of the normal attribute
+     * @param texture_attr Location of the texture coordinate attribute
+     */
+    void Renderable::initialize (QOpenGLShaderProgram* shader, int vertex_attr, int normal_attr, int texture_attr)
     {
+      _shader = shader;
+      _vertex_attr = vertex_attr;
+      _normal_attr = normal_attr;
+      _texture_attr = texture_attr;
+      _pick_id_attr = shader->uniformLocation ("in_pick_id");
+
       if (_data != 0)
         {
-          foreach (const GroupPtr& group, _data->getGroups ())
+          const Mesh& mesh = _data->getMesh ();
+
+          foreach (const MeshGroup& group, mesh.getGroups ())
             {
-              if (!group->getMaterial ().isEmpty ())
+              if (!group.getMaterial ().isEmpty ())
                 {
-                  const Material& material = _data->getMaterial (group->getMaterial ());
+                  const Material& material = _data->getMaterial (group.getMaterial ());
                   if ( !material.getTexture ().isEmpty () &&
-                       !_textures.contains (group->getMaterial ()) )
+                       !_textures.contains (group.getMaterial ()) )
                     {
                       QOpenGLTexture* texture = new QOpenGLTexture (Tools::loadResource<QImage> (material.getTexture ()).mirrored ());
                       texture->setMinificationFilter (QOpenGLTexture::Nearest);
                       texture->setMagnificationFilter (QOpenGLTexture::Linear);
                       texture->setWrapMode (QOpenGLTexture::Repeat);
 
-                      _textures.insert (group->getMaterial (), texture);
+                      _textures.insert (group.getMaterial (), texture);
                       _has_texture = true;
                     }
                 }
@@ -157,67 +171,118 @@ namespace HIP {
           //
           // Init render data
           //
-          VertexCollector vertices;
-
-          foreach (const GroupPtr& group, _data->getGroups ())
-            {
-              foreach (const Face& face, group->getFaces ())
-                {
-                  Q_ASSERT (face.getPoints ().size () == 3);
-
-                  addVertex (&vertices, face.getPoints ()[0]);
-                  addVertex (&vertices, face.getPoints ()[1]);
-                  addVertex (&vertices, face.getPoints ()[2]);
-                }
-            }
-
           _vertex_buffer.create ();
           _vertex_buffer.bind ();
-          _vertex_buffer.allocate (vertices._vertex_data.constData (), vertices._vertex_data.size () * sizeof (VertexData));
+          _vertex_buffer.allocate (mesh.getVertexData (), mesh.getNumberOfVertices () * sizeof (VertexData));
           _vertex_buffer.release ();
 
           _index_buffer.create ();
           _index_buffer.bind ();
-          _index_buffer.allocate (vertices._index_data.constData (), vertices._index_data.size () * sizeof (GLuint));
+          _index_buffer.allocate (mesh.getIndexData (), mesh.getNumberOfIndices () * sizeof (GLuint));
           _index_buffer.release ();
+
+          //
+          // Record attribute setup. The index buffer binding is part of the vertex
+          // array state, so it must stay bound until the vertex array is released.
+          //
+          if (_vertex_array.create ())
+            {
+              _vertex_array.bind ();
+              setupAttributes ();
+              _vertex_array.release ();
+
+              _index_buffer.release ();
+              _vertex_buffer.release ();
+            }
         }
     }
 
-    /*! Bind structures */
-    void Renderable::bind ()
+    /*
+     * Bind buffers and setup vertex attributes
+     */
+    void Renderable::setupAttributes ()
     {
       _vertex_buffer.bind ();
       _index_buffer.bind ();
+
+      _shader->enableAttributeArray (_vertex_attr);
+      _shader->setAttributeBuffer (_vertex_attr, GL_FLOAT, offsetof (VertexData, _vertex), 3, sizeof (VertexData));
+
+      _shader->enableAttributeArray (_normal_attr);
+      _shader->setAttributeBuffer (_normal_attr, GL_FLOAT, offsetof (VertexData, _normal), 3, sizeof (VertexData));
+
+      _shader->enableAttributeArray (_texture_attr);
+      _shader->setAttributeBuffer (_texture_attr, GL_FLOAT, offsetof (VertexData, _texture), 2, sizeof (VertexData));
+    }
+
+    /*! Bind structures */
+    void Renderable::bind ()
+    {
+      if (_vertex_array.isCreated ())
+        _vertex_array.bind ();
+      else
+        setupAttributes ();
     }
 
     /*! Release structures */
     void Renderable::release ()
     {
-      _index_buffer.release ();
-      _vertex_buffer.release ();
+      if (_vertex_array.isCreated ())
+        _vertex_array.release ();
+      else
+        {
+          _shader->disableAttributeArray (_texture_attr);
+          _shader->disableAttributeArray (_normal_attr);
+          _shader->disableAttributeArray (_vertex_attr);
+
+          _index_buffer.release ();
+          _vertex_buffer.release ();
+        }
     }
 
-    /*! Paint renderable */
+    /*!
+     * Paint renderable
+     *
+     * @param mvp        Model view projection matrix used for culling groups outside of the view
+     * @param parameters Paint parameters
+     */
     void Renderable::paint (const QMatrix4x4& mvp, const RenderableParameters& parameters)
     {
-      Q_UNUSED (mvp);
-
       QOpenGLFunctions gl (QOpenGLContext::currentContext ());
 
-      int point_offset = 0;
-      foreach (const GroupPtr& group, _data->getGroups ())
+      Frustum frustum (mvp);
+      _statistics = Statistics ();
+
+      const QVector<MeshGroup>& groups = _data->getMesh ().getGroups ();
+
+      for (int i=0; i < groups.size (); ++i)
         {
-          if (parameters.getVisibleGroups ().isEmpty () || parameters.getVisibleGroups ().contains (group->getName ()))
+          const MeshGroup& group = groups[i];
+
+          if (parameters.getVisibleGroups ().isEmpty () || parameters.getVisibleGroups ().contains (group.getName ()))
             {
+              if (!frustum.intersects (group.getBounds ()))
+                {
+                  ++_statistics._culled_groups;
+                  _statistics._culled_triangles += group.getNumberOfIndices () / 3;
+                  continue;
+                }
+
+              ++_statistics._drawn_groups;
+              _statistics._drawn_triangles += group.getNumberOfIndices () / 3;
+
+              if (parameters.getPickMode ())
+                _shader->setUniformValue (_pick_id_attr, PickBuffer::encode (PickBuffer::Type::GROUP, i));
+
               QOpenGLTexture* texture = 0;
-              if (!group->getMaterial ().isEmpty ())
+              if (!group.getMaterial ().isEmpty () && !parameters.getPickMode ())
                 {
-                  TextureMap::const_iterator pos = _textures.find (group->getMaterial ());
+                  TextureMap::const_iterator pos = _textures.find (group.getMaterial ());
                   if (pos != _textures.end ())
                     texture = pos.value ();
 
 #if 0
-                  const Material& material = _data->getMaterial (group->getMaterial ());
+                  const Material& material = _data->getMaterial (group.getMaterial ());
 
                   setLightParameter (GL_AMBIENT, material.getAmbient ());
                   setLightParameter (GL_DIFFUSE, material.getDiffuse ());
@@ -231,13 +296,12 @@ namespace HIP {
               if (texture != 0)
                 texture->bind ();
 
-              gl.glDrawElements (GL_TRIANGLES, group->getFaces ().size () * 3, GL_UNSIGNED_INT, (void*)(point_offset * sizeof (GLuint)));
+              gl.glDrawElements (GL_TRIANGLES, group.getNumberOfIndices (), GL_UNSIGNED_INT,
+                                 (void*)(group.getFirstIndex () * sizeof (GLuint)));
 
               if (texture != 0)
                 texture->release ();
             }
-
-          point_offset += group->getFaces ().size () * 3;
         }
     }
 
@@ -249,28 +313,6 @@ namespace HIP {
       return sizeof (VertexData);
     }
 
-    /*
-     * Add single vertex to data vectors
-     */
-    void Renderable::addVertex (VertexCollector* collector, const Point& point) const
-    {
-      VertexCollector::PointIndexMap::const_iterator pos = collector->_point_indices.find (point);
-      if (pos == collector->_point_indices.end ())
-        {
-          QVector2D texture_point (0, 0);
-          if (point.getTextureIndex () >= 0)
-            texture_point = _data->getTextures ()[point.getTextureIndex ()];
-
-          collector->_vertex_data.push_back (VertexData (_data->getVertices ()[point.getVertexIndex ()],
-                                                         _data->getNormals ()[point.getNormalIndex ()],
-                                                         texture_point));
-          collector->_point_indices.insert (point, collector->_vertex_data.size () - 1);
-          collector->_index_data.push_back (collector->_vertex_data.size () - 1);
-        }
-      else
-        collector->_index_data.push_back (pos.value ());
-    }
-
     /*!
      * Set single vector based light parameter
      */
@@ -0,0 +1,288 @@
+/*
+ * hip_gl_sparse_matrix.cpp - Sparse symmetric matrices and their factorization
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPGLSparseMatrix.h"
+
+#include <algorithm>
+
+namespace HIP {
+  namespace GL {
+
+    //#**********************************************************************
+    // Local definitions
+    //#**********************************************************************
+
+    namespace {
+
+      /* Order matrix entries by column, then by row */
+      bool compareEntries (const SparseMatrix::Entry& e1, const SparseMatrix::Entry& e2)
+      {
+        return e1._column < e2._column || (e1._column == e2._column && e1._row < e2._row);
+      }
+
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::SparseMatrix
+    //#**********************************************************************
+
+    /*! Constructor for an empty matrix */
+    SparseMatrix::SparseMatrix ()
+      : _column_offsets (1, 0),
+        _rows           (),
+        _values         ()
+    {
+    }
+
+    /*!
+     * Constructor
+     *
+     * @param size    Number of rows and columns
+     * @param entries Matrix entries in arbitrary order. Entries with the same row and
+     *                column are summed up.
+     */
+    SparseMatrix::SparseMatrix (int size, const QVector<Entry>& entries)
+      : _column_offsets (size + 1, 0),
+        _rows           (),
+        _values         ()
+    {
+      QVector<Entry> sorted = entries;
+      std::sort (sorted.begin (), sorted.end (), compareEntries);
+
+      _rows.reserve (sorted.size ());
+      _values.reserve (sorted.size ());
+
+      for (int i=0; i < sorted.size (); ++i)
+        {
+          const Entry& entry = sorted[i];
+          Q_ASSERT (entry._row >= 0 && entry._row < size && entry._column >= 0 && entry._column < size);
+
+          if (i > 0 && entry._row == sorted[i - 1]._row && entry._column == sorted[i - 1]._column)
+            _values.back () += entry._value;
+          else
+            {
+              _rows.push_back (entry._row);
+              _values.push_back (entry._value);
+              ++_column_offsets[entry._column + 1];
+            }
+        }
+
+      for (int i=0; i < size; ++i)
+        _column_offsets[i + 1] += _column_offsets[i];
+    }
+
+    /*!
+     * Compute matrix vector product
+     *
+     * @param x Vector to be multiplied
+     * @param y Result vector
+     */
+    void SparseMatrix::multiply (const QVector<double>& x, QVector<double>* y) const
+    {
+      Q_ASSERT (x.size () == getSize ());
+
+      y->fill (0.0, getSize ());
+
+      for (int column=0; column < getSize (); ++column)
+        for (int i=_column_offsets[column]; i < _column_offsets[column + 1]; ++i)
+          (*y)[_rows[i]] += _values[i] * x[column];
+    }
+
+
+    //#**********************************************************************
+    // CLASS HIP::GL::SparseLDLT
+    //#**********************************************************************
+
+    /*! Constructor */
+    SparseLDLT::SparseLDLT ()
+      : _permutation    (),
+        _column_offsets (),
+        _rows           (),
+        _values         (),
+        _diagonal       ()
+    {
+    }
+
+    /*! Release factorization */
+    void SparseLDLT::clear ()
+    {
+      _permutation.clear ();
+      _column_offsets.clear ();
+      _rows.clear ();
+      _values.clear ();
+      _diagonal.clear ();
+    }
+
+    /*!
+     * Factorize matrix
+     *
+     * @param matrix      Symmetric positive definite matrix with both triangles stored
+     * @param permutation Fill reducing order. Row/column 'permutation[k]' of the matrix
+     *                    becomes row/column 'k' of the factorized matrix.
+     * @return 'false' if the matrix is not positive definite
+     */
+    bool SparseLDLT::factorize (const SparseMatrix& matrix, const QVector<int>& permutation)
+    {
+      int n = matrix.getSize ();
+      Q_ASSERT (permutation.size () == n);
+
+      clear ();
+
+      const QVector<int>& ap = matrix.getColumnOffsets ();
+      const QVector<int>& ai = matrix.getRows ();
+      const QVector<double>& ax = matrix.getValues ();
+
+      QVector<int> inverse (n);
+      for (int k=0; k < n; ++k)
+        inverse[permutation[k]] = k;
+
+      //
+      // Symbolic analysis: elimination tree and column counts of L
+      //
+      QVector<int> parent (n);
+      QVector<int> flag (n);
+      QVector<int> counts (n);
+
+      for (int k=0; k < n; ++k)
+        {
+          parent[k] = -1;
+          flag[k] = k;
+          counts[k] = 0;
+
+          int column = permutation[k];
+
+          for (int p=ap[column]; p < ap[column + 1]; ++p)
+            {
+              int i = inverse[ai[p]];
+
+              if (i < k)
+                for (; flag[i] != k; i = parent[i])
+                  {
+                    if (parent[i] == -1)
+                      parent[i] = k;
+
+                    ++counts[i];
+                    flag[i] = k;
+                  }
+            }
+        }
+
+      _column_offsets.resize (n + 1);
+      _column_offsets[0] = 0;
+
+      for (int k=0; k < n; ++k)
+        _column_offsets[k + 1] = _column_offsets[k] + counts[k];
+
+      _rows.resize (_column_offsets[n]);
+      _values.resize (_column_offsets[n]);
+      _diagonal.resize (n);
+
+      //
+      // Numeric factorization. Row 'k' of L is computed from a sparse triangular solve
+      // whose pattern is given by the elimination tree.
+      //
+      QVector<double> y (n, 0.0);
+      QVector<int> pattern (n);
+
+      for (int k=0; k < n; ++k)
+        {
+          int top = n;
+          flag[k] = k;
+          counts[k] = 0;
+
+          int column = permutation[k];
+
+          for (int p=ap[column]; p < ap[column + 1]; ++p)
+            {
+              int i = inverse[ai[p]];
+
+              if (i <= k)
+                {
+                  y[i] += ax[p];
+
+                  int length = 0;
+                  for (; flag[i] != k; i = parent[i])
+                    {
+                      pattern[length++] = i;
+                      flag[i] = k;
+                    }
+
+                  while (length > 0)
+                    pattern[--top] = pattern[--length];
+                }
+            }
+
+          double d = y[k];
+          y[k] = 0.0;
+
+          for (; top < n; ++top)
+            {
+              int i = pattern[top];
+              double yi = y[i];
+              y[i] = 0.0;
+
+              int end = _column_offsets[i] + counts[i];
+              for (int p=_column_offsets[i]; p < end; ++p)
+                y[_rows[p]] -= _values[p] * yi;
+
+              double l = yi / _diagonal[i];
+              d -= l * yi;
+
+              _rows[end] = k;
+              _values[end] = l;
+              ++counts[i];
+            }
+
+          if (d <= 0.0)
+            {
+              clear ();
+              return false;
+            }
+
+          _diagonal[k] = d;
+        }
+
+      _permutation = permutation;
+
+      return true;
+    }
+
+    /*!
+     * Solve linear system with the factorized matrix
+     *
+     * @param b Right hand side
+     * @param x Solution
+     */
+    void SparseLDLT::solve (const QVector<double>& b, QVector<double>* x) const
+    {
+      Q_ASSERT (isValid ());
+
+      int n = _diagonal.size ();
+      Q_ASSERT (b.size () == n);
+
+      QVector<double> z (n);
+      for (int k=0; k < n; ++k)
+        z[k] = b[_permutation[k]];
+
+      for (int j=0; j < n; ++j)
+        for (int p=_column_offsets[j]; p < _column_offsets[j + 1]; ++p)
+          z[_rows[p]] -= _values[p] * z[j];
+
+      for (int j=0; j < n; ++j)
+        z[j] /= _diagonal[j];
+
+      for (int j=n - 1; j >= 0; --j)
+        for (int p=_column_offsets[j]; p < _column_offsets[j + 1]; ++p)
+          z[j] -= _values[p] * z[_rows[p]];
+
+      x->resize (n);
+      for (int k=0; k < n; ++k)
+        (*x)[_permutation[k]] = z[k];
+    }
+
+  }
+}
@@ -5,29 +5,46 @@
  */
 
 #include "HIPGLView.h"
+#include "HIPGLBoundingVolumeHierarchy.h"
 #include "HIPGLRenderable.h"
 #include "HIPGLData.h"
+#include "HIPGLPickBuffer.h"
 #include "HIPGLPin.h"
+#include "HIPGLPinInstances.h"
 #include "ui_hip_gl_view.h"
 
 #include "core/HIPConfig.h"
 #include "core/HIPException.h"
+#include "core/HIPStatusBar.h"
 #include "core/HIPTools.h"
 
 #include <QActionGroup>
+#include <QApplication>
 #include <QCursor>
+#include <QDebug>
 #include <QKeyEvent>
 #include <QMatrix4x4>
 #include <QMouseEvent>
 #include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLTexture>
+#include <QScopedPointer>
 #include <QSurfaceFormat>
 #include <QToolBar>
 #include <QWheelEvent>
 
+#ifndef GL_READ_FRAMEBUFFER
+#  define GL_READ_FRAMEBUFFER 0x8CA8
+#endif
+
+#ifndef GL_DRAW_FRAMEBUFFER
+#  define GL_DRAW_FRAMEBUFFER 0x8CA9
+#endif
+
 
 namespace HIP {
   namespace GL {
@@ -38,9 +55,26 @@ namespace HIP {
 
     /*
      * Widget displaying an open GL scene
+     *
+     * The widget renders on demand only. Changes are collected via 'invalidate ()'
+     * and coalesced into a single frame, which is synchronized to the display by
+     * the widgets buffer swap. The model layer is rendered into an offscreen frame
+     * buffer (color and depth) and is reused as long as neither the camera nor the
+     * model visibility changed, so pin updates only redraw the pins.
+     *
+     * Pins and model groups below the cursor are picked via an offscreen id buffer which
+     * is rendered only if a pick is requested and the scene changed since. Hovering
+     * highlights the pin below the cursor, a left click without dragging selects it. If
+     * no pin has been clicked, the visible model surface below the cursor is picked.
      */
     class Widget : public QOpenGLWidget, protected QOpenGLFunctions
     {
+      Q_OBJECT
+
+    public:
+      struct Change { enum Type_t { CAMERA = 0x01, MODEL = 0x02, PINS = 0x04, ALL = 0x07, PICK = 0x08 }; };
+      typedef Change::Type_t Change_t;
+
     public:
       Widget (Database::Database* database, QWidget* parent);
       virtual ~Widget ();
@@ -48,6 +82,10 @@ namespace HIP {
       void setData (const Data* data);
       void resetView ();
 
+      void invalidate (int changes);
+
+      bool pick (const QPointF& pos, Hit* hit) const;
+
       virtual void initializeGL ();
       virtual void resizeGL (int width, int height);
       virtual void paintGL ();
@@ -59,8 +97,22 @@ namespace HIP {
       virtual void mouseMoveEvent (QMouseEvent* event);
       virtual void mouseReleaseEvent (QMouseEvent* event);
       virtual void wheelEvent (QWheelEvent* event);
+      virtual void leaveEvent (QEvent* event);
+
+    private slots:
+      void onPinClicked (const QString& id, int modifiers);
 
     private:
+      typedef void (QOPENGLF_APIENTRYP BlitFramebufferFunc) (GLint src_x0, GLint src_y0, GLint src_x1, GLint src_y1,
+                                                             GLint dst_x0, GLint dst_y0, GLint dst_x1, GLint dst_y1,
+                                                             GLbitfield mask, GLenum filter);
+
+      QSet<QString> getVisibleGroups () const;
+      void drawModel (bool pick_mode=false);
+      void drawPickLayer ();
+      void requestPick (const QPointF& pos, bool click=false, Qt::KeyboardModifiers modifiers=Qt::NoModifier);
+      void handlePick (const PickBuffer::Pick& pick);
+      void showSurfaceInfo (const QPointF& pos);
       void drawRenderable (const RenderablePtr& renderable, const RenderableParameters& parameters);
       float checkBounds (float lower, float value, float upper) const;
 
@@ -75,7 +127,7 @@ namespace HIP {
       QOpenGLShaderProgram _shader;
 
       RenderablePtr _model;
-      RenderablePtr _pin;
+      PinInstancesPtr _pins;
 
       int _vertex_attr;
       int _normal_attr;
@@ -83,12 +135,27 @@ namespace HIP {
       int _mv_matrix_attr;
       int _n_matrix_attr;
       int _texture_attr;
+      int _sampler_attr;
+      int _has_texture_attr;
+      int _pick_mode_attr;
+
+      bool _matrices_changed;
+      int _has_texture_state;
+      int _pick_mode_state;
+
+      int _changes;
+      QScopedPointer<QOpenGLFramebufferObject> _model_layer;
+      BlitFramebufferFunc _blit_framebuffer;
+
+      PickBuffer _pick_buffer;
+      PickRequests _pick_requests;
 
       QMatrix4x4 _projection_matrix;
       QMatrix4x4 _camera_matrix;
       QMatrix4x4 _view_matrix;
 
       QPointF _last_pos;
+      QPointF _press_pos;
     };
 
 
@@ -102,24 +169,37 @@ namespace HIP {
         _pin_data          (Config::PIN_MODEL_FILE),
         _rotate_cursor     (QPixmap (Config::CURSOR_ROTATE)),
         _rotate_y_cursor   (QPixmap (Config::CURSOR_ROTATE_Y)),
-        _pin               (),
+        _pins              (new PinInstances (&_pin_data)),
         _vertex_attr       (-1),
         _normal_attr       (-1),
         _mvp_matrix_attr   (-1),
         _mv_matrix_attr    (-1),
         _n_matrix_attr     (-1),
         _texture_attr      (-1),
+        _sampler_attr      (-1),
+        _has_texture_attr  (-1),
+        _pick_mode_attr    (-1),
+        _matrices_changed  (true),
+        _has_texture_state (-1),
+        _pick_mode_state   (-1),
+        _changes           (Change::ALL),
+        _model_layer       (),
+        _blit_framebuffer  (0),
+        _pick_buffer       (),
+        _pick_requests     (),
         _projection_matrix (),
         _camera_matrix     (),
         _view_matrix       (),
-        _last_pos          (0, 0)
+        _last_pos          (0, 0),
+        _press_pos         (0, 0)
     {
       _pin_data.normalize ();
       _pin_data.scale (1.0 / 2.0);
-      _pin = RenderablePtr (new Renderable (&_pin_data));
+      _pins->setPoints (database->getPoints ());
 
       setFocusPolicy (Qt::WheelFocus);
       setContextMenuPolicy (Qt::NoContextMenu);
+      setMouseTracking (true);
 
       QSurfaceFormat format;
       format.setDepthBufferSize (24);
@@ -134,7 +214,9 @@ namespace HIP {
 
       // Delete GL related structures
       _model.reset ();
-      _pin.reset ();
+      _pins.reset ();
+      _model_layer.reset ();
+      _pick_buffer.destroy ();
 
       doneCurrent ();
     }
@@ -148,6 +230,7 @@ namespace HIP {
 
       _model = RenderablePtr (new Renderable (data));
       resetView ();
+      invalidate (Change::ALL);
     }
 
     /*! Reset view */
@@ -160,9 +243,29 @@ namespace HIP {
           _view_matrix.translate (0, 0, (cube.first + cube.second).z () / 2);
 
           _camera_matrix.setToIdentity ();
+          invalidate (Change::CAMERA);
         }
     }
 
+    /*!
+     * Mark parts of the scene as changed and schedule a repaint
+     *
+     * Multiple invalidations before the next frame are merged, so expensive updates
+     * like rebuilding the pin instances are done at most once per frame.
+     *
+     * @param changes Combination of 'Change' flags
+     */
+    void Widget::invalidate (int changes)
+    {
+      if (changes & Change::CAMERA)
+        _matrices_changed = true;
+
+      if (_changes == 0)
+        update ();
+
+      _changes |= changes;
+    }
+
     /*
      * Initialize GL widget
      */
@@ -206,8 +309,33 @@ namespace HIP {
       _texture_attr = _shader.attributeLocation ("in_texture");
       Q_ASSERT (_texture_attr >= 0);
 
-      _model->initialize ();
-      _pin->initialize ();
+      _sampler_attr = _shader.uniformLocation ("in_texture");
+      _has_texture_attr = _shader.uniformLocation ("has_texture");
+      _pick_mode_attr = _shader.uniformLocation ("in_pick_mode");
+
+      //
+      // The texture unit never changes, so the sampler is set only once
+      //
+      _shader.bind ();
+      _shader.setUniformValue (_sampler_attr, 0);
+      _shader.release ();
+
+      _matrices_changed = true;
+      _has_texture_state = -1;
+      _pick_mode_state = -1;
+
+      //
+      // Model layer caching needs frame buffer blits including the depth buffer
+      //
+      if (QOpenGLFramebufferObject::hasOpenGLFramebufferBlit ())
+        _blit_framebuffer = reinterpret_cast<BlitFramebufferFunc> (context ()->getProcAddress ("glBlitFramebuffer"));
+
+      _changes = Change::ALL;
+      _model_layer.reset ();
+      _pick_buffer.initialize ();
+
+      _model->initialize (&_shader, _vertex_attr, _normal_attr, _texture_attr);
+      _pins->initialize ();
     }
 
     /*
@@ -217,6 +345,7 @@ namespace HIP {
     {
       _projection_matrix = QMatrix4x4 ();
       _projection_matrix.perspective (45.0f /*fov*/, qreal (width) / qreal (height) /*aspect*/, 0.05f /*zNear*/, 20.0f /*zFar*/);
+      invalidate (Change::CAMERA);
     }
 
     /*
@@ -224,73 +353,335 @@ namespace HIP {
      */
     void Widget::paintGL ()
     {
-      glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      int changes = _changes;
+      _changes = 0;
 
-      if (!_model.isNull ())
+      //
+      // Widget repaints not triggered via 'invalidate ()' (expose, ...) redraw everything
+      //
+      if (changes == 0)
+        changes = Change::ALL;
+
+      if (_model.isNull ())
+        {
+          glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+          return;
+        }
+
+      if (changes & Change::PINS)
+        _pins->setPoints (_database->getPoints ());
+
+      if (changes & Change::ALL)
+        _pick_buffer.invalidate ();
+
+      if (_blit_framebuffer != 0)
         {
-          RenderableParameters model_parameters;
+          QSize size = QSize (width (), height ()) * devicePixelRatio ();
 
-          QSet<QString> groups;
-          if (!_database->getCurrentView ().isEmpty ())
+          if (_model_layer.isNull () || _model_layer->size () != size)
             {
-              foreach (const Database::View& view, _database->getViews ())
-                if (view.getName () == _database->getCurrentView ())
-                  model_parameters.setVisibleGroups (view.getGroups ().toSet ());
+              _model_layer.reset (new QOpenGLFramebufferObject (size, QOpenGLFramebufferObject::CombinedDepthStencil));
+              changes |= Change::MODEL;
             }
 
-          drawRenderable (_model, model_parameters);
+          //
+          // Render model layer into the offscreen buffer if necessary
+          //
+          if (changes & (Change::CAMERA | Change::MODEL))
+            {
+              _model_layer->bind ();
+              glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+              drawModel ();
+              _model_layer->release ();
+            }
+
+          //
+          // Copy cached model layer including the depth buffer into the widget frame
+          // buffer, so the pins are depth tested against the model
+          //
+          glBindFramebuffer (GL_READ_FRAMEBUFFER, _model_layer->handle ());
+          glBindFramebuffer (GL_DRAW_FRAMEBUFFER, defaultFramebufferObject ());
+
+          _blit_framebuffer (0, 0, size.width (), size.height (), 0, 0, size.width (), size.height (),
+                             GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
 
-          RenderableParameters pin_parameters;
-          foreach (const Database::Point& point, _database->getPoints ())
+          glBindFramebuffer (GL_FRAMEBUFFER, defaultFramebufferObject ());
+        }
+      else
+        {
+          glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+          drawModel ();
+        }
+
+      _pins->paint (_projection_matrix * _view_matrix * _camera_matrix, _view_matrix * _camera_matrix);
+
+      //
+      // Picking. The read back started in this frame is fetched in one of the next
+      // frames, so the pipeline is not stalled by waiting for the pixel transfer.
+      //
+      QPoint pick_pos;
+      int pick_tag;
+
+      if (_pick_requests.takeRequest (&pick_pos, &pick_tag))
+        {
+          if (!_pick_buffer.isValid ())
+            drawPickLayer ();
+
+          _pick_buffer.read (pick_pos, pick_tag);
+        }
+
+      PickBuffer::Pick pick;
+      if (_pick_buffer.fetch (&pick))
+        handlePick (pick);
+
+      if (_pick_buffer.isReadPending () || _pick_requests.hasRequest ())
+        invalidate (Change::PICK);
+    }
+
+    /*
+     * Render the id layer of model groups and pins into the pick buffer
+     */
+    void Widget::drawPickLayer ()
+    {
+      _pick_buffer.bind (QSize (width (), height ()) * devicePixelRatio ());
+
+      drawModel (true);
+      _pins->paint (_projection_matrix * _view_matrix * _camera_matrix, _view_matrix * _camera_matrix, true);
+
+      _pick_buffer.release ();
+
+      glBindFramebuffer (GL_FRAMEBUFFER, defaultFramebufferObject ());
+    }
+
+    /*
+     * Request picking the object at the given widget position with the next frame
+     *
+     * @param pos       Widget position
+     * @param click     If set, the pick is answered as a click
+     * @param modifiers Keyboard modifiers of the click
+     */
+    void Widget::requestPick (const QPointF& pos, bool click, Qt::KeyboardModifiers modifiers)
+    {
+      QPoint position = (pos * devicePixelRatio ()).toPoint ();
+
+      if (click)
+        _pick_requests.requestClick (position, modifiers);
+      else
+        _pick_requests.requestHover (position);
+
+      invalidate (Change::PICK);
+    }
+
+    /*
+     * React on a picked object
+     *
+     * The pin below the cursor is highlighted. If the pick has been requested by a
+     * click, the clicked pin is selected or, if the model has been clicked, the
+     * picked surface location is shown.
+     */
+    void Widget::handlePick (const PickBuffer::Pick& pick)
+    {
+      int highlighted = pick.getType () == PickBuffer::Type::PIN ? pick.getId () : -1;
+
+      if (highlighted != _pins->getHighlighted ())
+        {
+          _pins->setHighlighted (highlighted);
+
+          if (QApplication::mouseButtons () == Qt::NoButton)
             {
-              pin_parameters.setPosition (point.getPosition ());
-              pin_parameters.setTransparent (!point.getSelected ());
-              drawRenderable (_pin, pin_parameters);
+              if (highlighted >= 0)
+                setCursor (Qt::PointingHandCursor);
+              else
+                unsetCursor ();
             }
+
+          invalidate (Change::PICK);
+        }
+
+      Qt::KeyboardModifiers modifiers;
+
+      if (_pick_requests.isClick (pick, &modifiers))
+        {
+          //
+          // The pick is handled while painting, so the selection is changed after the
+          // frame. Otherwise the change notifications would reach the views mid-paint.
+          //
+          if (pick.getType () == PickBuffer::Type::PIN && pick.getId () < _database->getPoints ().size ())
+            QMetaObject::invokeMethod (this, "onPinClicked", Qt::QueuedConnection,
+                                       Q_ARG (QString, _database->getPoints ().at (pick.getId ()).getId ()),
+                                       Q_ARG (int, int (modifiers)));
+          else
+            showSurfaceInfo (QPointF (pick.getPosition ()) / devicePixelRatio ());
         }
     }
 
     /*
-     * Draw single renderable
+     * Change selection after a pin has been clicked
+     *
+     * @param id        Id of the clicked point. The point might have been removed since.
+     * @param modifiers Keyboard modifiers at the time of the click
      */
-    void Widget::drawRenderable (const RenderablePtr& renderable, const RenderableParameters& parameters)
+    void Widget::onPinClicked (const QString& id, int modifiers)
     {
-      renderable->bind ();
+      int index = _database->findIndex (id);
 
-      _shader.bind ();
-      _shader.setUniformValue (_mvp_matrix_attr, _projection_matrix * _view_matrix * _camera_matrix);
-      _shader.setUniformValue (_mv_matrix_attr, _view_matrix * _camera_matrix);
-      _shader.setUniformValue (_n_matrix_attr, (_view_matrix * _camera_matrix).normalMatrix ());
-      _shader.setUniformValue ("in_texture", 0);
+      if (index >= 0)
+        {
+          if (!(modifiers & Qt::ControlModifier))
+            _database->setSelection (QSet<QString> () << id);
+          else if (_database->getPoints ().at (index).getSelected ())
+            _database->deselect (id);
+          else
+            _database->select (id);
+        }
+    }
+
+    /*
+     * Show location of the visible model surface at the given widget position
+     */
+    void Widget::showSurfaceInfo (const QPointF& pos)
+    {
+      Hit hit;
+
+      if (pick (pos, &hit))
+        {
+          const MeshGroup& group = _database->getModel ()->getMesh ().getGroups ()[hit.getGroup ()];
+
+          Tools::StatusBar::showMessage (tr ("Group '%1', triangle %2 at (%3, %4, %5)")
+                                         .arg (group.getName ())
+                                         .arg (hit.getTriangle ())
+                                         .arg (hit.getPosition ().x ())
+                                         .arg (hit.getPosition ().y ())
+                                         .arg (hit.getPosition ().z ()));
+        }
+      else
+        Tools::StatusBar::clearMessage ();
+    }
+
+    /*!
+     * Pick model surface
+     *
+     * Only the groups of the current view are considered. Picking is not possible until
+     * the bounding volume hierarchy of the model has been built in the background.
+     *
+     * @param pos Widget position
+     * @param hit Closest hit of the view ray with the model surface
+     * @return 'true' if the model has been hit
+     */
+    bool Widget::pick (const QPointF& pos, Hit* hit) const
+    {
+      const Data* data = _database->getModel ();
+      const BoundingVolumeHierarchy* hierarchy = data != 0 ? data->getHierarchy () : 0;
+
+      if (hierarchy == 0 || width () <= 0 || height () <= 0)
+        return false;
 
-      int offset = 0;
+      //
+      // Unproject cursor position onto the near and far plane
+      //
+      QMatrix4x4 inverse_mvp = (_projection_matrix * _view_matrix * _camera_matrix).inverted ();
 
-      _shader.enableAttributeArray (_vertex_attr);
-      _shader.setAttributeBuffer (_vertex_attr, GL_FLOAT, offset, 3, renderable->getElementSize ());
+      float x = 2.0f * pos.x () / width () - 1.0f;
+      float y = 1.0f - 2.0f * pos.y () / height ();
 
-      offset += sizeof (QVector3D);
+      QVector3D near_point = inverse_mvp * QVector3D (x, y, -1.0f);
+      QVector3D far_point = inverse_mvp * QVector3D (x, y, 1.0f);
 
-      _shader.enableAttributeArray (_normal_attr);
-      _shader.setAttributeBuffer (_normal_attr, GL_FLOAT, offset, 3, renderable->getElementSize ());
+      //
+      // Restrict picking to the visible groups
+      //
+      QSet<QString> visible_groups = getVisibleGroups ();
+      QBitArray groups;
 
-      offset += sizeof (QVector3D);
+      if (!visible_groups.isEmpty ())
+        {
+          const QVector<MeshGroup>& mesh_groups = hierarchy->getMesh ()->getGroups ();
+          groups = QBitArray (mesh_groups.size ());
 
-      _shader.enableAttributeArray (_texture_attr);
-      _shader.setAttributeBuffer (_texture_attr, GL_FLOAT, offset, 2, renderable->getElementSize ());
-      _shader.setUniformValue ("has_texture", renderable->hasTexture ());
+          for (int i=0; i < mesh_groups.size (); ++i)
+            groups.setBit (i, visible_groups.contains (mesh_groups[i].getName ()));
+        }
 
-      QMatrix4x4 model_matrix;
-      model_matrix.translate (parameters.getPosition ());
+      return hierarchy->intersect (Ray (near_point, far_point - near_point), hit, groups);
+    }
 
-      renderable->paint (_projection_matrix * _view_matrix * model_matrix, parameters);
+    /*
+     * Return names of the groups visible in the current view. Empty if all groups are visible.
+     */
+    QSet<QString> Widget::getVisibleGroups () const
+    {
+      QSet<QString> groups;
 
-      _shader.disableAttributeArray (_texture_attr);
-      _shader.disableAttributeArray (_normal_attr);
-      _shader.disableAttributeArray (_vertex_attr);
+      if (!_database->getCurrentView ().isEmpty ())
+        {
+          foreach (const Database::View& view, _database->getViews ())
+            if (view.getName () == _database->getCurrentView ())
+              groups = view.getGroups ().toSet ();
+        }
 
-      _shader.release ();
+      return groups;
+    }
+
+    /*
+     * Draw model with the currently visible groups
+     *
+     * @param pick_mode If set, the groups are drawn with their packed ids as color
+     */
+    void Widget::drawModel (bool pick_mode)
+    {
+      RenderableParameters model_parameters;
+      model_parameters.setVisibleGroups (getVisibleGroups ());
+      model_parameters.setPickMode (pick_mode);
+
+      drawRenderable (_model, model_parameters);
 
+#ifdef HIP_PRINT_STATISTICS
+      if (pick_mode)
+        return;
+
+      const Renderable::Statistics& statistics = _model->getStatistics ();
+      qDebug () << "* Model groups drawn/culled:" << statistics._drawn_groups << "/" << statistics._culled_groups
+                << ", triangles drawn/culled:" << statistics._drawn_triangles << "/" << statistics._culled_triangles;
+#endif
+    }
+
+    /*
+     * Draw single renderable
+     *
+     * Uniform values are kept in the shader program between frames and are uploaded
+     * only if the view matrices or the texture state changed.
+     */
+    void Widget::drawRenderable (const RenderablePtr& renderable, const RenderableParameters& parameters)
+    {
+      QMatrix4x4 mvp = _projection_matrix * _view_matrix * _camera_matrix;
+
+      _shader.bind ();
+
+      if (_matrices_changed)
+        {
+          _shader.setUniformValue (_mvp_matrix_attr, mvp);
+          _shader.setUniformValue (_mv_matrix_attr, _view_matrix * _camera_matrix);
+          _shader.setUniformValue (_n_matrix_attr, (_view_matrix * _camera_matrix).normalMatrix ());
+          _matrices_changed = false;
+        }
+
+      if (_has_texture_state != static_cast<int> (renderable->hasTexture ()))
+        {
+          _shader.setUniformValue (_has_texture_attr, renderable->hasTexture ());
+          _has_texture_state = renderable->hasTexture ();
+        }
+
+      if (_pick_mode_state != static_cast<int> (parameters.getPickMode ()))
+        {
+          _shader.setUniformValue (_pick_mode_attr, parameters.getPickMode ());
+          _pick_mode_state = parameters.getPickMode ();
+        }
+
+      renderable->bind ();
+      renderable->paint (mvp, parameters);
       renderable->release ();
+
+      _shader.release ();
     }
 
     void Widget::keyPressEvent (QKeyEvent* event)
@@ -310,12 +701,13 @@ namespace HIP {
 
       _database->emitViewChanged (qVariantFromValue (_view_matrix * _camera_matrix));
 
-      update ();
+      invalidate (Change::CAMERA);
     }
 
     void Widget::mousePressEvent (QMouseEvent* event)
     {
       _last_pos = event->pos ();
+      _press_pos = event->pos ();
 
       if (event->buttons ().testFlag (Qt::LeftButton))
         {
@@ -333,6 +725,16 @@ namespace HIP {
       QPointF delta = event->pos () - _last_pos;
       _last_pos = event->pos ();
 
+      //
+      // Hovering (mouse tracking) does not change the view, the pin below the cursor
+      // is highlighted only
+      //
+      if (event->buttons () == Qt::NoButton)
+        {
+          requestPick (event->pos ());
+          return;
+        }
+
       if (event->buttons ().testFlag (Qt::LeftButton))
         {
           if (event->modifiers ().testFlag (Qt::ControlModifier))
@@ -355,13 +757,21 @@ namespace HIP {
 
       _database->emitViewChanged (qVariantFromValue (_view_matrix * _camera_matrix));
 
-      update ();
+      invalidate (Change::CAMERA);
     }
 
     void Widget::mouseReleaseEvent (QMouseEvent* event)
     {
-      Q_UNUSED (event);
       unsetCursor ();
+
+      //
+      // Left click without rotating the model
+      //
+      if ( event->button () == Qt::LeftButton &&
+           (event->pos () - _press_pos).manhattanLength () < QApplication::startDragDistance () )
+        {
+          requestPick (event->pos (), true, event->modifiers ());
+        }
     }
 
     void Widget::wheelEvent (QWheelEvent* event)
@@ -370,7 +780,21 @@ namespace HIP {
 
       _database->emitViewChanged (qVariantFromValue (_view_matrix * _camera_matrix));
 
-      update ();
+      invalidate (Change::CAMERA);
+    }
+
+    void Widget::leaveEvent (QEvent* event)
+    {
+      Q_UNUSED (event);
+
+      if (_pins->getHighlighted () >= 0)
+        {
+          _pins->setHighlighted (-1);
+          invalidate (Change::PICK);
+        }
+
+      if (QApplication::mouseButtons () == Qt::NoButton)
+        unsetCursor ();
     }
 
     /*!
@@ -425,9 +849,14 @@ namespace HIP {
         {
           Q_ASSERT (!data.isValid ());
           updateToolBar ();
+          _widget->invalidate (Widget::Change::ALL);
         }
-      else if (reason == Database::Database::Reason::SELECTION)
-        _widget->update ();
+      else if ( reason == Database::Database::Reason::POINT ||
+                reason == Database::Database::Reason::SELECTION ||
+                reason == Database::Database::Reason::PLACEMENT )
+        _widget->invalidate (Widget::Change::PINS);
+      else if (reason == Database::Database::Reason::VIEW)
+        _widget->invalidate (Widget::Change::MODEL);
     }
 
     /*! Update view switching buttons */
@@ -490,8 +919,9 @@ namespace HIP {
       Q_ASSERT (pos != _action_view_map.end ());
 
       _database->setCurrentView (pos.value ());
-      update ();
     }
 
   }
 }
+
+#include "hip_gl_view.moc"
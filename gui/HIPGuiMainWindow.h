@@ -9,6 +9,7 @@
 
 #include <database/HIPDatabase.h>
 
+#include <QFutureWatcher>
 #include <QMainWindow>
 
 class QDragEnterEvent;
@@ -48,11 +49,13 @@ namespace HIP {
 
     private slots:
       void onExportDatabase ();
+      void onExportFinished ();
       void onAbout ();
 
     private:
       Ui::HIP_Gui_MainWindow* _ui;
       Database::Database* _database;
+      QFutureWatcher<QString>* _export_watcher;
     };
 
   } // namespace Gui
@@ -41,8 +41,9 @@ namespace HIP {
     /*! Constructor */
     MainWindow::MainWindow (Database::Database* database, QWidget *parent)
       : QMainWindow (parent),
-      _ui       (new Ui::HIP_Gui_MainWindow),
-      _database (database)
+      _ui             (new Ui::HIP_Gui_MainWindow),
+      _database       (database),
+      _export_watcher (new QFutureWatcher<QString> (this))
     {
       _ui->setupUi (this);
 
@@ -63,6 +64,7 @@ namespace HIP {
       connect (_ui->_action_export_database, SIGNAL (triggered (bool)), SLOT (onExportDatabase ()));
       connect (_ui->_action_exit, SIGNAL (triggered (bool)), qApp, SLOT (quit ()));
       connect (_ui->_action_about, SIGNAL (triggered (bool)), SLOT (onAbout ()));
+      connect (_export_watcher, SIGNAL (finished ()), SLOT (onExportFinished ()));
     }
 
     /*! Destructor */
@@ -90,7 +92,12 @@ namespace HIP {
     }
 
 
-    /*! Export current database into file */
+    /*!
+     * Export current database into file
+     *
+     * The file is written in a background thread from a snapshot of the current
+     * database state.
+     */
     void MainWindow::onExportDatabase ()
     {
       QFileDialog dialog (this);
@@ -103,20 +110,26 @@ namespace HIP {
       if (dialog.exec ())
         {
           Q_ASSERT (dialog.selectedFiles ().size () == 1);
+          Q_ASSERT (_export_watcher->isFinished ());
 
-          QFile file (dialog.selectedFiles ().front ());
-          if (file.open (QIODevice::WriteOnly | QIODevice::Text))
-            {
-              QTextStream out (&file);
-              out << _database->toXML ();
+          _ui->_action_export_database->setEnabled (false);
+          Tools::StatusBar::showMessage (tr ("Exporting database..."));
 
-              file.close ();
-            }
-          else
-            QMessageBox::critical (this, tr ("Cannot save database file"), file.errorString ());
+          _export_watcher->setFuture (_database->saveAsync (dialog.selectedFiles ().front ()));
         }
     }
 
+    /*! Database export thread finished */
+    void MainWindow::onExportFinished ()
+    {
+      _ui->_action_export_database->setEnabled (true);
+      Tools::StatusBar::clearMessage ();
+
+      QString error = _export_watcher->result ();
+      if (!error.isEmpty ())
+        QMessageBox::critical (this, tr ("Cannot save database file"), error);
+    }
+
     /*! Show about dialog */
     void MainWindow::onAbout ()
     {
@@ -160,7 +173,7 @@ namespace HIP {
       {
         QFileInfo info (event->mimeData ()->text ());
         if (info.suffix ().toLower () == "xml")
-          _database->load (Tools::loadResource<QString> (path));
+          _database->loadFile (path);
         else if (info.suffix ().toLower () == "css")
           {
             qDebug () << "Reapply style sheet";
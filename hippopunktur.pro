@@ -10,6 +10,11 @@ QT += concurrent
 
 INCLUDEPATH += $$PWD
 
+# Print loading and rendering statistics / timings to the debug output
+# (memory statistics need psapi on Windows)
+#DEFINES += HIP_PRINT_STATISTICS
+#win32:LIBS += -lpsapi
+
 SOURCES += \
     main.cpp \
     core/hip_exception.cpp \
@@ -18,6 +23,10 @@ SOURCES += \
     core/hip_tools.cpp \
     database/hip_database.cpp \
     database/hip_database_model.cpp \
+    database/hip_database_filter_index.cpp \
+    database/hip_database_text_index.cpp \
+    database/hip_database_snapshot.cpp \
+    database/hip_database_spatial_index.cpp \
     gl/hip_gl_view.cpp \
     gui/hip_gui_main_window.cpp \
     explorer/hip_point_explorer_view.cpp \
@@ -28,7 +37,16 @@ SOURCES += \
     core/hip_xml.cpp \
     gl/hip_gl_pin.cpp \
     gl/hip_gl_renderable.cpp \
-    core/hip_config.cpp
+    core/hip_config.cpp \
+    gl/hip_gl_mesh.cpp \
+    gl/hip_gl_mesh_cache.cpp \
+    gl/hip_gl_mesh_optimizer.cpp \
+    gl/hip_gl_pin_instances.cpp \
+    gl/hip_gl_bounds.cpp \
+    gl/hip_gl_bounding_volume_hierarchy.cpp \
+    gl/hip_gl_pick_buffer.cpp \
+    gl/hip_gl_sparse_matrix.cpp \
+    gl/hip_gl_geodesics.cpp
 
 RESOURCES += \
     hippopunktur.qrc
@@ -45,6 +63,10 @@ HEADERS += \
     core/HIPTools.h \
     database/HIPDatabase.h \
     database/HIPDatabaseModel.h \
+    database/HIPDatabaseFilterIndex.h \
+    database/HIPDatabaseTextIndex.h \
+    database/HIPDatabaseSnapshot.h \
+    database/HIPDatabaseSpatialIndex.h \
     gui/HIPGuiMainWindow.h \
     gl/HIPGLView.h \
     core/HIPVersion.h \
@@ -57,7 +79,16 @@ HEADERS += \
     gl/HIPGLPin.h \
     gl/HIPGLRenderable.h \
     hipconfig.h \
-    core/HIPConfig.h
+    core/HIPConfig.h \
+    gl/HIPGLMesh.h \
+    gl/HIPGLMeshCache.h \
+    gl/HIPGLMeshOptimizer.h \
+    gl/HIPGLPinInstances.h \
+    gl/HIPGLBounds.h \
+    gl/HIPGLBoundingVolumeHierarchy.h \
+    gl/HIPGLPickBuffer.h \
+    gl/HIPGLSparseMatrix.h \
+    gl/HIPGLGeodesics.h
 
 FORMS += \
     explorer/hip_explorer_tagselector.ui \
@@ -72,5 +103,7 @@ DISTFILES += \
     gl/FragmentShader.glsl \
     gl/VertexShader.glsl \
     gl/PinFragmentShader.glsl \
-    gl/PinVertexShader.glsl
+    gl/PinVertexShader.glsl \
+    gl/PinInstancedVertexShader.glsl \
+    gl/PinInstancedFragmentShader.glsl
 
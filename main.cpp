@@ -37,7 +37,7 @@ int main (int argc, char* argv[])
   try
   {
     HIP::Database::Database database;
-    database.load (HIP::Tools::loadResource<QString> (HIP::Config::DATABASE_FILE));
+    database.loadFile (HIP::Config::DATABASE_FILE);
 
     HIP::Gui::MainWindow main_win (&database);
     main_win.resize (800, 600);
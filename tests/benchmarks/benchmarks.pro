@@ -0,0 +1,10 @@
+#
+# benchmarks.pro - Performance benchmarks
+#
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    mesh \
+    database \
+    hierarchy \
+    geodesics
@@ -0,0 +1,393 @@
+/*
+ * bench_database.cpp - Benchmarks of the points database
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPTestModels.h"
+#include "database/HIPDatabase.h"
+#include "database/HIPDatabaseModel.h"
+
+#include <QScopedPointer>
+#include <QSet>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QVector>
+#include <QVector3D>
+#include <QtTest>
+
+using namespace HIP;
+
+/*
+ * Benchmarks of the points database
+ *
+ * The database consists of 100k generated points on the horse model. Views are not
+ * attached, so the benchmarks measure the database and the models only.
+ *
+ * The spatial query benchmarks run 1000 queries around the placed points per
+ * iteration, so the latency of a single query in us is the reported msecs per
+ * iteration. The selection benchmarks use a second database of 50k points with
+ * an attached point model.
+ */
+class DatabaseBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase ();
+
+  void modelData_data ();
+  void modelData ();
+  void pointCopy ();
+  void filter_data ();
+  void filter ();
+  void search_data ();
+  void search ();
+  void findNearest_data ();
+  void findNearest ();
+  void findInRadius_data ();
+  void findInRadius ();
+  void findInBox_data ();
+  void findInBox ();
+  void select_data ();
+  void select ();
+  void deselect_data ();
+  void deselect ();
+
+private:
+  QVector<QVector3D> getQueryPositions () const;
+
+private:
+  static const int NUMBER_OF_QUERIES = 1000;
+
+  QScopedPointer<Database::Database> _database;
+  QScopedPointer<Database::DatabaseModel> _model;
+  QScopedPointer<Database::DatabaseFilterProxyModel> _proxy;
+
+  QScopedPointer<Database::Database> _selection_database;
+  QScopedPointer<Database::DatabaseModel> _selection_model;
+  QSet<QString> _selection_ids;
+};
+
+/* Generate and load the benchmark database */
+void DatabaseBenchmark::initTestCase ()
+{
+  static const int NUMBER_OF_POINTS = 100000;
+  static const int NUMBER_OF_SELECTION_POINTS = 50000;
+
+  QStandardPaths::setTestModeEnabled (true);
+
+  _database.reset (new Database::Database);
+  _database->load (Test::createDatabase (":/assets/models/horse/horse.obj", NUMBER_OF_POINTS));
+
+  QCOMPARE (_database->getPoints ().size (), NUMBER_OF_POINTS);
+  QTRY_VERIFY_WITH_TIMEOUT (_database->isTextIndexReady (), 60000);
+  QTRY_VERIFY_WITH_TIMEOUT (!_database->getPoints ().front ().getSurfaceNormal ().isNull (), 60000);
+
+  _model.reset (new Database::DatabaseModel (_database.data (), 0));
+  _proxy.reset (new Database::DatabaseFilterProxyModel (_database.data (), 0));
+  _proxy->setSourceModel (_model.data ());
+
+  _selection_database.reset (new Database::Database);
+  _selection_database->load (Test::createDatabase (":/assets/models/horse/horse.obj", NUMBER_OF_SELECTION_POINTS));
+
+  QCOMPARE (_selection_database->getPoints ().size (), NUMBER_OF_SELECTION_POINTS);
+  QTRY_VERIFY_WITH_TIMEOUT (_selection_database->isTextIndexReady (), 60000);
+  QTRY_VERIFY_WITH_TIMEOUT (!_selection_database->getPoints ().front ().getSurfaceNormal ().isNull (), 60000);
+
+  _selection_model.reset (new Database::DatabaseModel (_selection_database.data (), 0));
+
+  foreach (const Database::Point& point, _selection_database->getPoints ())
+    _selection_ids.insert (point.getId ());
+}
+
+/* Benchmark data for the model data access benchmark */
+void DatabaseBenchmark::modelData_data ()
+{
+  QTest::addColumn<int> ("role");
+  QTest::addColumn<bool> ("use_proxy");
+
+  QTest::newRow ("id") << int (Database::DatabaseModel::Role::ID) << false;
+  QTest::newRow ("description") << int (Database::DatabaseModel::Role::DESCRIPTION) << false;
+  QTest::newRow ("selected") << int (Database::DatabaseModel::Role::SELECTED) << false;
+  QTest::newRow ("point") << int (Database::DatabaseModel::Role::POINT) << false;
+  QTest::newRow ("point, filter proxy") << int (Database::DatabaseModel::Role::POINT) << true;
+}
+
+/* Read one role of all points through the model */
+void DatabaseBenchmark::modelData ()
+{
+  QFETCH (int, role);
+  QFETCH (bool, use_proxy);
+
+  QAbstractItemModel* model = use_proxy ? static_cast<QAbstractItemModel*> (_proxy.data ()) : _model.data ();
+  QCOMPARE (model->rowCount (QModelIndex ()), _database->getPoints ().size ());
+
+  int valid = 0;
+
+  QBENCHMARK
+    {
+      valid = 0;
+
+      for (int i=0; i < model->rowCount (QModelIndex ()); ++i)
+        if (model->data (model->index (i, 0, QModelIndex ()), role).isValid ())
+          ++valid;
+    }
+
+  QCOMPARE (valid, _database->getPoints ().size ());
+}
+
+/*
+ * Copy all points into variants and back
+ *
+ * This is what each view delegate does with the 'point' role.
+ */
+void DatabaseBenchmark::pointCopy ()
+{
+  const QList<Database::Point>& points = _database->getPoints ();
+  int selected = 0;
+
+  QBENCHMARK
+    {
+      selected = 0;
+
+      foreach (const Database::Point& point, points)
+        if (qVariantFromValue (point).value<Database::Point> ().getSelected ())
+          ++selected;
+    }
+
+  QCOMPARE (selected, 0);
+}
+
+/* Benchmark data for the filter benchmark */
+void DatabaseBenchmark::filter_data ()
+{
+  QTest::addColumn<QString> ("filter");
+
+  QTest::newRow ("tag") << "Leg";
+  QTest::newRow ("id") << "P0012";
+  QTest::newRow ("description") << "colic";
+  QTest::newRow ("no match") << "Xyz";
+}
+
+/*
+ * Type filter text character by character and clear it again
+ *
+ * Each step updates the filter matches of the database and the filter proxy model.
+ */
+void DatabaseBenchmark::filter ()
+{
+  QFETCH (QString, filter);
+
+  QBENCHMARK
+    {
+      for (int i=1; i <= filter.size (); ++i)
+        _database->setFilter (filter.left (i));
+
+      _database->setFilter (QString ());
+    }
+
+  QCOMPARE (_proxy->rowCount (QModelIndex ()), _database->getPoints ().size ());
+}
+
+/* Benchmark data for the full text search benchmark */
+void DatabaseBenchmark::search_data ()
+{
+  QTest::addColumn<QString> ("query");
+
+  QTest::newRow ("single word") << "colic";
+  QTest::newRow ("prefix") << "st";
+  QTest::newRow ("two words") << "pain left";
+  QTest::newRow ("three words") << "chronic pain leg";
+  QTest::newRow ("no match") << "xyz";
+}
+
+/* Latency of a single ranked full text query */
+void DatabaseBenchmark::search ()
+{
+  QFETCH (QString, query);
+
+  QList<Database::TextIndex::Match> matches;
+
+  QBENCHMARK
+    {
+      matches = _database->search (query);
+    }
+
+  QCOMPARE (matches.isEmpty (), query == "xyz");
+}
+
+/* Surface positions of evenly spread points used as query centers */
+QVector<QVector3D> DatabaseBenchmark::getQueryPositions () const
+{
+  const QList<Database::Point>& points = _database->getPoints ();
+
+  QVector<QVector3D> positions;
+  positions.reserve (NUMBER_OF_QUERIES);
+
+  for (int i=0; i < NUMBER_OF_QUERIES; ++i)
+    positions.push_back (points[(i * 7919) % points.size ()].getSurfacePosition ());
+
+  return positions;
+}
+
+/* Benchmark data for the nearest neighbour benchmark */
+void DatabaseBenchmark::findNearest_data ()
+{
+  QTest::addColumn<int> ("count");
+
+  QTest::newRow ("1") << 1;
+  QTest::newRow ("10") << 10;
+  QTest::newRow ("100") << 100;
+}
+
+/* Find the nearest points around the query positions */
+void DatabaseBenchmark::findNearest ()
+{
+  QFETCH (int, count);
+
+  QVector<QVector3D> positions = getQueryPositions ();
+  int found = 0;
+
+  QBENCHMARK
+    {
+      found = 0;
+
+      foreach (const QVector3D& position, positions)
+        found += _database->findNearest (position, count).size ();
+    }
+
+  QCOMPARE (found, NUMBER_OF_QUERIES * count);
+}
+
+/* Benchmark data for the radius query benchmark. The model fits into the unit sphere. */
+void DatabaseBenchmark::findInRadius_data ()
+{
+  QTest::addColumn<float> ("radius");
+
+  QTest::newRow ("0.01") << 0.01f;
+  QTest::newRow ("0.05") << 0.05f;
+  QTest::newRow ("0.2") << 0.2f;
+}
+
+/* Find all points within a distance of the query positions */
+void DatabaseBenchmark::findInRadius ()
+{
+  QFETCH (float, radius);
+
+  QVector<QVector3D> positions = getQueryPositions ();
+  int found = 0;
+
+  QBENCHMARK
+    {
+      found = 0;
+
+      foreach (const QVector3D& position, positions)
+        found += _database->findInRadius (position, radius).size ();
+    }
+
+  QVERIFY (found >= NUMBER_OF_QUERIES);
+}
+
+/* Benchmark data for the box query benchmark */
+void DatabaseBenchmark::findInBox_data ()
+{
+  QTest::addColumn<float> ("size");
+
+  QTest::newRow ("0.02") << 0.02f;
+  QTest::newRow ("0.1") << 0.1f;
+  QTest::newRow ("0.4") << 0.4f;
+}
+
+/* Find all points within boxes centered at the query positions */
+void DatabaseBenchmark::findInBox ()
+{
+  QFETCH (float, size);
+
+  QVector<QVector3D> positions = getQueryPositions ();
+  QVector3D extent (size / 2, size / 2, size / 2);
+  int found = 0;
+
+  QBENCHMARK
+    {
+      found = 0;
+
+      foreach (const QVector3D& position, positions)
+        found += _database->findInBox (position - extent, position + extent).size ();
+    }
+
+  QVERIFY (found >= NUMBER_OF_QUERIES);
+}
+
+/* Benchmark data for the select benchmark */
+void DatabaseBenchmark::select_data ()
+{
+  QTest::addColumn<bool> ("single");
+
+  QTest::newRow ("set") << false;
+  QTest::newRow ("one by one") << true;
+}
+
+/*
+ * Select all points of the unselected database
+ *
+ * The points are selected either with a single call for the whole set or with one
+ * call per point. Another run would find all points selected already, so the
+ * selection is measured once.
+ */
+void DatabaseBenchmark::select ()
+{
+  QFETCH (bool, single);
+
+  _selection_database->clearSelection ();
+
+  QBENCHMARK_ONCE
+    {
+      if (single)
+        {
+          foreach (const QString& id, _selection_ids)
+            _selection_database->select (id);
+        }
+      else
+        _selection_database->select (_selection_ids);
+    }
+
+  foreach (const Database::Point& point, _selection_database->getPoints ())
+    QVERIFY (point.getSelected ());
+}
+
+/* Benchmark data for the deselect benchmark */
+void DatabaseBenchmark::deselect_data ()
+{
+  select_data ();
+}
+
+/*
+ * Deselect all points of the fully selected database
+ *
+ * Counterpart of the select benchmark, measured once, too.
+ */
+void DatabaseBenchmark::deselect ()
+{
+  QFETCH (bool, single);
+
+  _selection_database->select (_selection_ids);
+
+  QBENCHMARK_ONCE
+    {
+      if (single)
+        {
+          foreach (const QString& id, _selection_ids)
+            _selection_database->deselect (id);
+        }
+      else
+        _selection_database->deselect (_selection_ids);
+    }
+
+  foreach (const Database::Point& point, _selection_database->getPoints ())
+    QVERIFY (!point.getSelected ());
+}
+
+QTEST_MAIN (DatabaseBenchmark)
+
+#include "bench_database.moc"
@@ -0,0 +1,10 @@
+#
+# database.pro - Benchmarks of the points database
+#
+TEMPLATE = app
+TARGET = bench_database
+
+include (../../tests.pri)
+
+SOURCES += \
+    bench_database.cpp
@@ -0,0 +1,210 @@
+/*
+ * bench_geodesics.cpp - Benchmarks of the geodesic distances
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPTestModels.h"
+#include "gl/HIPGLData.h"
+#include "gl/HIPGLGeodesics.h"
+#include "gl/HIPGLMesh.h"
+
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace HIP;
+
+Q_DECLARE_METATYPE (HIP::GL::MeshPtr)
+
+namespace {
+
+  /* Surface point at the center of a mesh triangle */
+  GL::SurfacePoint getSurfacePoint (const GL::Mesh& mesh, int triangle)
+  {
+    QVector3D center;
+    for (int i=0; i < 3; ++i)
+      center += mesh.getVertexData ()[mesh.getIndexData ()[triangle * 3 + i]]._vertex;
+
+    return GL::SurfacePoint (triangle, center / 3);
+  }
+
+}
+
+/*
+ * Benchmarks of the geodesic distances
+ *
+ * The models are the bundled horse with about 1.9k triangles and the horse subdivided
+ * three times with about 119k triangles. The query benchmarks run 16 queries from
+ * different sources per iteration, more than the number of cached distance fields, so
+ * each query computes a new field.
+ */
+class GeodesicsBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase ();
+
+  void prepare_data ();
+  void prepare ();
+  void factorize_data ();
+  void factorize ();
+  void distances_data ();
+  void distances ();
+  void path_data ();
+  void path ();
+
+private:
+  void addModels ();
+  QList<GL::SurfacePoint> createSurfacePoints (const GL::Mesh& mesh) const;
+
+private:
+  static const int NUMBER_OF_QUERIES = 16;
+
+  QTemporaryDir _directory;
+  QScopedPointer<GL::Data> _horse;
+  QScopedPointer<GL::Data> _subdivided;
+  GL::MeshPtr _horse_mesh;
+  GL::MeshPtr _subdivided_mesh;
+};
+
+/* Load and generate the benchmark models */
+void GeodesicsBenchmark::initTestCase ()
+{
+  static const char* const HORSE_MODEL = ":/assets/models/horse/horse.obj";
+  static const int SUBDIVISION_LEVELS = 3;
+
+  QVERIFY (_directory.isValid ());
+
+  _horse.reset (new GL::Data (HORSE_MODEL, GL::Data::Loader::PARALLEL, false));
+  _horse_mesh = GL::MeshPtr (new GL::Mesh (_horse.data ()));
+
+  _subdivided.reset (new GL::Data (Test::writeSubdividedModel (_directory.path (), HORSE_MODEL, SUBDIVISION_LEVELS),
+                                   GL::Data::Loader::PARALLEL, false));
+  _subdivided_mesh = GL::MeshPtr (new GL::Mesh (_subdivided.data ()));
+}
+
+/* Add the benchmark models as test data */
+void GeodesicsBenchmark::addModels ()
+{
+  QTest::addColumn<GL::MeshPtr> ("mesh");
+
+  QTest::newRow ("horse") << _horse_mesh;
+  QTest::newRow ("horse, subdivided") << _subdivided_mesh;
+}
+
+/* Query points spread over the mesh triangles */
+QList<GL::SurfacePoint> GeodesicsBenchmark::createSurfacePoints (const GL::Mesh& mesh) const
+{
+  QList<GL::SurfacePoint> points;
+
+  for (int i=0; i < NUMBER_OF_QUERIES; ++i)
+    points.push_back (getSurfacePoint (mesh, (i * 7919) % (mesh.getNumberOfIndices () / 3)));
+
+  return points;
+}
+
+/* Benchmark data for the preparation benchmark */
+void GeodesicsBenchmark::prepare_data ()
+{
+  addModels ();
+}
+
+/* Weld the mesh vertices and build the edge graph */
+void GeodesicsBenchmark::prepare ()
+{
+  QFETCH (GL::MeshPtr, mesh);
+
+  QBENCHMARK
+    {
+      GL::Geodesics geodesics (mesh);
+      Q_UNUSED (geodesics);
+    }
+}
+
+/* Benchmark data for the factorization benchmark */
+void GeodesicsBenchmark::factorize_data ()
+{
+  addModels ();
+}
+
+/*
+ * First heat method query on a new mesh
+ *
+ * Includes the preparation and the factorization of both linear systems, which is
+ * the delay of the first distance query after loading a model.
+ */
+void GeodesicsBenchmark::factorize ()
+{
+  QFETCH (GL::MeshPtr, mesh);
+
+  GL::SurfacePoint source = getSurfacePoint (*mesh, 0);
+
+  QBENCHMARK
+    {
+      GL::Geodesics geodesics (mesh);
+      geodesics.computeDistances (source, GL::Geodesics::Method::HEAT);
+    }
+}
+
+/* Benchmark data for the distance field benchmark */
+void GeodesicsBenchmark::distances_data ()
+{
+  QTest::addColumn<GL::MeshPtr> ("mesh");
+  QTest::addColumn<int> ("method");
+
+  QTest::newRow ("horse, graph") << _horse_mesh << int (GL::Geodesics::Method::GRAPH);
+  QTest::newRow ("horse, heat") << _horse_mesh << int (GL::Geodesics::Method::HEAT);
+  QTest::newRow ("horse subdivided, graph") << _subdivided_mesh << int (GL::Geodesics::Method::GRAPH);
+  QTest::newRow ("horse subdivided, heat") << _subdivided_mesh << int (GL::Geodesics::Method::HEAT);
+}
+
+/* Compute the distance fields of new sources, the factorization is already done */
+void GeodesicsBenchmark::distances ()
+{
+  QFETCH (GL::MeshPtr, mesh);
+  QFETCH (int, method);
+
+  GL::Geodesics geodesics (mesh);
+  QList<GL::SurfacePoint> sources = createSurfacePoints (*mesh);
+
+  geodesics.computeDistances (getSurfacePoint (*mesh, 0), GL::Geodesics::Method_t (method));
+
+  QBENCHMARK
+    {
+      foreach (const GL::SurfacePoint& source, sources)
+        geodesics.computeDistances (source, GL::Geodesics::Method_t (method));
+    }
+}
+
+/* Benchmark data for the shortest path benchmark */
+void GeodesicsBenchmark::path_data ()
+{
+  addModels ();
+}
+
+/* Compute shortest paths between pairs of surface points */
+void GeodesicsBenchmark::path ()
+{
+  QFETCH (GL::MeshPtr, mesh);
+
+  GL::Geodesics geodesics (mesh);
+  QList<GL::SurfacePoint> points = createSurfacePoints (*mesh);
+
+  int length = 0;
+
+  QBENCHMARK
+    {
+      length = 0;
+
+      for (int i=0; i < points.size (); ++i)
+        length += geodesics.computePath (points[i], points[(i + 1) % points.size ()]).size ();
+    }
+
+  QVERIFY (length > 0);
+}
+
+QTEST_MAIN (GeodesicsBenchmark)
+
+#include "bench_geodesics.moc"
@@ -0,0 +1,10 @@
+#
+# geodesics.pro - Benchmarks of the geodesic distances
+#
+TEMPLATE = app
+TARGET = bench_geodesics
+
+include (../../tests.pri)
+
+SOURCES += \
+    bench_geodesics.cpp
@@ -0,0 +1,231 @@
+/*
+ * bench_hierarchy.cpp - Benchmarks of the bounding volume hierarchy
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPTestModels.h"
+#include "gl/HIPGLBoundingVolumeHierarchy.h"
+#include "gl/HIPGLData.h"
+#include "gl/HIPGLMesh.h"
+
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace HIP;
+
+Q_DECLARE_METATYPE (HIP::GL::MeshPtr)
+
+namespace {
+
+  /* Compute bounding box of all mesh groups */
+  void computeBounds (const GL::Mesh& mesh, QVector3D* minimum, QVector3D* maximum)
+  {
+    *minimum = mesh.getGroups ().front ().getBounds ().getMinimum ();
+    *maximum = mesh.getGroups ().front ().getBounds ().getMaximum ();
+
+    foreach (const GL::MeshGroup& group, mesh.getGroups ())
+      {
+        const GL::Bounds& bounds = group.getBounds ();
+
+        *minimum = QVector3D (qMin (minimum->x (), bounds.getMinimum ().x ()),
+                              qMin (minimum->y (), bounds.getMinimum ().y ()),
+                              qMin (minimum->z (), bounds.getMinimum ().z ()));
+        *maximum = QVector3D (qMax (maximum->x (), bounds.getMaximum ().x ()),
+                              qMax (maximum->y (), bounds.getMaximum ().y ()),
+                              qMax (maximum->z (), bounds.getMaximum ().z ()));
+      }
+  }
+
+}
+
+/*
+ * Benchmarks of the bounding volume hierarchy
+ *
+ * The models are the bundled horse and a generated grid of 2M triangles. The
+ * query benchmarks run 100k queries per iteration, so the throughput in queries/s is
+ * 1e8 divided by the reported msecs per iteration.
+ */
+class HierarchyBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase ();
+
+  void build_data ();
+  void build ();
+  void intersect_data ();
+  void intersect ();
+  void findClosest_data ();
+  void findClosest ();
+
+private:
+  void addModels ();
+
+private:
+  static const int NUMBER_OF_QUERIES = 100000;
+
+  QTemporaryDir _directory;
+  QScopedPointer<GL::Data> _horse;
+  QScopedPointer<GL::Data> _grid;
+  GL::MeshPtr _horse_mesh;
+  GL::MeshPtr _grid_mesh;
+};
+
+/* Generate and load the benchmark models */
+void HierarchyBenchmark::initTestCase ()
+{
+  static const int GRID_SIZE = 1000; // 2.000.000 triangles
+
+  QVERIFY (_directory.isValid ());
+
+  _horse.reset (new GL::Data (":/assets/models/horse/horse.obj", GL::Data::Loader::PARALLEL, false));
+  _horse_mesh = GL::MeshPtr (new GL::Mesh (_horse.data ()));
+
+  _grid.reset (new GL::Data (Test::writeGridModel (_directory.path (), GRID_SIZE, false),
+                             GL::Data::Loader::PARALLEL, false));
+  _grid_mesh = GL::MeshPtr (new GL::Mesh (_grid.data ()));
+}
+
+/* Add the benchmark models as test data */
+void HierarchyBenchmark::addModels ()
+{
+  QTest::addColumn<GL::MeshPtr> ("mesh");
+
+  QTest::newRow ("horse") << _horse_mesh;
+  QTest::newRow ("grid") << _grid_mesh;
+}
+
+/* Benchmark data for the build benchmark */
+void HierarchyBenchmark::build_data ()
+{
+  addModels ();
+}
+
+/* Build the hierarchy */
+void HierarchyBenchmark::build ()
+{
+  QFETCH (GL::MeshPtr, mesh);
+
+  QBENCHMARK
+    {
+      GL::BoundingVolumeHierarchy hierarchy (mesh);
+      Q_UNUSED (hierarchy);
+    }
+}
+
+/* Benchmark data for the ray intersection benchmark */
+void HierarchyBenchmark::intersect_data ()
+{
+  addModels ();
+}
+
+/*
+ * Intersect rays from random points around the model towards random points inside of it
+ */
+void HierarchyBenchmark::intersect ()
+{
+  QFETCH (GL::MeshPtr, mesh);
+
+  GL::BoundingVolumeHierarchy hierarchy (mesh);
+
+  QVector3D minimum, maximum;
+  computeBounds (*mesh, &minimum, &maximum);
+
+  QVector3D center = (minimum + maximum) / 2;
+  float radius = (maximum - minimum).length () / 2;
+
+  Test::Random random;
+
+  QVector<GL::Ray> rays;
+  rays.reserve (NUMBER_OF_QUERIES);
+
+  for (int i=0; i < NUMBER_OF_QUERIES; ++i)
+    {
+      QVector3D direction = random.nextVector (QVector3D (-1, -1, -1), QVector3D (1, 1, 1)).normalized ();
+      QVector3D origin = center + direction * radius * 2.0f;
+
+      rays.push_back (GL::Ray (origin, random.nextVector (minimum, maximum) - origin));
+    }
+
+  int hits = 0;
+
+  QBENCHMARK
+    {
+      hits = 0;
+
+      foreach (const GL::Ray& ray, rays)
+        if (hierarchy.intersect (ray, 0))
+          ++hits;
+    }
+
+  QVERIFY (hits > 0);
+}
+
+/* Benchmark data for the closest point benchmark */
+void HierarchyBenchmark::findClosest_data ()
+{
+  QTest::addColumn<GL::MeshPtr> ("mesh");
+  QTest::addColumn<bool> ("batched");
+
+  QTest::newRow ("horse, single") << _horse_mesh << false;
+  QTest::newRow ("horse, batched") << _horse_mesh << true;
+  QTest::newRow ("grid, single") << _grid_mesh << false;
+  QTest::newRow ("grid, batched") << _grid_mesh << true;
+}
+
+/*
+ * Find the closest surface points of random points near the model, as done when
+ * placing the database points onto the model. The batched variant distributes the
+ * queries over all cores.
+ */
+void HierarchyBenchmark::findClosest ()
+{
+  QFETCH (GL::MeshPtr, mesh);
+  QFETCH (bool, batched);
+
+  GL::BoundingVolumeHierarchy hierarchy (mesh);
+
+  QVector3D minimum, maximum;
+  computeBounds (*mesh, &minimum, &maximum);
+
+  QVector3D margin = (maximum - minimum) * 0.1f;
+
+  Test::Random random;
+
+  QVector<QVector3D> points;
+  points.reserve (NUMBER_OF_QUERIES);
+
+  for (int i=0; i < NUMBER_OF_QUERIES; ++i)
+    points.push_back (random.nextVector (minimum - margin, maximum + margin));
+
+  int hits = 0;
+
+  QBENCHMARK
+    {
+      hits = 0;
+
+      if (batched)
+        {
+          foreach (const GL::Hit& hit, hierarchy.findClosest (points))
+            if (hit.isValid ())
+              ++hits;
+        }
+      else
+        {
+          GL::Hit hit;
+
+          foreach (const QVector3D& point, points)
+            if (hierarchy.findClosest (point, &hit))
+              ++hits;
+        }
+    }
+
+  QCOMPARE (hits, NUMBER_OF_QUERIES);
+}
+
+QTEST_MAIN (HierarchyBenchmark)
+
+#include "bench_hierarchy.moc"
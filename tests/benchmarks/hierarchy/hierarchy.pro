@@ -0,0 +1,10 @@
+#
+# hierarchy.pro - Benchmarks of the bounding volume hierarchy
+#
+TEMPLATE = app
+TARGET = bench_hierarchy
+
+include (../../tests.pri)
+
+SOURCES += \
+    bench_hierarchy.cpp
@@ -0,0 +1,175 @@
+/*
+ * bench_mesh.cpp - Benchmarks of the render ready mesh
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPTestModels.h"
+#include "gl/HIPGLData.h"
+#include "gl/HIPGLMesh.h"
+
+#include <QDir>
+#include <QMap>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace HIP;
+
+/*
+ * Benchmarks of the OBJ parsers and the render ready mesh
+ *
+ * The mesh model is a grid of about 1M triangles with split normals, so most grid vertices
+ * occur with several (vertex, normal, texture) triples. The parsers are compared on the
+ * bundled horse and on a grid of about 2.4M triangles.
+ */
+class MeshBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase ();
+
+  void parse_data ();
+  void parse ();
+  void deduplicate_data ();
+  void deduplicate ();
+  void buildBuffers_data ();
+  void buildBuffers ();
+
+private:
+  QTemporaryDir _directory;
+  QScopedPointer<GL::Data> _data;
+  QString _large_model;
+};
+
+/* Generate and load the benchmark model */
+void MeshBenchmark::initTestCase ()
+{
+  static const int GRID_SIZE = 710; // 1.008.200 triangles
+  static const int LARGE_GRID_SIZE = 1100; // 2.420.000 triangles
+
+  QVERIFY (_directory.isValid ());
+
+  QString path = Test::writeGridModel (_directory.path (), GRID_SIZE, true);
+  _data.reset (new GL::Data (path, GL::Data::Loader::PARALLEL, false));
+
+  QString large_directory = _directory.path () + "/large";
+  QVERIFY (QDir ().mkpath (large_directory));
+
+  _large_model = Test::writeGridModel (large_directory, LARGE_GRID_SIZE, true);
+}
+
+/* Benchmark data for the parser benchmark */
+void MeshBenchmark::parse_data ()
+{
+  static const char* const HORSE_MODEL = ":/assets/models/horse/horse.obj";
+
+  QTest::addColumn<QString> ("path");
+  QTest::addColumn<int> ("loader");
+
+  QTest::newRow ("horse, text") << QString (HORSE_MODEL) << int (GL::Data::Loader::TEXT);
+  QTest::newRow ("horse, streaming") << QString (HORSE_MODEL) << int (GL::Data::Loader::STREAMING);
+  QTest::newRow ("horse, parallel") << QString (HORSE_MODEL) << int (GL::Data::Loader::PARALLEL);
+  QTest::newRow ("grid, text") << _large_model << int (GL::Data::Loader::TEXT);
+  QTest::newRow ("grid, streaming") << _large_model << int (GL::Data::Loader::STREAMING);
+  QTest::newRow ("grid, parallel") << _large_model << int (GL::Data::Loader::PARALLEL);
+}
+
+/*
+ * Load the OBJ model without the mesh cache
+ *
+ * Includes reading the file, the normalization and the missing normals, which are the
+ * same for all parsers.
+ */
+void MeshBenchmark::parse ()
+{
+  QFETCH (QString, path);
+  QFETCH (int, loader);
+
+  int number_of_vertices = 0;
+
+  QBENCHMARK
+    {
+      GL::Data data (path, GL::Data::Loader_t (loader), false);
+      number_of_vertices = data.getVertices ().size ();
+    }
+
+  QVERIFY (number_of_vertices > 0);
+}
+
+/* Benchmark data for the deduplication benchmark */
+void MeshBenchmark::deduplicate_data ()
+{
+  QTest::addColumn<bool> ("use_hash");
+
+  QTest::newRow ("QMap") << false;
+  QTest::newRow ("PointIndexMap") << true;
+}
+
+/*
+ * Deduplicate the face points only
+ *
+ * The QMap variant is the previously used ordered map and kept as reference.
+ */
+void MeshBenchmark::deduplicate ()
+{
+  QFETCH (bool, use_hash);
+
+  int number_of_vertices = 0;
+
+  QBENCHMARK
+    {
+      if (use_hash)
+        {
+          GL::PointIndexMap map (_data->getVertices ().size ());
+
+          foreach (const GL::GroupPtr& group, _data->getGroups ())
+            for (int i=0; i < group->getNumberOfTriangles () * 3; ++i)
+              map.insert (group->getPoint (i / 3, i % 3));
+
+          number_of_vertices = map.size ();
+        }
+      else
+        {
+          QMap<GL::Point, int> map;
+
+          foreach (const GL::GroupPtr& group, _data->getGroups ())
+            for (int i=0; i < group->getNumberOfTriangles () * 3; ++i)
+              {
+                GL::Point point = group->getPoint (i / 3, i % 3);
+                if (!map.contains (point))
+                  map.insert (point, map.size ());
+              }
+
+          number_of_vertices = map.size ();
+        }
+    }
+
+  QVERIFY (number_of_vertices > _data->getVertices ().size ());
+}
+
+/* Benchmark data for the buffer construction benchmark */
+void MeshBenchmark::buildBuffers_data ()
+{
+  QTest::addColumn<bool> ("optimize");
+
+  QTest::newRow ("plain") << false;
+  QTest::newRow ("optimized") << true;
+}
+
+/* Build the render ready vertex and index buffers */
+void MeshBenchmark::buildBuffers ()
+{
+  QFETCH (bool, optimize);
+
+  QBENCHMARK
+    {
+      GL::Mesh mesh (_data.data (), optimize);
+      Q_UNUSED (mesh);
+    }
+}
+
+QTEST_MAIN (MeshBenchmark)
+
+#include "bench_mesh.moc"
@@ -0,0 +1,10 @@
+#
+# mesh.pro - Benchmarks of the render ready mesh
+#
+TEMPLATE = app
+TARGET = bench_mesh
+
+include (../../tests.pri)
+
+SOURCES += \
+    bench_mesh.cpp
@@ -0,0 +1,57 @@
+/*
+ * HIPTestModels.h - Generated models and databases for tests and benchmarks
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#ifndef __HIPTestModels_h__
+#define __HIPTestModels_h__
+
+#include <QString>
+#include <QVector3D>
+
+namespace HIP {
+  namespace Test {
+
+    /*!
+     * Deterministic pseudo random number generator
+     *
+     * Generated test data does not depend on the platform's 'qrand ()' implementation
+     * and on the random state of other code.
+     */
+    class Random
+    {
+    public:
+      Random () : _state (1) {}
+
+      int next (int range)
+      {
+        _state = _state * 1103515245u + 12345u;
+        return static_cast<int> ((_state >> 8) % static_cast<quint32> (range));
+      }
+
+      double nextDouble (double minimum, double maximum)
+      {
+        return minimum + (maximum - minimum) * next (1 << 20) / double (1 << 20);
+      }
+
+      QVector3D nextVector (const QVector3D& minimum, const QVector3D& maximum)
+      {
+        return QVector3D (nextDouble (minimum.x (), maximum.x ()),
+                          nextDouble (minimum.y (), maximum.y ()),
+                          nextDouble (minimum.z (), maximum.z ()));
+      }
+
+    private:
+      quint32 _state;
+    };
+
+    QString writeGridModel (const QString& directory, int size, bool split_normals, bool flat=false);
+    QString writeSphereModel (const QString& directory, int subdivisions);
+    QString writeSubdividedModel (const QString& directory, const QString& path, int levels);
+    QString createDatabase (const QString& model, int number_of_points);
+
+  }
+}
+
+#endif
@@ -0,0 +1,379 @@
+/*
+ * hip_test_models.cpp - Generated models and databases for tests and benchmarks
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPTestModels.h"
+#include "gl/HIPGLData.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+#include <QXmlStreamWriter>
+
+namespace HIP {
+  namespace Test {
+
+    //#**********************************************************************
+    // Local definitions
+    //#**********************************************************************
+
+    namespace {
+
+      /* Write model file, returns the path of the written file */
+      QString writeModel (const QString& path, const QByteArray& content)
+      {
+        QFile file (path);
+        if (!file.open (QIODevice::WriteOnly) || file.write (content) != content.size ())
+          qFatal ("Unable to write test model '%s'", qPrintable (path));
+
+        return path;
+      }
+
+      /* Append vector line like 'v x y z' to the model content */
+      void writeVector (QByteArray* content, const char* type, const QVector3D& v)
+      {
+        *content += QByteArray (type) + " " + QByteArray::number (v.x (), 'g', 9) + " " +
+          QByteArray::number (v.y (), 'g', 9) + " " + QByteArray::number (v.z (), 'g', 9) + "\n";
+      }
+
+      /*
+       * Split each triangle into four by inserting the edge midpoints
+       *
+       * Midpoints of shared edges are shared, so the mesh stays connected. The four
+       * triangles replacing a triangle are stored consecutively, so ranges of triangles
+       * keep their order. If 'project' is set, the new vertices are moved onto the unit
+       * sphere.
+       */
+      void subdivide (QVector<QVector3D>* vertices, QVector<int>* triangles, bool project)
+      {
+        QHash<QPair<int, int>, int> midpoints;
+
+        QVector<int> subdivided;
+        subdivided.reserve (triangles->size () * 4);
+
+        for (int i=0; i < triangles->size (); i += 3)
+          {
+            int corners[3] = { (*triangles)[i], (*triangles)[i + 1], (*triangles)[i + 2] };
+            int centers[3];
+
+            for (int j=0; j < 3; ++j)
+              {
+                int v0 = corners[j];
+                int v1 = corners[(j + 1) % 3];
+
+                QPair<int, int> edge = qMakePair (qMin (v0, v1), qMax (v0, v1));
+                QHash<QPair<int, int>, int>::const_iterator pos = midpoints.find (edge);
+
+                if (pos != midpoints.end ())
+                  centers[j] = pos.value ();
+                else
+                  {
+                    QVector3D center = ((*vertices)[v0] + (*vertices)[v1]) / 2;
+
+                    vertices->push_back (project ? center.normalized () : center);
+                    centers[j] = vertices->size () - 1;
+                    midpoints.insert (edge, centers[j]);
+                  }
+              }
+
+            //
+            // Corner triangles first, the center triangle last
+            //
+            int split[12] = { corners[0], centers[0], centers[2],
+                              centers[0], corners[1], centers[1],
+                              centers[2], centers[1], corners[2],
+                              centers[0], centers[1], centers[2] };
+
+            for (int j=0; j < 12; ++j)
+              subdivided.push_back (split[j]);
+          }
+
+        triangles->swap (subdivided);
+      }
+
+    }
+
+
+    //#**********************************************************************
+    // Model generators
+    //#**********************************************************************
+
+    /*!
+     * Write grid shaped OBJ model
+     *
+     * The grid consists of size x size quads in the xy plane with a slight bulge in z,
+     * each split into two triangles. Each grid vertex has its own texture coordinate.
+     * The grid spans [0, 1]^2 in x and y.
+     *
+     * @param directory     Directory the model is written into
+     * @param size          Number of quads per side. The model has 2 * size^2 triangles.
+     * @param split_normals If set, neighbouring quads use different normals, so the grid
+     *                      vertices are part of several (vertex, normal, texture) triples.
+     *                      Otherwise all faces share a single normal.
+     * @param flat          If set, the grid has no bulge, so geodesic distances on the
+     *                      grid are the straight line distances
+     * @return Path of the written model file
+     */
+    QString writeGridModel (const QString& directory, int size, bool split_normals, bool flat)
+    {
+      QByteArray content;
+      content.reserve (size * size * 80);
+
+      content += "o grid\n";
+
+      for (int y=0; y <= size; ++y)
+        for (int x=0; x <= size; ++x)
+          {
+            double u = double (x) / size;
+            double v = double (y) / size;
+
+            content += "v " + QByteArray::number (u) + " " + QByteArray::number (v) + " " +
+              QByteArray::number (flat ? 0.0 : u * (1.0 - u) * v * (1.0 - v)) + "\n";
+            content += "vt " + QByteArray::number (u) + " " + QByteArray::number (v) + "\n";
+          }
+
+      content += "vn 0 0 1\n";
+      content += "vn 0 0.6 0.8\n";
+
+      content += "g grid\n";
+
+      for (int y=0; y < size; ++y)
+        for (int x=0; x < size; ++x)
+          {
+            int v0 = y * (size + 1) + x + 1;
+            int v1 = v0 + 1;
+            int v2 = v0 + size + 1;
+            int v3 = v2 + 1;
+
+            QByteArray n = split_normals && (x + y) % 2 != 0 ? "2" : "1";
+
+            QByteArray p0 = QByteArray::number (v0) + "/" + QByteArray::number (v0) + "/" + n;
+            QByteArray p1 = QByteArray::number (v1) + "/" + QByteArray::number (v1) + "/" + n;
+            QByteArray p2 = QByteArray::number (v2) + "/" + QByteArray::number (v2) + "/" + n;
+            QByteArray p3 = QByteArray::number (v3) + "/" + QByteArray::number (v3) + "/" + n;
+
+            content += "f " + p0 + " " + p1 + " " + p3 + "\n";
+            content += "f " + p0 + " " + p3 + " " + p2 + "\n";
+          }
+
+      return writeModel (directory + "/grid.obj", content);
+    }
+
+    /*!
+     * Write sphere shaped OBJ model
+     *
+     * The sphere is an octahedron whose triangles are subdivided several times, with
+     * the new vertices moved onto the unit sphere. Each vertex has its position as
+     * normal, so the mesh is a closed surface without duplicated vertices.
+     *
+     * @param directory    Directory the model is written into
+     * @param subdivisions Number of subdivision steps. The model has 8 * 4^subdivisions
+     *                     triangles.
+     * @return Path of the written model file
+     */
+    QString writeSphereModel (const QString& directory, int subdivisions)
+    {
+      static const int OCTAHEDRON[] = { 0, 2, 4,  2, 1, 4,  1, 3, 4,  3, 0, 4,
+                                        2, 0, 5,  1, 2, 5,  3, 1, 5,  0, 3, 5 };
+
+      QVector<QVector3D> vertices;
+      vertices << QVector3D (1, 0, 0) << QVector3D (-1, 0, 0)
+               << QVector3D (0, 1, 0) << QVector3D (0, -1, 0)
+               << QVector3D (0, 0, 1) << QVector3D (0, 0, -1);
+
+      QVector<int> triangles;
+      for (int i=0; i < int (sizeof (OCTAHEDRON) / sizeof (OCTAHEDRON[0])); ++i)
+        triangles.push_back (OCTAHEDRON[i]);
+
+      for (int i=0; i < subdivisions; ++i)
+        subdivide (&vertices, &triangles, true);
+
+      QByteArray content;
+      content.reserve (vertices.size () * 80 + triangles.size () * 12);
+
+      content += "o sphere\n";
+
+      foreach (const QVector3D& vertex, vertices)
+        {
+          writeVector (&content, "v", vertex);
+          writeVector (&content, "vn", vertex);
+        }
+
+      content += "g sphere\n";
+
+      for (int i=0; i < triangles.size (); i += 3)
+        {
+          QByteArray p0 = QByteArray::number (triangles[i] + 1);
+          QByteArray p1 = QByteArray::number (triangles[i + 1] + 1);
+          QByteArray p2 = QByteArray::number (triangles[i + 2] + 1);
+
+          content += "f " + p0 + "//" + p0 + " " + p1 + "//" + p1 + " " + p2 + "//" + p2 + "\n";
+        }
+
+      return writeModel (directory + "/sphere.obj", content);
+    }
+
+    /*!
+     * Write subdivided copy of an OBJ model
+     *
+     * In each step, every triangle is split into four by its edge midpoints, so the
+     * surface keeps its shape while the number of triangles grows. The groups are kept,
+     * normals, texture coordinates and materials are dropped. The vertices are written
+     * in the model coordinates of the loaded source model.
+     *
+     * @param directory Directory the model is written into
+     * @param path      Path of the source OBJ model
+     * @param levels    Number of subdivision steps. The model has 4^levels times the
+     *                  triangles of the source model.
+     * @return Path of the written model file
+     */
+    QString writeSubdividedModel (const QString& directory, const QString& path, int levels)
+    {
+      GL::Data data (path, GL::Data::Loader::PARALLEL, false);
+
+      QVector<QVector3D> vertices = data.getVertices ();
+      QVector<int> triangles;
+
+      foreach (const GL::GroupPtr& group, data.getGroups ())
+        triangles += group->getVertexIndices ();
+
+      for (int i=0; i < levels; ++i)
+        subdivide (&vertices, &triangles, false);
+
+      QByteArray content;
+      content.reserve (vertices.size () * 40 + triangles.size () * 8);
+
+      content += "o subdivided\n";
+
+      foreach (const QVector3D& vertex, vertices)
+        writeVector (&content, "v", vertex);
+
+      int index = 0;
+
+      foreach (const GL::GroupPtr& group, data.getGroups ())
+        {
+          if (!group->getName ().isEmpty ())
+            content += "g " + group->getName ().toUtf8 () + "\n";
+
+          for (int i=0; i < group->getNumberOfTriangles () << (2 * levels); ++i, index += 3)
+            content += "f " + QByteArray::number (triangles[index] + 1) + " " +
+              QByteArray::number (triangles[index + 1] + 1) + " " +
+              QByteArray::number (triangles[index + 2] + 1) + "\n";
+        }
+
+      return writeModel (directory + "/subdivided.obj", content);
+    }
+
+
+    //#**********************************************************************
+    // Database generators
+    //#**********************************************************************
+
+    /*!
+     * Create XML database with generated points
+     *
+     * The points carry one to three tags out of a small tag set and descriptions built
+     * from a fixed vocabulary, including non ASCII characters. The point positions are
+     * spread over the cube [-1, 1]^3. The same parameters always result in the same
+     * database.
+     *
+     * @param model            Model file name of the database
+     * @param number_of_points Number of points to generate
+     * @return XML text of the database
+     */
+    QString createDatabase (const QString& model, int number_of_points)
+    {
+      static const char* const TAGS[] = {
+        "Head", "Snout", "Ear", "Eye", "Neck", "Back", "Chest", "Belly",
+        "Leg", "Hoof", "Tail", "Lung", "Heart", "Liver", "Stomach", "Skin"
+      };
+
+      static const char* const WORDS[] = {
+        "pain", "left", "right", "ear", "eye", "neck", "back", "leg", "hoof", "tail",
+        "cough", "fever", "colic", "lameness", "stiffness", "weakness", "swelling",
+        "digestion", "circulation", "breathing", "calming", "healing", "point", "meridian",
+        "nervus", "muscle", "tendon", "joint", "\xc3\x96" "dem", "Schmerz", "R\xc3\xbc" "cken",
+        "acute", "chronic", "general", "local", "upper", "lower", "inner", "outer"
+      };
+
+      static const char* const COLORS[] = {
+        "#0000ff", "#00ff00", "#ff0000", "#ffff00", "#00ffff", "#ff00ff"
+      };
+
+      static const int NUMBER_OF_TAGS = sizeof (TAGS) / sizeof (TAGS[0]);
+      static const int NUMBER_OF_WORDS = sizeof (WORDS) / sizeof (WORDS[0]);
+      static const int NUMBER_OF_COLORS = sizeof (COLORS) / sizeof (COLORS[0]);
+
+      Random random;
+
+      QString text;
+      QXmlStreamWriter out (&text);
+      out.setAutoFormatting (true);
+
+      out.writeStartDocument ();
+      out.writeStartElement ("database");
+      out.writeAttribute ("version", "0.2");
+      out.writeAttribute ("name", "Generated");
+
+      out.writeStartElement ("model");
+      out.writeTextElement ("file", model);
+      out.writeEndElement ();
+
+      out.writeStartElement ("views");
+      out.writeStartElement ("view");
+      out.writeAttribute ("name", "All");
+      out.writeTextElement ("group", "grid");
+      out.writeEndElement ();
+      out.writeEndElement ();
+
+      out.writeStartElement ("points");
+
+      for (int i=0; i < number_of_points; ++i)
+        {
+          out.writeStartElement ("point");
+          out.writeAttribute ("id", QString ("P%1").arg (i, 6, 10, QChar ('0')));
+
+          out.writeStartElement ("tags");
+
+          int first_tag = random.next (NUMBER_OF_TAGS);
+          int number_of_tags = 1 + random.next (3);
+
+          for (int j=0; j < number_of_tags; ++j)
+            {
+              out.writeStartElement ("tag");
+              out.writeAttribute ("name", TAGS[(first_tag + j * 5) % NUMBER_OF_TAGS]);
+              out.writeEndElement ();
+            }
+
+          out.writeEndElement ();
+
+          out.writeStartElement ("position");
+          out.writeAttribute ("x", QString::number (random.nextDouble (-1.0, 1.0)));
+          out.writeAttribute ("y", QString::number (random.nextDouble (-1.0, 1.0)));
+          out.writeAttribute ("z", QString::number (random.nextDouble (-1.0, 1.0)));
+          out.writeEndElement ();
+
+          QStringList description;
+          for (int j=4 + random.next (7); j > 0; --j)
+            description.push_back (QString::fromUtf8 (WORDS[random.next (NUMBER_OF_WORDS)]));
+
+          out.writeTextElement ("description", description.join (' '));
+          out.writeTextElement ("color", COLORS[i % NUMBER_OF_COLORS]);
+
+          out.writeEndElement ();
+        }
+
+      out.writeEndElement ();
+      out.writeEndElement ();
+      out.writeEndDocument ();
+
+      return text;
+    }
+
+  }
+}
@@ -0,0 +1,12 @@
+#
+# database.pro - Unit tests of the points database
+#
+TEMPLATE = app
+TARGET = tst_database
+
+CONFIG += testcase
+
+include (../tests.pri)
+
+SOURCES += \
+    tst_database.cpp
@@ -0,0 +1,366 @@
+/*
+ * tst_database.cpp - Unit tests of the points database
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPTestModels.h"
+#include "database/HIPDatabase.h"
+#include "database/HIPDatabaseModel.h"
+#include "database/HIPDatabaseSnapshot.h"
+#include "gl/HIPGLData.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QSharedPointer>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace HIP;
+
+namespace {
+
+  /* Bundled database used as test input */
+  const char* const HORSE_DATABASE = ":/assets/models/horse/horse.xml";
+
+  /* Bundled model used by the generated databases */
+  const char* const HORSE_MODEL = ":/assets/models/horse/horse.obj";
+
+  /* Read bundled database */
+  QString readDatabase (const QString& path)
+  {
+    QFile file (path);
+    if (!file.open (QIODevice::ReadOnly))
+      qFatal ("Unable to read test database '%s'", qPrintable (path));
+
+    return QString::fromUtf8 (file.readAll ());
+  }
+
+  /* Snapshot key for the given database source */
+  QByteArray computeKey (const QString& xml)
+  {
+    return QCryptographicHash::hash (xml.toUtf8 (), QCryptographicHash::Md5);
+  }
+
+}
+
+/*
+ * Unit tests of the points database
+ */
+class DatabaseTest : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase ();
+
+  void snapshotRoundTrip_data ();
+  void snapshotRoundTrip ();
+  void snapshotKey ();
+  void filterProxy_data ();
+  void filterProxy ();
+  void setPoint ();
+  void surfacePlacement ();
+  void surfaceDistance ();
+
+private:
+  QTemporaryDir _directory;
+};
+
+/*
+ * Prepare test case
+ *
+ * The test mode keeps the model caches written while loading out of the user's cache.
+ */
+void DatabaseTest::initTestCase ()
+{
+  QStandardPaths::setTestModeEnabled (true);
+  QVERIFY (_directory.isValid ());
+}
+
+/* Test data for the snapshot round trip test */
+void DatabaseTest::snapshotRoundTrip_data ()
+{
+  QTest::addColumn<QString> ("xml");
+
+  QTest::newRow ("horse") << readDatabase (HORSE_DATABASE);
+  QTest::newRow ("generated") << Test::createDatabase (HORSE_MODEL, 1000);
+}
+
+/*
+ * Test that storing and loading a snapshot keeps the database content
+ *
+ * The XML export of the database loaded from the snapshot must be identical to the
+ * export of the database loaded from XML. The snapshot is closed before the export,
+ * so the points must not reference the mapped file anymore. Both the snapshot and the
+ * XML export must keep the model file, so they can be loaded again.
+ */
+void DatabaseTest::snapshotRoundTrip ()
+{
+  QFETCH (QString, xml);
+
+  Database::Database database;
+  database.load (xml);
+
+  QCOMPARE (database.getModelFile (), QString (HORSE_MODEL));
+
+  QString path = _directory.path () + "/round_trip.db";
+  QByteArray key = computeKey (xml);
+
+  QVERIFY (Database::Snapshot::save (path, key, database));
+
+  QSharedPointer<Database::Snapshot> snapshot (new Database::Snapshot);
+  QVERIFY (snapshot->load (path, key));
+
+  QCOMPARE (snapshot->getName (), database.getName ());
+  QCOMPARE (snapshot->getModelName (), database.getModelFile ());
+  QCOMPARE (snapshot->getNumberOfPoints (), database.getPoints ().size ());
+  QCOMPARE (snapshot->getNumberOfTags (), database.getTags ().size ());
+
+  //
+  // Tag index
+  //
+  for (int i=0; i < snapshot->getNumberOfTags (); ++i)
+    {
+      QString tag = snapshot->getTag (i);
+      QCOMPARE (tag, database.getTags ()[i]);
+
+      QList<int> rows;
+      for (int j=0; j < database.getPoints ().size (); ++j)
+        if (database.getPoints ()[j].getTags ().contains (tag))
+          rows.push_back (j);
+
+      QCOMPARE (snapshot->getTagRows (i), rows);
+    }
+
+  Database::Database loaded;
+  loaded.load (snapshot);
+
+  snapshot.clear ();
+
+  QCOMPARE (loaded.getModelFile (), database.getModelFile ());
+  QCOMPARE (loaded.getViews ().size (), database.getViews ().size ());
+  QCOMPARE (loaded.toXML (), database.toXML ());
+
+  Database::Database reloaded;
+  reloaded.load (database.toXML ());
+
+  QCOMPARE (reloaded.getModelFile (), database.getModelFile ());
+  QCOMPARE (reloaded.toXML (), database.toXML ());
+}
+
+/* Test that snapshots stored with a different key are rejected */
+void DatabaseTest::snapshotKey ()
+{
+  QString xml = Test::createDatabase (HORSE_MODEL, 10);
+
+  Database::Database database;
+  database.load (xml);
+
+  QString path = _directory.path () + "/key.db";
+  QVERIFY (Database::Snapshot::save (path, computeKey (xml), database));
+
+  Database::Snapshot snapshot;
+  QVERIFY (!snapshot.load (path, computeKey (xml + " ")));
+}
+
+/* Test data for the filter proxy test */
+void DatabaseTest::filterProxy_data ()
+{
+  QTest::addColumn<QStringList> ("filters");
+
+  QTest::newRow ("typing") << (QStringList () << "L" << "Le" << "Leg" << "Le" << "L" << "");
+  QTest::newRow ("description") << (QStringList () << "c" << "co" << "colic" << "colic p" << "");
+  QTest::newRow ("extended, but widened") << (QStringList () << " " << " e" << " ea" << "");
+}
+
+/*
+ * Test that the filter proxy model follows the filter matches
+ *
+ * A longer filter text can add description matches, so the proxy model must not
+ * assume that the matches shrink whenever the filter text has been extended.
+ */
+void DatabaseTest::filterProxy ()
+{
+  QFETCH (QStringList, filters);
+
+  Database::Database database;
+  database.load (Test::createDatabase (HORSE_MODEL, 1000));
+
+  QTRY_VERIFY_WITH_TIMEOUT (database.isTextIndexReady (), 30000);
+
+  Database::DatabaseModel model (&database, 0);
+  Database::DatabaseFilterProxyModel proxy (&database, 0);
+  proxy.setSourceModel (&model);
+
+  foreach (const QString& filter, filters)
+    {
+      QBitArray previous = database.getFilterMatches ();
+
+      database.setFilter (filter);
+
+      const QBitArray& matches = database.getFilterMatches ();
+      QCOMPARE (database.isFilterNarrowed (), (matches & ~previous).count (true) == 0);
+
+      QCOMPARE (proxy.rowCount (QModelIndex ()), matches.count (true));
+
+      for (int i=0; i < proxy.rowCount (QModelIndex ()); ++i)
+        {
+          int row = proxy.mapToSource (proxy.index (i, 0, QModelIndex ())).row ();
+          QVERIFY (matches.testBit (row));
+        }
+    }
+}
+
+/*
+ * Test that changing single points keeps the indices in sync
+ *
+ * The points are renamed, so they move to other rows, and get tags which are new to the
+ * database or remove the last use of a tag. After each change, the patched filter index
+ * must match an index built from scratch.
+ */
+void DatabaseTest::setPoint ()
+{
+  Database::Database database;
+  database.load (Test::createDatabase (HORSE_MODEL, 200));
+  database.setFilter ("b");
+
+  QStringList filters;
+  filters << "" << "p" << "p0001" << "b" << "ba" << "new" << "z" << "a";
+
+  for (int i=0; i < 50; ++i)
+    {
+      Database::Point old_point = database.getPoints ()[(i * 37) % database.getPoints ().size ()];
+
+      Database::Point point = old_point;
+      point.setId (i % 3 == 0 ? QString ("A%1").arg (i) : QString ("P%1").arg ((i * 7919) % 100000, 6, 10, QChar ('0')));
+
+      if (database.findIndex (point.getId ()) >= 0)
+        point.setId (old_point.getId ());
+
+      QList<QString> tags = point.getTags ();
+      if (i % 2 == 0)
+        tags.push_back (QString ("New %1").arg (i));
+      else
+        tags.clear ();
+
+      point.setTags (tags);
+
+      database.setPoint (old_point.getId (), point);
+
+      QCOMPARE (database.getPoints ()[database.findIndex (point.getId ())].getTags (), tags);
+
+      Database::FilterIndex index;
+      index.build (database.getPoints ());
+
+      QCOMPARE (database.getTags (), index.getTags ());
+
+      foreach (const QString& filter, filters)
+        QCOMPARE (database.getFilterIndex ().match (filter), index.match (filter));
+
+      QCOMPARE (database.getFilterMatches (), database.match (database.getFilter ()));
+    }
+}
+
+/*
+ * Test placing the points onto the model surface
+ *
+ * The points are placed when the bounding volume hierarchy of the model has been built
+ * in the background. The stored positions are kept, the surface positions are the closest
+ * surface points of the positions mapped into model coordinates. A moved point is placed
+ * again right away. The placement must not reset the point models, which would drop the
+ * selection and the scroll position of the views.
+ */
+void DatabaseTest::surfacePlacement ()
+{
+  Database::Database database;
+  database.load (readDatabase (HORSE_DATABASE));
+
+  Database::DatabaseModel database_model (&database, 0);
+  QSignalSpy reset_spy (&database_model, SIGNAL (modelReset ()));
+
+  QString xml = database.toXML ();
+
+  QTRY_VERIFY_WITH_TIMEOUT (!database.getPoints ().front ().getSurfaceNormal ().isNull (), 60000);
+  QCOMPARE (reset_spy.count (), 0);
+
+  const GL::Data* model = database.getModel ();
+  const GL::BoundingVolumeHierarchy* hierarchy = model->getHierarchy ();
+  QVERIFY (hierarchy != 0);
+
+  QCOMPARE (database.toXML (), xml);
+
+  foreach (const Database::Point& point, database.getPoints ())
+    {
+      GL::Hit hit;
+      QVERIFY (hierarchy->findClosest (model->getTransform ().map (point.getPosition ()), &hit));
+      QCOMPARE (point.getSurfacePosition (), hit.getPosition ());
+      QCOMPARE (point.getSurfaceNormal (), hit.getNormal ());
+
+      QList<Database::SpatialIndex::Match> nearest = database.findNearest (point.getSurfacePosition (), 1);
+      QCOMPARE (nearest.size (), 1);
+      QCOMPARE (nearest.front ().second, 0.0f);
+    }
+
+  Database::Point point = database.getPoints ().front ();
+  point.setPosition (point.getPosition () * 0.5f);
+
+  database.setPoint (point);
+
+  const Database::Point& moved = database.getPoint (point.getId ());
+
+  GL::Hit hit;
+  QVERIFY (hierarchy->findClosest (model->getTransform ().map (point.getPosition ()), &hit));
+  QCOMPARE (moved.getPosition (), point.getPosition ());
+  QCOMPARE (moved.getSurfacePosition (), hit.getPosition ());
+}
+
+/*
+ * Test distances and paths along the model surface
+ *
+ * The geodesic distance engine is prepared in the background after the points have been
+ * placed. Until then, the queries return at once without a result. Afterwards, each path
+ * runs from the surface position of the source to the surface position of the target.
+ */
+void DatabaseTest::surfaceDistance ()
+{
+  Database::Database database;
+  database.load (readDatabase (HORSE_DATABASE));
+
+  const QList<Database::Point>& points = database.getPoints ();
+  QVERIFY (points.size () > 1);
+
+  const QString& from = points.front ().getId ();
+
+  QVERIFY (!database.isGeodesicsReady ());
+  QVERIFY (qIsInf (database.computeSurfaceDistance (from, points.back ().getId ())));
+  QVERIFY (database.computeSurfacePath (from, points.back ().getId ()).isEmpty ());
+
+  QTRY_VERIFY_WITH_TIMEOUT (database.isGeodesicsReady (), 60000);
+
+  int connected = 0;
+
+  for (int i=1; i < points.size (); ++i)
+    {
+      float distance = database.computeSurfaceDistance (from, points[i].getId ());
+      QVector<QVector3D> path = database.computeSurfacePath (from, points[i].getId ());
+
+      if (qIsInf (distance) || path.isEmpty ())
+        continue;
+
+      QVERIFY (distance >= 0.0f);
+      QVERIFY (path.size () >= 2);
+      QVERIFY ((path.front () - points.front ().getSurfacePosition ()).length () < 1e-5f);
+      QVERIFY ((path.back () - points[i].getSurfacePosition ()).length () < 1e-5f);
+
+      ++connected;
+    }
+
+  QVERIFY (connected > 0);
+}
+
+QTEST_MAIN (DatabaseTest)
+
+#include "tst_database.moc"
@@ -0,0 +1,12 @@
+#
+# geodesics.pro - Unit tests of the geodesic distances
+#
+TEMPLATE = app
+TARGET = tst_geodesics
+
+CONFIG += testcase
+
+include (../tests.pri)
+
+SOURCES += \
+    tst_geodesics.cpp
@@ -0,0 +1,202 @@
+/*
+ * tst_geodesics.cpp - Unit tests of the geodesic distances
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPTestModels.h"
+#include "gl/HIPGLData.h"
+#include "gl/HIPGLGeodesics.h"
+#include "gl/HIPGLMesh.h"
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <cmath>
+
+using namespace HIP;
+
+namespace {
+
+  /* Return corner of a mesh triangle */
+  const QVector3D& getCorner (const GL::Mesh& mesh, int triangle, int corner)
+  {
+    return mesh.getVertexData ()[mesh.getIndexData ()[triangle * 3 + corner]]._vertex;
+  }
+
+  /* Exact geodesic distance on the plane or on the sphere around the origin */
+  float computeExactDistance (const QVector3D& p0, const QVector3D& p1, bool sphere)
+  {
+    if (!sphere)
+      return (p1 - p0).length ();
+
+    float radius = p0.length ();
+    float angle = QVector3D::dotProduct (p0.normalized (), p1.normalized ());
+
+    return radius * std::acos (qBound (-1.0f, angle, 1.0f));
+  }
+
+}
+
+/*
+ * Unit tests of the geodesic distances
+ */
+class GeodesicsTest : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase ();
+
+  void accuracy_data ();
+  void accuracy ();
+  void path_data ();
+  void path ();
+
+private:
+  void addModels ();
+
+private:
+  QTemporaryDir _directory;
+};
+
+/* Prepare test case */
+void GeodesicsTest::initTestCase ()
+{
+  QVERIFY (_directory.isValid ());
+}
+
+/* Add the test models as test data */
+void GeodesicsTest::addModels ()
+{
+  QTest::addColumn<QString> ("path");
+  QTest::addColumn<bool> ("sphere");
+
+  QTest::newRow ("grid") << Test::writeGridModel (_directory.path (), 60, false, true) << false;
+  QTest::newRow ("sphere") << Test::writeSphereModel (_directory.path (), 6) << true;
+}
+
+/* Test data for the accuracy test */
+void GeodesicsTest::accuracy_data ()
+{
+  addModels ();
+}
+
+/*
+ * Test the distances against the exact distances on the plane and on the sphere
+ *
+ * The graph distances follow the mesh edges and are too long by a few percent, the
+ * heat method has to be considerably closer. A repeated query must be answered with
+ * the same distances.
+ */
+void GeodesicsTest::accuracy ()
+{
+  QFETCH (QString, path);
+  QFETCH (bool, sphere);
+
+  static const int NUMBER_OF_TARGETS = 2000;
+
+  GL::Data data (path, GL::Data::Loader::STREAMING, false);
+  GL::MeshPtr mesh (new GL::Mesh (&data));
+
+  GL::Geodesics geodesics (mesh);
+  GL::SurfacePoint source (0, getCorner (*mesh, 0, 0));
+
+  int number_of_triangles = mesh->getNumberOfIndices () / 3;
+  int step = qMax (1, number_of_triangles / NUMBER_OF_TARGETS);
+
+  double graph_error = 0.0;
+  double heat_error = 0.0;
+  int count = 0;
+
+  for (int i=0; i < number_of_triangles; i += step)
+    {
+      GL::SurfacePoint target (i, getCorner (*mesh, i, 0));
+
+      float exact = computeExactDistance (source.getPosition (), target.getPosition (), sphere);
+      if (exact < 1e-6f)
+        continue;
+
+      float graph = geodesics.computeDistance (source, target, GL::Geodesics::Method::GRAPH);
+      float heat = geodesics.computeDistance (source, target, GL::Geodesics::Method::HEAT);
+
+      QVERIFY (graph >= exact * 0.999f);
+
+      graph_error += qAbs (graph - exact) / exact;
+      heat_error += qAbs (heat - exact) / exact;
+      ++count;
+    }
+
+  QVERIFY (count > NUMBER_OF_TARGETS / 2);
+
+  graph_error /= count;
+  heat_error /= count;
+
+  QVERIFY2 (graph_error < 0.15, qPrintable (QString ("Mean graph error %1").arg (graph_error)));
+  QVERIFY2 (heat_error < 0.03, qPrintable (QString ("Mean heat error %1").arg (heat_error)));
+  QVERIFY (heat_error < graph_error);
+
+  QCOMPARE (geodesics.computeDistances (source, GL::Geodesics::Method::HEAT),
+            geodesics.computeDistances (source, GL::Geodesics::Method::HEAT));
+}
+
+/* Test data for the shortest path test */
+void GeodesicsTest::path_data ()
+{
+  addModels ();
+}
+
+/*
+ * Test shortest paths between triangle corners
+ *
+ * The path runs along the mesh edges from the source to the target, so its length is
+ * the graph distance and not shorter than the exact distance. Points within a single
+ * triangle are connected directly and are not tested here.
+ */
+void GeodesicsTest::path ()
+{
+  QFETCH (QString, path);
+  QFETCH (bool, sphere);
+
+  static const int NUMBER_OF_PATHS = 20;
+
+  GL::Data data (path, GL::Data::Loader::STREAMING, false);
+  GL::MeshPtr mesh (new GL::Mesh (&data));
+
+  GL::Geodesics geodesics (mesh);
+
+  int number_of_triangles = mesh->getNumberOfIndices () / 3;
+  Test::Random random;
+
+  for (int i=0; i < NUMBER_OF_PATHS; ++i)
+    {
+      int source_triangle = random.next (number_of_triangles);
+      int target_triangle = random.next (number_of_triangles);
+
+      if (source_triangle == target_triangle)
+        continue;
+
+      GL::SurfacePoint source (source_triangle, getCorner (*mesh, source_triangle, 0));
+      GL::SurfacePoint target (target_triangle, getCorner (*mesh, target_triangle, 0));
+
+      QVector<QVector3D> points = geodesics.computePath (source, target);
+      QVERIFY (points.size () >= 2);
+
+      QVERIFY ((points.front () - source.getPosition ()).length () < 1e-5f);
+      QVERIFY ((points.back () - target.getPosition ()).length () < 1e-5f);
+
+      float length = 0.0f;
+      for (int j=1; j < points.size (); ++j)
+        length += (points[j] - points[j - 1]).length ();
+
+      float graph = geodesics.computeDistance (source, target, GL::Geodesics::Method::GRAPH);
+      float exact = computeExactDistance (source.getPosition (), target.getPosition (), sphere);
+
+      QVERIFY (qAbs (length - graph) <= 1e-3f * qMax (graph, 1.0f));
+      QVERIFY (length >= exact * 0.999f);
+    }
+}
+
+QTEST_MAIN (GeodesicsTest)
+
+#include "tst_geodesics.moc"
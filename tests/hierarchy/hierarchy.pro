@@ -0,0 +1,12 @@
+#
+# hierarchy.pro - Unit tests of the bounding volume hierarchy
+#
+TEMPLATE = app
+TARGET = tst_hierarchy
+
+CONFIG += testcase
+
+include (../tests.pri)
+
+SOURCES += \
+    tst_hierarchy.cpp
@@ -0,0 +1,264 @@
+/*
+ * tst_hierarchy.cpp - Unit tests of the bounding volume hierarchy
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPTestModels.h"
+#include "gl/HIPGLBoundingVolumeHierarchy.h"
+#include "gl/HIPGLData.h"
+#include "gl/HIPGLMesh.h"
+
+#include <QBitArray>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <limits>
+
+using namespace HIP;
+
+namespace {
+
+  /* Ray from a random point around the model towards a random point inside of it */
+  GL::Ray createRay (Test::Random& random, const GL::Data::Cube& box)
+  {
+    QVector3D center = (box.first + box.second) / 2;
+    float radius = (box.second - box.first).length () / 2;
+
+    QVector3D direction = random.nextVector (QVector3D (-1, -1, -1), QVector3D (1, 1, 1)).normalized ();
+    QVector3D origin = center + direction * radius * 2.0f;
+
+    return GL::Ray (origin, random.nextVector (box.first, box.second) - origin);
+  }
+
+  /* Return corner of a mesh triangle */
+  const QVector3D& getCorner (const GL::Mesh& mesh, int triangle, int corner)
+  {
+    return mesh.getVertexData ()[mesh.getIndexData ()[triangle * 3 + corner]]._vertex;
+  }
+
+  /* Reference ray intersection testing all triangles of the mesh */
+  bool intersectAll (const GL::Mesh& mesh, const GL::Ray& ray, float* distance)
+  {
+    bool found = false;
+
+    for (int i=0; i < mesh.getNumberOfIndices () / 3; ++i)
+      {
+        QVector3D p0 = getCorner (mesh, i, 0);
+        QVector3D e1 = getCorner (mesh, i, 1) - p0;
+        QVector3D e2 = getCorner (mesh, i, 2) - p0;
+
+        QVector3D p = QVector3D::crossProduct (ray.getDirection (), e2);
+        float det = QVector3D::dotProduct (e1, p);
+
+        if (det != 0.0f)
+          {
+            QVector3D s = ray.getOrigin () - p0;
+            QVector3D q = QVector3D::crossProduct (s, e1);
+
+            float u = QVector3D::dotProduct (s, p) / det;
+            float v = QVector3D::dotProduct (ray.getDirection (), q) / det;
+            float t = QVector3D::dotProduct (e2, q) / det;
+
+            if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && (!found || t < *distance))
+              {
+                *distance = t;
+                found = true;
+              }
+          }
+      }
+
+    return found;
+  }
+
+  /* Closest point on a line segment */
+  QVector3D getClosestOnSegment (const QVector3D& a, const QVector3D& b, const QVector3D& point)
+  {
+    QVector3D ab = b - a;
+    float length = QVector3D::dotProduct (ab, ab);
+    float t = length > 0.0f ? qBound (0.0f, QVector3D::dotProduct (point - a, ab) / length, 1.0f) : 0.0f;
+
+    return a + ab * t;
+  }
+
+  /*
+   * Reference closest point query testing all triangles of the mesh
+   *
+   * The closest point of a triangle is either the projection onto its plane, if that is
+   * inside of the triangle, or the closest point of one of its edges.
+   *
+   * @return Distance of the closest surface point
+   */
+  float findClosestAll (const GL::Mesh& mesh, const QVector3D& point)
+  {
+    float closest = std::numeric_limits<float>::max ();
+
+    for (int i=0; i < mesh.getNumberOfIndices () / 3; ++i)
+      {
+        QVector3D p0 = getCorner (mesh, i, 0);
+        QVector3D p1 = getCorner (mesh, i, 1);
+        QVector3D p2 = getCorner (mesh, i, 2);
+
+        closest = qMin (closest, (getClosestOnSegment (p0, p1, point) - point).length ());
+        closest = qMin (closest, (getClosestOnSegment (p1, p2, point) - point).length ());
+        closest = qMin (closest, (getClosestOnSegment (p2, p0, point) - point).length ());
+
+        QVector3D normal = QVector3D::crossProduct (p1 - p0, p2 - p0);
+
+        if (!normal.isNull ())
+          {
+            QVector3D projected = point - normal * QVector3D::dotProduct (point - p0, normal) / normal.lengthSquared ();
+
+            if ( QVector3D::dotProduct (QVector3D::crossProduct (p1 - p0, projected - p0), normal) >= 0.0f &&
+                 QVector3D::dotProduct (QVector3D::crossProduct (p2 - p1, projected - p1), normal) >= 0.0f &&
+                 QVector3D::dotProduct (QVector3D::crossProduct (p0 - p2, projected - p2), normal) >= 0.0f )
+              closest = qMin (closest, (projected - point).length ());
+          }
+      }
+
+    return closest;
+  }
+
+}
+
+/*
+ * Unit tests of the bounding volume hierarchy
+ */
+class HierarchyTest : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase ();
+
+  void intersect_data ();
+  void intersect ();
+  void findClosest_data ();
+  void findClosest ();
+
+private:
+  QTemporaryDir _directory;
+};
+
+/* Prepare test case */
+void HierarchyTest::initTestCase ()
+{
+  QVERIFY (_directory.isValid ());
+}
+
+/* Test data for the ray intersection test */
+void HierarchyTest::intersect_data ()
+{
+  QTest::addColumn<QString> ("path");
+
+  QTest::newRow ("grid") << Test::writeGridModel (_directory.path (), 24, false);
+  QTest::newRow ("horse") << ":/assets/models/horse/horse.obj";
+}
+
+/*
+ * Test ray intersections against intersecting all triangles
+ *
+ * Each hit must be the closest hit along the ray and a ray must not hit anything if
+ * all groups are excluded.
+ */
+void HierarchyTest::intersect ()
+{
+  QFETCH (QString, path);
+
+  static const int NUMBER_OF_RAYS = 1000;
+
+  GL::Data data (path, GL::Data::Loader::STREAMING, false);
+  GL::MeshPtr mesh (new GL::Mesh (&data));
+
+  GL::BoundingVolumeHierarchy hierarchy (mesh);
+  QVERIFY (hierarchy.getNumberOfNodes () > 0);
+
+  QBitArray no_groups (mesh->getGroups ().size ());
+
+  Test::Random random;
+  int hits = 0;
+
+  for (int i=0; i < NUMBER_OF_RAYS; ++i)
+    {
+      GL::Ray ray = createRay (random, data.getBoundingBox ());
+
+      GL::Hit hit;
+      bool found = hierarchy.intersect (ray, &hit);
+
+      float distance = 0.0f;
+      QCOMPARE (found, intersectAll (*mesh, ray, &distance));
+
+      if (found)
+        {
+          QVERIFY (qAbs (hit.getDistance () - distance) < 1e-4f);
+          QVERIFY ((hit.getPosition () - ray.getPoint (distance)).length () < 1e-4f);
+          QVERIFY (hit.getGroup () >= 0 && hit.getGroup () < mesh->getGroups ().size ());
+          ++hits;
+        }
+
+      QVERIFY (!hierarchy.intersect (ray, &hit, no_groups));
+    }
+
+  QVERIFY (hits > NUMBER_OF_RAYS / 10);
+}
+
+/* Test data for the closest point test */
+void HierarchyTest::findClosest_data ()
+{
+  intersect_data ();
+}
+
+/*
+ * Test closest point queries against testing all triangles
+ *
+ * The query points are spread over twice the model bounding box, so there are points
+ * inside and outside of the model. The batched query must match the single queries.
+ */
+void HierarchyTest::findClosest ()
+{
+  QFETCH (QString, path);
+
+  static const int NUMBER_OF_POINTS = 1000;
+
+  GL::Data data (path, GL::Data::Loader::STREAMING, false);
+  GL::MeshPtr mesh (new GL::Mesh (&data));
+
+  GL::BoundingVolumeHierarchy hierarchy (mesh);
+
+  const GL::Data::Cube& box = data.getBoundingBox ();
+  QVector3D center = (box.first + box.second) / 2;
+  QVector3D extent = box.second - box.first;
+
+  Test::Random random;
+
+  QVector<QVector3D> points;
+  for (int i=0; i < NUMBER_OF_POINTS; ++i)
+    points.push_back (random.nextVector (center - extent, center + extent));
+
+  QVector<GL::Hit> hits = hierarchy.findClosest (points);
+  QCOMPARE (hits.size (), points.size ());
+
+  for (int i=0; i < points.size (); ++i)
+    {
+      const GL::Hit& hit = hits[i];
+      QVERIFY (hit.isValid ());
+
+      float distance = findClosestAll (*mesh, points[i]);
+
+      QVERIFY (qAbs (hit.getDistance () - distance) < 1e-4f);
+      QVERIFY (qAbs ((hit.getPosition () - points[i]).length () - distance) < 1e-4f);
+      QVERIFY (hit.getGroup () >= 0 && hit.getGroup () < mesh->getGroups ().size ());
+
+      GL::Hit single;
+      QVERIFY (hierarchy.findClosest (points[i], &single));
+      QCOMPARE (single.getTriangle (), hit.getTriangle ());
+      QCOMPARE (single.getPosition (), hit.getPosition ());
+    }
+
+  GL::Hit hit;
+  QVERIFY (!hierarchy.findClosest (points.front (), &hit, QBitArray (mesh->getGroups ().size ())));
+}
+
+QTEST_MAIN (HierarchyTest)
+
+#include "tst_hierarchy.moc"
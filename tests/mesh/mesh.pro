@@ -0,0 +1,12 @@
+#
+# mesh.pro - Unit tests of the render ready mesh
+#
+TEMPLATE = app
+TARGET = tst_mesh
+
+CONFIG += testcase
+
+include (../tests.pri)
+
+SOURCES += \
+    tst_mesh.cpp
@@ -0,0 +1,413 @@
+/*
+ * tst_mesh.cpp - Unit tests of the render ready mesh
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "HIPTestModels.h"
+#include "gl/HIPGLData.h"
+#include "gl/HIPGLMesh.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QFileInfo>
+#include <QMatrix4x4>
+#include <QPair>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace HIP;
+
+namespace {
+
+  /* Append face point like 'v/t/n' with absolute or relative indices to the model content */
+  void writeIndex (QByteArray* content, Test::Random* random, int count, int max_back_reference)
+  {
+    int back = 1 + random->next (qMin (count, max_back_reference));
+
+    if (random->next (2) == 0)
+      *content += QByteArray::number (-back);
+    else
+      *content += QByteArray::number (count - back + 1);
+  }
+
+  /*
+   * Write OBJ model spanning several chunks of the parallel parser
+   *
+   * The parallel parser splits files into chunks of at least 256 KB. Vertices, normals and
+   * texture coordinates are written in small blocks between the faces. The faces reference
+   * them with absolute and relative indices reaching back over many blocks, so relative
+   * indices cross the chunk boundaries. Group and material statements are spread over the
+   * file, so groups continue across chunk boundaries, too. The faces use all point formats
+   * and include quads.
+   */
+  QString writeChunkedModel (const QString& directory)
+  {
+    static const int NUMBER_OF_BLOCKS = 2000;
+    static const int BLOCK_SIZE = 16;
+    static const int MAX_BACK_REFERENCE = 4000;
+
+    Test::Random random;
+
+    QByteArray content;
+    content += "o chunked\n";
+
+    int number_of_vertices = 0;
+    int number_of_normals = 0;
+    int number_of_textures = 0;
+
+    for (int block=0; block < NUMBER_OF_BLOCKS; ++block)
+      {
+        for (int i=0; i < BLOCK_SIZE; ++i)
+          {
+            content += "v " + QByteArray::number (random.nextDouble (-10.0, 10.0), 'f', 4) + " " +
+              QByteArray::number (random.nextDouble (-10.0, 10.0), 'f', 4) + " " +
+              QByteArray::number (random.nextDouble (-10.0, 10.0), 'f', 4) + "\n";
+            content += "vt " + QByteArray::number (random.nextDouble (0.0, 1.0), 'f', 4) + " " +
+              QByteArray::number (random.nextDouble (0.0, 1.0), 'f', 4) + "\n";
+          }
+
+        content += "vn " + QByteArray::number (random.nextDouble (-1.0, 1.0), 'f', 4) + " " +
+          QByteArray::number (random.nextDouble (-1.0, 1.0), 'f', 4) + " " +
+          QByteArray::number (random.nextDouble (-1.0, 1.0), 'f', 4) + "\n";
+
+        number_of_vertices += BLOCK_SIZE;
+        number_of_textures += BLOCK_SIZE;
+        number_of_normals += 1;
+
+        if (block % 37 == 0)
+          content += "g group_" + QByteArray::number (block / 37) + "\n";
+        if (block % 23 == 0)
+          content += "usemtl material_" + QByteArray::number (block % 5) + "\n";
+
+        for (int face=0; face < BLOCK_SIZE; ++face)
+          {
+            int format = (block + face) % 4;
+            int number_of_points = face % 5 == 0 ? 4 : 3;
+
+            content += "f";
+
+            for (int i=0; i < number_of_points; ++i)
+              {
+                content += " ";
+                writeIndex (&content, &random, number_of_vertices, MAX_BACK_REFERENCE);
+
+                //
+                // Formats 'v/t/n', 'v//n', 'v/t' and 'v'
+                //
+                if (format == 0 || format == 2)
+                  {
+                    content += "/";
+                    writeIndex (&content, &random, number_of_textures, MAX_BACK_REFERENCE);
+                  }
+                else if (format == 1)
+                  content += "/";
+
+                if (format == 0 || format == 1)
+                  {
+                    content += "/";
+                    writeIndex (&content, &random, number_of_normals, MAX_BACK_REFERENCE);
+                  }
+              }
+
+            content += "\n";
+          }
+      }
+
+    QString path = directory + "/chunked.obj";
+
+    QFile file (path);
+    if (!file.open (QIODevice::WriteOnly) || file.write (content) != content.size ())
+      qFatal ("Unable to write test model '%s'", qPrintable (path));
+
+    return path;
+  }
+
+  /* Compare vectors loaded by different parsers, which may round differently in the last digit */
+  template <class T>
+  bool isEqual (const QVector<T>& v0, const QVector<T>& v1)
+  {
+    if (v0.size () != v1.size ())
+      return false;
+
+    for (int i=0; i < v0.size (); ++i)
+      if ((v0[i] - v1[i]).length () > 1e-5f)
+        return false;
+
+    return true;
+  }
+
+}
+
+/*
+ * Unit tests of the render ready mesh
+ */
+class MeshTest : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase ();
+
+  void pointIndexMap ();
+  void deduplication_data ();
+  void deduplication ();
+  void transform ();
+  void loaders_data ();
+  void loaders ();
+
+private:
+  QTemporaryDir _directory;
+};
+
+/*
+ * Prepare test case
+ *
+ * The test mode keeps the model caches written while loading out of the user's cache.
+ */
+void MeshTest::initTestCase ()
+{
+  QStandardPaths::setTestModeEnabled (true);
+  QVERIFY (_directory.isValid ());
+}
+
+/*
+ * Test index assignment of the point hash map
+ *
+ * The points differ in single components only, including missing (-1) indices, and
+ * the map starts small so that it has to grow several times.
+ */
+void MeshTest::pointIndexMap ()
+{
+  GL::PointIndexMap map;
+
+  QList<GL::Point> points;
+  for (int v=-1; v < 20; ++v)
+    for (int n=-1; n < 5; ++n)
+      for (int t=-1; t < 5; ++t)
+        points.push_back (GL::Point (v, n, t));
+
+  for (int i=0; i < points.size (); ++i)
+    {
+      bool inserted = false;
+      QCOMPARE (map.insert (points[i], &inserted), i);
+      QVERIFY (inserted);
+    }
+
+  QCOMPARE (map.size (), points.size ());
+  QVERIFY (map.capacity () >= points.size ());
+
+  for (int i=0; i < points.size (); ++i)
+    {
+      bool inserted = true;
+      QCOMPARE (map.insert (points[i], &inserted), i);
+      QVERIFY (!inserted);
+      QCOMPARE (map.find (points[i]), i);
+    }
+
+  QCOMPARE (map.size (), points.size ());
+  QCOMPARE (map.find (GL::Point (20, 0, 0)), -1);
+  QCOMPARE (map.find (GL::Point (0, 5, 0)), -1);
+  QCOMPARE (map.find (GL::Point (0, 0, 5)), -1);
+}
+
+/* Test data for the deduplication test */
+void MeshTest::deduplication_data ()
+{
+  QTest::addColumn<bool> ("split_normals");
+  QTest::addColumn<bool> ("optimize");
+
+  QTest::newRow ("shared normals") << false << false;
+  QTest::newRow ("split normals") << true << false;
+  QTest::newRow ("split normals, optimized") << true << true;
+}
+
+/*
+ * Test deduplication of the face points
+ *
+ * Each unique (vertex, normal, texture) triple of the model must result in exactly one
+ * mesh vertex, and each triangle corner must reference a vertex with its attributes.
+ */
+void MeshTest::deduplication ()
+{
+  QFETCH (bool, split_normals);
+  QFETCH (bool, optimize);
+
+  static const int GRID_SIZE = 16;
+
+  QString path = Test::writeGridModel (_directory.path (), GRID_SIZE, split_normals);
+  GL::Data data (path, GL::Data::Loader::STREAMING, false);
+
+  GL::Mesh mesh (&data, optimize);
+
+  //
+  // Unique face points of the model
+  //
+  QSet<QPair<int, QPair<int, int> > > triples;
+  int number_of_indices = 0;
+
+  foreach (const GL::GroupPtr& group, data.getGroups ())
+    for (int i=0; i < group->getNumberOfTriangles () * 3; ++i)
+      {
+        GL::Point point = group->getPoint (i / 3, i % 3);
+        triples.insert (qMakePair (point.getVertexIndex (), qMakePair (point.getNormalIndex (), point.getTextureIndex ())));
+        ++number_of_indices;
+      }
+
+  QCOMPARE (mesh.getNumberOfIndices (), number_of_indices);
+  QCOMPARE (mesh.getNumberOfVertices (), triples.size ());
+
+  if (split_normals)
+    QVERIFY (mesh.getNumberOfVertices () > data.getVertices ().size ());
+  else
+    QCOMPARE (mesh.getNumberOfVertices (), data.getVertices ().size ());
+
+  //
+  // No two mesh vertices may be equal
+  //
+  QSet<QByteArray> vertices;
+  for (int i=0; i < mesh.getNumberOfVertices (); ++i)
+    vertices.insert (QByteArray (reinterpret_cast<const char*> (mesh.getVertexData () + i), sizeof (GL::VertexData)));
+
+  QCOMPARE (vertices.size (), mesh.getNumberOfVertices ());
+
+  //
+  // Each corner references a vertex with its original attributes. Optimizing reorders the
+  // triangles within the groups, so the triangles are compared as sets per group.
+  //
+  QCOMPARE (mesh.getGroups ().size (), data.getGroups ().size ());
+
+  for (int i=0; i < data.getGroups ().size (); ++i)
+    {
+      const GL::GroupPtr& group = data.getGroups ()[i];
+      const GL::MeshGroup& mesh_group = mesh.getGroups ()[i];
+
+      QCOMPARE (mesh_group.getNumberOfIndices (), group->getNumberOfTriangles () * 3);
+
+      QSet<QByteArray> expected;
+      QSet<QByteArray> found;
+
+      for (int j=0; j < group->getNumberOfTriangles (); ++j)
+        {
+          QByteArray expected_triangle;
+          QByteArray found_triangle;
+
+          for (int k=0; k < 3; ++k)
+            {
+              GL::Point point = group->getPoint (j, k);
+              GL::VertexData vertex (data.getVertices ()[point.getVertexIndex ()],
+                                     data.getNormals ()[point.getNormalIndex ()],
+                                     data.getTextures ()[point.getTextureIndex ()]);
+
+              expected_triangle += QByteArray (reinterpret_cast<const char*> (&vertex), sizeof (GL::VertexData));
+
+              GLuint index = mesh.getIndexData ()[mesh_group.getFirstIndex () + j * 3 + k];
+              QVERIFY (index < GLuint (mesh.getNumberOfVertices ()));
+
+              found_triangle += QByteArray (reinterpret_cast<const char*> (mesh.getVertexData () + index),
+                                            sizeof (GL::VertexData));
+            }
+
+          expected.insert (expected_triangle);
+          found.insert (found_triangle);
+        }
+
+      QCOMPARE (found, expected);
+    }
+}
+
+/*
+ * Test the transformation from file coordinates into model coordinates
+ *
+ * The transformation must map the grid vertices as written into the OBJ file onto the
+ * loaded vertices and must be kept in the mesh cache.
+ */
+void MeshTest::transform ()
+{
+  static const int GRID_SIZE = 8;
+
+  QString path = Test::writeGridModel (_directory.path (), GRID_SIZE, false);
+  GL::Data data (path, GL::Data::Loader::STREAMING, true);
+
+  QCOMPARE (data.getVertices ().size (), (GRID_SIZE + 1) * (GRID_SIZE + 1));
+
+  for (int y=0; y <= GRID_SIZE; ++y)
+    for (int x=0; x <= GRID_SIZE; ++x)
+      {
+        double u = double (x) / GRID_SIZE;
+        double v = double (y) / GRID_SIZE;
+
+        QVector3D position = data.getTransform ().map (QVector3D (u, v, u * (1.0 - u) * v * (1.0 - v)));
+        QVERIFY ((position - data.getVertices ()[y * (GRID_SIZE + 1) + x]).length () < 1e-5f);
+      }
+
+  GL::Data cached (path, GL::Data::Loader::STREAMING, true);
+
+  QVERIFY (cached.getVertices ().isEmpty ());
+  QVERIFY (cached.getTransform () == data.getTransform ());
+}
+
+/* Test data for the loader test */
+void MeshTest::loaders_data ()
+{
+  QTest::addColumn<QString> ("path");
+
+  QTest::newRow ("horse") << QString (":/assets/models/horse/horse.obj");
+  QTest::newRow ("generated, multiple chunks") << writeChunkedModel (_directory.path ());
+}
+
+/*
+ * Test that all loaders produce the same model data
+ *
+ * The text based parser is the reference. The parallel parser splits the generated model
+ * into several chunks, which have to be stitched together with the relative indices and
+ * the group and material state resolved as in a single pass.
+ */
+void MeshTest::loaders ()
+{
+  QFETCH (QString, path);
+
+  static const int MIN_CHUNK_SIZE = 256 * 1024;
+
+  GL::Data reference (path, GL::Data::Loader::TEXT, false);
+
+  if (!path.startsWith (':'))
+    {
+      QVERIFY (QFileInfo (path).size () > 4 * MIN_CHUNK_SIZE);
+      QVERIFY (reference.getGroups ().size () > 1);
+    }
+
+  GL::Data::Loader_t loaders[] = { GL::Data::Loader::STREAMING, GL::Data::Loader::PARALLEL };
+
+  for (int i=0; i < int (sizeof (loaders) / sizeof (loaders[0])); ++i)
+    {
+      GL::Data data (path, loaders[i], false);
+
+      QCOMPARE (data.getName (), reference.getName ());
+      QCOMPARE (data.getMaterialLibrary (), reference.getMaterialLibrary ());
+
+      QVERIFY (isEqual (data.getVertices (), reference.getVertices ()));
+      QVERIFY (isEqual (data.getNormals (), reference.getNormals ()));
+      QVERIFY (isEqual (data.getTextures (), reference.getTextures ()));
+
+      QCOMPARE (data.getGroups ().size (), reference.getGroups ().size ());
+
+      for (int j=0; j < data.getGroups ().size (); ++j)
+        {
+          const GL::Group& group = *data.getGroups ()[j];
+          const GL::Group& reference_group = *reference.getGroups ()[j];
+
+          QCOMPARE (group.getName (), reference_group.getName ());
+          QCOMPARE (group.getMaterial (), reference_group.getMaterial ());
+          QCOMPARE (group.getVertexIndices (), reference_group.getVertexIndices ());
+          QCOMPARE (group.getNormalIndices (), reference_group.getNormalIndices ());
+          QCOMPARE (group.getTextureIndices (), reference_group.getTextureIndices ());
+        }
+    }
+}
+
+QTEST_MAIN (MeshTest)
+
+#include "tst_mesh.moc"
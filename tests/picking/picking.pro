@@ -0,0 +1,12 @@
+#
+# picking.pro - Unit tests of the pick requests
+#
+TEMPLATE = app
+TARGET = tst_picking
+
+CONFIG += testcase
+
+include (../tests.pri)
+
+SOURCES += \
+    tst_picking.cpp
@@ -0,0 +1,153 @@
+/*
+ * tst_picking.cpp - Unit tests of the pick requests
+ *
+ * Frank Blankenburg, Mar. 2015
+ */
+
+#include "gl/HIPGLPickBuffer.h"
+
+#include <QtTest>
+
+using namespace HIP;
+
+/*
+ * Unit tests of the pick requests
+ *
+ * The pick buffer itself needs a GL context. The picks are created here as the
+ * buffer returns them: with the position and the tag of the read request.
+ */
+class PickingTest : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void hover ();
+  void click ();
+  void hoverAfterClick ();
+  void hoverAtClickPosition ();
+  void repeatedClick ();
+};
+
+/* Hover requests replace each other and are never answered as a click */
+void PickingTest::hover ()
+{
+  GL::PickRequests requests;
+  QVERIFY (!requests.hasRequest ());
+
+  requests.requestHover (QPoint (10, 10));
+  requests.requestHover (QPoint (20, 20));
+  QVERIFY (requests.hasRequest ());
+
+  QPoint position;
+  int tag = -1;
+
+  QVERIFY (requests.takeRequest (&position, &tag));
+  QCOMPARE (position, QPoint (20, 20));
+  QVERIFY (!requests.hasRequest ());
+  QVERIFY (!requests.takeRequest (&position, &tag));
+
+  Qt::KeyboardModifiers modifiers;
+  QVERIFY (!requests.isClick (GL::PickBuffer::Pick (GL::PickBuffer::Type::PIN, 0, position, tag), &modifiers));
+}
+
+/* A click is answered exactly once */
+void PickingTest::click ()
+{
+  GL::PickRequests requests;
+  requests.requestClick (QPoint (10, 10), Qt::ControlModifier);
+
+  QPoint position;
+  int tag = 0;
+
+  QVERIFY (requests.takeRequest (&position, &tag));
+  QCOMPARE (position, QPoint (10, 10));
+
+  GL::PickBuffer::Pick pick (GL::PickBuffer::Type::PIN, 0, position, tag);
+  Qt::KeyboardModifiers modifiers = Qt::NoModifier;
+
+  QVERIFY (requests.isClick (pick, &modifiers));
+  QCOMPARE (modifiers, Qt::KeyboardModifiers (Qt::ControlModifier));
+  QVERIFY (!requests.isClick (pick, &modifiers));
+}
+
+/* A mouse move before the next frame does not replace the click */
+void PickingTest::hoverAfterClick ()
+{
+  GL::PickRequests requests;
+  requests.requestClick (QPoint (10, 10), Qt::NoModifier);
+  requests.requestHover (QPoint (30, 30));
+
+  QPoint click_position;
+  int click_tag = 0;
+
+  QVERIFY (requests.takeRequest (&click_position, &click_tag));
+  QCOMPARE (click_position, QPoint (10, 10));
+  QVERIFY (requests.hasRequest ());
+
+  QPoint hover_position;
+  int hover_tag = 0;
+
+  QVERIFY (requests.takeRequest (&hover_position, &hover_tag));
+  QCOMPARE (hover_position, QPoint (30, 30));
+
+  Qt::KeyboardModifiers modifiers;
+  QVERIFY (!requests.isClick (GL::PickBuffer::Pick (GL::PickBuffer::Type::NONE, -1, hover_position, hover_tag), &modifiers));
+  QVERIFY (requests.isClick (GL::PickBuffer::Pick (GL::PickBuffer::Type::NONE, -1, click_position, click_tag), &modifiers));
+}
+
+/*
+ * A hover pick at the clicked position is no click
+ *
+ * Regression: the click has been matched by position, so a hover pick at the clicked
+ * pixel fired a click after the click pick had been lost.
+ */
+void PickingTest::hoverAtClickPosition ()
+{
+  GL::PickRequests requests;
+  requests.requestClick (QPoint (10, 10), Qt::NoModifier);
+
+  QPoint position;
+  int tag = 0;
+
+  QVERIFY (requests.takeRequest (&position, &tag));
+
+  requests.requestHover (QPoint (10, 10));
+
+  QPoint hover_position;
+  int hover_tag = 0;
+
+  QVERIFY (requests.takeRequest (&hover_position, &hover_tag));
+  QCOMPARE (hover_position, position);
+
+  Qt::KeyboardModifiers modifiers;
+  QVERIFY (!requests.isClick (GL::PickBuffer::Pick (GL::PickBuffer::Type::PIN, 0, hover_position, hover_tag), &modifiers));
+}
+
+/* A new click drops the answer of a previous click which is still being read */
+void PickingTest::repeatedClick ()
+{
+  GL::PickRequests requests;
+  requests.requestClick (QPoint (10, 10), Qt::NoModifier);
+
+  QPoint first_position;
+  int first_tag = 0;
+
+  QVERIFY (requests.takeRequest (&first_position, &first_tag));
+
+  requests.requestClick (QPoint (20, 20), Qt::ShiftModifier);
+
+  QPoint second_position;
+  int second_tag = 0;
+
+  QVERIFY (requests.takeRequest (&second_position, &second_tag));
+  QVERIFY (first_tag != second_tag);
+
+  Qt::KeyboardModifiers modifiers = Qt::NoModifier;
+  QVERIFY (!requests.isClick (GL::PickBuffer::Pick (GL::PickBuffer::Type::PIN, 0, first_position, first_tag), &modifiers));
+  QVERIFY (requests.isClick (GL::PickBuffer::Pick (GL::PickBuffer::Type::PIN, 1, second_position, second_tag), &modifiers));
+  QCOMPARE (modifiers, Qt::KeyboardModifiers (Qt::ShiftModifier));
+}
+
+QTEST_MAIN (PickingTest)
+
+#include "tst_picking.moc"
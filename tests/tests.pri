@@ -0,0 +1,47 @@
+#
+# tests.pri - Common settings of the unit test and benchmark projects
+#
+# The application sources except the user interface are compiled into each
+# executable. The application resources give access to the bundled models.
+#
+QT += testlib
+QT += gui
+QT += xml
+QT += qml
+QT += concurrent
+
+CONFIG += console
+CONFIG -= app_bundle
+
+HIP_ROOT = $$PWD/..
+
+INCLUDEPATH += $$HIP_ROOT
+INCLUDEPATH += $$PWD/common
+
+SOURCES += \
+    $$HIP_ROOT/core/hip_exception.cpp \
+    $$HIP_ROOT/core/hip_tools.cpp \
+    $$HIP_ROOT/database/hip_database.cpp \
+    $$HIP_ROOT/database/hip_database_model.cpp \
+    $$HIP_ROOT/database/hip_database_filter_index.cpp \
+    $$HIP_ROOT/database/hip_database_text_index.cpp \
+    $$HIP_ROOT/database/hip_database_snapshot.cpp \
+    $$HIP_ROOT/database/hip_database_spatial_index.cpp \
+    $$HIP_ROOT/gl/hip_gl_data.cpp \
+    $$HIP_ROOT/gl/hip_gl_mesh.cpp \
+    $$HIP_ROOT/gl/hip_gl_mesh_cache.cpp \
+    $$HIP_ROOT/gl/hip_gl_mesh_optimizer.cpp \
+    $$HIP_ROOT/gl/hip_gl_bounds.cpp \
+    $$HIP_ROOT/gl/hip_gl_bounding_volume_hierarchy.cpp \
+    $$HIP_ROOT/gl/hip_gl_sparse_matrix.cpp \
+    $$HIP_ROOT/gl/hip_gl_geodesics.cpp \
+    $$HIP_ROOT/gl/hip_gl_pick_buffer.cpp \
+    $$PWD/common/hip_test_models.cpp
+
+HEADERS += \
+    $$HIP_ROOT/database/HIPDatabase.h \
+    $$HIP_ROOT/database/HIPDatabaseModel.h \
+    $$PWD/common/HIPTestModels.h
+
+RESOURCES += \
+    $$HIP_ROOT/hippopunktur.qrc
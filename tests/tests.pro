@@ -0,0 +1,15 @@
+#
+# tests.pro - Unit tests and benchmarks
+#
+# The unit tests are run with 'make check'. The benchmarks are built, but not
+# run by 'make check'. Run them directly, e.g. 'bench_mesh -iterations 5'.
+#
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    mesh \
+    database \
+    hierarchy \
+    geodesics \
+    picking \
+    benchmarks